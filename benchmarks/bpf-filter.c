@@ -0,0 +1,217 @@
+/* Measure how fast libbpf runs packet filters.
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+/* Reads up to COUNT Ethernet frames (10000 by default) from FILE, a
+   capture in pcap format, and runs each of two filters on all of them
+   ROUNDS times (100 by default), as eth-multiplexer does for every
+   frame it receives: the one pfinet sets, which only looks at the
+   Ethernet type, and one accepting TCP segments to or from port 80,
+   which has to be interpreted.  Then the rate is printed for each:
+
+     tcpdump -i eth0 -w /tmp/eth0.pcap -c 10000
+     bpf-filter /tmp/eth0.pcap  */
+
+#include <errno.h>
+#include <error.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <mach.h>
+#include <bpf_impl.h>
+
+#define USAGE "Usage: %s [-c COUNT] [-n ROUNDS] FILE"
+
+#define ETH_HLEN 14
+#define FRAME_MAX (ETH_HLEN + NET_RCV_MAX)
+
+static struct bpf_insn ether_filter[] =
+{
+  {NETF_IN|NETF_BPF, 0, 0, 0},
+  {BPF_LD|BPF_H|BPF_ABS, 0, 0, 12},		/* Ethernet type */
+  {BPF_JMP|BPF_JEQ|BPF_K, 2, 0, 0x0806},	/* ARP */
+  {BPF_JMP|BPF_JEQ|BPF_K, 1, 0, 0x0800},	/* IPv4 */
+  {BPF_JMP|BPF_JEQ|BPF_K, 0, 1, 0x86DD},	/* IPv6 */
+  {BPF_RET|BPF_K, 0, 0, 1500},
+  {BPF_RET|BPF_K, 0, 0, 0},
+};
+
+static struct bpf_insn http_filter[] =
+{
+  {NETF_IN|NETF_BPF, 0, 0, 0},
+  {BPF_LD|BPF_H|BPF_ABS, 0, 0, 12},		/* Ethernet type */
+  {BPF_JMP|BPF_JEQ|BPF_K, 0, 10, 0x0800},	/* IPv4 */
+  {BPF_LD|BPF_B|BPF_ABS, 0, 0, 23},		/* protocol */
+  {BPF_JMP|BPF_JEQ|BPF_K, 0, 8, 6},		/* TCP */
+  {BPF_LD|BPF_H|BPF_ABS, 0, 0, 20},		/* fragment offset */
+  {BPF_JMP|BPF_JSET|BPF_K, 6, 0, 0x1fff},
+  {BPF_LDX|BPF_MSH|BPF_B, 0, 0, 14},		/* IP header length */
+  {BPF_LD|BPF_H|BPF_IND, 0, 0, 14},		/* source port */
+  {BPF_JMP|BPF_JEQ|BPF_K, 2, 0, 80},
+  {BPF_LD|BPF_H|BPF_IND, 0, 0, 16},		/* destination port */
+  {BPF_JMP|BPF_JEQ|BPF_K, 0, 1, 80},
+  {BPF_RET|BPF_K, 0, 0, 1500},
+  {BPF_RET|BPF_K, 0, 0, 0},
+};
+
+struct pcap_file_header
+{
+  uint32_t magic;
+  uint16_t version_major, version_minor;
+  int32_t thiszone;
+  uint32_t sigfigs, snaplen, linktype;
+};
+
+struct pcap_record_header
+{
+  uint32_t ts_sec, ts_usec, caplen, len;
+};
+
+static char *frames;
+static unsigned int *frame_lens;
+static long nframes;
+
+static uint32_t
+swap32 (uint32_t x, int swap)
+{
+  return swap ? __builtin_bswap32 (x) : x;
+}
+
+/* Read at most COUNT Ethernet frames from the pcap file NAME.  */
+static void
+read_pcap (const char *name, long count)
+{
+  struct pcap_file_header fh;
+  struct pcap_record_header rh;
+  int swap;
+  FILE *f;
+
+  f = fopen (name, "r");
+  if (! f)
+    error (1, errno, "%s", name);
+  if (fread (&fh, sizeof fh, 1, f) != 1)
+    error (1, 0, "%s: Not a pcap file", name);
+  if (fh.magic == 0xa1b2c3d4 || fh.magic == 0xa1b23c4d)
+    swap = 0;
+  else if (fh.magic == 0xd4c3b2a1 || fh.magic == 0x4d3cb2a1)
+    swap = 1;
+  else
+    error (1, 0, "%s: Not a pcap file", name);
+  if (swap32 (fh.linktype, swap) != 1)
+    error (1, 0, "%s: Not an Ethernet capture", name);
+
+  frames = malloc ((size_t) count * FRAME_MAX);
+  frame_lens = malloc (count * sizeof *frame_lens);
+  if (! frames || ! frame_lens)
+    error (1, errno, "malloc");
+
+  while (nframes < count && fread (&rh, sizeof rh, 1, f) == 1)
+    {
+      char *frame = frames + nframes * FRAME_MAX;
+      unsigned int caplen = swap32 (rh.caplen, swap);
+      unsigned int keep = caplen < FRAME_MAX ? caplen : FRAME_MAX;
+
+      memset (frame, 0, FRAME_MAX);
+      if (fread (frame, 1, keep, f) != keep
+	  || fseek (f, caplen - keep, SEEK_CUR) < 0)
+	error (1, 0, "%s: Truncated", name);
+      if (keep < ETH_HLEN)
+	continue;
+      frame_lens[nframes++] = keep - ETH_HLEN;
+    }
+
+  fclose (f);
+  if (nframes == 0)
+    error (1, 0, "%s: No Ethernet frames", name);
+}
+
+/* Run FILTER of LEN instructions on all the frames ROUNDS times, and
+   print the rate.  */
+static void
+run_filter (const char *what, struct bpf_insn *filter, size_t len,
+	    long rounds)
+{
+  if_filter_list_t list;
+  net_rcv_port_t infp;
+  mach_port_t port;
+  struct timespec start, end;
+  long accepted = 0, i, j;
+  double secs;
+  error_t err;
+
+  err = mach_port_allocate (mach_task_self (), MACH_PORT_RIGHT_RECEIVE,
+			    &port);
+  if (err)
+    error (1, err, "mach_port_allocate");
+
+  queue_init (&list.if_rcv_port_list);
+  queue_init (&list.if_snd_port_list);
+  err = net_set_filter (&list, port, 0, (filter_t *) filter,
+			len * sizeof *filter / sizeof (filter_t));
+  if (err)
+    error (1, err, "net_set_filter");
+  infp = (net_rcv_port_t) queue_first (&list.if_rcv_port_list);
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < rounds; i++)
+    for (j = 0; j < nframes; j++)
+      {
+	char *frame = frames + j * FRAME_MAX;
+	net_hash_entry_t entp = 0, *hash_headp;
+
+	if (bpf_do_filter (infp, frame + ETH_HLEN, frame_lens[j], frame,
+			   ETH_HLEN, &hash_headp, &entp))
+	  accepted++;
+      }
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf ("%s: %ld of %ld frames accepted in %.3f s: %.0f frames/s\n",
+	  what, accepted / rounds, nframes, secs, nframes * rounds / secs);
+
+  destroy_filters (&list);
+}
+
+int
+main (int argc, char **argv)
+{
+  long count = 10000, rounds = 100;
+  int opt;
+
+  while ((opt = getopt (argc, argv, "c:n:")) != -1)
+    switch (opt)
+      {
+      case 'c': count = atol (optarg); break;
+      case 'n': rounds = atol (optarg); break;
+      default:
+	error (1, 0, USAGE, argv[0]);
+      }
+  if (optind != argc - 1 || count < 1 || rounds < 1)
+    error (1, 0, USAGE, argv[0]);
+
+  read_pcap (argv[optind], count);
+
+  run_filter ("Ethernet type", ether_filter,
+	      sizeof ether_filter / sizeof ether_filter[0], rounds);
+  run_filter ("TCP port 80", http_filter,
+	      sizeof http_filter / sizeof http_filter[0], rounds);
+
+  return 0;
+}
@@ -0,0 +1,474 @@
+/* A minimal ftp server, for benchmarking ftpfs without a network.
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+/* Serves the files below DIR to anyone connecting to PORT on the loopback
+   interface, speaking just enough of the protocol for ftpfs: passive mode,
+   directory listings in `ls -l' format or with MLSD and MLST, RETR and
+   REST.  Every transfer is
+   logged to stderr with the number of bytes actually sent, so that the
+   amount of data ftpfs fetches for some access pattern can be measured:
+
+     ftp-stand-in /some/dir &
+     settrans -a /tmp/ftp /hurd/ftpfs localhost:/
+     dd if=/tmp/ftp/big-file bs=64k skip=1000 count=1 of=/dev/null
+
+   With -n, REST is refused, and with -m, MLSD and MLST are, as some servers
+   do.  With -b, transfers are
+   throttled to the given number of bytes per second, to make the cost of
+   fetching too much visible.  */
+
+#include <errno.h>
+#include <error.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define CHUNK_SIZE	(64 * 1024)
+
+static const char *root;
+static int no_rest, no_mlsx;
+static long rate;
+
+/* State of one control connection.  */
+struct session
+{
+  FILE *in, *out;
+  char cwd[1024];
+  int pasv;			/* Listening socket for passive mode, or -1. */
+  off_t rest;			/* Offset given by REST for the next RETR.  */
+};
+
+static void
+reply (struct session *s, int code, const char *fmt, ...)
+{
+  va_list ap;
+
+  fprintf (s->out, "%d ", code);
+  va_start (ap, fmt);
+  vfprintf (s->out, fmt, ap);
+  va_end (ap);
+  fputs ("\r\n", s->out);
+  fflush (s->out);
+}
+
+/* Return the local path for the ftp path NAME in malloced storage, or 0 if
+   NAME tries to escape from ROOT.  */
+static char *
+local_path (struct session *s, const char *name)
+{
+  char *path;
+
+  if (! name || ! *name)
+    name = ".";
+  if (strstr (name, ".."))
+    return 0;
+  if (*name == '/')
+    asprintf (&path, "%s%s", root, name);
+  else
+    asprintf (&path, "%s%s/%s", root, s->cwd, name);
+  return path;
+}
+
+/* Accept the data connection for a transfer, or return -1.  */
+static int
+open_data (struct session *s)
+{
+  int data;
+
+  if (s->pasv < 0)
+    {
+      reply (s, 425, "Use PASV first");
+      return -1;
+    }
+  reply (s, 150, "Opening BINARY mode data connection");
+  data = accept (s->pasv, 0, 0);
+  close (s->pasv);
+  s->pasv = -1;
+  if (data < 0)
+    reply (s, 425, "Can't open data connection");
+  return data;
+}
+
+static void
+do_pasv (struct session *s)
+{
+  struct sockaddr_in addr;
+  socklen_t len = sizeof addr;
+  unsigned char *a = (unsigned char *) &addr.sin_addr;
+  unsigned char *p = (unsigned char *) &addr.sin_port;
+
+  if (s->pasv >= 0)
+    close (s->pasv);
+
+  memset (&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  s->pasv = socket (AF_INET, SOCK_STREAM, 0);
+  if (s->pasv < 0
+      || bind (s->pasv, (struct sockaddr *) &addr, sizeof addr) < 0
+      || listen (s->pasv, 1) < 0
+      || getsockname (s->pasv, (struct sockaddr *) &addr, &len) < 0)
+    {
+      reply (s, 425, "%s", strerror (errno));
+      return;
+    }
+
+  reply (s, 227, "Entering Passive Mode (%u,%u,%u,%u,%u,%u)",
+	 a[0], a[1], a[2], a[3], p[0], p[1]);
+}
+
+/* Print a line for the file PATH, called NAME, in `ls -l' format, or as
+   MLSx facts if MLSX is true.  */
+static void
+list_one (FILE *out, const char *path, const char *name, int mlsx)
+{
+  struct stat st;
+  char mode[11], date[20];
+
+  if (lstat (path, &st) < 0)
+    return;
+
+  if (mlsx)
+    {
+      strftime (date, sizeof date, "%Y%m%d%H%M%S", gmtime (&st.st_mtime));
+      fprintf (out, "type=%s;size=%lld;modify=%s;unix.mode=0%o; %s\r\n",
+	       S_ISDIR (st.st_mode) ? "dir" : "file", (long long) st.st_size,
+	       date, (unsigned) (st.st_mode & 07777), name);
+      return;
+    }
+
+  strcpy (mode, "----------");
+  if (S_ISDIR (st.st_mode))
+    mode[0] = 'd';
+  else if (S_ISLNK (st.st_mode))
+    mode[0] = 'l';
+  for (int i = 0; i < 9; i++)
+    if (st.st_mode & (0400 >> i))
+      mode[i + 1] = "rwxrwxrwx"[i];
+
+  strftime (date, sizeof date, "%b %e %Y", localtime (&st.st_mtime));
+  fprintf (out, "%s %3lu %-8s %-8s %10lld %s %s\r\n",
+	   mode, (unsigned long) st.st_nlink, "ftp", "ftp",
+	   (long long) st.st_size, date, name);
+}
+
+static void
+do_list (struct session *s, const char *arg, int mlsx)
+{
+  char *path;
+  struct stat st;
+  FILE *out;
+  int data;
+
+  /* Skip any ls flags.  */
+  while (arg && *arg == '-')
+    {
+      arg += strcspn (arg, " ");
+      arg += strspn (arg, " ");
+    }
+
+  path = local_path (s, arg);
+  if (! path || stat (path, &st) < 0)
+    {
+      reply (s, 550, "%s: %s", arg ?: ".", strerror (path ? errno : EACCES));
+      free (path);
+      return;
+    }
+
+  data = open_data (s);
+  if (data < 0)
+    {
+      free (path);
+      return;
+    }
+
+  out = fdopen (data, "w");
+  if (S_ISDIR (st.st_mode))
+    {
+      DIR *dir = opendir (path);
+      struct dirent *de;
+
+      while (dir && (de = readdir (dir)))
+	if (strcmp (de->d_name, ".") && strcmp (de->d_name, ".."))
+	  {
+	    char *entry;
+	    asprintf (&entry, "%s/%s", path, de->d_name);
+	    list_one (out, entry, de->d_name, mlsx);
+	    free (entry);
+	  }
+      if (dir)
+	closedir (dir);
+    }
+  else
+    list_one (out, path, arg, mlsx);
+  fclose (out);
+  free (path);
+
+  reply (s, 226, "Transfer complete");
+}
+
+static void
+do_retr (struct session *s, const char *arg)
+{
+  char *path = local_path (s, arg);
+  off_t offset = s->rest;
+  long long sent = 0;
+  char *buf;
+  int fd, data;
+
+  s->rest = 0;
+
+  if (! path)
+    {
+      reply (s, 550, "%s: %s", arg, strerror (EACCES));
+      return;
+    }
+  fd = open (path, O_RDONLY);
+  free (path);
+  if (fd < 0)
+    {
+      reply (s, 550, "%s: %s", arg, strerror (errno));
+      return;
+    }
+  if (offset > 0 && lseek (fd, offset, SEEK_SET) < 0)
+    {
+      reply (s, 550, "%s: %s", arg, strerror (errno));
+      close (fd);
+      return;
+    }
+
+  data = open_data (s);
+  if (data < 0)
+    {
+      close (fd);
+      return;
+    }
+
+  buf = malloc (CHUNK_SIZE);
+  for (;;)
+    {
+      ssize_t rd = read (fd, buf, CHUNK_SIZE), wr = 0;
+
+      if (rd <= 0)
+	break;
+      while (wr < rd)
+	{
+	  ssize_t n = write (data, buf + wr, rd - wr);
+	  if (n < 0)
+	    break;
+	  wr += n;
+	}
+      sent += wr;
+      if (wr < rd)
+	/* The client closed the data connection.  */
+	break;
+
+      if (rate > 0)
+	{
+	  struct timespec delay;
+	  long long ns = (long long) rd * 1000000000 / rate;
+	  delay.tv_sec = ns / 1000000000;
+	  delay.tv_nsec = ns % 1000000000;
+	  nanosleep (&delay, 0);
+	}
+    }
+  free (buf);
+  close (fd);
+  close (data);
+
+  fprintf (stderr, "RETR %s from %lld: %lld bytes\n",
+	   arg, (long long) offset, sent);
+  reply (s, 226, "Transfer complete");
+}
+
+static void
+serve (int control)
+{
+  struct session s = { .pasv = -1, .cwd = "" };
+  char line[1200];
+
+  s.in = fdopen (control, "r");
+  s.out = fdopen (dup (control), "w");
+
+  reply (&s, 220, "ftp-stand-in ready");
+
+  while (fgets (line, sizeof line, s.in))
+    {
+      char *cmd = line, *arg;
+
+      line[strcspn (line, "\r\n")] = '\0';
+      arg = strchr (line, ' ');
+      if (arg)
+	*arg++ = '\0';
+
+      if (strcasecmp (cmd, "user") == 0)
+	reply (&s, 331, "Any password will do");
+      else if (strcasecmp (cmd, "pass") == 0)
+	reply (&s, 230, "Logged in");
+      else if (strcasecmp (cmd, "syst") == 0)
+	reply (&s, 215, "UNIX Type: L8");
+      else if (strcasecmp (cmd, "type") == 0 || strcasecmp (cmd, "noop") == 0)
+	reply (&s, 200, "OK");
+      else if (strcasecmp (cmd, "pwd") == 0)
+	reply (&s, 257, "\"%s\"", *s.cwd ? s.cwd : "/");
+      else if (strcasecmp (cmd, "cwd") == 0 && arg)
+	{
+	  char *path = local_path (&s, arg);
+	  struct stat st;
+
+	  if (path && stat (path, &st) == 0 && S_ISDIR (st.st_mode))
+	    {
+	      size_t len = *arg == '/' ? 0 : strlen (s.cwd);
+
+	      if (strcmp (arg, "/") == 0)
+		s.cwd[0] = '\0';
+	      else if (len + 1 + strlen (arg) < sizeof s.cwd)
+		sprintf (s.cwd + len, "%s%s", *arg == '/' ? "" : "/", arg);
+	      reply (&s, 250, "OK");
+	    }
+	  else
+	    reply (&s, 550, "%s: Not a directory", arg);
+	  free (path);
+	}
+      else if (strcasecmp (cmd, "cdup") == 0)
+	{
+	  char *slash = strrchr (s.cwd, '/');
+	  if (slash)
+	    *slash = '\0';
+	  reply (&s, 250, "OK");
+	}
+      else if (strcasecmp (cmd, "pasv") == 0)
+	do_pasv (&s);
+      else if (strcasecmp (cmd, "rest") == 0 && arg && !no_rest)
+	{
+	  s.rest = strtoll (arg, 0, 10);
+	  reply (&s, 350, "Restarting at %lld", (long long) s.rest);
+	}
+      else if (strcasecmp (cmd, "retr") == 0 && arg)
+	do_retr (&s, arg);
+      else if (strcasecmp (cmd, "list") == 0 || strcasecmp (cmd, "nlst") == 0)
+	do_list (&s, arg, 0);
+      else if (strcasecmp (cmd, "mlsd") == 0 && !no_mlsx)
+	do_list (&s, arg, 1);
+      else if (strcasecmp (cmd, "mlst") == 0 && arg && !no_mlsx)
+	{
+	  char *path = local_path (&s, arg);
+
+	  if (path && access (path, F_OK) == 0)
+	    {
+	      fprintf (s.out, "250-Listing %s\r\n ", arg);
+	      list_one (s.out, path, arg, 1);
+	      reply (&s, 250, "End");
+	    }
+	  else
+	    reply (&s, 550, "%s: No such file or directory", arg);
+	  free (path);
+	}
+      else if (strcasecmp (cmd, "feat") == 0)
+	{
+	  fputs ("211-Features:\r\n", s.out);
+	  if (! no_mlsx)
+	    fputs (" MLST type*;size*;modify*;unix.mode*;\r\n", s.out);
+	  if (! no_rest)
+	    fputs (" REST STREAM\r\n", s.out);
+	  reply (&s, 211, "End");
+	}
+      else if (strcasecmp (cmd, "quit") == 0)
+	{
+	  reply (&s, 221, "Bye");
+	  break;
+	}
+      else
+	reply (&s, 500, "%s: Command not understood", cmd);
+    }
+
+  if (s.pasv >= 0)
+    close (s.pasv);
+  fclose (s.in);
+  fclose (s.out);
+}
+
+int
+main (int argc, char **argv)
+{
+  struct sockaddr_in addr;
+  int port = 21, opt, sock, one = 1;
+
+  while ((opt = getopt (argc, argv, "p:nmb:")) != -1)
+    switch (opt)
+      {
+      case 'p': port = atoi (optarg); break;
+      case 'n': no_rest = 1; break;
+      case 'm': no_mlsx = 1; break;
+      case 'b': rate = atol (optarg); break;
+      default:
+	error (1, 0, "Usage: %s [-p PORT] [-n] [-m] [-b BYTES-PER-SEC] DIR",
+	       argv[0]);
+      }
+  if (optind != argc - 1)
+    error (1, 0, "Usage: %s [-p PORT] [-n] [-m] [-b BYTES-PER-SEC] DIR", argv[0]);
+  root = argv[optind];
+
+  signal (SIGCHLD, SIG_IGN);
+  signal (SIGPIPE, SIG_IGN);
+
+  sock = socket (AF_INET, SOCK_STREAM, 0);
+  if (sock < 0)
+    error (1, errno, "socket");
+  setsockopt (sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+
+  memset (&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  addr.sin_port = htons (port);
+  if (bind (sock, (struct sockaddr *) &addr, sizeof addr) < 0)
+    error (1, errno, "bind");
+  if (listen (sock, 8) < 0)
+    error (1, errno, "listen");
+
+  for (;;)
+    {
+      int control = accept (sock, 0, 0);
+
+      if (control < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  error (1, errno, "accept");
+	}
+
+      if (fork () == 0)
+	{
+	  close (sock);
+	  serve (control);
+	  _exit (0);
+	}
+      close (control);
+    }
+}
@@ -0,0 +1,248 @@
+/* Measure what waiting on many sockets costs with io_select and with
+   io_notify_request.
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+/* Makes SOCKETS pairs of local sockets (400 by default), then COUNT
+   times (10000 by default) writes a byte into one of them and waits
+   for it to be readable among all of them, first with select, then
+   with one io_notify_request for each socket and a port receiving
+   io_ready, re-arming only the socket that was ready.  Then the rate
+   of wakeups is printed for both.  Before that, both ends of the first
+   pair are registered on the one port, to check that neither takes the
+   place of the other:
+
+     io-notify -n 10000 -s 400  */
+
+#include <errno.h>
+#include <error.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <hurd.h>
+#include <hurd/io.h>
+#include "io_notify_U.h"
+#include "io_ready_S.h"
+
+#define USAGE "Usage: %s [-n COUNT] [-s SOCKETS]"
+
+static int (*pairs)[2];
+static long nsockets = 400;
+static long count = 10000;
+static long ready_cookie = -1;
+static int ready_type;
+
+static double
+elapsed (struct timespec *start)
+{
+  struct timespec end;
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Make socket number I readable.  */
+static void
+poke (long i)
+{
+  if (write (pairs[i][1], "x", 1) != 1)
+    error (1, errno, "write");
+}
+
+/* Check that socket READY is number I, and read from it.  */
+static void
+drain (long i, long ready)
+{
+  char c;
+
+  if (ready != i)
+    error (1, 0, "socket %ld ready, expected %ld", ready, i);
+  if (read (pairs[i][0], &c, 1) != 1)
+    error (1, errno, "read");
+}
+
+static double
+run_select (void)
+{
+  struct timespec start;
+  fd_set fds;
+  long i, j;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < count; i++)
+    {
+      long want = random () % nsockets, ready = -1;
+
+      poke (want);
+      FD_ZERO (&fds);
+      for (j = 0; j < nsockets; j++)
+	FD_SET (pairs[j][0], &fds);
+      if (select (FD_SETSIZE, &fds, NULL, NULL, NULL) < 0)
+	error (1, errno, "select");
+      for (j = 0; j < nsockets; j++)
+	if (FD_ISSET (pairs[j][0], &fds))
+	  ready = j;
+      drain (want, ready);
+    }
+  return elapsed (&start);
+}
+
+kern_return_t
+S_io_ready (mach_port_t notify, natural_t cookie, int select_type)
+{
+  ready_cookie = cookie;
+  ready_type = select_type;
+  return 0;
+}
+
+/* Register PORT for SELECT_TYPE on FD, with COOKIE.  */
+static void
+notify_request (int fd, mach_port_t port, int select_type, long cookie)
+{
+  error_t err;
+
+  err = HURD_DPORT_USE (fd, io_notify_request (port, port,
+					       MACH_MSG_TYPE_MAKE_SEND,
+					       select_type, cookie));
+  if (err)
+    error (1, err, "io_notify_request");
+}
+
+/* Receive one io_ready on PORT, waiting at most a second, and check that
+   it is for COOKIE and SELECT_TYPE.  */
+static void
+receive_ready (mach_port_t port, long cookie, int select_type)
+{
+  union
+  {
+    mig_reply_header_t reply;
+    char buf[256];
+  } in, out;
+  error_t err;
+
+  err = mach_msg (&in.reply.Head, MACH_RCV_MSG | MACH_RCV_TIMEOUT, 0,
+		  sizeof in, port, 1000, MACH_PORT_NULL);
+  if (err == MACH_RCV_TIMED_OUT)
+    error (1, 0, "No io_ready for %ld", cookie);
+  if (err)
+    error (1, err, "mach_msg");
+  if (! io_ready_server (&in.reply.Head, &out.reply.Head))
+    error (1, 0, "Unexpected message %d", in.reply.Head.msgh_id);
+  if (ready_cookie != cookie || ready_type != select_type)
+    error (1, 0, "io_ready for %ld (%#x), expected %ld (%#x)",
+	   ready_cookie, ready_type, cookie, select_type);
+}
+
+/* Register both ends of the first pair on PORT: the reading end of one
+   shares its pipe with the writing end of the other, and a registration
+   of one end must not replace or cancel that of the other.  */
+static void
+check_both_ends (mach_port_t port)
+{
+  char c;
+
+  notify_request (pairs[0][0], port, SELECT_READ, 0);
+  notify_request (pairs[0][1], port, SELECT_READ | SELECT_WRITE, 1);
+  receive_ready (port, 1, SELECT_WRITE);
+
+  if (write (pairs[0][1], "x", 1) != 1)
+    error (1, errno, "write");
+  receive_ready (port, 0, SELECT_READ);
+  if (read (pairs[0][0], &c, 1) != 1)
+    error (1, errno, "read");
+
+  notify_request (pairs[0][1], port, SELECT_READ, 1);
+  if (write (pairs[0][0], "x", 1) != 1)
+    error (1, errno, "write");
+  receive_ready (port, 1, SELECT_READ);
+  if (read (pairs[0][1], &c, 1) != 1)
+    error (1, errno, "read");
+
+  /* Leave only the reading end of the pair registered.  */
+  notify_request (pairs[0][1], port, 0, 1);
+}
+
+static double
+run_notify (void)
+{
+  struct timespec start;
+  mach_port_t port;
+  error_t err;
+  long i;
+
+  err = mach_port_allocate (mach_task_self (), MACH_PORT_RIGHT_RECEIVE,
+			    &port);
+  if (err)
+    error (1, err, "mach_port_allocate");
+
+  check_both_ends (port);
+
+  for (i = 0; i < nsockets; i++)
+    notify_request (pairs[i][0], port, SELECT_READ, i);
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < count; i++)
+    {
+      long want = random () % nsockets;
+
+      poke (want);
+      receive_ready (port, want, SELECT_READ);
+      drain (want, ready_cookie);
+      notify_request (pairs[want][0], port, SELECT_READ, want);
+    }
+  return elapsed (&start);
+}
+
+int
+main (int argc, char **argv)
+{
+  double secs;
+  long i;
+  int opt;
+
+  while ((opt = getopt (argc, argv, "n:s:")) != -1)
+    switch (opt)
+      {
+      case 'n': count = atol (optarg); break;
+      case 's': nsockets = atol (optarg); break;
+      default:
+	error (1, 0, USAGE, argv[0]);
+      }
+  if (optind != argc || count < 1 || nsockets < 1)
+    error (1, 0, USAGE, argv[0]);
+  if (nsockets * 2 + 3 > FD_SETSIZE)
+    error (1, 0, "At most %d sockets", (FD_SETSIZE - 3) / 2);
+
+  pairs = malloc (nsockets * sizeof *pairs);
+  if (! pairs)
+    error (1, errno, "malloc");
+  for (i = 0; i < nsockets; i++)
+    if (socketpair (AF_LOCAL, SOCK_STREAM, 0, pairs[i]) < 0)
+      error (1, errno, "socketpair");
+
+  secs = run_select ();
+  printf ("select: %ld wakeups on %ld sockets in %.3f s: %.0f wakeups/s\n",
+	  count, nsockets, secs, count / secs);
+  secs = run_notify ();
+  printf ("io_notify: %ld wakeups on %ld sockets in %.3f s: %.0f wakeups/s\n",
+	  count, nsockets, secs, count / secs);
+
+  return 0;
+}
@@ -0,0 +1,199 @@
+/* Measure how fast a TCP/IP stack receives packets.
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+/* Writes COUNT UDP datagrams of SIZE bytes (100000 of 18 by default)
+   to DEVICE, as fast as it can, in Ethernet frames for MAC and
+   ADDRESS, while reading them from a socket bound to PORT; then the
+   rates of both are printed.  DEVICE and the interface of the stack
+   under test are best two virtual interfaces of eth-multiplexer:
+
+     settrans -a /dev/eth0m /hurd/eth-multiplexer -i /dev/eth0
+     settrans -a /servers/socket/2 /hurd/pfinet -i /dev/eth0m/0 \
+       -a 10.0.0.1 -m 255.255.255.0
+     ifconfig /dev/eth0m/0		# for its MAC address
+     net-rx /dev/eth0m/1 52:54:xx:xx:xx:xx 10.0.0.1 9000  */
+
+#include <errno.h>
+#include <error.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <net/ethernet.h>
+#include <sys/socket.h>
+#include <hurd.h>
+#include <device/device.h>
+
+#define USAGE "Usage: %s [-n COUNT] [-s SIZE] DEVICE MAC ADDRESS PORT"
+
+static device_t device;
+static char frame[ETH_FRAME_LEN];
+static size_t frame_len;
+static long count = 100000;
+static double send_secs;
+
+static double
+elapsed (struct timespec *start)
+{
+  struct timespec end;
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/* Build in FRAME a datagram of SIZE bytes from 192.0.2.1 to ADDR:PORT,
+   in an Ethernet frame for MAC.  */
+static void
+make_frame (const uint8_t *mac, struct in_addr addr, int port, size_t size)
+{
+  struct ether_header *eh = (struct ether_header *) frame;
+  struct iphdr *ip = (struct iphdr *) (eh + 1);
+  struct udphdr *udp = (struct udphdr *) (ip + 1);
+  uint16_t *w = (uint16_t *) ip;
+  uint32_t sum = 0;
+  int i;
+
+  memcpy (eh->ether_dhost, mac, ETH_ALEN);
+  memcpy (eh->ether_shost, "\x02\0\0\0\0\x01", ETH_ALEN);
+  eh->ether_type = htons (ETHERTYPE_IP);
+
+  ip->version = 4;
+  ip->ihl = sizeof *ip / 4;
+  ip->tot_len = htons (sizeof *ip + sizeof *udp + size);
+  ip->ttl = 64;
+  ip->protocol = IPPROTO_UDP;
+  ip->saddr = htonl (0xc0000201);
+  ip->daddr = addr.s_addr;
+  for (i = 0; i < sizeof *ip / 2; i++)
+    sum += w[i];
+  sum = (sum & 0xffff) + (sum >> 16);
+  ip->check = ~((sum & 0xffff) + (sum >> 16));
+
+  udp->uh_sport = htons (port);
+  udp->uh_dport = htons (port);
+  udp->uh_ulen = htons (sizeof *udp + size);
+  udp->uh_sum = 0;
+
+  frame_len = sizeof *eh + sizeof *ip + sizeof *udp + size;
+}
+
+static void *
+send_frames (void *arg)
+{
+  struct timespec start;
+  long i;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (i = 0; i < count; i++)
+    {
+      int written;
+      error_t err;
+
+      if (frame_len <= IO_INBAND_MAX)
+	err = device_write_inband (device, 0, 0, frame, frame_len, &written);
+      else
+	err = device_write (device, 0, 0, frame, frame_len, &written);
+      if (err)
+	error (1, err, "device_write");
+    }
+  send_secs = elapsed (&start);
+
+  return NULL;
+}
+
+int
+main (int argc, char **argv)
+{
+  struct sockaddr_in sin = { .sin_family = AF_INET };
+  struct timeval timeout = { .tv_sec = 1 };
+  struct timespec start;
+  struct in_addr addr;
+  uint8_t mac[ETH_ALEN];
+  size_t size = 18;
+  long received = 0;
+  double secs;
+  mach_port_t master;
+  pthread_t sender;
+  char buf[ETH_FRAME_LEN];
+  int opt, sock, port;
+  error_t err;
+
+  while ((opt = getopt (argc, argv, "n:s:")) != -1)
+    switch (opt)
+      {
+      case 'n': count = atol (optarg); break;
+      case 's': size = atol (optarg); break;
+      default:
+	error (1, 0, USAGE, argv[0]);
+      }
+  if (optind != argc - 4 || count < 1
+      || size > ETH_DATA_LEN - sizeof (struct iphdr) - sizeof (struct udphdr))
+    error (1, 0, USAGE, argv[0]);
+
+  if (sscanf (argv[optind + 1], "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
+	      &mac[0], &mac[1], &mac[2], &mac[3], &mac[4], &mac[5]) != 6)
+    error (1, 0, "%s: Invalid MAC address", argv[optind + 1]);
+  if (! inet_aton (argv[optind + 2], &addr))
+    error (1, 0, "%s: Invalid address", argv[optind + 2]);
+  port = atoi (argv[optind + 3]);
+  make_frame (mac, addr, port, size);
+
+  master = file_name_lookup (argv[optind], O_READ | O_WRITE, 0);
+  if (master == MACH_PORT_NULL)
+    error (1, errno, "%s", argv[optind]);
+  err = device_open (master, D_READ | D_WRITE, "eth", &device);
+  if (err)
+    error (1, err, "device_open");
+
+  sock = socket (AF_INET, SOCK_DGRAM, 0);
+  if (sock < 0)
+    error (1, errno, "socket");
+  sin.sin_port = htons (port);
+  if (bind (sock, (struct sockaddr *) &sin, sizeof sin) < 0)
+    error (1, errno, "bind");
+  if (setsockopt (sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout) < 0)
+    error (1, errno, "setsockopt");
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  err = pthread_create (&sender, NULL, send_frames, NULL);
+  if (err)
+    error (1, err, "pthread_create");
+
+  /* Until a second passes without any.  */
+  while (recv (sock, buf, sizeof buf, 0) >= 0)
+    received++;
+  if (errno != EAGAIN && errno != EWOULDBLOCK)
+    error (1, errno, "recv");
+  secs = elapsed (&start) - timeout.tv_sec;
+  pthread_join (sender, NULL);
+
+  printf ("sent %ld frames of %zu bytes in %.3f s: %.0f frames/s\n",
+	  count, frame_len, send_secs, count / send_secs);
+  printf ("received %ld datagrams (%.1f%%) in %.3f s: %.0f datagrams/s\n",
+	  received, 100.0 * received / count, secs, received / secs);
+
+  return 0;
+}
@@ -0,0 +1,345 @@
+/* Measure how fast a file can be read from an NFSv3 server over TCP.
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+/* Mounts EXPORT from the server on the loopback interface with MOUNT v3,
+   looks up FILE in it, and reads all of FILE with NFSv3 READs of SIZE
+   bytes (32 KB by default), keeping up to WINDOW of them (8 by default)
+   outstanding on a single TCP connection; then the rate is printed:
+
+     settrans -a /tmp/export /hurd/ext2fs /dev/hd0s5
+     nfsd /tmp/export &
+     nfs-read -w 1 /tmp/export big-file
+     nfs-read -w 16 -s 65536 /tmp/export big-file
+
+   The mount protocol is spoken on the same port as NFS, as nfsd serves
+   both there; use -m to give another one.  */
+
+#include <errno.h>
+#include <error.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#define NFS_PROGRAM	100003
+#define NFS_VERSION	3
+#define NFS3PROC_LOOKUP	3
+#define NFS3PROC_READ	6
+
+#define MOUNT_PROGRAM	100005
+#define MOUNT_VERSION	3
+#define MOUNTPROC_MNT	1
+
+#define AUTH_UNIX	1
+#define FHSIZE3		64
+
+/* Words in a fattr3.  */
+#define FATTR3_SIZE	21
+
+#define USAGE "Usage: %s [-p PORT] [-m MOUNT-PORT] [-w WINDOW] [-s SIZE] \
+EXPORT FILE"
+
+/* An NFSv3 file handle.  */
+struct fhandle
+{
+  size_t len;
+  char data[FHSIZE3];
+};
+
+static unsigned int next_xid = 1;
+
+/* Return a connection to PORT on the loopback interface.  */
+static int
+connect_to (int port)
+{
+  struct sockaddr_in addr;
+  int fd, one = 1;
+
+  fd = socket (AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    error (1, errno, "socket");
+  setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+  memset (&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+  addr.sin_port = htons (port);
+  if (connect (fd, (struct sockaddr *) &addr, sizeof addr) < 0)
+    error (1, errno, "connect to port %d", port);
+
+  return fd;
+}
+
+/* Write the header of a call of PROC in version VERS of PROG into P, and
+   return the next thing to come after it.  Its xid is returned in
+   *XID.  */
+static int *
+start_call (int *p, int prog, int vers, int proc, unsigned int *xid)
+{
+  *xid = next_xid++;
+  *(p++) = htonl (*xid);
+  *(p++) = htonl (0);			/* CALL */
+  *(p++) = htonl (2);			/* RPC version */
+  *(p++) = htonl (prog);
+  *(p++) = htonl (vers);
+  *(p++) = htonl (proc);
+
+  /* AUTH_UNIX credentials, with no machine name.  */
+  *(p++) = htonl (AUTH_UNIX);
+  *(p++) = htonl (5 * 4);
+  *(p++) = htonl (time (0));
+  *(p++) = htonl (0);
+  *(p++) = htonl (getuid ());
+  *(p++) = htonl (getgid ());
+  *(p++) = htonl (0);
+
+  *(p++) = htonl (0);			/* AUTH_NULL verifier */
+  *(p++) = htonl (0);
+
+  return p;
+}
+
+static int *
+encode_string (int *p, const char *s, size_t len)
+{
+  *(p++) = htonl (len);
+  memcpy (p, s, len);
+  if (len % 4)
+    memset ((char *) p + len, 0, 4 - len % 4);
+  return p + (len + 3) / 4;
+}
+
+/* Send the call from BUF to END on FD as a single record.  */
+static void
+send_call (int fd, int *buf, int *end)
+{
+  size_t len = (end - buf) * sizeof (int);
+  char *bp = (char *) (buf - 1);
+
+  buf[-1] = htonl (0x80000000 | len);
+  len += sizeof (int);
+  while (len)
+    {
+      ssize_t n = write (fd, bp, len);
+      if (n < 0)
+	error (1, errno, "write");
+      bp += n;
+      len -= n;
+    }
+}
+
+static void
+read_fully (int fd, void *buf, size_t len)
+{
+  char *bp = buf;
+
+  while (len)
+    {
+      ssize_t n = read (fd, bp, len);
+      if (n < 0)
+	error (1, errno, "read");
+      if (n == 0)
+	error (1, 0, "Server closed the connection");
+      bp += n;
+      len -= n;
+    }
+}
+
+/* Read a reply record from FD into BUF, of SIZE bytes, and return its
+   xid.  If the call was successful, return the results, following the
+   status, in *RESULTS; otherwise give up.  */
+static unsigned int
+receive_reply (int fd, int *buf, size_t size, int **results)
+{
+  size_t len = 0;
+  unsigned int mark;
+  int *p;
+
+  do
+    {
+      size_t frag;
+
+      read_fully (fd, &mark, sizeof mark);
+      mark = ntohl (mark);
+      frag = mark & 0x7fffffff;
+      if (len + frag > size)
+	error (1, 0, "Reply too large");
+      read_fully (fd, (char *) buf + len, frag);
+      len += frag;
+    }
+  while (! (mark & 0x80000000));
+
+  p = buf;
+  if (ntohl (p[1]) != 1 || ntohl (p[2]) != 0)	/* REPLY, MSG_ACCEPTED */
+    error (1, 0, "Call rejected");
+  p += 3;
+  p += 2 + (ntohl (p[1]) + 3) / 4;		/* Skip the verifier.  */
+  if (ntohl (*p) != 0)
+    error (1, 0, "Call failed: accept status %d", ntohl (*p));
+  p++;
+  if (ntohl (*p) != 0)
+    error (1, 0, "Call failed: status %d", ntohl (*p));
+  p++;
+
+  *results = p;
+  return ntohl (buf[0]);
+}
+
+static int *
+decode_fhandle (int *p, struct fhandle *fh)
+{
+  fh->len = ntohl (*p);
+  p++;
+  if (fh->len > FHSIZE3)
+    error (1, 0, "Bad file handle");
+  memcpy (fh->data, p, fh->len);
+  return p + (fh->len + 3) / 4;
+}
+
+/* Mount EXPORT from the mount server at FD, and return its handle in
+   *FH.  BUF is room for the messages.  */
+static void
+mount_export (int fd, int *buf, size_t size, const char *export,
+	      struct fhandle *fh)
+{
+  unsigned int xid;
+  int *p;
+
+  p = start_call (buf + 1, MOUNT_PROGRAM, MOUNT_VERSION, MOUNTPROC_MNT, &xid);
+  p = encode_string (p, export, strlen (export));
+  send_call (fd, buf + 1, p);
+
+  receive_reply (fd, buf, size, &p);
+  decode_fhandle (p, fh);
+}
+
+/* Look up the path NAME below the directory *FH at the server at FD,
+   one component at a time, and return its handle in *FH and its size
+   in *FILESIZE.  */
+static void
+lookup_path (int fd, int *buf, size_t size, char *name,
+	     struct fhandle *fh, unsigned long long *filesize)
+{
+  char *component, *save;
+
+  for (component = strtok_r (name, "/", &save);
+       component;
+       component = strtok_r (0, "/", &save))
+    {
+      unsigned int xid;
+      int *p;
+
+      p = start_call (buf + 1, NFS_PROGRAM, NFS_VERSION, NFS3PROC_LOOKUP,
+		      &xid);
+      p = encode_string (p, fh->data, fh->len);
+      p = encode_string (p, component, strlen (component));
+      send_call (fd, buf + 1, p);
+
+      receive_reply (fd, buf, size, &p);
+      p = decode_fhandle (p, fh);
+      if (! ntohl (*p))
+	error (1, 0, "%s: No attributes", component);
+      p++;
+      *filesize = ((unsigned long long) ntohl (p[5]) << 32) | ntohl (p[6]);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  int port = 2049, mount_port = 0, window = 8, opt, fd, outstanding;
+  size_t iosize = 32 * 1024, bufsize;
+  unsigned long long filesize = 0, offset = 0, received = 0;
+  struct timespec start, end;
+  struct fhandle fh;
+  double secs;
+  int *buf;
+
+  while ((opt = getopt (argc, argv, "p:m:w:s:")) != -1)
+    switch (opt)
+      {
+      case 'p': port = atoi (optarg); break;
+      case 'm': mount_port = atoi (optarg); break;
+      case 'w': window = atoi (optarg); break;
+      case 's': iosize = atol (optarg); break;
+      default:
+	error (1, 0, USAGE, argv[0]);
+      }
+  if (optind != argc - 2 || window < 1 || iosize < 1)
+    error (1, 0, USAGE, argv[0]);
+
+  bufsize = iosize + 4096;
+  buf = malloc (bufsize + sizeof (int));
+  if (! buf)
+    error (1, errno, "malloc");
+
+  fd = connect_to (mount_port ?: port);
+  mount_export (fd, buf, bufsize, argv[optind], &fh);
+  if (mount_port)
+    {
+      close (fd);
+      fd = connect_to (port);
+    }
+  lookup_path (fd, buf, bufsize, argv[optind + 1], &fh, &filesize);
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+
+  for (outstanding = 0; outstanding > 0 || offset < filesize; )
+    {
+      int *p;
+
+      /* Keep the window full.  */
+      while (outstanding < window && offset < filesize)
+	{
+	  unsigned int xid;
+
+	  p = start_call (buf + 1, NFS_PROGRAM, NFS_VERSION, NFS3PROC_READ,
+			  &xid);
+	  p = encode_string (p, fh.data, fh.len);
+	  *(p++) = htonl (offset >> 32);
+	  *(p++) = htonl (offset & 0xffffffff);
+	  *(p++) = htonl (iosize);
+	  send_call (fd, buf + 1, p);
+
+	  offset += iosize;
+	  outstanding++;
+	}
+
+      receive_reply (fd, buf, bufsize, &p);
+      outstanding--;
+
+      if (ntohl (*p))
+	p += 1 + FATTR3_SIZE;
+      else
+	p++;
+      received += ntohl (*p);		/* COUNT */
+    }
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf ("%llu bytes in %.3f s: %.1f MB/s (%d x %zu bytes in flight)\n",
+	  received, secs, received / secs / (1024 * 1024), window, iosize);
+
+  return 0;
+}
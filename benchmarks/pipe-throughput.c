@@ -0,0 +1,215 @@
+/* Measure the throughput of pipes and local sockets.
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+/* For each message size from 64 bytes to 16 MB, a child process writes
+   TOTAL bytes (64 MB by default) in messages of that size to its parent,
+   first through a pipe and then through a SOCK_STREAM socketpair, and the
+   rate at which the parent reads them is printed.  The messages are
+   page-aligned, so that large ones can be transferred without copying.
+
+   Before measuring, check that single writes of 64 KB and more go into an
+   empty pipe whole, which only happens when their pages are moved: the
+   copying path stops at the pipe's write limit.  */
+
+#include <errno.h>
+#include <error.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#define MIN_SIZE	64
+#define MAX_SIZE	(16 * 1024 * 1024)
+
+static void
+writer (int fd, size_t size, size_t total)
+{
+  char *buf = mmap (0, size, PROT_READ|PROT_WRITE, MAP_ANON|MAP_PRIVATE,
+		    -1, 0);
+  size_t done;
+
+  if (buf == MAP_FAILED)
+    error (1, errno, "mmap");
+  memset (buf, 'x', size);
+
+  for (done = 0; done < total; )
+    {
+      size_t off = 0;
+      while (off < size)
+	{
+	  ssize_t n = write (fd, buf + off, size - off);
+	  if (n < 0)
+	    error (1, errno, "write");
+	  off += n;
+	}
+      done += size;
+    }
+}
+
+static double
+reader (int fd, size_t size, size_t total)
+{
+  char *buf = mmap (0, size, PROT_READ|PROT_WRITE, MAP_ANON|MAP_PRIVATE,
+		    -1, 0);
+  struct timespec begin, end;
+  size_t done = 0;
+
+  if (buf == MAP_FAILED)
+    error (1, errno, "mmap");
+
+  clock_gettime (CLOCK_MONOTONIC, &begin);
+  while (done < total)
+    {
+      ssize_t n = read (fd, buf, size);
+      if (n < 0)
+	error (1, errno, "read");
+      if (n == 0)
+	error (1, 0, "unexpected EOF after %zu bytes", done);
+      /* Touch the data, as a real reader would.  */
+      buf[0] = buf[n - 1];
+      done += n;
+    }
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  munmap (buf, size);
+  return (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+}
+
+/* Write SIZE bytes in one non-blocking write to an empty pipe or socket of
+   kind KIND, and fail unless all of them are taken at once and read back
+   intact.  */
+static void
+check_page_move (const char *kind, size_t size)
+{
+  char *buf = mmap (0, size, PROT_READ|PROT_WRITE, MAP_ANON|MAP_PRIVATE,
+		    -1, 0);
+  int fds[2];
+  ssize_t n;
+  size_t done;
+
+  if (buf == MAP_FAILED)
+    error (1, errno, "mmap");
+
+  if (strcmp (kind, "pipe") == 0)
+    {
+      if (pipe (fds))
+	error (1, errno, "pipe");
+    }
+  else if (socketpair (AF_LOCAL, SOCK_STREAM, 0, fds))
+    error (1, errno, "socketpair");
+  if (fcntl (fds[1], F_SETFL, O_NONBLOCK))
+    error (1, errno, "fcntl");
+
+  memset (buf, 'y', size);
+  n = write (fds[1], buf, size);
+  if (n < 0)
+    error (1, errno, "%s: write of %zu bytes", kind, size);
+  if (n != size)
+    error (1, 0, "%s: write of %zu bytes took only %zd; pages were copied",
+	   kind, size, n);
+
+  /* Clobber BUF, so that what is checked below is what was read.  */
+  memset (buf, 'z', size);
+  for (done = 0; done < size; done += n)
+    {
+      n = read (fds[0], buf + done, size - done);
+      if (n <= 0)
+	error (1, n < 0 ? errno : 0, "%s: read back", kind);
+    }
+  for (done = 0; done < size; done++)
+    if (buf[done] != 'y')
+      error (1, 0, "%s: byte %zu of %zu read back wrong", kind, done, size);
+
+  close (fds[0]);
+  close (fds[1]);
+  munmap (buf, size);
+}
+
+static void
+run (const char *kind, size_t size, size_t total)
+{
+  int fds[2], status;
+  pid_t child;
+  double secs;
+
+  if (strcmp (kind, "pipe") == 0)
+    {
+      if (pipe (fds))
+	error (1, errno, "pipe");
+    }
+  else if (socketpair (AF_LOCAL, SOCK_STREAM, 0, fds))
+    error (1, errno, "socketpair");
+
+  child = fork ();
+  if (child < 0)
+    error (1, errno, "fork");
+  if (child == 0)
+    {
+      close (fds[0]);
+      writer (fds[1], size, total);
+      _exit (0);
+    }
+
+  close (fds[1]);
+  secs = reader (fds[0], size, total);
+  close (fds[0]);
+
+  if (waitpid (child, &status, 0) < 0)
+    error (1, errno, "waitpid");
+  if (! WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    error (1, 0, "writer failed");
+
+  printf ("%-10s %10zu %10.3f %12.1f\n",
+	  kind, size, secs, total / secs / (1024 * 1024));
+}
+
+int
+main (int argc, char **argv)
+{
+  size_t total = 64 * 1024 * 1024;
+  size_t size;
+
+  if (argc > 2)
+    error (1, 0, "Usage: %s [total-bytes]", argv[0]);
+  if (argc == 2)
+    total = strtoul (argv[1], NULL, 0);
+  if (total < MAX_SIZE)
+    total = MAX_SIZE;
+
+  for (size = 64 * 1024; size <= 1024 * 1024; size *= 4)
+    {
+      check_page_move ("pipe", size);
+      check_page_move ("socketpair", size);
+    }
+
+  printf ("%-10s %10s %10s %12s\n", "kind", "msg size", "seconds", "MB/s");
+  for (size = MIN_SIZE; size <= MAX_SIZE; size *= 4)
+    {
+      /* Send a whole number of messages.  */
+      size_t msgs_total = total - total % size;
+      run ("pipe", size, msgs_total);
+      run ("socketpair", size, msgs_total);
+    }
+
+  return 0;
+}
@@ -0,0 +1,175 @@
+/* Measure how fast objects can be allocated from a slab space.
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+/* With 1, 2, 4... up to THREADS threads (8 by default), each thread
+   allocates BATCH objects of SIZE bytes (16 and 128 by default) from
+   one slab space shared by all, and deallocates them again, until it
+   has done COUNT allocations (a million by default); then the rate of
+   allocations and deallocations is printed for that many threads.
+   With -m, malloc and free are measured instead, for comparison:
+
+     slab-alloc -t 4
+     slab-alloc -t 4 -m
+     slab-alloc -t 16 -s 512 -b 100  */
+
+#include <errno.h>
+#include <error.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <hurd/slab.h>
+
+#define USAGE "Usage: %s [-m] [-t THREADS] [-n COUNT] [-s SIZE] [-b BATCH]"
+
+static struct hurd_slab_space *space;
+static bool use_malloc;
+static size_t size = 128;
+static int batch = 16;
+static long count = 1000000;
+
+static pthread_barrier_t barrier;
+
+static void *
+worker (void *arg)
+{
+  void **objs = arg;
+  long done;
+  int i;
+
+  pthread_barrier_wait (&barrier);
+
+  for (done = 0; done < count; done += batch)
+    {
+      for (i = 0; i < batch; i++)
+	if (use_malloc)
+	  {
+	    objs[i] = malloc (size);
+	    if (! objs[i])
+	      error (1, errno, "malloc");
+	  }
+	else
+	  {
+	    error_t err = hurd_slab_alloc (space, &objs[i]);
+	    if (err)
+	      error (1, err, "hurd_slab_alloc");
+	  }
+
+      /* Touch them, as real users would.  */
+      for (i = 0; i < batch; i++)
+	*(char *) objs[i] = i;
+
+      for (i = 0; i < batch; i++)
+	if (use_malloc)
+	  free (objs[i]);
+	else
+	  hurd_slab_dealloc (space, objs[i]);
+    }
+
+  pthread_barrier_wait (&barrier);
+  return objs;
+}
+
+/* Run NTHREADS workers and return the time they took, in seconds.  */
+static double
+run (int nthreads)
+{
+  pthread_t threads[nthreads];
+  struct timespec start, end;
+  int i, err;
+
+  pthread_barrier_init (&barrier, NULL, nthreads + 1);
+
+  for (i = 0; i < nthreads; i++)
+    {
+      void **objs = malloc (batch * sizeof *objs);
+      if (! objs)
+	error (1, errno, "malloc");
+      err = pthread_create (&threads[i], NULL, worker, objs);
+      if (err)
+	error (1, err, "pthread_create");
+    }
+
+  pthread_barrier_wait (&barrier);
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  pthread_barrier_wait (&barrier);
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  for (i = 0; i < nthreads; i++)
+    {
+      void *objs;
+      pthread_join (threads[i], &objs);
+      free (objs);
+    }
+  pthread_barrier_destroy (&barrier);
+
+  return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+int
+main (int argc, char **argv)
+{
+  int max_threads = 8, nthreads, opt;
+  error_t err;
+
+  while ((opt = getopt (argc, argv, "mt:n:s:b:")) != -1)
+    switch (opt)
+      {
+      case 'm': use_malloc = true; break;
+      case 't': max_threads = atoi (optarg); break;
+      case 'n': count = atol (optarg); break;
+      case 's': size = atol (optarg); break;
+      case 'b': batch = atoi (optarg); break;
+      default:
+	error (1, 0, USAGE, argv[0]);
+      }
+  if (optind != argc || max_threads < 1 || count < 1 || size < 1
+      || batch < 1)
+    error (1, 0, USAGE, argv[0]);
+
+  if (! use_malloc)
+    {
+      err = hurd_slab_create (size, 0, NULL, NULL, NULL, NULL, NULL, &space);
+      if (err)
+	error (1, err, "hurd_slab_create");
+    }
+
+  printf ("%s, %zu byte objects, %d at a time\n",
+	  use_malloc ? "malloc" : "slab", size, batch);
+  printf ("threads     ops/s total  ops/s per thread\n");
+
+  for (nthreads = 1; ; nthreads *= 2)
+    {
+      if (nthreads > max_threads)
+	nthreads = max_threads;
+
+      /* An allocation and a deallocation for each object.  */
+      double ops = 2.0 * nthreads * ((count + batch - 1) / batch * batch);
+      double secs = run (nthreads);
+
+      printf ("%7d  %14.0f  %16.0f\n", nthreads, ops / secs,
+	      ops / secs / nthreads);
+
+      if (nthreads == max_threads)
+	break;
+    }
+
+  return 0;
+}
@@ -0,0 +1,102 @@
+/* Measure how fast small pieces of a file can be read.
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+/* Reads COUNT pieces of SIZE bytes (100000 of 100 by default) from
+   FILE with pread, one after the other from its start, wrapping
+   around at its end, or at random places with -r; then the rate is
+   printed.  FILE should already be in the filesystem's cache, so
+   that the cost of each io_read is measured rather than that of the
+   disk:
+
+     cat big-file > /dev/null
+     small-reads big-file
+     small-reads -r -s 4096 big-file  */
+
+#include <errno.h>
+#include <error.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define USAGE "Usage: %s [-r] [-n COUNT] [-s SIZE] FILE"
+
+int
+main (int argc, char **argv)
+{
+  size_t size = 100;
+  long count = 100000, i;
+  bool random_offsets = false;
+  struct timespec start, end;
+  struct stat st;
+  off_t offset = 0;
+  double secs;
+  char *buf;
+  int opt, fd;
+
+  while ((opt = getopt (argc, argv, "rn:s:")) != -1)
+    switch (opt)
+      {
+      case 'r': random_offsets = true; break;
+      case 'n': count = atol (optarg); break;
+      case 's': size = atol (optarg); break;
+      default:
+	error (1, 0, USAGE, argv[0]);
+      }
+  if (optind != argc - 1 || count < 1 || size < 1)
+    error (1, 0, USAGE, argv[0]);
+
+  fd = open (argv[optind], O_RDONLY);
+  if (fd < 0)
+    error (1, errno, "%s", argv[optind]);
+  if (fstat (fd, &st) < 0)
+    error (1, errno, "%s", argv[optind]);
+  if (st.st_size < size)
+    error (1, 0, "%s: Smaller than %zu bytes", argv[optind], size);
+
+  buf = malloc (size);
+  if (! buf)
+    error (1, errno, "malloc");
+
+  srandom (1);
+  clock_gettime (CLOCK_MONOTONIC, &start);
+
+  for (i = 0; i < count; i++)
+    {
+      if (random_offsets)
+	offset = random () % (st.st_size - size + 1);
+      else if (offset + size > st.st_size)
+	offset = 0;
+
+      if (pread (fd, buf, size, offset) != size)
+	error (1, errno, "pread");
+
+      offset += size;
+    }
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf ("%ld reads of %zu bytes in %.3f s: %.0f reads/s, %.1f us each\n",
+	  count, size, secs, count / secs, secs / count * 1e6);
+
+  return 0;
+}
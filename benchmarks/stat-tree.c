@@ -0,0 +1,102 @@
+/* Measure how fast the files of a tree can be looked up and stat'ed.
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+/* Walks the tree under DIR COUNT times (5 by default), stat'ing every
+   file by its full name and, in every directory, looking for a name
+   that is not there, as a build looking for headers does; then the
+   rate of lookups is printed for each walk.  On a netfs translator,
+   the later walks show what its caches are worth:
+
+     settrans -a /ftp /hurd/hostmux /hurd/ftpfs /
+     stat-tree /ftp/ftp.gnu.org/gnu/hurd
+     fsysopts /ftp/ftp.gnu.org --attr-cache-timeout=60 \
+       --lookup-cache-timeout=60
+     stat-tree /ftp/ftp.gnu.org/gnu/hurd  */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <error.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define USAGE "Usage: %s [-n COUNT] DIR"
+
+static long lookups;
+
+static int
+visit (const char *name, const struct stat *st, int flag, struct FTW *ftw)
+{
+  struct stat buf;
+
+  if (lstat (name, &buf) < 0)
+    error (1, errno, "%s", name);
+  lookups++;
+
+  if (flag == FTW_D)
+    {
+      char *missing;
+
+      if (asprintf (&missing, "%s/no-such-file.h", name) < 0)
+	error (1, errno, "asprintf");
+      if (lstat (missing, &buf) == 0 || errno != ENOENT)
+	error (1, errno, "%s", missing);
+      free (missing);
+      lookups++;
+    }
+
+  return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  long count = 5, i;
+  int opt;
+
+  while ((opt = getopt (argc, argv, "n:")) != -1)
+    switch (opt)
+      {
+      case 'n': count = atol (optarg); break;
+      default:
+	error (1, 0, USAGE, argv[0]);
+      }
+  if (optind != argc - 1 || count < 1)
+    error (1, 0, USAGE, argv[0]);
+
+  for (i = 0; i < count; i++)
+    {
+      struct timespec start, end;
+      double secs;
+
+      lookups = 0;
+      clock_gettime (CLOCK_MONOTONIC, &start);
+      if (nftw (argv[optind], visit, 16, FTW_PHYS) < 0)
+	error (1, errno, "%s", argv[optind]);
+      clock_gettime (CLOCK_MONOTONIC, &end);
+
+      secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+      printf ("walk %ld: %ld lookups in %.3f s: %.0f lookups/s\n",
+	      i + 1, lookups, secs, lookups / secs);
+    }
+
+  return 0;
+}
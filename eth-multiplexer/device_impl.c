@@ -28,6 +28,8 @@
 #include "ethernet.h"
 #include "vdev.h"
 #include "device_S.h"
+#include "net_frames_S.h"
+#include "net_frames_U.h"
 #include "bpf_impl.h"
 #include "netfs_impl.h"
 #include "util.h"
@@ -136,6 +138,78 @@ ds_device_write_inband (struct vether_device *vdev, mach_port_t reply_port,
   return D_INVALID_OPERATION;
 }
 
+/* Whether the interface which the multiplexer connects to takes
+ * device_write_frames too; cleared the first time it does not.  */
+static int ether_port_frames = 1;
+
+kern_return_t
+S_device_write_frames (struct vether_device *vdev, dev_mode_t mode,
+		       io_buf_ptr_t data, mach_msg_type_number_t datalen,
+		       intarray_t lengths, mach_msg_type_number_t nframes,
+		       int *frames_written)
+{
+  kern_return_t ret = 0;
+  vm_size_t total = 0;
+  int i;
+
+  if (vdev == NULL)
+    return D_NO_SUCH_DEVICE;
+
+  if ((vdev->if_flags & IFF_UP) == 0)
+    return D_DEVICE_DOWN;
+
+  for (i = 0; i < nframes; i++)
+    {
+      if (lengths[i] < (int) sizeof (struct ethhdr)
+	  || lengths[i] - sizeof (struct ethhdr)
+	     > NET_RCV_MAX - sizeof (struct packet_header)
+	  || lengths[i] > datalen - total)
+	return D_INVALID_SIZE;
+      total += lengths[i];
+    }
+
+  /* Each packet is forwarded as by ds_device_write.  */
+  total = 0;
+  for (i = 0; i < nframes; i++)
+    {
+      broadcast_pack (data + total, lengths[i], vdev);
+      total += lengths[i];
+    }
+  *frames_written = nframes;
+
+  if (ether_port != MACH_PORT_NULL)
+    {
+      if (ether_port_frames)
+	{
+	  ret = device_write_frames (ether_port, mode, data, datalen,
+				     lengths, nframes, frames_written);
+	  if (ret == MIG_BAD_ID || ret == EOPNOTSUPP)
+	    ether_port_frames = 0;
+	}
+      if (! ether_port_frames)
+	{
+	  total = 0;
+	  for (i = 0; i < nframes; i++)
+	    {
+	      int written;
+
+	      ret = device_write (ether_port, mode, 0, data + total,
+				  lengths[i], &written);
+	      if (ret)
+		break;
+	      total += lengths[i];
+	    }
+	  *frames_written = i;
+	}
+    }
+
+  /* The data came out of line; on errors, it is deallocated with the
+   * request.  */
+  if (! ret)
+    vm_deallocate (mach_task_self (), (vm_address_t) data, datalen);
+  return ret;
+}
+
 kern_return_t
 ds_device_read (struct vether_device *vdev, mach_port_t reply_port,
 		mach_msg_type_name_t reply_type, dev_mode_t mode,
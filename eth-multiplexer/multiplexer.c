@@ -44,6 +44,7 @@
 #include "ethernet.h"
 #include "vdev.h"
 #include "device_S.h"
+#include "net_frames_S.h"
 #include "libports/notify_S.h"
 #include "bpf_impl.h"
 #include "netfs_impl.h"
@@ -55,10 +56,18 @@ static char *device_file;
 const char *argp_program_version = STANDARD_HURD_VERSION (eth-multiplexer);
 
 static const char doc[] = "Hurd multiplexer server.";
+
+#define OPT_MAC_AGE -1
+#define OPT_VDEV_STATS -2
+
 static const struct argp_option options[] =
 {
     {"interface", 'i', "DEVICE", 0,
       "Network interface to use", 2},
+    {"mac-age", OPT_MAC_AGE, "SECS", 0,
+      "Forget learned Ethernet addresses after SECS seconds (default 300);"
+      " 0 sends every frame to all interfaces", 2},
+    {"vdev-stats", OPT_VDEV_STATS, "STATS", OPTION_HIDDEN},
     {0}
 };
 
@@ -82,6 +91,7 @@ multiplexer_demuxer (mach_msg_header_t *inp,
   mig_routine_t routine;
   if ((routine = NULL, ethernet_demuxer (inp, outp)) ||
       (routine = device_server_routine (inp)) ||
+      (routine = net_frames_server_routine (inp)) ||
       (routine = ports_notify_server_routine (inp)))
     {
       if (routine)
@@ -109,6 +119,11 @@ parse_opt (int opt, char *arg, struct argp_state *state)
     case 'i':
       device_file = arg;
       break;
+    case OPT_MAC_AGE:
+      mac_age = atoi (arg);
+      break;
+    case OPT_VDEV_STATS:
+      break;
     case ARGP_KEY_ERROR:
     case ARGP_KEY_SUCCESS:
     case ARGP_KEY_INIT:
@@ -149,14 +164,15 @@ main (int argc, char *argv[])
   if (bootstrap == MACH_PORT_NULL)
     error (1, 0, "must be started as a translator");
 
-  /* Run the multiplexer server in another thread. */
-  pthread_create (&t, NULL, multiplexer_thread, NULL);
-  pthread_detach (t);
-
+  /* Forwarding frames needs the time.  */
   err = maptime_map (0, 0, &multiplexer_maptime);
   if (err)
     error (4, err, "Cannot map time");
 
+  /* Run the multiplexer server in another thread. */
+  pthread_create (&t, NULL, multiplexer_thread, NULL);
+  pthread_detach (t);
+
   /* Initialize netfs and start the translator. */
   netfs_init ();
 
@@ -201,8 +217,17 @@ netfs_append_args (char **argz, size_t *argz_len)
        if (! err) {							\
          snprintf (buf, sizeof buf, fmt , ##args);			\
          err = argz_add (argz, argz_len, buf); } } while (0)
+  int add_vdev_stats (struct vether_device *vdev)
+    {
+      ADD_OPT ("--vdev-stats=%s:%lu/%lu", vdev->name,
+	       vdev->forwarded, vdev->flooded);
+      return err;
+    }
+
   if (device_file)
     ADD_OPT ("--interface=%s", device_file);
+  ADD_OPT ("--mac-age=%d", mac_age);
+  foreach_dev_do (add_vdev_stats);
 #undef ADD_OPT
   return err;
 }
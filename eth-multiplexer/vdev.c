@@ -28,6 +28,7 @@
 #include <arpa/inet.h>
 #include <stdlib.h>
 #include <error.h>
+#include <maptime.h>
 #include <hurd/ihash.h>
 
 #include <pthread.h>
@@ -36,6 +37,7 @@
 #include "ethernet.h"
 #include "queue.h"
 #include "bpf_impl.h"
+#include "netfs_impl.h"
 #include "util.h"
 
 
@@ -46,6 +48,33 @@ static int dev_num;
  * TODO every device structure should has its own lock to protect itself. */
 static pthread_mutex_t dev_list_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/* The forwarding database: the interface each Ethernet address was
+ * last seen as the source on, so that frames to it only go to that
+ * interface.  Frames to other addresses, and broadcast and multicast
+ * frames, are flooded to all interfaces.  */
+struct fdb_entry
+{
+  hurd_ihash_locp_t locp;
+  unsigned char addr[ETH_ALEN];
+  /* Null for the real interface.  */
+  struct vether_device *vdev;
+  time_t seen;
+};
+
+#define FDB_MAX 4096
+
+int mac_age = 300;
+
+static hurd_ihash_key_t fdb_hash (const void *);
+static int fdb_compare (const void *, const void *);
+
+/* Also held while delivering a frame to the interface found in it, so
+ * that the interface is not destroyed meanwhile.  */
+static pthread_mutex_t fdb_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct hurd_ihash fdb =
+  HURD_IHASH_INITIALIZER_GKI (offsetof (struct fdb_entry, locp), NULL,
+			      NULL, fdb_hash, fdb_compare);
+
 /* Should match MiG's desired_complex_alignof */
 #define MSG_ALIGNMENT __alignof__(uintptr_t)
 
@@ -77,6 +106,89 @@ get_dev_num (void)
   return dev_num;
 }
 
+static hurd_ihash_key_t
+fdb_hash (const void *key)
+{
+  return (hurd_ihash_key_t) hurd_ihash_hash32 (key, ETH_ALEN, 0);
+}
+
+static int
+fdb_compare (const void *key1, const void *key2)
+{
+  return memcmp (key1, key2, ETH_ALEN) == 0;
+}
+
+static time_t
+fdb_now (void)
+{
+  struct timeval tv;
+
+  maptime_read (multiplexer_maptime, &tv);
+  return tv.tv_sec;
+}
+
+/* Forget the entries for which DEAD returns true.  FDB_LOCK must be
+ * held.  */
+static void
+fdb_remove_if (int (*dead) (struct fdb_entry *))
+{
+  HURD_IHASH_ITERATE (&fdb, value)
+    {
+      struct fdb_entry *e = value;
+
+      if (dead (e))
+	{
+	  hurd_ihash_locp_remove (&fdb, e->locp);
+	  free (e);
+	}
+    }
+}
+
+/* Record that ADDR is the source of a frame from VDEV, or from the
+ * real interface if VDEV is null.  FDB_LOCK must be held.  */
+static void
+fdb_learn (const unsigned char *addr, struct vether_device *vdev, time_t now)
+{
+  struct fdb_entry *e;
+
+  /* Group addresses are not those of a station.  */
+  if (addr[0] & 1)
+    return;
+
+  e = hurd_ihash_find (&fdb, (hurd_ihash_key_t) addr);
+  if (e)
+    {
+      /* The real interface may hand back the frames we sent it: do not
+       * let that move the address of a virtual interface.  */
+      if (vdev || ! e->vdev || now - e->seen >= mac_age)
+	e->vdev = vdev;
+      if (e->vdev == vdev)
+	e->seen = now;
+      return;
+    }
+
+  if (fdb.nr_items >= FDB_MAX)
+    {
+      int expired (struct fdb_entry *e)
+	{
+	  return now - e->seen >= mac_age;
+	}
+
+      fdb_remove_if (expired);
+      if (fdb.nr_items >= FDB_MAX)
+	return;
+    }
+
+  e = malloc (sizeof *e);
+  if (! e)
+    return;
+  memcpy (e->addr, addr, ETH_ALEN);
+  e->vdev = vdev;
+  e->seen = now;
+  if (hurd_ihash_add (&fdb, (hurd_ihash_key_t) e->addr, e))
+    free (e);
+}
+
 struct vether_device *
 lookup_dev_by_name (const char *name)
 {
@@ -165,6 +277,8 @@ add_vdev (char *name, size_t size)
 
   queue_init (&vdev->port_list.if_rcv_port_list);
   queue_init (&vdev->port_list.if_snd_port_list);
+  vdev->forwarded = 0;
+  vdev->flooded = 0;
 
   pthread_mutex_lock (&dev_list_lock);
   vdev->next = dev_head;
@@ -193,6 +307,15 @@ destroy_vdev (void *port)
   dev_num--;
   pthread_mutex_unlock (&dev_list_lock);
 
+  int learned_on_vdev (struct fdb_entry *e)
+    {
+      return e->vdev == vdev;
+    }
+
+  pthread_mutex_lock (&fdb_lock);
+  fdb_remove_if (learned_on_vdev);
+  pthread_mutex_unlock (&fdb_lock);
+
   /* TODO Delete all filters in the interface,
    * there shouldn't be any filters left */
   destroy_filters (&vdev->port_list);
@@ -200,7 +323,61 @@ destroy_vdev (void *port)
 
 static int deliver_msg (struct net_rcv_msg *msg, struct vether_device *vdev);
 
-/* Broadcast the packet to all virtual interfaces
+/* Deliver MSG, a frame from FROM_VDEV or from the real interface if
+ * FROM_VDEV is null, to the virtual interfaces it is for: the one its
+ * destination was learned on, if any, otherwise all but FROM_VDEV.  */
+static int
+forward_msg (struct net_rcv_msg *msg, struct vether_device *from_vdev)
+{
+  struct ethhdr *header = (struct ethhdr *) msg->header;
+
+  if (mac_age > 0)
+    {
+      time_t now = fdb_now ();
+      struct fdb_entry *e = NULL;
+
+      pthread_mutex_lock (&fdb_lock);
+      fdb_learn (header->h_source, from_vdev, now);
+      if ((header->h_dest[0] & 1) == 0)
+	{
+	  e = hurd_ihash_find (&fdb, (hurd_ihash_key_t) header->h_dest);
+	  if (e && now - e->seen >= mac_age)
+	    e = NULL;
+	}
+      if (e)
+	{
+	  struct vether_device *vdev = e->vdev;
+	  int rval = 0;
+
+	  /* A frame to an address on the real interface concerns no
+	   * virtual one.  */
+	  if (vdev && vdev != from_vdev && (vdev->if_flags & IFF_UP))
+	    {
+	      vdev->forwarded++;
+	      rval = deliver_msg (msg, vdev);
+	    }
+	  pthread_mutex_unlock (&fdb_lock);
+	  return rval;
+	}
+      pthread_mutex_unlock (&fdb_lock);
+    }
+
+  int internal_deliver_msg (struct vether_device *vdev)
+    {
+      /* Skip current interface.  */
+      if (from_vdev == vdev)
+	return 0;
+      /* Skip interfaces that are down.  */
+      if ((vdev->if_flags & IFF_UP) == 0)
+        return 0;
+      vdev->flooded++;
+      return deliver_msg (msg, vdev);
+    }
+
+  return foreach_dev_do (internal_deliver_msg);
+}
+
+/* Forward the packet to the virtual interfaces it is for,
  * except the one the packet is from */
 int
 broadcast_pack (char *data, int datalen, struct vether_device *from_vdev)
@@ -226,38 +403,20 @@ broadcast_pack (char *data, int datalen, struct vether_device *from_vdev)
   packet->length = pack_size + sizeof (struct packet_header);
   msg.packet_type.msgt_number = packet->length;
 
-  int internal_deliver_pack (struct vether_device *vdev)
-    {
-      /* Skip current interface.  */
-      if (from_vdev == vdev)
-	return 0;
-      /* Skip interfaces that are down.  */
-      if ((vdev->if_flags & IFF_UP) == 0)
-        return 0;
-      return deliver_msg (&msg, vdev);
-    }
-
-  return foreach_dev_do (internal_deliver_pack);
+  return forward_msg (&msg, from_vdev);
 }
 
-/* Broadcast the message to all virtual interfaces. */
+/* Forward the message from the real interface to the virtual
+ * interfaces it is for. */
 int
 broadcast_msg (struct net_rcv_msg *msg)
 {
   int rval = 0;
   mach_msg_header_t header;
 
-  int internal_deliver_msg (struct vether_device *vdev)
-    {
-      /* Skip interfaces that are down.  */
-      if ((vdev->if_flags & IFF_UP) == 0)
-        return 0;
-      return deliver_msg (msg, vdev);
-    }
-
   /* Save the message header because deliver_msg will change it. */
   header = msg->msg_hdr;
-  rval = foreach_dev_do (internal_deliver_msg);
+  rval = forward_msg (msg, NULL);
   msg->msg_hdr = header;
   return rval;
 }
@@ -57,8 +57,17 @@ struct vether_device
   struct vether_device **pprev;
 
   if_filter_list_t port_list;
+
+  /* Frames delivered to this interface because their destination was
+     learned on it, and because they were flooded to all interfaces.  */
+  unsigned long forwarded;
+  unsigned long flooded;
 };
 
+/* How long a learned Ethernet address is kept, in seconds; 0 floods
+   every frame to all interfaces.  */
+extern int mac_age;
+
 typedef int (*dev_act_func) (struct vether_device *);
 
 int serv_connect (mach_port_t port);
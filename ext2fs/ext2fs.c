@@ -43,6 +43,7 @@ int diskfs_shortcut_chrdev = 1;
 int diskfs_shortcut_blkdev = 1;
 int diskfs_shortcut_fifo = 1;
 int diskfs_shortcut_ifsock = 1;
+int diskfs_slab_nodes = 1;
 
 char *diskfs_server_name = "ext2fs";
 char *diskfs_server_version = HURD_VERSION;
@@ -81,7 +81,7 @@ diskfs_node_norefs (struct node *np)
   pokel_inherit (&global_pokel, &diskfs_node_disknode (np)->indir_pokel);
   pokel_finalize (&diskfs_node_disknode (np)->indir_pokel);
 
-  free (np);
+  diskfs_dealloc_node (np);
 }
 
 /* The user must define this function if she wants to use the node
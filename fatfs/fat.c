@@ -1,5 +1,5 @@
 /* fat.c - Support for FAT filesystems.
-   Copyright (C) 2002, 2003 Free Software Foundation, Inc.
+   Copyright (C) 2002, 2003, 2026 Free Software Foundation, Inc.
    Written by Marcus Brinkmann.
 
    This file is part of the GNU Hurd.
@@ -53,7 +53,8 @@ cluster_t nr_of_clusters;
 /* Hold this lock while converting times using gmtime.  */
 pthread_spinlock_t epoch_to_time_lock = PTHREAD_SPINLOCK_INITIALIZER;
 
-/* Hold this lock while allocating a new cluster in the FAT.  */
+/* Hold this lock while allocating a new cluster in the FAT, or
+   otherwise touching the free cluster map.  */
 pthread_spinlock_t allocate_free_cluster_lock = PTHREAD_SPINLOCK_INITIALIZER;
 
 /* Where to look for the next free cluster. This is meant to avoid
@@ -63,6 +64,35 @@ pthread_spinlock_t allocate_free_cluster_lock = PTHREAD_SPINLOCK_INITIALIZER;
    FAT.  */
 cluster_t next_free_cluster = 2;
 
+/* A bit for each cluster in the FAT, set if the cluster is free, so
+   that free clusters are found without paging in the FAT.  Built by
+   fat_read_free_map at startup and kept up to date by
+   fat_write_next_cluster.  */
+static unsigned long *free_map;
+static cluster_t nr_of_free_clusters;
+
+#define FREE_MAP_BITS (sizeof (unsigned long) * CHAR_BIT)
+
+/* Mark CLUSTER as free if IS_FREE is true, and in use otherwise.
+   Hold ALLOCATE_FREE_CLUSTER_LOCK.  */
+static void
+mark_cluster (cluster_t cluster, int is_free)
+{
+  unsigned long *word = &free_map[cluster / FREE_MAP_BITS];
+  unsigned long bit = 1UL << (cluster % FREE_MAP_BITS);
+
+  if (is_free && !(*word & bit))
+    {
+      *word |= bit;
+      nr_of_free_clusters++;
+    }
+  else if (!is_free && (*word & bit))
+    {
+      *word &= ~bit;
+      nr_of_free_clusters--;
+    }
+}
+
 
 /* Read the superblock.  */
 void
@@ -211,6 +241,7 @@ fat_write_next_cluster(cluster_t cluster, cluster_t next_cluster)
 {
   loff_t fat_entry_offset;
   cluster_t data;
+  int is_free = next_cluster == FAT_FREE_CLUSTER;
 
   /* First data cluster is cluster 2.  */
   assert_backtrace (cluster >= 2 && cluster < nr_of_clusters + 2); 
@@ -254,6 +285,10 @@ fat_write_next_cluster(cluster_t cluster, cluster_t next_cluster)
       write_dword (fat_image + fat_entry_offset, next_cluster & 0x0fffffff);
     }
 
+  pthread_spin_lock (&allocate_free_cluster_lock);
+  mark_cluster (cluster, is_free);
+  pthread_spin_unlock (&allocate_free_cluster_lock);
+
   return 0;
 }
 
@@ -308,55 +343,59 @@ fat_get_next_cluster(cluster_t cluster, cluster_t *next_cluster)
 }
 
 /* Allocate a new cluster, write CONTENT into the FAT at this new
-   clusters position.  At success, 0 is returned and CLUSTER contains
-   the cluster number allocated.  Otherwise, ENOSPC is returned if the
-   filesystem is full.
+   clusters position.  GOAL is tried first, if it is a cluster at all,
+   so that files can be kept contiguous.  At success, 0 is returned
+   and CLUSTER contains the cluster number allocated.  Otherwise,
+   ENOSPC is returned if the filesystem is full.
    You must call this from inside diskfs_catch_exception.  */
-error_t
-fat_allocate_cluster (cluster_t content, cluster_t *cluster)
+static error_t
+fat_allocate_cluster (cluster_t goal, cluster_t content, cluster_t *cluster)
 {
-  error_t err = 0;
-  cluster_t old_next_free_cluster;
-  int wrapped = 0;
-  cluster_t found_cluster = FAT_FREE_CLUSTER;
+  cluster_t found_cluster;
+  cluster_t word;
+  unsigned long bits;
 
   assert_backtrace (content != FAT_FREE_CLUSTER);
 
   pthread_spin_lock (&allocate_free_cluster_lock);
-  old_next_free_cluster = next_free_cluster;
 
-  /* Loop over all clusters, starting from next_free_cluster and
-     wrapping if reaching the end of the FAT, until we either find an
-     unallocated cluster, or we have to give up because all clusters
-     are allocated.  */
-  do
+  if (nr_of_free_clusters == 0)
     {
-      cluster_t next_free_content;
-
-      fat_get_next_cluster (next_free_cluster, &next_free_content);
-
-      if (next_free_content == FAT_FREE_CLUSTER)
-	found_cluster = next_free_cluster;
+      pthread_spin_unlock (&allocate_free_cluster_lock);
+      return ENOSPC;
+    }
 
-      if (++next_free_cluster == nr_of_clusters + 2)
+  if (goal >= 2 && goal < nr_of_clusters + 2
+      && (free_map[goal / FREE_MAP_BITS] & (1UL << (goal % FREE_MAP_BITS))))
+    found_cluster = goal;
+  else
+    {
+      /* Look at the map a word at a time, starting from
+	 next_free_cluster and wrapping if reaching the end of the FAT.
+	 There is a free cluster somewhere, so this finds it.  */
+      word = next_free_cluster / FREE_MAP_BITS;
+      bits = free_map[word] & (~0UL << (next_free_cluster % FREE_MAP_BITS));
+      while (! bits)
 	{
-	  next_free_cluster = 2;
-	  wrapped = 1;
+	  if (++word == (nr_of_clusters + 2 + FREE_MAP_BITS - 1) / FREE_MAP_BITS)
+	    word = 0;
+	  bits = free_map[word];
 	}
+      found_cluster = word * FREE_MAP_BITS + ffsl (bits) - 1;
     }
-  while (found_cluster == FAT_FREE_CLUSTER
-	 && !(wrapped && next_free_cluster == old_next_free_cluster));
 
-  if (found_cluster != FAT_FREE_CLUSTER)
-    {
-      *cluster = found_cluster;
-      fat_write_next_cluster(found_cluster, content);
-    }
-  else 
-    err = ENOSPC;
+  mark_cluster (found_cluster, 0);
+
+  next_free_cluster = found_cluster + 1;
+  if (next_free_cluster == nr_of_clusters + 2)
+    next_free_cluster = 2;
 
   pthread_spin_unlock (&allocate_free_cluster_lock);
-  return err;
+
+  *cluster = found_cluster;
+  fat_write_next_cluster (found_cluster, content);
+
+  return 0;
 }
 
 /* Extend the cluster chain to maximum size or new_last_cluster,
@@ -369,26 +408,9 @@ fat_extend_chain (struct node *node, cluster_t new_last_cluster, int create)
 {
   error_t err = 0;
   struct disknode *dn = node->dn;
-  struct cluster_chain *table;
-  int offs;
+  struct cluster_run *run;
   cluster_t left, prev_cluster, cluster;
 
-  error_t allocate_new_table(struct cluster_chain **table)
-    {
-      struct cluster_chain *t;
-
-      t = *table;
-      *table = malloc (sizeof (struct cluster_chain));
-      if (!*table)
-	return ENOMEM;
-      (*table)->next = 0;
-      if (t)
-	dn->last = t->next = *table;
-      else
-	dn->last = dn->first = *table;
-      return 0;
-    }
-  
   pthread_spin_lock (&dn->chain_extension_lock);
 
   /* If we already have what we need, or we have all clusters that are
@@ -402,23 +424,36 @@ fat_extend_chain (struct node *node, cluster_t new_last_cluster, int create)
 
   left = new_last_cluster + 1 - dn->length_of_chain;
 
-  table = dn->last;
-  if (table)
+  if (dn->nr_runs)
     {
-      offs = (dn->length_of_chain - 1) & (CLUSTERS_PER_TABLE - 1);
-      prev_cluster = table->cluster[offs];
+      run = &dn->runs[dn->nr_runs - 1];
+      prev_cluster = run->physical + run->length - 1;
     }
   else
-    {
-      offs = CLUSTERS_PER_TABLE - 1;
-      prev_cluster = FAT_FREE_CLUSTER;
-    }
+    prev_cluster = FAT_FREE_CLUSTER;
 
    while (left)
      {
+       /* Make room for a new run before a cluster is allocated, so
+	  that it can't get lost.  */
+       if (dn->nr_runs == dn->runs_alloced)
+	 {
+	   cluster_t alloced = dn->runs_alloced ? dn->runs_alloced * 2 : 4;
+	   struct cluster_run *runs = realloc (dn->runs,
+					       alloced * sizeof *runs);
+	   if (! runs)
+	     {
+	       err = ENOMEM;
+	       break;
+	     }
+	   dn->runs = runs;
+	   dn->runs_alloced = alloced;
+	 }
+
        if (dn->chain_complete)
 	 {
-	   err = fat_allocate_cluster(FAT_EOC, &cluster);
+	   err = fat_allocate_cluster(prev_cluster ? prev_cluster + 1 : 0,
+				      FAT_EOC, &cluster);
 	   if (err)
 	     break;
 	   if (prev_cluster)
@@ -442,16 +477,21 @@ fat_extend_chain (struct node *node, cluster_t new_last_cluster, int create)
 		 break;
 	     }
 	 }
-       prev_cluster = cluster;
-       offs++;
-       if (offs == CLUSTERS_PER_TABLE)
+
+       /* Add CLUSTER to the last run if it follows it on the disk, or
+	  start a new one.  */
+       run = dn->nr_runs ? &dn->runs[dn->nr_runs - 1] : 0;
+       if (run && run->physical + run->length == cluster)
+	 run->length++;
+       else
 	 {
-	   offs = 0;
-	   err = allocate_new_table(&table);
-	   if (err)
-	     break;
+	   run = &dn->runs[dn->nr_runs++];
+	   run->logical = dn->length_of_chain;
+	   run->physical = cluster;
+	   run->length = 1;
 	 }
-       table->cluster[offs] = cluster;
+
+       prev_cluster = cluster;
        dn->length_of_chain++;
        left--;
      }
@@ -471,39 +511,56 @@ fat_getcluster (struct node *node, cluster_t cluster, int create,
 		cluster_t *disk_cluster)
 {
   error_t err = 0;
-  cluster_t chains_to_go = cluster >> LOG2_CLUSTERS_PER_TABLE;
-  cluster_t offs = cluster & (CLUSTERS_PER_TABLE - 1);
-  struct cluster_chain *chain;
+  struct disknode *dn = node->dn;
+  struct cluster_run *run;
+  cluster_t lo, hi;
 
-  if (cluster >= node->dn->length_of_chain)
+  if (cluster >= dn->length_of_chain)
     {
       err = fat_extend_chain (node, cluster, create);
       if (err)
 	return err;
-      if (cluster >= node->dn->length_of_chain)
+      if (cluster >= dn->length_of_chain)
 	{
 	  assert_backtrace (!create);
 	  return EINVAL;
 	}
     }
-  chain = node->dn->first;
-  while (chains_to_go--)
+
+  /* Someone might be extending the chain, moving the runs.  */
+  pthread_spin_lock (&dn->chain_extension_lock);
+
+  /* Accesses tend to be close to each other, so try the run of the
+     last lookup before searching for the right one.  */
+  run = &dn->runs[dn->run_hint < dn->nr_runs ? dn->run_hint : 0];
+  if (cluster < run->logical || cluster - run->logical >= run->length)
     {
-      assert_backtrace (chain);
-      chain = chain->next;
+      lo = 0;
+      hi = dn->nr_runs;
+      while (hi - lo > 1)
+	{
+	  cluster_t mid = (lo + hi) / 2;
+	  if (dn->runs[mid].logical <= cluster)
+	    lo = mid;
+	  else
+	    hi = mid;
+	}
+      run = &dn->runs[lo];
+      dn->run_hint = lo;
     }
-  assert_backtrace (chain);
-  *disk_cluster = chain->cluster[offs];
+  assert_backtrace (cluster >= run->logical
+		    && cluster - run->logical < run->length);
+  *disk_cluster = run->physical + (cluster - run->logical);
+
+  pthread_spin_unlock (&dn->chain_extension_lock);
   return 0;
 }
 
 void
 fat_truncate_node (struct node *node, cluster_t clusters_to_keep)
 {
-  struct cluster_chain *next;
-  cluster_t count;
-  cluster_t offs;
-  cluster_t pos;
+  struct disknode *dn = node->dn;
+  cluster_t first_run, pos, i;
 
   /* The root dir of a FAT12/16 fs is of fixed size, while the root
      dir of a FAT32 fs must never decease to exist.  */
@@ -512,102 +569,107 @@ fat_truncate_node (struct node *node, cluster_t clusters_to_keep)
 
   /* Expand the cluster chain, because we have to know the complete tail.  */
   fat_extend_chain (node, FAT_EOC, 0);
-  if (clusters_to_keep == node->dn->length_of_chain)
+  if (clusters_to_keep == dn->length_of_chain)
     return;
-  assert_backtrace (clusters_to_keep < node->dn->length_of_chain);
+  assert_backtrace (clusters_to_keep < dn->length_of_chain);
 
   /* Truncation happens here.  */
-  next = node->dn->first;
   if (clusters_to_keep == 0)
-    {
-      /* Deallocate the complete file.  */
-      node->dn->start_cluster = 0;
-      pos = count = offs = 0;
-      node->dn->last = 0;
-    }
+    /* Deallocate the complete file.  */
+    dn->start_cluster = 0;
   else
     {
-      count = (clusters_to_keep - 1) >> LOG2_CLUSTERS_PER_TABLE;
-      offs = (clusters_to_keep - 1) & (CLUSTERS_PER_TABLE - 1);
-      while (count-- > 0)
-	{
-	  assert_backtrace (next);
+      cluster_t last_cluster;
 
-	  /* This cluster is now the last cluster in the chain.  */
-	  if (count == 0)
-	    node->dn->last = next;
-
-	  next = next->next;
-	}
-      assert_backtrace (next);
-      fat_write_next_cluster (next->cluster[offs++], FAT_EOC);
-      pos = clusters_to_keep;
+      fat_getcluster (node, clusters_to_keep - 1, 0, &last_cluster);
+      fat_write_next_cluster (last_cluster, FAT_EOC);
     }
 
+  /* Find the first run that goes, at least partially.  */
+  for (first_run = 0; first_run < dn->nr_runs; first_run++)
+    if (dn->runs[first_run].logical + dn->runs[first_run].length
+	> clusters_to_keep)
+      break;
+  assert_backtrace (first_run < dn->nr_runs);
+
   /* Purge dangling clusters. If we die here, scandisk will have to
      clean up the remains.  */
-  while (pos < node->dn->length_of_chain)
-    {
-      if (offs == CLUSTERS_PER_TABLE)
-	{
-	  offs = 0;
-	  next = next->next;
-	  assert_backtrace (next);
-	}
-      fat_write_next_cluster(next->cluster[offs++], 0);
-      pos++;
-    }
- 
-  /* Free now unused tables.  (Could be done in one run with the above.)  */
-  next = node->dn->first;
-  if (clusters_to_keep != 0)
+  for (i = first_run; i < dn->nr_runs; i++)
     {
-      count = (clusters_to_keep - 1) >> LOG2_CLUSTERS_PER_TABLE;
-      offs = (clusters_to_keep - 1) & (CLUSTERS_PER_TABLE - 1);
-      while (count-- > 0)
-	{
-	  assert_backtrace (next);
-	  next = next->next;
-	}
-      assert_backtrace (next);
-      next = next->next;
+      struct cluster_run *run = &dn->runs[i];
+
+      pos = (clusters_to_keep > run->logical
+	     ? clusters_to_keep - run->logical : 0);
+      while (pos < run->length)
+	fat_write_next_cluster (run->physical + pos++, 0);
     }
-  while (next)
+
+  /* Drop the runs of what's gone.  */
+  if (clusters_to_keep > dn->runs[first_run].logical)
     {
-      struct cluster_chain *next_next = next->next;
-      free (next);
-      next = next_next;
+      dn->runs[first_run].length
+	= clusters_to_keep - dn->runs[first_run].logical;
+      first_run++;
     }
+  dn->nr_runs = first_run;
+  dn->run_hint = 0;
 
-  if (clusters_to_keep == 0)
-    node->dn->first = 0;
-  
-  node->dn->length_of_chain = clusters_to_keep; 
+  dn->length_of_chain = clusters_to_keep; 
+}
+
+/* Forget all about NODE's cluster chain.  */
+void
+fat_drop_chain (struct node *node)
+{
+  struct disknode *dn = node->dn;
+
+  free (dn->runs);
+  dn->runs = 0;
+  dn->nr_runs = 0;
+  dn->runs_alloced = 0;
+  dn->run_hint = 0;
+  dn->length_of_chain = 0;
+  dn->chain_complete = 0;
 }
 
 
-/* Count the number of free clusters in the FAT.  */
-int
-fat_get_freespace (void)
+/* Build the free cluster map from the FAT.  */
+void
+fat_read_free_map (void)
 {
-  int free_clusters = 0;
   cluster_t curr_cluster;
   cluster_t next_cluster;
   error_t err;
 
+  free_map = calloc ((nr_of_clusters + 2 + FREE_MAP_BITS - 1)
+		     / FREE_MAP_BITS, sizeof *free_map);
+  if (! free_map)
+    error (1, ENOMEM, "Could not allocate the free cluster map");
+
   err = diskfs_catch_exception ();
-  if (!err)
+  if (err)
+    error (1, err, "Could not read the FAT");
+
+  /* First cluster is the 3rd entry in the FAT table.  */
+  for (curr_cluster = 2; curr_cluster < nr_of_clusters + 2; curr_cluster++)
     {
-      /* First cluster is the 3rd entry in the FAT table.  */
-      for (curr_cluster = 2; curr_cluster < nr_of_clusters + 2;
-	   curr_cluster++)
-	{
-	  fat_get_next_cluster (curr_cluster, &next_cluster);
-	  if (next_cluster == FAT_FREE_CLUSTER)
-	    free_clusters++;
-	}
+      fat_get_next_cluster (curr_cluster, &next_cluster);
+      if (next_cluster == FAT_FREE_CLUSTER)
+	mark_cluster (curr_cluster, 1);
     }
+
   diskfs_end_catch_exception ();
+}
+
+/* Count the number of free clusters in the FAT.  */
+int
+fat_get_freespace (void)
+{
+  int free_clusters;
+
+  pthread_spin_lock (&allocate_free_cluster_lock);
+  free_clusters = nr_of_free_clusters;
+  pthread_spin_unlock (&allocate_free_cluster_lock);
 
   return free_clusters;
 }
@@ -307,13 +307,14 @@ extern size_t bytes_per_cluster;
 /* A cluster number.  */
 typedef unsigned long cluster_t;
 
-#define LOG2_CLUSTERS_PER_TABLE 10
-#define CLUSTERS_PER_TABLE (1 << LOG2_CLUSTERS_PER_TABLE)
-
-struct cluster_chain
+/* A run of clusters which follow each other both in a file and on
+   the disk.  A file's cluster chain is kept as an array of those,
+   sorted by LOGICAL.  */
+struct cluster_run
 {
-  struct cluster_chain *next;
-  cluster_t cluster[CLUSTERS_PER_TABLE];
+  cluster_t logical;		/* First cluster of the run in the file.  */
+  cluster_t physical;		/* Its cluster on the disk.  */
+  cluster_t length;		/* Number of clusters in the run.  */
 };
 
 /* Prototyping.  */
@@ -323,6 +324,8 @@ void fat_from_epoch (unsigned char *, unsigned char *, time_t *);
 error_t fat_getcluster (struct node *, cluster_t, int, cluster_t *);
 void fat_truncate_node (struct node *, cluster_t);
 error_t fat_extend_chain (struct node *, cluster_t, int);
+void fat_drop_chain (struct node *);
+void fat_read_free_map (void);
 int fat_get_freespace (void);
 
 /* Unprocessed superblock.  */
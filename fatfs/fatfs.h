@@ -52,12 +52,17 @@ struct disknode
   /* Lock to hold while fiddling with this inode's block allocation
      info.  */
   pthread_rwlock_t alloc_lock;
-  /* Lock to hold while extending this inode's block allocation info.
-     Hold only if you hold readers alloc_lock, then you don't need to
-     hold it if you hold writers alloc_lock already.  */
+  /* Lock to hold while extending this inode's block allocation info,
+     or looking into it while someone else might extend it.  Hold only
+     if you hold readers alloc_lock, then you don't need to hold it if
+     you hold writers alloc_lock already.  */
   pthread_spinlock_t chain_extension_lock;
-  struct cluster_chain *first;
-  struct cluster_chain *last;
+  /* The part of the cluster chain read so far, as runs of clusters.  */
+  struct cluster_run *runs;
+  cluster_t nr_runs;
+  cluster_t runs_alloced;
+  /* The run last looked up, where the next lookup likely starts.  */
+  cluster_t run_hint;
   cluster_t length_of_chain;
   int chain_complete;
 
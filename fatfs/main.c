@@ -45,6 +45,7 @@ int diskfs_synchronous = 0;
 int diskfs_link_max = 1;
 int diskfs_name_max = FAT_NAME_MAX;
 int diskfs_maxsymlinks = 8;     /* XXX */
+int diskfs_slab_nodes = 1;
 
 /* Handy source of zeroes.  */
 vm_address_t zerocluster;
@@ -233,6 +234,8 @@ main (int argc, char **argv)
 
   create_fat_pager ();
 
+  fat_read_free_map ();
+
   zerocluster = (vm_address_t) mmap (0, bytes_per_cluster, PROT_READ|PROT_WRITE,
 				     MAP_ANON, 0, 0);
 
@@ -1,6 +1,6 @@
 /* Remote file contents caching
 
-   Copyright (C) 1997, 1999 Free Software Foundation, Inc.
+   Copyright (C) 1997, 1999, 2026 Free Software Foundation, Inc.
    Written by Miles Bader <miles@gnu.ai.mit.edu>
    This file is part of the GNU Hurd.
 
@@ -20,31 +20,326 @@
 
 #include <unistd.h>
 #include <string.h>
+#include <stddef.h>
 #include <sys/mman.h>
 
 #include <hurd/netfs.h>
 
 #include "ccache.h"
 
-#define READ_CHUNK_SIZE   (8*1024)
-#define ALLOC_CHUNK_SIZE  (64*1024)
-
+/* If the data connection is this far behind the position we want, it's
+   cheaper to read and throw away the data in between than to start a new
+   transfer.  */
+#define SKIP_MAX  CCACHE_BLOCK_SIZE
+
+/* All cached blocks, of all files, most recently used first.  */
+static struct ccache_block *lru_head, *lru_tail;
+/* Memory used by the blocks in that list.  */
+static size_t lru_mem;
+static pthread_mutex_t lru_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Remove BLOCK from the LRU list.  LRU_LOCK should be held.  */
+static void
+lru_unlink (struct ccache_block *block)
+{
+  if (block->lru_prev)
+    block->lru_prev->lru_next = block->lru_next;
+  else
+    lru_head = block->lru_next;
+  if (block->lru_next)
+    block->lru_next->lru_prev = block->lru_prev;
+  else
+    lru_tail = block->lru_prev;
+}
+
+/* Add BLOCK to the front of the LRU list.  LRU_LOCK should be held.  */
+static void
+lru_push (struct ccache_block *block)
+{
+  block->lru_prev = 0;
+  block->lru_next = lru_head;
+  if (lru_head)
+    lru_head->lru_prev = block;
+  else
+    lru_tail = block;
+  lru_head = block;
+}
+
+/* Remove BLOCK from its cache and free it.  LRU_LOCK and the lock on
+   BLOCK's cache should be held.  */
+static void
+drop_block (struct ccache_block *block)
+{
+  lru_unlink (block);
+  lru_mem -= CCACHE_BLOCK_SIZE;
+  hurd_ihash_locp_remove (&block->cc->blocks, block->locp);
+  munmap (block->data, CCACHE_BLOCK_SIZE);
+  free (block);
+}
+
+/* Throw away the least recently used blocks until the cache fits in the
+   configured memory again, leaving KEEP alone.  CC, which is KEEP's cache,
+   should be locked.  Blocks of caches that are busy are skipped rather than
+   waited for, since we may not block on another cache's lock here.  */
+static void
+trim_cache (struct ccache *cc, struct ccache_block *keep)
+{
+  size_t max = cc->node->nn->fs->params.contents_cache_max;
+  struct ccache_block *block, *prev;
+
+  pthread_mutex_lock (&lru_lock);
+  for (block = lru_tail; block && lru_mem > max; block = prev)
+    {
+      prev = block->lru_prev;
+      if (block == keep)
+	continue;
+      if (block->cc == cc)
+	drop_block (block);
+      else if (pthread_mutex_trylock (&block->cc->lock) == 0)
+	{
+	  struct ccache *other = block->cc;
+	  drop_block (block);
+	  pthread_mutex_unlock (&other->lock);
+	}
+    }
+  pthread_mutex_unlock (&lru_lock);
+}
+
+/* Drop all blocks cached in CC, which should be locked.  */
+static void
+drop_blocks (struct ccache *cc)
+{
+  pthread_mutex_lock (&lru_lock);
+  HURD_IHASH_ITERATE (&cc->blocks, value)
+    {
+      struct ccache_block *block = value;
+      lru_unlink (block);
+      lru_mem -= CCACHE_BLOCK_SIZE;
+      munmap (block->data, CCACHE_BLOCK_SIZE);
+      free (block);
+    }
+  pthread_mutex_unlock (&lru_lock);
+
+  hurd_ihash_destroy (&cc->blocks);
+  hurd_ihash_init (&cc->blocks, offsetof (struct ccache_block, locp));
+}
+
+/* Finish the transfer in progress over CC's data connection, and give back
+   its ftp connection.  */
+static void
+close_transfer (struct ccache *cc)
+{
+  close (cc->data_conn);
+  cc->data_conn = -1;
+  ftp_conn_finish_transfer (cc->conn);
+  ftpfs_release_ftp_conn (cc->node->nn->fs, cc->conn);
+  cc->conn = 0;
+}
+
+/* Start a transfer of CC's file over a new connection, beginning at POS if
+   the server allows that, and otherwise at the beginning of the file.  */
+static error_t
+open_transfer (struct ccache *cc, off_t pos)
+{
+  struct netnode *nn = cc->node->nn;
+  int from_start = (pos == 0 || cc->no_rest);
+  error_t err = ftpfs_get_ftp_conn (nn->fs, &cc->conn);
+
+  if (err)
+    {
+      cc->conn = 0;
+      return err;
+    }
+
+  if (! from_start)
+    {
+      err = ftp_conn_start_retrieve_at (cc->conn, nn->rmt_path, pos,
+					&cc->data_conn);
+      if (err == EOPNOTSUPP)
+	/* Fetch from the beginning of the file, skipping what we don't
+	   want; remember not to bother asking again.  */
+	{
+	  cc->no_rest = 1;
+	  from_start = 1;
+	}
+      else if (! err)
+	cc->data_conn_pos = pos;
+    }
+
+  if (from_start)
+    {
+      err = ftp_conn_start_retrieve (cc->conn, nn->rmt_path, &cc->data_conn);
+      if (! err)
+	cc->data_conn_pos = 0;
+    }
+
+  if (err == ENOENT)
+    err = ESTALE;
+  if (err)
+    {
+      ftpfs_release_ftp_conn (nn->fs, cc->conn);
+      cc->conn = 0;
+      cc->data_conn = -1;
+    }
+
+  return err;
+}
+
+/* Fetch block NUM of the file referred to by CC, and add it to CC.  CC
+   should be locked, and no other thread be fetching data for it; the lock
+   is released while talking to the server.  */
+static error_t
+fetch_block (struct ccache *cc, off_t num)
+{
+  error_t err = 0;
+  off_t start = num * CCACHE_BLOCK_SIZE, size = cc->size;
+  size_t want = CCACHE_BLOCK_SIZE, got = 0;
+  int re_connected = 0;
+  char *data;
+
+  if (start + want > size)
+    want = size - start;
+
+  cc->fetching_active = 1;
+  pthread_mutex_unlock (&cc->lock);
+
+  data = mmap (0, CCACHE_BLOCK_SIZE, PROT_READ|PROT_WRITE, MAP_ANON, 0, 0);
+  if (data == MAP_FAILED)
+    err = errno;
+
+  while (got < want && !err)
+    {
+      off_t pos = start + got;
+      size_t amount;
+      ssize_t rd;
+
+      if (cc->conn
+	  && (cc->data_conn_pos > pos
+	      || (!cc->no_rest && pos - cc->data_conn_pos > SKIP_MAX)))
+	/* The transfer in progress is of no use to us; start another one.  */
+	close_transfer (cc);
+
+      if (! cc->conn)
+	{
+	  err = open_transfer (cc, pos);
+	  if (err)
+	    break;
+	  re_connected = 1;
+	}
+
+      if (cc->data_conn_pos < pos)
+	/* Read up to where we want to be, using the unfilled part of the
+	   block as scratch space.  */
+	amount = pos - cc->data_conn_pos;
+      else
+	amount = want - got;
+      if (amount > CCACHE_BLOCK_SIZE - got)
+	amount = CCACHE_BLOCK_SIZE - got;
+
+      rd = read (cc->data_conn, data + got, amount);
+      if (rd < 0)
+	err = errno;
+      else if (rd == 0)
+	/* EOF.  This either means the file changed size, or our
+	   data-connection got closed; we just try to open the connection a
+	   second time, and then if that fails, assume the size changed.  */
+	{
+	  if (re_connected)
+	    err = EIO; /* Something's fucked */
+	  else
+	    close_transfer (cc);
+	}
+      else
+	{
+	  if (cc->data_conn_pos == pos)
+	    got += rd;
+	  cc->data_conn_pos += rd;
+	}
+
+      if (!err && ports_self_interrupted ())
+	err = EINTR;
+    }
+
+  if (!err && cc->conn && cc->data_conn_pos == size)
+    /* We're finished reading all data, close the data connection.  */
+    close_transfer (cc);
+
+  pthread_mutex_lock (&cc->lock);
+
+  if (! err)
+    {
+      struct ccache_block *block = malloc (sizeof (struct ccache_block));
+
+      if (! block)
+	err = ENOMEM;
+      else
+	{
+	  block->cc = cc;
+	  block->num = num;
+	  block->data = data;
+	  err = hurd_ihash_add (&cc->blocks, num, block);
+	  if (err)
+	    free (block);
+	  else
+	    {
+	      pthread_mutex_lock (&lru_lock);
+	      lru_push (block);
+	      lru_mem += CCACHE_BLOCK_SIZE;
+	      pthread_mutex_unlock (&lru_lock);
+
+	      trim_cache (cc, block);
+	    }
+	}
+    }
+
+  if (err && data != MAP_FAILED)
+    munmap (data, CCACHE_BLOCK_SIZE);
+
+  /* We're done, error or no.  */
+  cc->fetching_active = 0;
+
+  /* Let others know something's going on.  */
+  pthread_cond_broadcast (&cc->wakeup);
+
+  return err;
+}
+
 /* Read LEN bytes at OFFS in the file referred to by CC into DATA, or return
    an error.  */
 error_t
 ccache_read (struct ccache *cc, off_t offs, size_t len, void *data)
 {
   error_t err = 0;
-  size_t max = offs + len;
+  off_t pos = offs, max = offs + len;
 
   pthread_mutex_lock (&cc->lock);
 
+  /* The node is locked by our caller, and its size is what we should be
+     caching; if it changed, ccache_invalidate will have been called.  */
+  cc->size = cc->node->nn_stat.st_size;
   if (max > cc->size)
     max = cc->size;
 
-  while (cc->max < max && !err)
+  while (pos < max && !err)
     {
-      if (cc->fetching_active)
+      off_t num = pos / CCACHE_BLOCK_SIZE;
+      struct ccache_block *block = hurd_ihash_find (&cc->blocks, num);
+
+      if (block)
+	{
+	  off_t block_end = (num + 1) * CCACHE_BLOCK_SIZE;
+	  size_t amount = (block_end < max ? block_end : max) - pos;
+
+	  memcpy ((char *) data + (pos - offs),
+		  block->data + (pos - num * CCACHE_BLOCK_SIZE), amount);
+	  pos += amount;
+
+	  pthread_mutex_lock (&lru_lock);
+	  lru_unlink (block);
+	  lru_push (block);
+	  pthread_mutex_unlock (&lru_lock);
+	}
+      else if (cc->fetching_active)
 	/* Some thread is fetching data, so just let it do its thing, but get
 	   a wakeup call when it's done.  */
 	{
@@ -52,166 +347,14 @@ ccache_read (struct ccache *cc, off_t offs, size_t len, void *data)
 	    err = EINTR;
 	}
       else
-	{
-	  int re_connected = 0;
-	  struct netnode *nn = cc->node->nn;
-
-	  cc->fetching_active = 1;
-
-	  while (cc->max < max && !err)
-	    {
-	      pthread_mutex_unlock (&cc->lock);
-
-	      if (! cc->conn)
-		/* We need to setup a connection to fetch data over.  */
-		{
-		  err = ftpfs_get_ftp_conn (nn->fs, &cc->conn);
-		  if (! err)
-		    {
-		      err = ftp_conn_start_retrieve (cc->conn, nn->rmt_path,
-						     &cc->data_conn);
-		      if (err == ENOENT)
-			err = ESTALE;
-		      if (err)
-			{
-			  ftpfs_release_ftp_conn (nn->fs, cc->conn);
-			  cc->conn = 0;
-			}
-		      else
-			cc->data_conn_pos = 0;
-		    }
-		  re_connected = 1;
-		}
-
-	      if (! err)
-		/* Try and read some data over the connection.  */
-		{
-		  size_t new_end = cc->max + READ_CHUNK_SIZE;
-
-		  if (new_end > cc->size)
-		    new_end = cc->size;
-
-		  if (new_end > cc->alloced)
-		    /* Make some room in memory for the new part of the
-		       image.  */
-		    {
-		      size_t alloc_end = cc->alloced + ALLOC_CHUNK_SIZE;
-
-		      if (alloc_end < new_end)
-			alloc_end = new_end;
-		      else if (alloc_end > cc->size)
-			alloc_end = cc->size;
-
-		      if (cc->alloced == 0)
-			{
-			  vm_address_t addr = 0;
-			  addr = (vm_address_t) mmap (0, alloc_end, 
-						      PROT_READ|PROT_WRITE,
-						      MAP_ANON, 0, 0);
-			  err = (addr == -1) ? errno : 0;
-			  if (! err)
-			    cc->image = (char *)addr;
-			}
-		      else
-			{
-			  vm_address_t addr =
-			    (vm_address_t)cc->image + cc->alloced;
-			  /* XXX.  This can't be replaced with mmap until we
-			     have MAP_EXCL.  -tb  */
-			  err = vm_allocate (mach_task_self (),
-					     &addr, alloc_end - cc->alloced,
-					     0);
-			  if (err == EKERN_NO_SPACE)
-			    /* Gack.  We've goota move the whole splooge.  */
-			    {
-			      addr = 0;
-			      addr = (vm_address_t) mmap (0, alloc_end, 
-							  PROT_READ|PROT_WRITE,
-							  MAP_ANON, 0, 0);
-			      err = (addr == -1) ? errno : 0;
-			      if (! err)
-				/* That worked; copy what's already-fetched. */
-				{
-				  bcopy (cc->image, (void *)addr, cc->max);
-				  munmap (cc->image, cc->alloced);
-				  cc->image = (char *)addr;
-				}
-			    }
-			}
-		      if (! err)
-			cc->alloced = alloc_end;
-		    }
-
-		  if (! err)
-		    {
-		      ssize_t rd =
-			read (cc->data_conn,
-			      cc->image + cc->data_conn_pos,
-			      new_end - cc->data_conn_pos);
-		      if (rd < 0)
-			err = errno;
-		      else if (rd == 0)
-			/* EOF.  This either means the file changed size, or
-			   our data-connection got closed; we just try to
-			   open the connection a second time, and then if
-			   that fails, assume the size changed.  */
-			{
-			  if (re_connected)
-			    err = EIO; /* Something's fucked */
-			  else
-			    /* Try opening the connection again.  */
-			    {
-			      close (cc->data_conn);
-			      ftp_conn_finish_transfer (cc->conn);
-			      ftpfs_release_ftp_conn (nn->fs, cc->conn);
-			      cc->conn = 0;
-			    }
-			}
-		      else
-			{
-			  cc->data_conn_pos += rd;
-			  if (cc->data_conn_pos > cc->max)
-			    cc->max = cc->data_conn_pos;
-			}
-		    }
-
-		  if (!err && ports_self_interrupted ())
-		    err = EINTR;
-		}
-
-	      pthread_mutex_lock (&cc->lock);
-
-	      if (cc->max < max && !err)
-		/* If anyone's waiting for data, let them look (if we're done
-		   fetching, this gets delayed until below).  */
-		pthread_cond_broadcast (&cc->wakeup);
-	    }
-
-	  if (!err && cc->conn && cc->max == cc->size)
-	    /* We're finished reading all data, close the data connection.  */
-	    {
-	      close (cc->data_conn);
-	      ftp_conn_finish_transfer (cc->conn);
-	      ftpfs_release_ftp_conn (nn->fs, cc->conn);
-	      cc->conn = 0;
-	    }
-
-	  /* We're done, error or no.  */
-	  cc->fetching_active = 0;
-
-	  /* Let others know something's going on.  */
-	  pthread_cond_broadcast (&cc->wakeup);
-	}
+	err = fetch_block (cc, num);
     }
 
-  if (! err)
-    bcopy (cc->image + offs, data, max - offs);
-
   pthread_mutex_unlock (&cc->lock);
 
   return err;
 }
-
+
 /* Discard any cached contents in CC.  */
 error_t
 ccache_invalidate (struct ccache *cc)
@@ -230,27 +373,16 @@ ccache_invalidate (struct ccache *cc)
 
   if (! err)
     {
-      if (cc->alloced > 0)
-	{
-	  munmap (cc->image, cc->alloced);
-	  cc->image = 0;
-	  cc->alloced = 0;
-	  cc->max = 0;
-	}
+      drop_blocks (cc);
       if (cc->conn)
-	{
-	  close (cc->data_conn);
-	  ftp_conn_finish_transfer (cc->conn);
-	  ftpfs_release_ftp_conn (cc->node->nn->fs, cc->conn);
-	  cc->conn = 0;
-	}
+	close_transfer (cc);
     }
 
   pthread_mutex_unlock (&cc->lock);
 
   return err;
 }
-
+
 /* Return a ccache object for NODE in CC.  */
 error_t
 ccache_create (struct node *node, struct ccache **cc)
@@ -261,15 +393,15 @@ ccache_create (struct node *node, struct ccache **cc)
     return ENOMEM;
 
   new->node = node;
-  new->image = 0;
+  hurd_ihash_init (&new->blocks, offsetof (struct ccache_block, locp));
   new->size = node->nn_stat.st_size;
-  new->max = 0;
-  new->alloced = 0;
   pthread_mutex_init (&new->lock, NULL);
   pthread_cond_init (&new->wakeup, NULL);
   new->fetching_active = 0;
   new->conn = 0;
   new->data_conn = -1;
+  new->data_conn_pos = 0;
+  new->no_rest = 0;
 
   *cc = new;
 
@@ -280,14 +412,13 @@ ccache_create (struct node *node, struct ccache **cc)
 void
 ccache_free (struct ccache *cc)
 {
-  if (cc->alloced > 0)
-    munmap (cc->image, cc->alloced);
-  if (cc->data_conn >= 0)
-    close (cc->data_conn);
+  /* Other caches may be trimming our blocks, so this is done under the
+     lock like everywhere else.  */
+  pthread_mutex_lock (&cc->lock);
+  drop_blocks (cc);
+  hurd_ihash_destroy (&cc->blocks);
   if (cc->conn)
-    {
-      ftp_conn_finish_transfer (cc->conn);
-      ftpfs_release_ftp_conn (cc->node->nn->fs, cc->conn);
-    }
+    close_transfer (cc);
+  pthread_mutex_unlock (&cc->lock);
   free (cc);
 }
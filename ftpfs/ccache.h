@@ -1,6 +1,6 @@
 /* Remote file contents caching
 
-   Copyright (C) 1997 Free Software Foundation, Inc.
+   Copyright (C) 1997, 2026 Free Software Foundation, Inc.
    Written by Miles Bader <miles@gnu.ai.mit.edu>
    This file is part of the GNU Hurd.
 
@@ -21,32 +21,53 @@
 #ifndef __CCACHE_H__
 #define __CCACHE_H__
 
+#include <hurd/ihash.h>
+
 #include "ftpfs.h"
 
+/* File contents are cached in blocks of this size.  */
+#define CCACHE_BLOCK_SIZE  (64*1024)
+
+/* One cached block of a file.  Only completely fetched blocks are ever
+   entered into a ccache.  */
+struct ccache_block
+{
+  /* The cache this is part of.  */
+  struct ccache *cc;
+
+  /* Position of the block in the file, in units of CCACHE_BLOCK_SIZE.  */
+  off_t num;
+
+  /* CCACHE_BLOCK_SIZE bytes of data, allocated using mmap; only the part
+     within the file's size is meaningful.  */
+  char *data;
+
+  /* Position in the global list of cached blocks, most recently used
+     first.  */
+  struct ccache_block *lru_next, *lru_prev;
+
+  /* Location pointer for CC's block table.  */
+  hurd_ihash_locp_t locp;
+};
+
 struct ccache
 {
   /* The filesystem node this is a cache of.  */
   struct node *node;
 
-  /* In memory file image, alloced using vm_allocate.  */
-  char *image;
+  /* Blocks of the file that are cached, indexed by their number.  */
+  struct hurd_ihash blocks;
 
   /* Size of data.  */
   off_t size;
 
-  /* Upper bounds of fetched image.  */
-  off_t max;
-
-  /* Amount of IMAGE that has been allocated.  */
-  size_t alloced;
-
   pthread_mutex_t lock;
 
   /* People can wait for a reading thread on this condition.  */
   pthread_cond_t wakeup;
 
   /* True if some thread is now fetching data.  Only that thread should
-     modify the DATA_CONN, DATA_CONN_POS, and MAX fields.  */
+     modify the CONN, DATA_CONN, DATA_CONN_POS and NO_REST fields.  */
   int fetching_active;
 
   /* Ftp connection over which data is being fetched, or 0.  */
@@ -55,6 +76,10 @@ struct ccache
   int data_conn;
   /* Where DATA_CONN points in the file.  */
   off_t data_conn_pos;
+
+  /* True if the server wouldn't start a transfer in the middle of the
+     file, so we always fetch from the beginning.  */
+  int no_rest;
 };
 
 /* Read LEN bytes at OFFS in the file referred to by CC into DATA, or return
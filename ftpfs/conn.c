@@ -1,6 +1,6 @@
 /* Ftp connection management
 
-   Copyright (C) 1997,2002 Free Software Foundation, Inc.
+   Copyright (C) 1997,2002,2026 Free Software Foundation, Inc.
    Written by Miles Bader <miles@gnu.ai.mit.edu>
    This file is part of the GNU Hurd.
 
@@ -20,6 +20,7 @@
 
 #include <assert-backtrace.h>
 #include <stdint.h>
+#include <unistd.h>
 
 #include "ftpfs.h"
 
@@ -28,8 +29,15 @@ struct ftpfs_conn
 {
   struct ftp_conn *conn;
   struct ftpfs_conn *next;
+
+  /* When this connection was last put back into the free pool.  */
+  time_t last_used;
 };
 
+/* How often the keepalive thread looks for idle connections when
+   keepalives are turned off, in case they get turned on again.  */
+#define KEEPALIVE_IDLE_CHECK	60
+
 /* For debugging purposes, give each connection a unique integer id.  */
 static unsigned conn_id = 0;
 
@@ -42,7 +50,10 @@ ftpfs_get_ftp_conn (struct ftpfs *fs, struct ftp_conn **conn)
   pthread_spin_lock (&fs->conn_lock);
   fsc = fs->free_conns;
   if (fsc)
-    fs->free_conns = fsc->next;
+    {
+      fs->free_conns = fsc->next;
+      fs->num_free_conns--;
+    }
   pthread_spin_unlock (&fs->conn_lock);
 
   if (! fsc)
@@ -83,6 +94,32 @@ ftpfs_get_ftp_conn (struct ftpfs *fs, struct ftp_conn **conn)
   return 0;
 }
 
+/* Put FSC into FS's pool of free connections, unless there are enough
+   there already, in which case it is closed and freed.  */
+static void
+pool_conn (struct ftpfs *fs, struct ftpfs_conn *fsc)
+{
+  int keep;
+
+  fsc->last_used = NOW;
+
+  pthread_spin_lock (&fs->conn_lock);
+  keep = fs->num_free_conns < fs->params.conn_pool_size;
+  if (keep)
+    {
+      fsc->next = fs->free_conns;
+      fs->free_conns = fsc;
+      fs->num_free_conns++;
+    }
+  pthread_spin_unlock (&fs->conn_lock);
+
+  if (! keep)
+    {
+      ftp_conn_free (fsc->conn);
+      free (fsc);
+    }
+}
+
 /* Return CONN to the pool of free connections in FS.  */
 void
 ftpfs_release_ftp_conn (struct ftpfs *fs, struct ftp_conn *conn)
@@ -97,10 +134,65 @@ ftpfs_release_ftp_conn (struct ftpfs *fs, struct ftp_conn *conn)
 	  pfsc->next = fsc->next;
 	else
 	  fs->conns = fsc->next;
-	fsc->next = fs->free_conns;
-	fs->free_conns = fsc;
 	break;
       }
   assert_backtrace (fsc);
   pthread_spin_unlock (&fs->conn_lock);
+
+  pool_conn (fs, fsc);
+}
+
+/* Send a NOOP every so often over connections in the free pool of the
+   filesystem ARG, so that the server doesn't close them while they're idle.
+   Connections that turn out to be dead are thrown away.  */
+void *
+ftpfs_keepalive_thread (void *arg)
+{
+  struct ftpfs *fs = arg;
+
+  for (;;)
+    {
+      time_t period = fs->params.conn_keepalive;
+      struct ftpfs_conn *fsc, **fscp, *idle = 0;
+      time_t now;
+
+      sleep (period ?: KEEPALIVE_IDLE_CHECK);
+      if (! period)
+	continue;
+
+      /* Take out the connections that have been idle for a whole period,
+	 so that no one else uses them while we talk to the server.  */
+      now = NOW;
+      pthread_spin_lock (&fs->conn_lock);
+      for (fscp = &fs->free_conns; *fscp; )
+	{
+	  fsc = *fscp;
+	  if (fsc->last_used + period <= now)
+	    {
+	      *fscp = fsc->next;
+	      fs->num_free_conns--;
+	      fsc->next = idle;
+	      idle = fsc;
+	    }
+	  else
+	    fscp = &fsc->next;
+	}
+      pthread_spin_unlock (&fs->conn_lock);
+
+      while (idle)
+	{
+	  fsc = idle;
+	  idle = fsc->next;
+
+	  if (ftp_conn_noop (fsc->conn) == 0)
+	    pool_conn (fs, fsc);
+	  else
+	    {
+	      ftp_conn_free (fsc->conn);
+	      free (fsc);
+	    }
+	}
+    }
+
+  return 0;
 }
@@ -291,8 +291,9 @@ refresh_dir (struct ftpfs_dir *dir, int update_stats, time_t timestamp,
 	     struct ftpfs_dir_entry *preserve_entry)
 {
   error_t err;
-  struct ftp_conn *conn;
+  struct ftp_conn *conn = 0;
   struct dir_fetch_state dfs;
+  int got_stats = 0;
 
   if ((update_stats
        ? dir->stat_timestamp + dir->fs->params.stat_timeout
@@ -301,10 +302,6 @@ refresh_dir (struct ftpfs_dir *dir, int update_stats, time_t timestamp,
     /* We've already refreshed this directory recently.  */
     return 0;
 
-  err = ftpfs_get_ftp_conn (dir->fs, &conn);
-  if (err)
-    return err;
-
   /* Mark directory entries so we can GC them later using sweep.  */
   mark (dir);
 
@@ -325,22 +322,36 @@ refresh_dir (struct ftpfs_dir *dir, int update_stats, time_t timestamp,
 
   if (! err)
     {
-      /* Refetch the directory from the server.  */
-      if (update_stats)
-	/* Fetch both names and stat info.  */
-	err = ftp_conn_get_stats (conn, dir->rmt_path, 1,
-				  update_ordered_entry, &dfs);
-      else
-	/* Just fetch names.  */
-	err = ftp_conn_get_names (conn, dir->rmt_path,
-				  update_ordered_name, &dfs);
+      /* Use the listing fetched ahead of time, if there's a fresh one;
+	 then no connection is needed for it.  */
+      err = ftpfs_prefetched_stats (dir->fs, dir->rmt_path,
+				    timestamp - dir->fs->params.stat_timeout,
+				    update_ordered_entry, &dfs);
+      if (! err)
+	got_stats = 1;
+      else if (err == ENOENT)
+	err = ftpfs_get_ftp_conn (dir->fs, &conn);
+      if (conn && ! err)
+	{
+	  /* Refetch the directory from the server.  If the server can send
+	     names and stats in a single round trip, get both anyway.  */
+	  got_stats = update_stats || conn->use_mlsx;
+	  if (got_stats)
+	    /* Fetch both names and stat info.  */
+	    err = ftp_conn_get_stats (conn, dir->rmt_path, 1,
+				      update_ordered_entry, &dfs);
+	  else
+	    /* Just fetch names.  */
+	    err = ftp_conn_get_names (conn, dir->rmt_path,
+				      update_ordered_name, &dfs);
+	}
     }
 
   if (! err)
     /* GC any directory entries that weren't seen this time.  */
     {
       dir->name_timestamp = timestamp;
-      if (update_stats)
+      if (got_stats)
 	dir->stat_timestamp = timestamp;
       if (preserve_entry && !preserve_entry->valid)
 	{
@@ -350,7 +361,33 @@ refresh_dir (struct ftpfs_dir *dir, int update_stats, time_t timestamp,
       sweep (dir);
     }
 
-  ftpfs_release_ftp_conn (dir->fs, conn);
+  if (!err && got_stats && dir->fs->params.prefetch_threads > 0)
+    /* Whoever wanted this listing may well want those of the
+       subdirectories next.  */
+    {
+      struct ftpfs_dir_entry *e;
+
+      for (e = dir->ordered; e; e = e->ordered_next)
+	if (S_ISDIR (e->stat.st_mode) && *e->name
+	    && strcmp (e->name, ".") != 0 && strcmp (e->name, "..") != 0)
+	  {
+	    char *rmt_path;
+
+	    /* Names are joined as the server wants, which takes a
+	       connection.  */
+	    if (! conn && ftpfs_get_ftp_conn (dir->fs, &conn))
+	      break;
+	    if (ftp_conn_append_name (conn, dir->rmt_path, e->name,
+				      &rmt_path) == 0)
+	      {
+		ftpfs_prefetch_dir (dir->fs, rmt_path);
+		free (rmt_path);
+	      }
+	  }
+    }
+
+  if (conn)
+    ftpfs_release_ftp_conn (dir->fs, conn);
 
   return err;
 }
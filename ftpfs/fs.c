@@ -48,10 +48,16 @@ ftpfs_create (char *rmt_path, int fsid,
 
   new->free_conns = 0;
   new->conns = 0;
+  new->num_free_conns = 0;
   pthread_spin_init (&new->conn_lock, PTHREAD_PROCESS_PRIVATE);
   new->node_cache_mru = new->node_cache_lru = 0;
   new->node_cache_len = 0;
   pthread_mutex_init (&new->node_cache_lock, NULL);
+  new->prefetches = 0;
+  new->num_prefetches = 0;
+  new->prefetch_threads = 0;
+  pthread_mutex_init (&new->prefetch_lock, NULL);
+  pthread_cond_init (&new->prefetch_wakeup, NULL);
 
   new->fsid = fsid;
   new->next_inode = 2;
@@ -74,6 +80,15 @@ ftpfs_create (char *rmt_path, int fsid,
 	err = ftpfs_dir_null_lookup (super_root_dir, &new->root);
     }
 
+  if (! err)
+    {
+      pthread_t thread;
+
+      err = pthread_create (&thread, NULL, ftpfs_keepalive_thread, new);
+      if (! err)
+	pthread_detach (thread);
+    }
+
   if (err)
     {
       hurd_ihash_destroy (&new->inode_mappings);
@@ -106,6 +106,12 @@ cntl_debug (struct ftp_conn *conn, int type, const char *txt)
 
 #define DEFAULT_NODE_CACHE_MAX	50
 
+#define DEFAULT_CONTENTS_CACHE_MAX  (16*1024*1024)
+
+#define DEFAULT_CONN_POOL_SIZE	4
+#define DEFAULT_CONN_KEEPALIVE	60
+#define DEFAULT_PREFETCH_THREADS 4
+
 /* Return a string corresponding to the printed rep of DEFAULT_what */
 #define ___D(what) #what
 #define __D(what) ___D(what)
@@ -120,6 +126,10 @@ cntl_debug (struct ftp_conn *conn, int type, const char *txt)
 #define OPT_NODE_CACHE_MAX      8
 #define OPT_BULK_STAT_PERIOD    9
 #define OPT_BULK_STAT_THRESHOLD 10
+#define OPT_CONTENTS_CACHE_MAX  11
+#define OPT_CONN_POOL_SIZE      12
+#define OPT_CONN_KEEPALIVE      13
+#define OPT_PREFETCH_THREADS    14
 
 /* Options usable both at startup and at runtime.  */
 static const struct argp_option common_options[] =
@@ -135,6 +145,17 @@ static const struct argp_option common_options[] =
   {"node-cache-size", OPT_NODE_CACHE_MAX, "ENTRIES", 0,
    "Number of recently used filesystem nodes that are cached (default "
    _D(NODE_CACHE_MAX) ")"},
+  {"contents-cache-size", OPT_CONTENTS_CACHE_MAX, "BYTES", 0,
+   "Amount of memory used to cache file contents (default 16 megabytes)"},
+  {"conn-pool-size", OPT_CONN_POOL_SIZE, "ENTRIES", 0,
+   "Number of idle connections to the server kept open (default "
+   _D(CONN_POOL_SIZE) ")"},
+  {"keepalive", OPT_CONN_KEEPALIVE, "SECS", 0,
+   "Period after which a NOOP is sent over idle connections, or 0 not to"
+   " (default " _D(CONN_KEEPALIVE) ")"},
+  {"prefetch", OPT_PREFETCH_THREADS, "THREADS", 0,
+   "Number of threads fetching subdirectory listings ahead of time, or 0"
+   " not to (default " _D(PREFETCH_THREADS) ")"},
 
   {"bulk-stat-period",    OPT_BULK_STAT_PERIOD,    "SECS", 0,
    "Period for detecting bulk stats (default " _D(BULK_STAT_PERIOD) ")"},
@@ -203,6 +224,14 @@ parse_common_opt (int key, char *arg, struct argp_state *state)
 
     case OPT_NODE_CACHE_MAX:
       params->node_cache_max = atoi (arg); break;
+    case OPT_CONTENTS_CACHE_MAX:
+      params->contents_cache_max = strtoul (arg, 0, 0); break;
+    case OPT_CONN_POOL_SIZE:
+      params->conn_pool_size = atoi (arg); break;
+    case OPT_CONN_KEEPALIVE:
+      params->conn_keepalive = atoi (arg); break;
+    case OPT_PREFETCH_THREADS:
+      params->prefetch_threads = atoi (arg); break;
     case OPT_NAME_TIMEOUT:
       params->name_timeout = atoi (arg); break;
     case OPT_STAT_TIMEOUT:
@@ -359,6 +388,14 @@ netfs_append_args (char **argz, size_t *argz_len)
     FOPT ("--stat-timeout=%ld", ftpfs->params.stat_timeout);
   if (ftpfs->params.node_cache_max != DEFAULT_NODE_CACHE_MAX)
     FOPT ("--node-cache-size=%Zu", ftpfs->params.node_cache_max);
+  if (ftpfs->params.contents_cache_max != DEFAULT_CONTENTS_CACHE_MAX)
+    FOPT ("--contents-cache-size=%Zu", ftpfs->params.contents_cache_max);
+  if (ftpfs->params.conn_pool_size != DEFAULT_CONN_POOL_SIZE)
+    FOPT ("--conn-pool-size=%Zu", ftpfs->params.conn_pool_size);
+  if (ftpfs->params.conn_keepalive != DEFAULT_CONN_KEEPALIVE)
+    FOPT ("--keepalive=%ld", ftpfs->params.conn_keepalive);
+  if (ftpfs->params.prefetch_threads != DEFAULT_PREFETCH_THREADS)
+    FOPT ("--prefetch=%u", ftpfs->params.prefetch_threads);
   if (ftpfs->params.bulk_stat_period != DEFAULT_BULK_STAT_PERIOD)
     FOPT ("--bulk-stat-period=%ld", ftpfs->params.bulk_stat_period);
   if (ftpfs->params.bulk_stat_threshold != DEFAULT_BULK_STAT_THRESHOLD)
@@ -382,6 +419,10 @@ main (int argc, char **argv)
   ftpfs_params.name_timeout = DEFAULT_NAME_TIMEOUT;
   ftpfs_params.stat_timeout = DEFAULT_STAT_TIMEOUT;
   ftpfs_params.node_cache_max = DEFAULT_NODE_CACHE_MAX;
+  ftpfs_params.contents_cache_max = DEFAULT_CONTENTS_CACHE_MAX;
+  ftpfs_params.conn_pool_size = DEFAULT_CONN_POOL_SIZE;
+  ftpfs_params.conn_keepalive = DEFAULT_CONN_KEEPALIVE;
+  ftpfs_params.prefetch_threads = DEFAULT_PREFETCH_THREADS;
   ftpfs_params.bulk_stat_period = DEFAULT_BULK_STAT_PERIOD;
   ftpfs_params.bulk_stat_threshold = DEFAULT_BULK_STAT_THRESHOLD;
 
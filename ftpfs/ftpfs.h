@@ -30,6 +30,7 @@
 /* Anonymous types.  */
 struct ccache;
 struct ftpfs_conn;
+struct ftpfs_prefetch;
 
 /* A single entry in a directory.  */
 struct ftpfs_dir_entry
@@ -145,6 +146,21 @@ struct ftpfs_params
 
   /* The size of the node cache.  */
   size_t node_cache_max;
+
+  /* Amount of memory that may be used to cache file contents, shared by
+     all files.  */
+  size_t contents_cache_max;
+
+  /* The number of idle connections to the server kept open for reuse.  */
+  size_t conn_pool_size;
+
+  /* If non-zero, idle connections are kept alive by sending a NOOP after
+     this many seconds.  */
+  time_t conn_keepalive;
+
+  /* The number of threads fetching the listings of subdirectories ahead of
+     time; zero turns this off.  */
+  unsigned prefetch_threads;
 };
 
 /* A particular filesystem.  */
@@ -156,6 +172,7 @@ struct ftpfs
   /* A pool of ftp connections for server threads to use.  */
   struct ftpfs_conn *free_conns;
   struct ftpfs_conn *conns;
+  size_t num_free_conns;	/* Number of entries in FREE_CONNS.  */
   pthread_spinlock_t conn_lock;
 
   /* Parameters for making new ftp connections.  */
@@ -176,6 +193,14 @@ struct ftpfs
   struct node *node_cache_mru, *node_cache_lru;
   size_t node_cache_len;	/* Number of entries in it.  */
   pthread_mutex_t node_cache_lock;
+
+  /* Directory listings fetched ahead of time, oldest first.  */
+  struct ftpfs_prefetch *prefetches;
+  size_t num_prefetches;	/* Number of entries in it.  */
+  unsigned prefetch_threads;	/* Threads started to fetch them.  */
+  pthread_mutex_t prefetch_lock;
+  /* Signalled when a listing is queued or has been fetched.  */
+  pthread_cond_t prefetch_wakeup;
 };
 
 extern volatile struct mapped_time_value *ftpfs_maptime;
@@ -214,6 +239,24 @@ error_t ftpfs_get_ftp_conn (struct ftpfs *fs, struct ftp_conn **conn);
 /* Return CONN to the pool of free connections in FS.  */
 void ftpfs_release_ftp_conn (struct ftpfs *fs, struct ftp_conn *conn);
 
+/* Send a NOOP every so often over connections in the free pool of the
+   filesystem ARG, so that the server doesn't close them while they're idle.
+   Connections that turn out to be dead are thrown away.  */
+void *ftpfs_keepalive_thread (void *arg);
+
+/* Start fetching the listing of the remote directory RMT_PATH in FS in the
+   background, so that it's at hand if it's wanted soon.  */
+void ftpfs_prefetch_dir (struct ftpfs *fs, const char *rmt_path);
+
+/* If the listing of the remote directory RMT_PATH in FS has been fetched
+   ahead of time, no earlier than OLDEST, call ADD_STAT with HOOK for each
+   entry in it as ftp_conn_get_stats would, and return the result.  If
+   there's no such listing, return ENOENT.  The listing is used up either
+   way.  */
+error_t ftpfs_prefetched_stats (struct ftpfs *fs, const char *rmt_path,
+				time_t oldest,
+				ftp_conn_add_stat_fun_t add_stat, void *hook);
+
 /* Return in DIR a new ftpfs directory, in the filesystem FS, with node NODE
    and remote path RMT_PATH.  RMT_PATH is *not copied*, so it shouldn't ever
    change while this directory is active.  */
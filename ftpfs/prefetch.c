@@ -0,0 +1,293 @@
+/* Fetching directory listings ahead of time
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+/* Someone walking a tree (ls -lR, find, du...) will list each directory's
+   subdirectories right after listing the directory itself.  So whenever a
+   directory is listed, the listings of its subdirectories are fetched by a
+   few background threads over connections of their own, and the next
+   refresh of one of those directories just uses what's been fetched instead
+   of waiting for a round trip to the server.  */
+
+#include <string.h>
+
+#include <hurd/netfs.h>
+
+#include "ftpfs.h"
+
+/* The most listings kept around at once; when more are wanted, only those
+   already too old to be used are thrown away, and past that the new ones
+   are not fetched, as those asked for first are likely wanted first.  */
+#define MAX_PREFETCHES	64
+
+/* One entry in a listing.  */
+struct prefetch_entry
+{
+  char *name;
+  struct stat stat;
+  char *symlink_target;
+  struct prefetch_entry *next;
+};
+
+/* A directory listing fetched, or being fetched, ahead of time.  */
+struct ftpfs_prefetch
+{
+  /* The remote directory.  */
+  char *rmt_path;
+
+  enum { PREFETCH_QUEUED, PREFETCH_ACTIVE, PREFETCH_DONE, PREFETCH_FAILED }
+    state;
+
+  /* When the listing was fetched.  */
+  time_t timestamp;
+
+  /* The entries in the listing, in the order the server sent them.  */
+  struct prefetch_entry *entries, **entries_tail;
+
+  struct ftpfs_prefetch *next;
+};
+
+static void
+free_prefetch (struct ftpfs_prefetch *pf)
+{
+  struct prefetch_entry *e, *next;
+
+  for (e = pf->entries; e; e = next)
+    {
+      next = e->next;
+      free (e->name);
+      free (e->symlink_target);
+      free (e);
+    }
+  free (pf->rmt_path);
+  free (pf);
+}
+
+/* Return the listing of RMT_PATH in FS, or 0; if PREVP isn't 0, a pointer
+   to the pointer to it is returned there.  FS's prefetch lock should be
+   held.  */
+static struct ftpfs_prefetch *
+find_prefetch (struct ftpfs *fs, const char *rmt_path,
+	       struct ftpfs_prefetch ***prevp)
+{
+  struct ftpfs_prefetch *pf, **prev;
+
+  for (prev = &fs->prefetches; (pf = *prev); prev = &pf->next)
+    if (strcmp (pf->rmt_path, rmt_path) == 0)
+      break;
+  if (prevp)
+    *prevp = prev;
+  return pf;
+}
+
+/* Add an entry to the listing HOOK; called by ftp_conn_get_stats.  */
+static error_t
+add_entry (const char *name, const struct stat *stat,
+	   const char *symlink_target, void *hook)
+{
+  struct ftpfs_prefetch *pf = hook;
+  struct prefetch_entry *e = malloc (sizeof *e);
+
+  if (! e)
+    return ENOMEM;
+
+  e->name = strdup (name);
+  e->symlink_target = symlink_target ? strdup (symlink_target) : 0;
+  if (!e->name || (symlink_target && !e->symlink_target))
+    {
+      free (e->name);
+      free (e->symlink_target);
+      free (e);
+      return ENOMEM;
+    }
+  e->stat = *stat;
+  e->next = 0;
+
+  *pf->entries_tail = e;
+  pf->entries_tail = &e->next;
+
+  return 0;
+}
+
+/* Fetch queued listings for the filesystem ARG, forever.  */
+static void *
+prefetch_thread (void *arg)
+{
+  struct ftpfs *fs = arg;
+
+  pthread_mutex_lock (&fs->prefetch_lock);
+  for (;;)
+    {
+      struct ftpfs_prefetch *pf;
+      struct ftp_conn *conn;
+      error_t err;
+
+      for (pf = fs->prefetches; pf; pf = pf->next)
+	if (pf->state == PREFETCH_QUEUED)
+	  break;
+      if (! pf)
+	{
+	  pthread_cond_wait (&fs->prefetch_wakeup, &fs->prefetch_lock);
+	  continue;
+	}
+
+      /* While active, PF stays put, and only we touch its entries.  */
+      pf->state = PREFETCH_ACTIVE;
+      pthread_mutex_unlock (&fs->prefetch_lock);
+
+      err = ftpfs_get_ftp_conn (fs, &conn);
+      if (! err)
+	{
+	  err = ftp_conn_get_stats (conn, pf->rmt_path, 1, add_entry, pf);
+	  ftpfs_release_ftp_conn (fs, conn);
+	}
+
+      pthread_mutex_lock (&fs->prefetch_lock);
+      pf->state = err ? PREFETCH_FAILED : PREFETCH_DONE;
+      pf->timestamp = NOW;
+      pthread_cond_broadcast (&fs->prefetch_wakeup);
+    }
+
+  return 0;
+}
+
+/* Start fetching the listing of the remote directory RMT_PATH in FS in the
+   background, so that it's at hand if it's wanted soon.  */
+void
+ftpfs_prefetch_dir (struct ftpfs *fs, const char *rmt_path)
+{
+  struct ftpfs_prefetch *pf, **prev;
+
+  if (fs->params.prefetch_threads == 0)
+    return;
+
+  pthread_mutex_lock (&fs->prefetch_lock);
+
+  if (find_prefetch (fs, rmt_path, 0))
+    /* Already there.  */
+    {
+      pthread_mutex_unlock (&fs->prefetch_lock);
+      return;
+    }
+
+  if (fs->num_prefetches >= MAX_PREFETCHES)
+    /* Make room by dropping a listing that can't be used any more.  */
+    {
+      time_t oldest = NOW - fs->params.stat_timeout;
+
+      for (prev = &fs->prefetches; (pf = *prev); prev = &pf->next)
+	if (pf->state == PREFETCH_FAILED
+	    || (pf->state == PREFETCH_DONE && pf->timestamp < oldest))
+	  break;
+      if (! pf)
+	{
+	  pthread_mutex_unlock (&fs->prefetch_lock);
+	  return;
+	}
+      *prev = pf->next;
+      fs->num_prefetches--;
+      free_prefetch (pf);
+    }
+
+  pf = malloc (sizeof *pf);
+  if (pf)
+    {
+      pf->rmt_path = strdup (rmt_path);
+      if (! pf->rmt_path)
+	{
+	  free (pf);
+	  pf = 0;
+	}
+    }
+  if (! pf)
+    {
+      pthread_mutex_unlock (&fs->prefetch_lock);
+      return;
+    }
+
+  pf->state = PREFETCH_QUEUED;
+  pf->timestamp = 0;
+  pf->entries = 0;
+  pf->entries_tail = &pf->entries;
+  pf->next = 0;
+
+  /* Add it at the end, keeping the list oldest first.  */
+  for (prev = &fs->prefetches; *prev; prev = &(*prev)->next)
+    ;
+  *prev = pf;
+  fs->num_prefetches++;
+
+  if (fs->prefetch_threads < fs->params.prefetch_threads)
+    {
+      pthread_t thread;
+
+      if (pthread_create (&thread, NULL, prefetch_thread, fs) == 0)
+	{
+	  pthread_detach (thread);
+	  fs->prefetch_threads++;
+	}
+    }
+
+  pthread_cond_broadcast (&fs->prefetch_wakeup);
+  pthread_mutex_unlock (&fs->prefetch_lock);
+}
+
+/* If the listing of the remote directory RMT_PATH in FS has been fetched
+   ahead of time, no earlier than OLDEST, call ADD_STAT with HOOK for each
+   entry in it as ftp_conn_get_stats would, and return the result.  If
+   there's no such listing, return ENOENT.  The listing is used up either
+   way.  */
+error_t
+ftpfs_prefetched_stats (struct ftpfs *fs, const char *rmt_path,
+			time_t oldest,
+			ftp_conn_add_stat_fun_t add_stat, void *hook)
+{
+  struct ftpfs_prefetch *pf, **prev;
+  struct prefetch_entry *e;
+  error_t err = 0;
+
+  pthread_mutex_lock (&fs->prefetch_lock);
+
+  while ((pf = find_prefetch (fs, rmt_path, &prev))
+	 && pf->state == PREFETCH_ACTIVE)
+    /* It's on its way; that's likely quicker than starting over.  */
+    if (pthread_hurd_cond_wait_np (&fs->prefetch_wakeup, &fs->prefetch_lock))
+      {
+	pthread_mutex_unlock (&fs->prefetch_lock);
+	return EINTR;
+      }
+
+  if (pf)
+    {
+      *prev = pf->next;
+      fs->num_prefetches--;
+    }
+
+  pthread_mutex_unlock (&fs->prefetch_lock);
+
+  if (!pf || pf->state != PREFETCH_DONE || pf->timestamp < oldest)
+    err = ENOENT;
+  else
+    for (e = pf->entries; e && !err; e = e->next)
+      err = (*add_stat) (e->name, &e->stat, e->symlink_target, hook);
+
+  if (pf)
+    free_prefetch (pf);
+
+  return err;
+}
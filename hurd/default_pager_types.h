@@ -29,4 +29,22 @@ typedef const recnum_t *const_recnum_array_t;
 typedef vm_size_t *vm_size_array_t;
 typedef const vm_size_t *const_vm_size_array_t;
 
+/* Returned by default_pager_paging_stats.  */
+typedef struct default_pager_paging_stats
+{
+  vm_size_t dps_pageins;	/* Pages asked for by the kernel.  */
+  vm_size_t dps_pagein_reads;	/* Reads done to get them.  */
+  vm_size_t dps_readahead_pages; /* Pages read along with them.  */
+  vm_size_t dps_readahead_hits;	/* Of those, pages later asked for.  */
+  vm_size_t dps_pageouts;	/* Pages returned by the kernel.  */
+  vm_size_t dps_pageout_writes;	/* Writes done to store them.  */
+  vm_size_t dps_allocs;		/* Blocks allocated for pages.  */
+  vm_size_t dps_clustered_allocs; /* Of those, blocks right next to
+				   those of neighbouring pages.  */
+  vm_size_t dps_compressed_pages; /* Pages in the compressed pool.  */
+  vm_size_t dps_compressed_bytes; /* Memory they take.  */
+  vm_size_t dps_compressed_hits; /* Pageins served from the pool.  */
+  vm_size_t dps_compressed_evictions; /* Pages written out of it.  */
+} default_pager_paging_stats_t;
+
 #endif
@@ -54,6 +54,7 @@ typedef mach_port_t ctty_t;
 typedef mach_port_t pci_t;
 typedef mach_port_t shutdown_t;
 typedef mach_port_t acpi_t;
+typedef mach_port_t rpcstats_t;
 
 #include <errno.h>		/* Defines `error_t'.  */
 
@@ -170,6 +171,11 @@ typedef enum file_changed_type file_changed_type_t;
 #define FSYS_GOAWAY_UNLINK    0x00000008 /* Go away only if non-directory.  */
 #define FSYS_GOAWAY_RECURSE   0x00000010 /* Shutdown children too.  */
 
+/* Flags for rpcstats.defs:rpcstats_control.  */
+#define RPCSTATS_ENABLE       0x00000001 /* Start gathering statistics.  */
+#define RPCSTATS_DISABLE      0x00000002 /* Stop gathering statistics.  */
+#define RPCSTATS_RESET        0x00000004 /* Forget what was gathered.  */
+
 /* Types of ports the terminal driver can run on top of;
    used in term.defs:term_get_bottom_type.  */
 enum term_bottom_type
@@ -59,6 +59,7 @@ diskfs_user_make_node (struct node **npp, struct lookup_context *ctx)
   /* Format specific data for the new node.  */
   dn = diskfs_node_disknode (np);
   dn->fileinfo = 0;
+  dn->dirindex = 0;
   dn->dr = ctx->dr;
   err = calculate_file_start (ctx->dr, &dn->file_start, &ctx->rr);
   if (err)
@@ -328,8 +329,11 @@ diskfs_node_norefs (struct node *np)
   if (np->dn->translator)
     free (np->dn->translator);
 
+  if (np->dn->dirindex)
+    dirindex_free (np->dn->dirindex);
+
   assert_backtrace (!np->dn->fileinfo);
-  free (np);
+  diskfs_dealloc_node (np);
 }
 
 /* The user must define this function if she wants to use the node
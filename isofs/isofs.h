@@ -1,5 +1,5 @@
 /*
-   Copyright (C) 1997, 1999 Free Software Foundation, Inc.
+   Copyright (C) 1997, 1999, 2026 Free Software Foundation, Inc.
    Written by Thomas Bushnell, n/BSG.
 
    This file is part of the GNU Hurd.
@@ -43,6 +43,9 @@ struct disknode
 
   size_t translen;
   char *translator;
+
+  /* For directories, the index of their entries, once built.  */
+  struct dirindex *dirindex;
 };
 
 struct user_pager_info
@@ -102,5 +105,7 @@ error_t cache_id (struct dirrect *record, struct rrip_lookup *rr, ino_t *idp);
 
 error_t calculate_file_start (struct dirrect *, off_t *, struct rrip_lookup *);
 
+void dirindex_free (struct dirindex *);
+
 char *isodate_915 (char *, struct timespec *);
 char *isodate_84261 (char *, struct timespec *);
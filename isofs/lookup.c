@@ -1,5 +1,5 @@
 /*
-   Copyright (C) 1997,98,99,2001,02 Free Software Foundation, Inc.
+   Copyright (C) 1997,98,99,2001,02,2026 Free Software Foundation, Inc.
    Written by Thomas Bushnell, n/BSG.
 
    This file is part of the GNU Hurd.
@@ -20,15 +20,41 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
 #include <dirent.h>
+#include <hurd/ihash.h>
 #include "isofs.h"
 
 /* From inode.c */
 int use_file_start_id (struct dirrect *record, struct rrip_lookup *rr);
 
-/* Forward */
-static error_t dirscanblock (void *, const char *, size_t,
-			     struct dirrect **, struct rrip_lookup *);
+/* Finding a name in a directory means parsing the Rock-Ridge fields of
+   each record until one matches, and so does skipping to an entry in
+   readdir.  As the medium never changes, each directory is scanned
+   just once instead, into an index kept with its node.  */
+
+/* An entry in a directory index.  */
+struct dirindex_entry
+{
+  struct dirrect *dr;		/* Its record, somewhere in disk_image.  */
+  char *name;			/* The name readdir reports.  */
+  size_t namelen;
+  char *key;			/* The name it's hashed by (maybe NAME).  */
+  int rrname;			/* NAME is from a Rock-Ridge NM field.  */
+  ino_t fileno;			/* The file number readdir reports.  */
+  struct dirindex_entry *same;	/* The next entry with the same key.  */
+};
+
+struct dirindex
+{
+  /* Entries, in directory order, by key.  Entries having the same key
+     are chained by their SAME field, and only the first is hashed.  */
+  struct hurd_ihash names;
+
+  /* All entries but RE ones, in directory order.  */
+  struct dirindex_entry *entries;
+  int nentries;
+};
 
 static int
 isonamematch (const char *dirname, size_t dnamelen,
@@ -63,18 +89,299 @@ isonamematch (const char *dirname, size_t dnamelen,
   return 0;
 }
 
+/* Free the directory index INDEX.  */
+void
+dirindex_free (struct dirindex *index)
+{
+  int i;
+
+  hurd_ihash_destroy (&index->names);
+  for (i = 0; i < index->nentries; i++)
+    {
+      if (index->entries[i].key != index->entries[i].name)
+	free (index->entries[i].key);
+      free (index->entries[i].name);
+    }
+  free (index->entries);
+  free (index);
+}
+
+/* Hash the name KEY.  */
+static hurd_ihash_key_t
+dirindex_hash (const void *key)
+{
+  return (hurd_ihash_key_t) hurd_ihash_hash32 (key, strlen (key), 0);
+}
+
+/* Compare the names KEY1 and KEY2.  */
+static int
+dirindex_compare (const void *key1, const void *key2)
+{
+  return strcmp (key1, key2) == 0;
+}
+
+/* Store in KEY, which must hold NAMELEN + 1 characters, the key under
+   which an ISO 9660 name matching NAME (length NAMELEN) is hashed: the
+   name in lower case, without any version number and trailing dots.  */
+static void
+iso_key (char *key, const char *name, size_t namelen)
+{
+  size_t len;
+
+  if ((namelen == 1 && name[0] == '.')
+      || (namelen == 2 && name[0] == '.' && name[1] == '.'))
+    {
+      memcpy (key, name, namelen);
+      key[namelen] = '\0';
+      return;
+    }
+
+  for (len = 0; len < namelen && name[len] != ';'; len++)
+    key[len] = tolower (name[len]);
+  while (len > 0 && key[len - 1] == '.')
+    len--;
+  key[len] = '\0';
+}
+
+/* Call FUN with HOOK for each record in the directory DP, until it
+   returns nonzero, which is then returned.  */
+static error_t
+dirindex_scan (struct node *dp,
+	       error_t (*fun) (struct dirrect *record, void *hook),
+	       void *hook)
+{
+  void *buf = disk_image + (dp->dn->file_start << store->log2_block_size);
+  void *blkaddr, *currentoff;
+  struct dirrect *entry;
+  size_t reclen;
+  error_t err;
+
+  for (blkaddr = buf;
+       blkaddr < buf + dp->dn_stat.st_size;
+       blkaddr += logical_sector_size)
+    for (currentoff = blkaddr;
+	 currentoff < blkaddr + logical_sector_size;
+	 currentoff += reclen)
+      {
+	entry = (struct dirrect *) currentoff;
+
+	reclen = entry->len;
+
+	/* Validate reclen; a bad one ends the logical sector.  */
+	if (reclen == 0
+	    || reclen < sizeof (struct dirrect) + entry->namelen
+	    || currentoff + reclen > blkaddr + logical_sector_size)
+	  break;
+
+	err = (*fun) (entry, hook);
+	if (err)
+	  return err;
+      }
+
+  return 0;
+}
+
+/* Count the record ENTRY in the int HOOK.  */
+static error_t
+dirindex_count (struct dirrect *entry, void *hook)
+{
+  ++*(int *) hook;
+  return 0;
+}
+
+/* Add the record ENTRY to the directory index HOOK.  */
+static error_t
+dirindex_add (struct dirrect *entry, void *hook)
+{
+  struct dirindex *index = hook;
+  struct dirindex_entry *e = &index->entries[index->nentries];
+  struct dirindex_entry *first;
+  struct rrip_lookup rr;
+  const char *name;
+  error_t err = 0;
+
+  rrip_lookup (entry, &rr, 0);
+
+  /* Ignore RE entries */
+  if (rr.valid & VALID_RE)
+    {
+      release_rrip (&rr);
+      return 0;
+    }
+
+  e->dr = entry;
+  e->same = 0;
+  e->rrname = !!(rr.valid & VALID_NM);
+  if (e->rrname)
+    {
+      name = rr.name;
+      e->namelen = strlen (name);
+    }
+  else if (entry->namelen == 1 && entry->name[0] == '\0')
+    {
+      name = ".";
+      e->namelen = 1;
+    }
+  else if (entry->namelen == 1 && entry->name[0] == '\1')
+    {
+      name = "..";
+      e->namelen = 2;
+    }
+  else
+    {
+      name = (const char *) entry->name;
+      e->namelen = entry->namelen;
+    }
+
+  e->name = strndup (name, e->namelen);
+  if (e->rrname)
+    e->key = e->name;
+  else
+    {
+      e->key = malloc (e->namelen + 1);
+      if (e->key)
+	iso_key (e->key, e->name, e->namelen);
+    }
+  if (!e->name || !e->key)
+    {
+      if (e->key != e->name)
+	free (e->key);
+      free (e->name);
+      release_rrip (&rr);
+      return ENOMEM;
+    }
+
+  if (use_file_start_id (entry, &rr))
+    {
+      off_t file_start;
+
+      err = calculate_file_start (entry, &file_start, &rr);
+      e->fileno = file_start << store->log2_block_size;
+    }
+  else
+    e->fileno = (ino_t) ((void *) entry - (void *) disk_image);
+
+  release_rrip (&rr);
+
+  /* From now on it's freed with the index.  */
+  index->nentries++;
+
+  if (err)
+    return err;
+
+  first = hurd_ihash_find (&index->names, (hurd_ihash_key_t) e->key);
+  if (first)
+    {
+      while (first->same)
+	first = first->same;
+      first->same = e;
+    }
+  else
+    err = hurd_ihash_add (&index->names, (hurd_ihash_key_t) e->key, e);
+
+  return err;
+}
+
+/* Return in *INDEX the index of the directory DP, which must be locked,
+   building it if it hasn't been built yet.  */
+static error_t
+dirindex_get (struct node *dp, struct dirindex **index)
+{
+  struct dirindex *new;
+  int nrecords = 0;
+  error_t err;
+
+  if (dp->dn->dirindex)
+    {
+      *index = dp->dn->dirindex;
+      return 0;
+    }
+
+  new = malloc (sizeof *new);
+  if (! new)
+    return ENOMEM;
+  hurd_ihash_init (&new->names, HURD_IHASH_NO_LOCP);
+  hurd_ihash_set_gki (&new->names, dirindex_hash, dirindex_compare);
+  new->entries = 0;
+  new->nentries = 0;
+
+  err = diskfs_catch_exception ();
+  if (err)
+    {
+      dirindex_free (new);
+      return err;
+    }
+
+  /* The entries are counted first, so that they can be kept in an
+     array, which the hash table may point into.  */
+  dirindex_scan (dp, dirindex_count, &nrecords);
+  if (nrecords > 0)
+    {
+      new->entries = calloc (nrecords, sizeof *new->entries);
+      if (! new->entries)
+	err = ENOMEM;
+    }
+  if (! err)
+    err = dirindex_scan (dp, dirindex_add, new);
+
+  diskfs_end_catch_exception ();
+
+  if (err)
+    {
+      dirindex_free (new);
+      return err;
+    }
+
+  *index = dp->dn->dirindex = new;
+  return 0;
+}
+
+/* Return the first entry in INDEX matching NAME (length NAMELEN), or 0
+   if there is none.  */
+static struct dirindex_entry *
+dirindex_lookup (struct dirindex *index, const char *name, size_t namelen)
+{
+  struct dirindex_entry *e, *found = 0;
+  char *key = alloca (namelen + 1);
+
+  /* Rock-Ridge names have to match exactly...  */
+  for (e = hurd_ihash_find (&index->names, (hurd_ihash_key_t) name);
+       e; e = e->same)
+    if (e->rrname && e->namelen == namelen
+	&& memcmp (e->name, name, namelen) == 0)
+      {
+	found = e;
+	break;
+      }
+
+  /* ... while ISO 9660 ones are looked up by their key.  Entries are in
+     directory order, so the first matching one of both is found.  */
+  iso_key (key, name, namelen);
+  for (e = hurd_ihash_find (&index->names, (hurd_ihash_key_t) key);
+       e && (!found || e < found); e = e->same)
+    if (!e->rrname
+	&& isonamematch ((const char *) e->dr->name, e->dr->namelen,
+			 name, namelen))
+      {
+	found = e;
+	break;
+      }
+
+  return found;
+}
+
 /* Implement the diskfs_lookup callback from the diskfs library.  See
    <hurd/diskfs.h> for the interface specification. */
 error_t
 diskfs_lookup_hard (struct node *dp, const char *name, enum lookup_type type,
 		    struct node **npp, struct dirstat *ds, struct protid *cred)
 {
-  error_t err = ENOENT;
+  error_t err;
   struct lookup_context ctx;
   int namelen;
   int spec_dotdot;
-  void *buf;
-  void *blockaddr;
+  struct dirindex *index;
+  struct dirindex_entry *e;
   ino_t id;
 
   if ((type == REMOVE) || (type == RENAME))
@@ -93,20 +400,12 @@ diskfs_lookup_hard (struct node *dp, const char *name, enum lookup_type type,
   if (type == RENAME)
     return EROFS;
 
-  buf = disk_image + (dp->dn->file_start << store->log2_block_size);
-
-  for (blockaddr = buf;
-       blockaddr < buf + dp->dn_stat.st_size;
-       blockaddr += logical_sector_size)
-    {
-      err = dirscanblock (blockaddr, name, namelen, &ctx.dr, &ctx.rr);
-
-      if (!err)
-	break;
+  err = dirindex_get (dp, &index);
+  if (err)
+    return err;
 
-      if (err != ENOENT)
-	return err;
-    }
+  e = dirindex_lookup (index, name, namelen);
+  err = e ? 0 : ENOENT;
 
   if ((!err && type == REMOVE)
       || (err == ENOENT && type == CREATE))
@@ -115,9 +414,15 @@ diskfs_lookup_hard (struct node *dp, const char *name, enum lookup_type type,
   if (err)
     return err;
 
+  ctx.dr = e->dr;
+  rrip_lookup (ctx.dr, &ctx.rr, 0);
+
   err = cache_id (ctx.dr, &ctx.rr, &id);
   if (err)
-    return err;
+    {
+      release_rrip (&ctx.rr);
+      return err;
+    }
 
   /* Load the inode */
   if (namelen == 2 && name[0] == '.' && name[1] == '.')
@@ -153,73 +458,6 @@ diskfs_lookup_hard (struct node *dp, const char *name, enum lookup_type type,
   return err;
 }
 
-
-/* Scan one logical sector of directory contents (at address BLKADDR)
-   for NAME of length NAMELEN.  Return its address in *RECORD. */
-static error_t
-dirscanblock (void *blkaddr, const char *name, size_t namelen,
-	      struct dirrect **record, struct rrip_lookup *rr)
-{
-  struct dirrect *entry;
-  void *currentoff;
-  size_t reclen;
-  size_t entry_namelen;
-  int matchrr;
-  int matchnormal;
-
-  for (currentoff = blkaddr;
-       currentoff < blkaddr + logical_sector_size;
-       currentoff += reclen)
-    {
-      entry = (struct dirrect *) currentoff;
-
-      reclen = entry->len;
-
-      /* Validate reclen */
-      if (reclen == 0
-	  || reclen < sizeof (struct dirrect)
-	  || currentoff + reclen > blkaddr + logical_sector_size)
-	break;
-
-      entry_namelen = entry->namelen;
-
-      /* More validation */
-      if (reclen < sizeof (struct dirrect) + entry_namelen)
-	break;
-
-      /* Check to see if the name matches the directory entry. */
-      if (isonamematch ((const char *) entry->name, entry_namelen, name, namelen))
-	matchnormal = 1;
-      else
-	matchnormal = 0;
-
-      /* Now scan for RRIP fields */
-      matchrr = rrip_match_lookup (entry, name, namelen, rr);
-
-      /* Ignore RE entries */
-      if (rr->valid & VALID_RE)
-	{
-	  release_rrip (rr);
-	  continue;
-	}
-
-      /* See if the name matches */
-      if (((rr->valid & VALID_NM) && matchrr)
-	  || (!(rr->valid & VALID_NM) && matchnormal))
-	{
-	  /* We've got it.  Return success */
-	  *record = entry;
-	  return 0;
-	}
-
-      release_rrip (rr);
-    }
-
-  /* Wasn't there. */
-  *record = 0;
-  return ENOENT;
-}
-
 error_t
 diskfs_get_directs (struct node *dp,
 		    int entry,
@@ -229,15 +467,18 @@ diskfs_get_directs (struct node *dp,
 		    vm_size_t bufsiz,
 		    int *amt)
 {
-  volatile vm_size_t allocsize;
-  struct dirrect *ep;
+  vm_size_t allocsize;
   struct dirent *userp;
   int i;
-  void *dirbuf, *bufp;
   char *datap;
-  volatile int ouralloc = 0;
+  int ouralloc = 0;
+  struct dirindex *index;
   error_t err;
 
+  err = dirindex_get (dp, &index);
+  if (err)
+    return err;
+
   /* Allocate some space to hold the returned data. */
   allocsize = bufsiz ? round_page (bufsiz) : vm_page_size * 4;
   if (allocsize > *datacnt)
@@ -246,158 +487,52 @@ diskfs_get_directs (struct node *dp,
       ouralloc = 1;
     }
 
-  err = diskfs_catch_exception ();
-  if (err)
-    {
-      if (ouralloc)
-	munmap (*data, allocsize);
-      return err;
-    }
-
-  /* Skip to ENTRY */
-  dirbuf = disk_image + (dp->dn->file_start << store->log2_block_size);
-  bufp = dirbuf;
-  for (i = 0; i < entry; i ++)
-    {
-      struct rrip_lookup rr;
-
-      ep = (struct dirrect *) bufp;
-      rrip_lookup (ep, &rr, 0);
-
-      /* Ignore and skip RE entries */
-      if (rr.valid & VALID_RE)
-	i--;
-      else
-	{
-	  if (bufp - dirbuf >= dp->dn_stat.st_size)
-	    {
-	      /* Not that many entries in the directory; return nothing. */
-	      release_rrip (&rr);
-	      if (allocsize > *datacnt)
-		munmap (data, allocsize);
-	      *datacnt = 0;
-	      *amt = 0;
-	      return 0;
-	    }
-	}
-      bufp = bufp + ep->len;
-      release_rrip (&rr);
-
-      /* If BUFP points at a null, then we have hit the last
-	 record in this logical sector.  In that case, skip up to
-	 the next logical sector. */
-      if (*(char *)bufp == '\0')
-	bufp = (void *) (((long) bufp & ~(logical_sector_size - 1))
-			 + logical_sector_size);
-    }
-
-  /* Now copy entries one at a time */
+  /* Now copy entries one at a time, starting at ENTRY.  */
   i = 0;
   datap = *data;
   while (((nentries == -1) || (i < nentries))
 	 && (!bufsiz || datap - *data < bufsiz)
-	 && ((void *) bufp - dirbuf < dp->dn_stat.st_size))
+	 && entry + i < index->nentries)
     {
-      struct rrip_lookup rr;
-      const char *name;
-      size_t namlen, reclen;
-
-      ep = (struct dirrect *) bufp;
+      struct dirindex_entry *e = &index->entries[entry + i];
+      size_t reclen;
 
-      /* Fetch Rock-Ridge information for this file */
-      rrip_lookup (ep, &rr, 0);
+      reclen = sizeof (struct dirent) + e->namelen;
+      reclen = (reclen + 3) & ~3;
 
-      /* Ignore and skip RE entries */
-      if (! (rr.valid & VALID_RE))
+      /* Expand buffer if necessary */
+      if (datap - *data + reclen > allocsize)
 	{
-	  /* See if there's room to hold this one */
-	  name = rr.valid & VALID_NM ? rr.name : (char *) ep->name;
-	  namlen = rr.valid & VALID_NM ? strlen (name) : ep->namelen;
-
-	  /* Name frobnication */
-	  if (!(rr.valid & VALID_NM))
-	    {
-	      if (namlen == 1 && name[0] == '\0')
-		{
-		  name = ".";
-		  namlen = 1;
-		}
-	      else if (namlen == 1 && name[0] == '\1')
-		{
-		  name = "..";
-		  namlen = 2;
-		}
-	      /* Perhaps downcase it too? */
-	    }
-
-	  reclen = sizeof (struct dirent) + namlen;
-	  reclen = (reclen + 3) & ~3;
-
-	  /* Expand buffer if necessary */
-	  if (datap - *data + reclen > allocsize)
-	    {
-	      vm_address_t newdata;
-
-	      vm_allocate (mach_task_self (), &newdata,
-			   (ouralloc
-			    ? (allocsize *= 2)
-			    : (allocsize = vm_page_size * 2)), 1);
-	      memcpy ((void *) newdata, (void *) *data, datap - *data);
-
-	      if (ouralloc)
-		munmap (*data, allocsize / 2);
-
-	      datap = (char *) newdata + (datap - *data);
-	      *data = (char *) newdata;
-	      ouralloc = 1;
-	    }
-
-	  userp = (struct dirent *) datap;
-
-	  /* Fill in entry */
-
-	  if (use_file_start_id (ep, &rr))
-	    {
-	      off_t file_start;
-
-	      err = calculate_file_start (ep, &file_start, &rr);
-	      if (err)
-		{
-		  release_rrip (&rr);
-		  diskfs_end_catch_exception ();
-		  if (ouralloc)
-		    munmap (*data, allocsize);
-		  return err;
-		}
-
-	      userp->d_fileno = file_start << store->log2_block_size;
-	    }
-	  else
-	    userp->d_fileno = (ino_t) ((void *) ep - (void *) disk_image);
-
-	  userp->d_type = DT_UNKNOWN;
-	  userp->d_reclen = reclen;
-	  userp->d_namlen = namlen;
-	  memcpy (userp->d_name, name, namlen);
-	  userp->d_name[namlen] = '\0';
-
-	  /* And move along */
-	  datap = datap + reclen;
-	  i++;
+	  vm_address_t newdata;
+
+	  vm_allocate (mach_task_self (), &newdata,
+		       (ouralloc
+			? (allocsize *= 2)
+			: (allocsize = vm_page_size * 2)), 1);
+	  memcpy ((void *) newdata, (void *) *data, datap - *data);
+
+	  if (ouralloc)
+	    munmap (*data, allocsize / 2);
+
+	  datap = (char *) newdata + (datap - *data);
+	  *data = (char *) newdata;
+	  ouralloc = 1;
 	}
 
-      release_rrip (&rr);
-      bufp = bufp + ep->len;
-
-      /* If BUFP points at a null, then we have hit the last
-	 record in this logical sector.  In that case, skip up to
-	 the next logical sector. */
-      if (*(char *)bufp == '\0')
-	bufp = (void *) (((long) bufp & ~(logical_sector_size - 1))
-			 + logical_sector_size);
-    }
+      userp = (struct dirent *) datap;
 
-  diskfs_end_catch_exception ();
+      /* Fill in entry */
+      userp->d_fileno = e->fileno;
+      userp->d_type = DT_UNKNOWN;
+      userp->d_reclen = reclen;
+      userp->d_namlen = e->namelen;
+      memcpy (userp->d_name, e->name, e->namelen);
+      userp->d_name[e->namelen] = '\0';
+
+      /* And move along */
+      datap = datap + reclen;
+      i++;
+    }
 
   /* If we didn't use all the pages of a buffer we allocated, free
      the excess.  */
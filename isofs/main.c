@@ -38,6 +38,7 @@ int diskfs_synchronous = 0;
 int diskfs_link_max = INT_MAX;
 int diskfs_name_max = 255;	/* see iso9660.h: struct dirrect::namelen */
 int diskfs_maxsymlinks = 8;
+int diskfs_slab_nodes = 1;
 
 char *host_name;
 char *mounted_on;
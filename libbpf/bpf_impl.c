@@ -49,292 +49,440 @@
 static struct net_hash_header filter_hash_header[N_NET_HASH];
 
 /*
- * Execute the filter program starting at pc on the packet p
- * wirelen is the length of the original packet
- * buflen is the amount of data present
- *
- * @p: packet data.
- * @wirelen: data_count (in bytes)
- * @hlen: header len (in bytes)
+ * Filters are translated when they are set, so that running them on
+ * each packet takes as little as possible: bpf_run jumps from one
+ * instruction straight to the code of the next (direct threading),
+ * without decoding it or checking where the filter ends, as
+ * bpf_validate has made sure that it ends with a return.  Filters
+ * that only look at the Ethernet type, as those of pfinet do, are
+ * not even run: their result for each type is looked up.
  */
 
-int
-bpf_do_filter(net_rcv_port_t infp, char *p,	unsigned int wirelen,
-		char *header, unsigned int hlen, net_hash_entry_t **hash_headpp,
+enum bpf_op {
+	OP_REJECT,
+	OP_RET_K, OP_RET_A, OP_MATCH,
+	OP_LD_W_ABS, OP_LD_H_ABS, OP_LD_B_ABS,
+	OP_LD_W_IND, OP_LD_H_IND, OP_LD_B_IND,
+	OP_LD_LEN, OP_LDX_LEN, OP_LDX_MSH,
+	OP_LD_IMM, OP_LDX_IMM, OP_LD_MEM, OP_LDX_MEM, OP_ST, OP_STX,
+	OP_JA, OP_JGT_K, OP_JGE_K, OP_JEQ_K, OP_JSET_K,
+	OP_JGT_X, OP_JGE_X, OP_JEQ_X, OP_JSET_X,
+	OP_ADD_X, OP_SUB_X, OP_MUL_X, OP_DIV_X,
+	OP_AND_X, OP_OR_X, OP_LSH_X, OP_RSH_X,
+	OP_ADD_K, OP_SUB_K, OP_MUL_K, OP_DIV_K,
+	OP_AND_K, OP_OR_K, OP_LSH_K, OP_RSH_K,
+	OP_NEG, OP_TAX, OP_TXA,
+	OP_COUNT
+};
+
+/* The code of each operation in bpf_run.  */
+static const void *const *bpf_labels;
+
+/*
+ * Return where the SIZE bytes at offset K of a packet are, or 0 if K
+ * is out of bounds.  Offsets below HLEN are in the HEADER, the others
+ * in P.
+ */
+static inline unsigned char *
+bpf_data(unsigned int k, unsigned int size, char *p,
+		char *header, unsigned int hlen)
+{
+	if (size <= hlen && k <= hlen - size)
+		return (unsigned char *)header + k;
+	if (k <= NET_RCV_MAX - size)
+		return (unsigned char *)p + (int)(k - hlen);
+	return 0;
+}
+
+static inline unsigned int
+bpf_ret(net_rcv_port_t infp, unsigned int ret, unsigned int wirelen,
 		net_hash_entry_t *entpp)
 {
-	bpf_insn_t pc, pc_end;
-	unsigned int buflen;
+	if (infp->rcv_port == MACH_PORT_NULL && *entpp == 0)
+		return 0;
+	return (ret <= wirelen) ? ret : wirelen;
+}
 
-	unsigned int A, X;
-	int k;
+/*
+ * Run the translated filter of INFP.  If INFP is null, set
+ * bpf_labels instead.
+ */
+static int
+bpf_run(net_rcv_port_t infp, char *p, unsigned int wirelen,
+		char *header, unsigned int hlen, net_hash_entry_t **hash_headpp,
+		net_hash_entry_t *entpp)
+{
+	static const void *const labels[OP_COUNT] = {
+		[OP_REJECT] = &&reject,
+		[OP_RET_K] = &&ret_k, [OP_RET_A] = &&ret_a,
+		[OP_MATCH] = &&match,
+		[OP_LD_W_ABS] = &&ld_w_abs, [OP_LD_H_ABS] = &&ld_h_abs,
+		[OP_LD_B_ABS] = &&ld_b_abs,
+		[OP_LD_W_IND] = &&ld_w_ind, [OP_LD_H_IND] = &&ld_h_ind,
+		[OP_LD_B_IND] = &&ld_b_ind,
+		[OP_LD_LEN] = &&ld_len, [OP_LDX_LEN] = &&ldx_len,
+		[OP_LDX_MSH] = &&ldx_msh,
+		[OP_LD_IMM] = &&ld_imm, [OP_LDX_IMM] = &&ldx_imm,
+		[OP_LD_MEM] = &&ld_mem, [OP_LDX_MEM] = &&ldx_mem,
+		[OP_ST] = &&st, [OP_STX] = &&stx,
+		[OP_JA] = &&ja,
+		[OP_JGT_K] = &&jgt_k, [OP_JGE_K] = &&jge_k,
+		[OP_JEQ_K] = &&jeq_k, [OP_JSET_K] = &&jset_k,
+		[OP_JGT_X] = &&jgt_x, [OP_JGE_X] = &&jge_x,
+		[OP_JEQ_X] = &&jeq_x, [OP_JSET_X] = &&jset_x,
+		[OP_ADD_X] = &&add_x, [OP_SUB_X] = &&sub_x,
+		[OP_MUL_X] = &&mul_x, [OP_DIV_X] = &&div_x,
+		[OP_AND_X] = &&and_x, [OP_OR_X] = &&or_x,
+		[OP_LSH_X] = &&lsh_x, [OP_RSH_X] = &&rsh_x,
+		[OP_ADD_K] = &&add_k, [OP_SUB_K] = &&sub_k,
+		[OP_MUL_K] = &&mul_k, [OP_DIV_K] = &&div_k,
+		[OP_AND_K] = &&and_k, [OP_OR_K] = &&or_k,
+		[OP_LSH_K] = &&lsh_k, [OP_RSH_K] = &&rsh_k,
+		[OP_NEG] = &&neg, [OP_TAX] = &&tax, [OP_TXA] = &&txa,
+	};
+	const struct bpf_cinsn *code, *pc;
+	unsigned int A = 0, X = 0;
 	unsigned int mem[BPF_MEMWORDS];
+	unsigned char *d;
 
-	/* Generic pointer to either HEADER or P according to the specified offset. */
-	char *data = NULL;
-
-	pc = ((bpf_insn_t) infp->filter) + 1;
-	/* filter[0].code is (NETF_BPF | flags) */
-	pc_end = (bpf_insn_t)infp->filter_end;
-	buflen = NET_RCV_MAX;
-	*entpp = 0;			/* default */
-
-	A = 0;
-	X = 0;
-	for (; pc < pc_end; ++pc) {
-		switch (pc->code) {
-
-			default:
-				// Unknown instruction, abort
-				return 0;
-			case BPF_RET|BPF_K:
-				if (infp->rcv_port == MACH_PORT_NULL &&
-						*entpp == 0) {
-					return 0;
-				}
-				return ((u_int)pc->k <= wirelen) ?
-					pc->k : wirelen;
-
-			case BPF_RET|BPF_A:
-				if (infp->rcv_port == MACH_PORT_NULL &&
-						*entpp == 0) {
-					return 0;
-				}
-				return ((u_int)A <= wirelen) ?
-					A : wirelen;
-
-			case BPF_RET|BPF_MATCH_IMM:
-				if (bpf_match ((net_hash_header_t)infp, pc->jt, mem,
-							hash_headpp, entpp)) {
-					return ((u_int)pc->k <= wirelen) ?
-						pc->k : wirelen;
-				}
-				return 0;
-
-			case BPF_LD|BPF_W|BPF_ABS:
-				k = pc->k;
-
-load_word:
-				if ((u_int)k + sizeof(int) <= hlen)
-					data = header;
-				else if ((u_int)k + sizeof(int) <= buflen) {
-					k -= hlen;
-					data = p;
-				} else
-					return 0;
-
-#ifdef BPF_ALIGN
-				if (((int)(data + k) & 3) != 0)
-					A = EXTRACT_LONG(&data[k]);
-				else
-#endif
-					A = ntohl(*(int *)(data + k));
-				continue;
-
-			case BPF_LD|BPF_H|BPF_ABS:
-				k = pc->k;
-
-load_half:
-				if ((u_int)k + sizeof(short) <= hlen)
-					data = header;
-				else if ((u_int)k + sizeof(short) <= buflen) {
-					k -= hlen;
-					data = p;
-				} else
-					return 0;
-
-				A = EXTRACT_SHORT(&data[k]);
-				continue;
-
-			case BPF_LD|BPF_B|BPF_ABS:
-				k = pc->k;
-
-load_byte:
-				if ((u_int)k < hlen)
-					data = header;
-				else if ((u_int)k < buflen) {
-					data = p;
-					k -= hlen;
-				} else
-					return 0;
-
-				A = data[k];
-				continue;
-
-			case BPF_LD|BPF_W|BPF_LEN:
-				A = wirelen;
-				continue;
-
-			case BPF_LDX|BPF_W|BPF_LEN:
-				X = wirelen;
-				continue;
-
-			case BPF_LD|BPF_W|BPF_IND:
-				k = X + pc->k;
-				goto load_word;
-
-			case BPF_LD|BPF_H|BPF_IND:
-				k = X + pc->k;
-				goto load_half;
-
-			case BPF_LD|BPF_B|BPF_IND:
-				k = X + pc->k;
-				goto load_byte;
-
-			case BPF_LDX|BPF_MSH|BPF_B:
-				k = pc->k;
-				if (k < hlen)
-					data = header;
-				else if (k < buflen) {
-					data = p;
-					k -= hlen;
-				} else
-					return 0;
-
-				X = (data[k] & 0xf) << 2;
-				continue;
-
-			case BPF_LD|BPF_IMM:
-				A = pc->k;
-				continue;
-
-			case BPF_LDX|BPF_IMM:
-				X = pc->k;
-				continue;
-
-			case BPF_LD|BPF_MEM:
-				A = mem[pc->k];
-				continue;
-
-			case BPF_LDX|BPF_MEM:
-				X = mem[pc->k];
-				continue;
-
-			case BPF_ST:
-				mem[pc->k] = A;
-				continue;
-
-			case BPF_STX:
-				mem[pc->k] = X;
-				continue;
-
-			case BPF_JMP|BPF_JA:
-				pc += pc->k;
-				continue;
-
-			case BPF_JMP|BPF_JGT|BPF_K:
-				pc += (A > pc->k) ? pc->jt : pc->jf;
-				continue;
-
-			case BPF_JMP|BPF_JGE|BPF_K:
-				pc += (A >= pc->k) ? pc->jt : pc->jf;
-				continue;
-
-			case BPF_JMP|BPF_JEQ|BPF_K:
-				pc += (A == pc->k) ? pc->jt : pc->jf;
-				continue;
-
-			case BPF_JMP|BPF_JSET|BPF_K:
-				pc += (A & pc->k) ? pc->jt : pc->jf;
-				continue;
-
-			case BPF_JMP|BPF_JGT|BPF_X:
-				pc += (A > X) ? pc->jt : pc->jf;
-				continue;
-
-			case BPF_JMP|BPF_JGE|BPF_X:
-				pc += (A >= X) ? pc->jt : pc->jf;
-				continue;
-
-			case BPF_JMP|BPF_JEQ|BPF_X:
-				pc += (A == X) ? pc->jt : pc->jf;
-				continue;
+#define NEXT		goto *(++pc)->op
+#define JUMP(t)		do { pc = code + (t); goto *pc->op; } while (0)
+#define LOAD(k, size)	if (!(d = bpf_data(k, size, p, header, hlen))) \
+				return 0
 
-			case BPF_JMP|BPF_JSET|BPF_X:
-				pc += (A & X) ? pc->jt : pc->jf;
-				continue;
+	if (infp == 0) {
+		bpf_labels = labels;
+		return 0;
+	}
 
-			case BPF_ALU|BPF_ADD|BPF_X:
-				A += X;
-				continue;
+	code = infp->code;
+	pc = code + 1;
+	/* filter[0].code is (NETF_BPF | flags) */
+	goto *pc->op;
 
-			case BPF_ALU|BPF_SUB|BPF_X:
-				A -= X;
-				continue;
+reject:
+	return 0;
+ret_k:
+	return bpf_ret(infp, pc->k, wirelen, entpp);
+ret_a:
+	return bpf_ret(infp, A, wirelen, entpp);
+match:
+	if (bpf_match((net_hash_header_t)infp, pc->jt, mem,
+				hash_headpp, entpp))
+		return (pc->k <= wirelen) ? pc->k : wirelen;
+	return 0;
 
-			case BPF_ALU|BPF_MUL|BPF_X:
-				A *= X;
-				continue;
+ld_w_abs:
+	LOAD(pc->k, sizeof(int));
+	A = EXTRACT_LONG(d);
+	NEXT;
+ld_h_abs:
+	LOAD(pc->k, sizeof(short));
+	A = EXTRACT_SHORT(d);
+	NEXT;
+ld_b_abs:
+	LOAD(pc->k, 1);
+	A = *d;
+	NEXT;
+ld_w_ind:
+	LOAD(X + pc->k, sizeof(int));
+	A = EXTRACT_LONG(d);
+	NEXT;
+ld_h_ind:
+	LOAD(X + pc->k, sizeof(short));
+	A = EXTRACT_SHORT(d);
+	NEXT;
+ld_b_ind:
+	LOAD(X + pc->k, 1);
+	A = *d;
+	NEXT;
+ld_len:
+	A = wirelen;
+	NEXT;
+ldx_len:
+	X = wirelen;
+	NEXT;
+ldx_msh:
+	LOAD(pc->k, 1);
+	X = (*d & 0xf) << 2;
+	NEXT;
+ld_imm:
+	A = pc->k;
+	NEXT;
+ldx_imm:
+	X = pc->k;
+	NEXT;
+ld_mem:
+	A = mem[pc->k];
+	NEXT;
+ldx_mem:
+	X = mem[pc->k];
+	NEXT;
+st:
+	mem[pc->k] = A;
+	NEXT;
+stx:
+	mem[pc->k] = X;
+	NEXT;
+
+ja:
+	JUMP(pc->jt);
+jgt_k:
+	JUMP((A > pc->k) ? pc->jt : pc->jf);
+jge_k:
+	JUMP((A >= pc->k) ? pc->jt : pc->jf);
+jeq_k:
+	JUMP((A == pc->k) ? pc->jt : pc->jf);
+jset_k:
+	JUMP((A & pc->k) ? pc->jt : pc->jf);
+jgt_x:
+	JUMP((A > X) ? pc->jt : pc->jf);
+jge_x:
+	JUMP((A >= X) ? pc->jt : pc->jf);
+jeq_x:
+	JUMP((A == X) ? pc->jt : pc->jf);
+jset_x:
+	JUMP((A & X) ? pc->jt : pc->jf);
+
+add_x:
+	A += X;
+	NEXT;
+sub_x:
+	A -= X;
+	NEXT;
+mul_x:
+	A *= X;
+	NEXT;
+div_x:
+	if (X == 0)
+		return 0;
+	A /= X;
+	NEXT;
+and_x:
+	A &= X;
+	NEXT;
+or_x:
+	A |= X;
+	NEXT;
+lsh_x:
+	A <<= X;
+	NEXT;
+rsh_x:
+	A >>= X;
+	NEXT;
+add_k:
+	A += pc->k;
+	NEXT;
+sub_k:
+	A -= pc->k;
+	NEXT;
+mul_k:
+	A *= pc->k;
+	NEXT;
+div_k:
+	A /= pc->k;
+	NEXT;
+and_k:
+	A &= pc->k;
+	NEXT;
+or_k:
+	A |= pc->k;
+	NEXT;
+lsh_k:
+	A <<= pc->k;
+	NEXT;
+rsh_k:
+	A >>= pc->k;
+	NEXT;
+neg:
+	A = -A;
+	NEXT;
+tax:
+	X = A;
+	NEXT;
+txa:
+	A = X;
+	NEXT;
+
+#undef NEXT
+#undef JUMP
+#undef LOAD
+}
 
-			case BPF_ALU|BPF_DIV|BPF_X:
-				if (X == 0)
-					return 0;
-				A /= X;
-				continue;
+/*
+ * Return the operation of the instruction F.
+ */
+static enum bpf_op
+bpf_op(bpf_insn_t f)
+{
+	switch (f->code) {
+		case BPF_RET|BPF_K:		return OP_RET_K;
+		case BPF_RET|BPF_A:		return OP_RET_A;
+		case BPF_RET|BPF_MATCH_IMM:	return OP_MATCH;
+		case BPF_LD|BPF_W|BPF_ABS:	return OP_LD_W_ABS;
+		case BPF_LD|BPF_H|BPF_ABS:	return OP_LD_H_ABS;
+		case BPF_LD|BPF_B|BPF_ABS:	return OP_LD_B_ABS;
+		case BPF_LD|BPF_W|BPF_IND:	return OP_LD_W_IND;
+		case BPF_LD|BPF_H|BPF_IND:	return OP_LD_H_IND;
+		case BPF_LD|BPF_B|BPF_IND:	return OP_LD_B_IND;
+		case BPF_LD|BPF_W|BPF_LEN:	return OP_LD_LEN;
+		case BPF_LDX|BPF_W|BPF_LEN:	return OP_LDX_LEN;
+		case BPF_LDX|BPF_MSH|BPF_B:	return OP_LDX_MSH;
+		case BPF_LD|BPF_IMM:		return OP_LD_IMM;
+		case BPF_LDX|BPF_IMM:		return OP_LDX_IMM;
+		case BPF_LD|BPF_MEM:		return OP_LD_MEM;
+		case BPF_LDX|BPF_MEM:		return OP_LDX_MEM;
+		case BPF_ST:			return OP_ST;
+		case BPF_STX:			return OP_STX;
+		case BPF_JMP|BPF_JA:		return OP_JA;
+		case BPF_JMP|BPF_JGT|BPF_K:	return OP_JGT_K;
+		case BPF_JMP|BPF_JGE|BPF_K:	return OP_JGE_K;
+		case BPF_JMP|BPF_JEQ|BPF_K:	return OP_JEQ_K;
+		case BPF_JMP|BPF_JSET|BPF_K:	return OP_JSET_K;
+		case BPF_JMP|BPF_JGT|BPF_X:	return OP_JGT_X;
+		case BPF_JMP|BPF_JGE|BPF_X:	return OP_JGE_X;
+		case BPF_JMP|BPF_JEQ|BPF_X:	return OP_JEQ_X;
+		case BPF_JMP|BPF_JSET|BPF_X:	return OP_JSET_X;
+		case BPF_ALU|BPF_ADD|BPF_X:	return OP_ADD_X;
+		case BPF_ALU|BPF_SUB|BPF_X:	return OP_SUB_X;
+		case BPF_ALU|BPF_MUL|BPF_X:	return OP_MUL_X;
+		case BPF_ALU|BPF_DIV|BPF_X:	return OP_DIV_X;
+		case BPF_ALU|BPF_AND|BPF_X:	return OP_AND_X;
+		case BPF_ALU|BPF_OR|BPF_X:	return OP_OR_X;
+		case BPF_ALU|BPF_LSH|BPF_X:	return OP_LSH_X;
+		case BPF_ALU|BPF_RSH|BPF_X:	return OP_RSH_X;
+		case BPF_ALU|BPF_ADD|BPF_K:	return OP_ADD_K;
+		case BPF_ALU|BPF_SUB|BPF_K:	return OP_SUB_K;
+		case BPF_ALU|BPF_MUL|BPF_K:	return OP_MUL_K;
+		case BPF_ALU|BPF_DIV|BPF_K:	return OP_DIV_K;
+		case BPF_ALU|BPF_AND|BPF_K:	return OP_AND_K;
+		case BPF_ALU|BPF_OR|BPF_K:	return OP_OR_K;
+		case BPF_ALU|BPF_LSH|BPF_K:	return OP_LSH_K;
+		case BPF_ALU|BPF_RSH|BPF_K:	return OP_RSH_K;
+		case BPF_ALU|BPF_NEG:		return OP_NEG;
+		case BPF_MISC|BPF_TAX:		return OP_TAX;
+		case BPF_MISC|BPF_TXA:		return OP_TXA;
+		default:			return OP_REJECT;
+	}
+}
 
-			case BPF_ALU|BPF_AND|BPF_X:
-				A &= X;
-				continue;
+#define BPF_TYPE_HASH(t)	(((t) ^ ((t) >> 6)) & (BPF_TYPE_SLOTS - 1))
 
-			case BPF_ALU|BPF_OR|BPF_X:
-				A |= X;
-				continue;
+/*
+ * Return the result of the filter F, which only tests the Ethernet
+ * type, for packets of type TYPE, or of a type it does not test for
+ * if TYPE is -1.
+ */
+static unsigned int
+bpf_type_result(bpf_insn_t f, int type)
+{
+	int i = 2;
 
-			case BPF_ALU|BPF_LSH|BPF_X:
-				A <<= X;
-				continue;
+	while (f[i].code != (BPF_RET|BPF_K))
+		i += 1 + ((type >= 0 && (u_int)type == (u_int)f[i].k) ?
+				f[i].jt : f[i].jf);
+	return f[i].k;
+}
 
-			case BPF_ALU|BPF_RSH|BPF_X:
-				A >>= X;
-				continue;
+/*
+ * If the valid filter F of LEN instructions only loads the Ethernet
+ * type and compares it with constants, fill in MAP with its result
+ * for each type and return TRUE.
+ */
+static boolean_t
+bpf_type_map_init(bpf_insn_t f, int len, struct bpf_type_map *map)
+{
+	int i, h;
 
-			case BPF_ALU|BPF_ADD|BPF_K:
-				A += pc->k;
-				continue;
+	if (len < 3 || f[1].code != (BPF_LD|BPF_H|BPF_ABS) || f[1].k != 12)
+		return FALSE;
+	for (i = 2; i < len; i++)
+		if (f[i].code != (BPF_JMP|BPF_JEQ|BPF_K)
+				&& f[i].code != (BPF_RET|BPF_K))
+			return FALSE;
 
-			case BPF_ALU|BPF_SUB|BPF_K:
-				A -= pc->k;
-				continue;
+	memset(map, 0, sizeof *map);
+	map->other = bpf_type_result(f, -1);
 
-			case BPF_ALU|BPF_MUL|BPF_K:
-				A *= pc->k;
-				continue;
+	for (i = 2; i < len; i++) {
+		unsigned int type = (u_int)f[i].k;
 
-			case BPF_ALU|BPF_DIV|BPF_K:
-				A /= pc->k;
-				continue;
+		if (f[i].code != (BPF_JMP|BPF_JEQ|BPF_K) || type > 0xffff)
+			continue;
 
-			case BPF_ALU|BPF_AND|BPF_K:
-				A &= pc->k;
-				continue;
+		for (h = BPF_TYPE_HASH(type);
+				map->slots[h].used && map->slots[h].type != type;
+				h = (h + 1) & (BPF_TYPE_SLOTS - 1))
+			;
+		map->slots[h].used = 1;
+		map->slots[h].type = type;
+		map->slots[h].result = bpf_type_result(f, type);
+	}
+	return TRUE;
+}
 
-			case BPF_ALU|BPF_OR|BPF_K:
-				A |= pc->k;
-				continue;
+/*
+ * Translate the valid filter of INFP.
+ */
+static void
+bpf_compile(net_rcv_port_t infp)
+{
+	bpf_insn_t f = (bpf_insn_t)infp->filter;
+	int len = BPF_BYTES2LEN((char *)infp->filter_end
+			- (char *)infp->filter);
+	struct bpf_cinsn *c;
+	int i;
 
-			case BPF_ALU|BPF_LSH|BPF_K:
-				A <<= pc->k;
-				continue;
+	if (bpf_labels == 0)
+		bpf_run(0, 0, 0, 0, 0, 0, 0);
+
+	for (i = 1; i < len; i++) {
+		c = &infp->code[i];
+		c->op = bpf_labels[bpf_op(&f[i])];
+		c->k = f[i].k;
+		if (f[i].code == (BPF_JMP|BPF_JA))
+			c->jt = i + 1 + f[i].k;
+		else if (BPF_CLASS(f[i].code) == BPF_JMP) {
+			c->jt = i + 1 + f[i].jt;
+			c->jf = i + 1 + f[i].jf;
+		} else
+			c->jt = f[i].jt;	/* number of keys of a match */
+	}
 
-			case BPF_ALU|BPF_RSH|BPF_K:
-				A >>= pc->k;
-				continue;
+	infp->by_type = bpf_type_map_init(f, len, &infp->types);
+}
 
-			case BPF_ALU|BPF_NEG:
-				A = -A;
-				continue;
+/*
+ * Execute the filter program of INFP on the packet p
+ * wirelen is the length of the original packet
+ *
+ * @p: packet data.
+ * @wirelen: data_count (in bytes)
+ * @hlen: header len (in bytes)
+ */
 
-			case BPF_MISC|BPF_TAX:
-				X = A;
-				continue;
+int
+bpf_do_filter(net_rcv_port_t infp, char *p,	unsigned int wirelen,
+		char *header, unsigned int hlen, net_hash_entry_t **hash_headpp,
+		net_hash_entry_t *entpp)
+{
+	*entpp = 0;			/* default */
 
-			case BPF_MISC|BPF_TXA:
-				A = X;
-				continue;
-		}
+	if (infp->by_type) {
+		unsigned char *d = bpf_data(12, sizeof(short), p, header, hlen);
+		unsigned int type = EXTRACT_SHORT(d);
+		int h;
+
+		for (h = BPF_TYPE_HASH(type);
+				infp->types.slots[h].used;
+				h = (h + 1) & (BPF_TYPE_SLOTS - 1))
+			if (infp->types.slots[h].type == type)
+				return bpf_ret(infp, infp->types.slots[h].result,
+						wirelen, entpp);
+		return bpf_ret(infp, infp->types.other, wirelen, entpp);
 	}
 
-	return 0;
+	return bpf_run(infp, p, wirelen, header, hlen, hash_headpp, entpp);
 }
 
 /*
@@ -372,7 +520,7 @@ bpf_validate(bpf_insn_t f, int bytes, bpf_insn_t *match)
 			int from = i + 1;
 
 			if (BPF_OP(p->code) == BPF_JA) {
-				if (from + p->k >= len)
+				if ((u_int)p->k >= (u_int)(len - from))
 					return 0;
 			}
 			else if (from + p->jt >= len || from + p->jf >= len)
@@ -382,9 +530,11 @@ bpf_validate(bpf_insn_t f, int bytes, bpf_insn_t *match)
 		 * Check that memory operations use valid addresses.
 		 */
 		if ((BPF_CLASS(p->code) == BPF_ST ||
-					(BPF_CLASS(p->code) == BPF_LD &&
+					BPF_CLASS(p->code) == BPF_STX ||
+					((BPF_CLASS(p->code) == BPF_LD ||
+					  BPF_CLASS(p->code) == BPF_LDX) &&
 					 (p->code & 0xe0) == BPF_MEM)) &&
-				(p->k >= BPF_MEMWORDS || p->k < 0)) {
+				(u_int)p->k >= BPF_MEMWORDS) {
 			return 0;
 		}
 		/*
@@ -590,7 +740,7 @@ net_set_filter(if_filter_list_t *ifp, mach_port_t rcv_port, int priority,
 	filter_bytes = CSPF_BYTES (filter_count);
 	match = (bpf_insn_t) 0;
 
-	if (filter_count == 0) {
+	if (filter_count == 0 || filter_count > NET_MAX_FILTER) {
 		return (D_INVALID_OPERATION);
 	} else if (!((filter[0] & NETF_IN) || (filter[0] & NETF_OUT))) {
 		return (D_INVALID_OPERATION); /* NETF_IN or NETF_OUT required */
@@ -740,6 +890,7 @@ hash_loop_end:
 		memcpy (my_infp->filter, filter, filter_bytes);
 		my_infp->filter_end =
 			(filter_t *)((char *)my_infp->filter + filter_bytes);
+		bpf_compile(my_infp);
 
 		/* Insert my_infp according to priority */
 		if (in) {
@@ -92,6 +92,36 @@ typedef filter_t	*filter_array_t;
 
 #define CSPF_BYTES(n) ((n) * sizeof (filter_t))
 
+/* Maximum number of BPF instructions in a filter.  */
+#define BPF_MAX_INSNS	(CSPF_BYTES (NET_MAX_FILTER) / sizeof (struct bpf_insn))
+
+/*
+ * A BPF instruction as translated when the filter is set:
+ * OP is the address of the code executing it, and the
+ * targets of jumps are indices in the filter.
+ */
+struct bpf_cinsn {
+	const void	*op;
+	unsigned int	k;
+	unsigned short	jt, jf;
+};
+
+/*
+ * The result of a filter that only looks at the Ethernet type,
+ * for each type it tests, and for all others.  Types are found
+ * by open addressing.
+ */
+#define BPF_TYPE_SLOTS	64
+
+struct bpf_type_map {
+	unsigned int	other;
+	struct {
+		unsigned short	used;
+		unsigned short	type;
+		unsigned int	result;
+	} slots[BPF_TYPE_SLOTS];
+};
+
 /*
  * Receive port for net, with packet filter.
  * This data structure by itself represents a packet
@@ -106,6 +136,10 @@ struct net_rcv_port {
 	filter_t	*filter_end;	/* pointer to end of filter */
 	filter_t	filter[NET_MAX_FILTER];
 	/* filter operations */
+	struct bpf_cinsn code[BPF_MAX_INSNS];
+					/* FILTER, translated */
+	int		by_type;	/* TYPES gives the result */
+	struct bpf_type_map types;
 };
 typedef struct net_rcv_port *net_rcv_port_t;
 
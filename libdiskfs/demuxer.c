@@ -18,10 +18,12 @@
 #include "priv.h"
 
 #include "io_S.h"
+#include "io_transfer_S.h"
 #include "fs_S.h"
 #include "../libports/notify_S.h"
 #include "fsys_S.h"
 #include "../libports/interrupt_S.h"
+#include "../libports/rpcstats_S.h"
 #include "ifsock_S.h"
 #include "startup_notify_S.h"
 #include "exec_startup_S.h"
@@ -33,9 +35,11 @@ diskfs_demuxer (mach_msg_header_t *inp,
   mig_routine_t routine;
   if ((routine = diskfs_io_server_routine (inp)) ||
       (routine = diskfs_fs_server_routine (inp)) ||
+      (routine = diskfs_io_transfer_server_routine (inp)) ||
       (routine = ports_notify_server_routine (inp)) ||
       (routine = diskfs_fsys_server_routine (inp)) ||
       (routine = ports_interrupt_server_routine (inp)) ||
+      (routine = ports_rpcstats_server_routine (inp)) ||
       (diskfs_shortcut_ifsock ?
        (routine = diskfs_ifsock_server_routine (inp)) : 0) ||
       (routine = diskfs_startup_notify_server_routine (inp)) ||
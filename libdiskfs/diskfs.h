@@ -100,7 +100,10 @@ struct node
 
   /* Indicate whether the author is tracking the uid because the
      on-disk file format does not encode a separate author.  */
-    author_tracks_uid:1;
+    author_tracks_uid:1,
+
+  /* The node was allocated from a slab space rather than by malloc.  */
+    from_slab:1;
 
   pthread_mutex_t lock;
 
@@ -125,6 +128,9 @@ struct node
   loff_t allocsize;
 
   ino64_t cache_id;
+
+  /* Mappings of the file's contents kept for reads and writes.  */
+  struct diskfs_window *windows;
 };
 
 struct diskfs_control
@@ -208,6 +214,10 @@ extern int pager_port_type;
 /* Whether the filesystem is currently writable or not. */
 extern int diskfs_readonly;
 
+/* The most address space, in bytes, that mappings of files kept
+   between io_read and io_write calls may take.  Zero disables them.  */
+extern size_t diskfs_window_cache_size;
+
 
 struct pager;
 
@@ -299,6 +309,12 @@ extern int diskfs_shortcut_ifsock;
    thread is started up (in diskfs_spawn_first_thread).   */
 extern int diskfs_default_sync_interval;
 
+/* The user may define this variable to be nonzero if diskfs_node_norefs
+   frees nodes with diskfs_dealloc_node.  Nodes are then allocated from a
+   slab, which is cheaper when many are made and freed; otherwise they
+   are allocated with malloc, and may be freed with free.  */
+extern int diskfs_slab_nodes;
+
 /* The user must define this variable, which should be a string that somehow
    identifies the particular disk this filesystem is interpreting.  It is
    generally only used to print messages or to distinguish instances of the
@@ -450,7 +466,8 @@ error_t diskfs_alloc_node (struct node *dp, mode_t mode, struct node **np);
 void diskfs_free_node (struct node *np, mode_t mode);
 
 /* Node NP has no more references; free local state, including *NP
-   if it isn't to be retained.  */
+   (with diskfs_dealloc_node or free, see diskfs_slab_nodes) if it
+   isn't to be retained.  */
 void diskfs_node_norefs (struct node *np);
 
 /* The user must define this function unless she wants to use the node
@@ -584,6 +601,16 @@ extern error_t (*diskfs_create_symlink_hook)(struct node *np, const char *target
    used.  If it returns any other error, it is returned to the user. */
 extern error_t (*diskfs_read_symlink_hook)(struct node *np, char *target);
 
+/* If this function is nonzero it is called to read (DIR clear) or
+   write (DIR set) *AMT bytes of the contents of locked node NP at
+   OFFSET from or into DATA without going through the node's memory
+   object, and to set *AMT to the amount transferred.  If it returns
+   EINVAL or isn't set, then the normal method (pager_memcpy on the
+   object returned by diskfs_get_filemap) is used.  If it returns any
+   other error, it is returned to the user.  */
+extern error_t (*diskfs_rdwr_hook)(struct node *np, char *data, off_t offset,
+				   size_t *amt, int dir);
+
 /* The user may define this function.  The function must set source to
    the source of the translator. The function may return an EOPNOTSUPP
    to indicate that the concept of a source device is not
@@ -727,6 +754,12 @@ struct node *diskfs_make_node (struct disknode *dn);
    and no light references.  */
 struct node *diskfs_make_node_alloc (size_t size);
 
+/* Free the memory of node NP, made by diskfs_make_node or
+   diskfs_make_node_alloc.  This is the last thing diskfs_node_norefs
+   should do.  If diskfs_slab_nodes is set, the node must not be freed
+   with free.  */
+void diskfs_dealloc_node (struct node *np);
+
 /* To avoid breaking the ABI whenever sizeof (struct node) changes, we
    explicitly provide the size.  The following two functions will use
    this value for offset calculations.  */
@@ -30,6 +30,7 @@ diskfs_S_file_set_size (struct protid *cred,
 			 err = EINVAL;
 		       else if (size < np->dn_stat.st_size)
 			 {
+			   _diskfs_drop_windows (np);
 			   err = diskfs_truncate (np, size);
 			   if (!err && np->filemod_reqs)
 			     diskfs_notice_filechange (np, 
@@ -169,6 +169,7 @@ diskfs_S_file_set_translator (struct protid *cred,
 		  np->dn_stat.st_rdev = gnu_dev_makedev (major, minor);
 		}
 
+	      _diskfs_drop_windows (np);
 	      err = diskfs_truncate (np, 0);
 	      if (err)
 		{
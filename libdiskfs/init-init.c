@@ -52,6 +52,18 @@ struct port_class *diskfs_shutdown_notification_class;
 
 struct port_bucket *diskfs_port_bucket;
 
+/* Only the control port and root users may look at or change the RPC
+   statistics.  */
+static int
+rpcstats_allowed (struct port_info *pi)
+{
+  if (pi->class == diskfs_control_class)
+    return 1;
+  if (pi->class == diskfs_protid_class)
+    return idvec_contains (((struct protid *) pi)->user->uids, 0);
+  return 0;
+}
+
 /* Call this after arguments have been parsed to initialize the
    library.  */
 error_t
@@ -95,6 +107,7 @@ diskfs_init_diskfs (void)
   diskfs_shutdown_notification_class = ports_create_class (0, 0);
 
   diskfs_port_bucket = ports_create_bucket ();
+  ports_rpcstats_allowed = rpcstats_allowed;
 
   _hurd_port_init (&_diskfs_exec_portcell, MACH_PORT_NULL);
 
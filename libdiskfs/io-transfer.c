@@ -0,0 +1,152 @@
+/* libdiskfs implementation of io_transfer.defs: io_transfer
+   Copyright (C) 2026 Free Software Foundation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+#include "priv.h"
+#include "io_transfer_S.h"
+#include <fcntl.h>
+#include <hurd/pager.h>
+#include <sys/param.h>
+
+/* How much of the file is copied and sent to the destination at once.  */
+#define TRANSFER_WINDOW		(1024 * 1024)
+
+/* Implement io_transfer as described in <hurd/io_transfer.defs>.  The
+   file's pages are copied from its memory object with pager_memcpy,
+   which uses vm_copy for whole pages and turns faults into errors, and
+   are sent out-of-line, so the destination gets them by copy-on-write
+   rather than by value.  The writes time out (see the Makefile), so an
+   unresponsive destination cannot keep this thread forever.  */
+kern_return_t
+diskfs_S_io_transfer (struct protid *cred,
+		      mach_port_t destination,
+		      loff_t offset,
+		      vm_size_t amount,
+		      vm_size_t *transferred)
+{
+  struct node *np;
+  struct pager *pager = NULL;
+  memory_object_t memobj = MACH_PORT_NULL;
+  void *buf = MAP_FAILED;
+  off_t off = offset;
+  vm_size_t done = 0;
+  error_t err = 0;
+
+  if (!cred)
+    return EOPNOTSUPP;
+
+  np = cred->po->np;
+  if (!(cred->po->openstat & O_READ))
+    return EBADF;
+
+  pthread_mutex_lock (&np->lock);
+
+  if (! S_ISREG (np->dn_stat.st_mode))
+    {
+      pthread_mutex_unlock (&np->lock);
+      return EOPNOTSUPP;
+    }
+
+  iohelp_get_conch (&np->conch);
+
+  if (off == -1)
+    off = cred->po->filepointer;
+  if (off < 0)
+    {
+      pthread_mutex_unlock (&np->lock);
+      return EINVAL;
+    }
+
+  if (off >= np->dn_stat.st_size)
+    amount = 0;
+  else if (off + (off_t) amount > np->dn_stat.st_size)
+    amount = np->dn_stat.st_size - off;
+
+  /* We map the file, which inherently uses vm_offset_t.  */
+  if (sizeof (off_t) > sizeof (vm_offset_t)
+      && off + amount > ((off_t) 1) << (sizeof (vm_offset_t) * 8))
+    err = EFBIG;
+  else if (amount > 0)
+    {
+      memobj = diskfs_get_filemap (np, VM_PROT_READ);
+      if (memobj == MACH_PORT_NULL)
+	err = errno;
+      else
+	pager = diskfs_get_filemap_pager_struct (np);
+      if (!err)
+	{
+	  buf = mmap (0, TRANSFER_WINDOW, PROT_READ|PROT_WRITE,
+		      MAP_ANON, 0, 0);
+	  if (buf == MAP_FAILED)
+	    err = errno;
+	}
+      if (!err && !diskfs_check_readonly ()
+	  && !(cred->po->openstat & O_NOATIME)
+	  && atime_should_update (np))
+	np->dn_set_atime = 1;
+    }
+
+  /* Don't hold the node while the destination takes its time.  */
+  pthread_mutex_unlock (&np->lock);
+
+  while (!err && done < amount)
+    {
+      size_t len = MIN (amount - done, TRANSFER_WINDOW);
+      vm_size_t written;
+      error_t read_err;
+
+      read_err = pager_memcpy (pager, memobj, off + done, buf, &len,
+			       VM_PROT_READ);
+      if (len == 0)
+	{
+	  err = read_err;
+	  break;
+	}
+
+      err = iohelp_transfer_write (destination, buf, len, &written);
+      if (!err)
+	{
+	  done += written;
+	  if (written < len)
+	    break;
+	  err = read_err;
+	}
+    }
+
+  if (buf != MAP_FAILED)
+    munmap (buf, TRANSFER_WINDOW);
+  if (MACH_PORT_VALID (memobj))
+    mach_port_deallocate (mach_task_self (), memobj);
+
+  if (done > 0)
+    /* Report what was transferred, even if something went wrong later.  */
+    err = 0;
+
+  if (!err)
+    {
+      pthread_mutex_lock (&np->lock);
+      if (offset == -1)
+	cred->po->filepointer += done;
+      if (diskfs_synchronous)
+	diskfs_node_update (np, 1);	/* atime! */
+      pthread_mutex_unlock (&np->lock);
+
+      *transferred = done;
+      mach_port_deallocate (mach_task_self (), destination);
+    }
+
+  return err;
+}
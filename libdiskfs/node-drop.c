@@ -61,6 +61,7 @@ diskfs_drop_node (struct node *np)
 	     will notice that the size is zero, and not have to
 	     do anything. */
 	  refcounts_unsafe_ref (&np->refcounts, NULL);
+	  _diskfs_drop_windows (np);
 	  diskfs_truncate (np, 0);
 	  
 	  /* Force allocsize to zero; if truncate consistently fails this
@@ -92,6 +93,8 @@ diskfs_drop_node (struct node *np)
 
   assert_backtrace (!np->sockaddr);
 
+  _diskfs_drop_windows (np);
+
   pthread_mutex_unlock(&np->lock);
   pthread_mutex_destroy(&np->lock);
   diskfs_node_norefs (np);
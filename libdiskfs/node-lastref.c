@@ -30,6 +30,9 @@ _diskfs_lastref (struct node *np)
      updates now happen in a timely fashion.  */
   diskfs_set_node_times (np);
   diskfs_lost_hardrefs (np);
+
+  /* Our mappings would keep the file's memory object alive.  */
+  _diskfs_drop_windows (np);
   if (!np->dn_stat.st_nlink)
     {
       if (np->sockaddr != MACH_PORT_NULL)
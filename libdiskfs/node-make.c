@@ -16,7 +16,64 @@
 
 #include "priv.h"
 #include <fcntl.h>
+#include <hurd/slab.h>
 
+/* If diskfs_slab_nodes is set, nodes of NODE_SIZE bytes, the size of
+   the first one made, are allocated from NODE_SLAB unless it is null.
+   A filesystem makes all its nodes the same way, so this covers them
+   all.  */
+static size_t node_size;
+static struct hurd_slab_space *node_slab;
+static pthread_mutex_t node_slab_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Allocate SIZE bytes for a node.  */
+static struct node *
+alloc_node (size_t size)
+{
+  size_t obj_size;
+  struct node *np;
+  void *buf;
+
+  if (! diskfs_slab_nodes)
+    goto use_malloc;
+
+  obj_size = __atomic_load_n (&node_size, __ATOMIC_ACQUIRE);
+  if (! obj_size)
+    {
+      pthread_mutex_lock (&node_slab_lock);
+      if (! node_size)
+	{
+	  /* Aligned as malloc would, for the disknode.  */
+	  if (hurd_slab_create (size, 16, NULL, NULL, NULL, NULL, NULL,
+				&node_slab))
+	    node_slab = NULL;
+	  __atomic_store_n (&node_size, size, __ATOMIC_RELEASE);
+	}
+      obj_size = node_size;
+      pthread_mutex_unlock (&node_slab_lock);
+    }
+
+  if (obj_size == size && node_slab && ! hurd_slab_alloc (node_slab, &buf))
+    {
+      np = buf;
+      np->from_slab = 1;
+      return np;
+    }
+
+use_malloc:
+  np = malloc (size);
+  if (np)
+    np->from_slab = 0;
+  return np;
+}
+
+/* Give the memory of freed nodes back to the system.  */
+void
+_diskfs_reap_nodes (void)
+{
+  if (__atomic_load_n (&node_size, __ATOMIC_ACQUIRE) && node_slab)
+    hurd_slab_reap (node_slab);
+}
 
 static struct node *
 init_node (struct node *np, struct disknode *dn)
@@ -37,6 +94,7 @@ init_node (struct node *np, struct disknode *dn)
   np->dirmod_tick = 0;
   np->filemod_reqs = 0;
   np->filemod_tick = 0;
+  np->windows = NULL;
 
   fshelp_transbox_init (&np->transbox, &np->lock, np);
   iohelp_initialize_conch (&np->conch, &np->lock);
@@ -50,7 +108,7 @@ init_node (struct node *np, struct disknode *dn)
 struct node *
 diskfs_make_node (struct disknode *dn)
 {
-  struct node *np = malloc (sizeof (struct node));
+  struct node *np = alloc_node (sizeof (struct node));
 
   if (np == 0)
     return 0;
@@ -65,10 +123,21 @@ diskfs_make_node (struct disknode *dn)
 struct node *
 diskfs_make_node_alloc (size_t size)
 {
-  struct node *np = malloc (sizeof (struct node) + size);
+  struct node *np = alloc_node (sizeof (struct node) + size);
 
   if (np == NULL)
     return NULL;
 
   return init_node (np, diskfs_node_disknode (np));
 }
+
+/* Free the memory of node NP, made by diskfs_make_node or
+   diskfs_make_node_alloc.  */
+void
+diskfs_dealloc_node (struct node *np)
+{
+  if (np->from_slab)
+    hurd_slab_dealloc (node_slab, np);
+  else
+    free (np);
+}
@@ -19,6 +19,50 @@
 #include <stdlib.h>
 #include <sys/file.h>
 #include <hurd/fshelp.h>
+#include <hurd/slab.h>
+
+/* Peropens are allocated from PEROPEN_SLAB, or by malloc if it could
+   not be made.  */
+static struct hurd_slab_space *peropen_slab;
+static pthread_once_t peropen_slab_once = PTHREAD_ONCE_INIT;
+
+static void
+create_peropen_slab (void)
+{
+  if (hurd_slab_create (sizeof (struct peropen), 0, NULL, NULL, NULL, NULL,
+			NULL, &peropen_slab))
+    peropen_slab = NULL;
+}
+
+static struct peropen *
+alloc_peropen (void)
+{
+  void *buf;
+
+  pthread_once (&peropen_slab_once, create_peropen_slab);
+  if (! peropen_slab)
+    return malloc (sizeof (struct peropen));
+
+  return hurd_slab_alloc (peropen_slab, &buf) ? NULL : buf;
+}
+
+/* Free the memory of PO, made by diskfs_make_peropen.  */
+void
+_diskfs_free_peropen (struct peropen *po)
+{
+  if (peropen_slab)
+    hurd_slab_dealloc (peropen_slab, po);
+  else
+    free (po);
+}
+
+/* Give the memory of freed peropens back to the system.  */
+void
+_diskfs_reap_peropens (void)
+{
+  if (peropen_slab)
+    hurd_slab_reap (peropen_slab);
+}
 
 /* Create and return a new peropen structure on node NP with open
    flags FLAGS.  */
@@ -27,7 +71,7 @@ diskfs_make_peropen (struct node *np, int flags, struct peropen *context,
 		     struct peropen **ppo)
 {
   error_t err;
-  struct peropen *po = *ppo = malloc (sizeof (struct peropen));
+  struct peropen *po = *ppo = alloc_peropen ();
 
   if (! po)
     return ENOMEM;
@@ -35,7 +79,7 @@ diskfs_make_peropen (struct node *np, int flags, struct peropen *context,
   err = fshelp_rlock_po_init (&po->lock_status);
   if (err)
     {
-      free (po);
+      _diskfs_free_peropen (po);
       return err;
     }
 
@@ -53,7 +97,7 @@ diskfs_make_peropen (struct node *np, int flags, struct peropen *context,
 	  if (! po->path)
 	    {
 	      fshelp_rlock_po_fini (&po->lock_status);
-	      free (po);
+	      _diskfs_free_peropen (po);
 	      return ENOMEM;
 	    }
 	}
@@ -39,5 +39,5 @@ diskfs_release_peropen (struct peropen *po)
   fshelp_rlock_po_fini (&po->lock_status);
 
   free (po->path);
-  free (po);
+  _diskfs_free_peropen (po);
 }
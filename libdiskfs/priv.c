@@ -27,7 +27,11 @@ int diskfs_shortcut_chrdev __attribute__ ((weak)) = 0;
 int diskfs_shortcut_blkdev __attribute__ ((weak)) = 0;
 int diskfs_shortcut_fifo __attribute__ ((weak)) = 0;
 int diskfs_shortcut_ifsock __attribute__ ((weak)) = 0;
+int diskfs_slab_nodes __attribute__ ((weak)) = 0;
 error_t (*diskfs_create_symlink_hook)(struct node *np, const char *target)
   __attribute__ ((weak));
 error_t (*diskfs_read_symlink_hook)(struct node *np, char *target)
   __attribute__ ((weak));
+error_t (*diskfs_rdwr_hook)(struct node *np, char *data, off_t offset,
+			    size_t *amt, int dir)
+  __attribute__ ((weak));
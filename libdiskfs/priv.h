@@ -103,6 +103,25 @@ void _diskfs_control_clean (void *);
    links, then request soft references to be dropped.  */
 void _diskfs_lastref (struct node *np);
 
+/* Free the memory of PO, made by diskfs_make_peropen.  */
+void _diskfs_free_peropen (struct peropen *po);
+
+/* Release the memory the node and peropen slabs keep for reuse; called
+   by the periodic sync.  */
+void _diskfs_reap_nodes (void);
+void _diskfs_reap_peropens (void);
+
+/* Copy *AMT bytes between DATA and OFFSET in MEMOBJ, the memory object
+   of NP, like pager_memcpy, but through mappings kept for later calls.
+   NP must be locked.  */
+error_t _diskfs_window_memcpy (struct node *np, memory_object_t memobj,
+			       vm_offset_t offset, char *data, size_t *amt,
+			       vm_prot_t prot);
+
+/* Unmap the mappings kept for NP.  This must be done when NP is
+   truncated and when its last hard reference goes away.  */
+void _diskfs_drop_windows (struct node *np);
+
 /* If the disk is not readonly and noatime is not set, then check relatime
    conditions: if either `np->dn_stat.st_mtim.tv_sec' or
    `np->dn_stat.st_ctim.tv_sec' is greater than `np->dn_stat.st_atim.tv_sec',
@@ -49,6 +49,19 @@ _diskfs_rdwr_internal (struct node *np, char *data, off_t offset,
 	np->dn_set_atime = 1;
     }
 
+  if (diskfs_rdwr_hook)
+    {
+      size_t amount = *amt;
+      err = (*diskfs_rdwr_hook) (np, data, offset, &amount, dir);
+      if (err != EINVAL)
+	{
+	  if (!err)
+	    *amt = amount;
+	  return err;
+	}
+      err = 0;
+    }
+
   memobj = diskfs_get_filemap (np, prot);
 
   if (memobj == MACH_PORT_NULL)
@@ -61,8 +74,7 @@ _diskfs_rdwr_internal (struct node *np, char *data, off_t offset,
   else
     {
       size_t amount = *amt;
-      err = pager_memcpy (diskfs_get_filemap_pager_struct (np), memobj,
-                          offset, data, &amount, prot);
+      err = _diskfs_window_memcpy (np, memobj, offset, data, &amount, prot);
       if (!err)
         *amt = amount;
     }
@@ -0,0 +1,316 @@
+/* Mappings of file contents kept between reads and writes.
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+/* pager_memcpy maps a window of the file's memory object for every
+   copy and unmaps it again, which costs more than the copy itself for
+   small reads and writes.  Instead, windows of WINDOW_SIZE bytes
+   aligned on that size are kept mapped, on a list in their node, and
+   reused by later calls.  All the windows of all nodes are on one LRU
+   list; the least recently used ones are unmapped when they take more
+   than diskfs_window_cache_size bytes of address space.
+
+   A mapping keeps the memory object alive, so a node's windows are
+   dropped when its last hard reference goes away, and before it is
+   truncated, as the memory object may be replaced.  */
+
+#include "priv.h"
+#include <string.h>
+#include <setjmp.h>
+#include <hurd/pager.h>
+#include <hurd/sigpreempt.h>
+
+#define WINDOW_SIZE (32 * vm_page_size)
+
+size_t diskfs_window_cache_size = 16 * 1024 * 1024;
+
+struct diskfs_window
+{
+  struct diskfs_window *next;	/* In the node's list.  */
+  struct diskfs_window *lru_next, *lru_prev; /* Most recently used first.  */
+  struct node *np;
+  vm_offset_t offset;		/* In the file.  */
+  vm_address_t addr;
+  vm_prot_t prot;
+  int users;			/* Copies in progress.  */
+  int dead;			/* Unmap it when they are done.  */
+};
+
+/* Protects the windows of all nodes, and the following.  */
+static pthread_mutex_t window_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct diskfs_window *lru_first, *lru_last;
+static size_t window_space;
+
+/* Take W off its node's list and the LRU list.  WINDOW_LOCK must be
+   held.  */
+static void
+unlink_window (struct diskfs_window *w)
+{
+  struct diskfs_window **wp;
+
+  for (wp = &w->np->windows; *wp != w; wp = &(*wp)->next)
+    ;
+  *wp = w->next;
+
+  if (w->lru_prev)
+    w->lru_prev->lru_next = w->lru_next;
+  else
+    lru_first = w->lru_next;
+  if (w->lru_next)
+    w->lru_next->lru_prev = w->lru_prev;
+  else
+    lru_last = w->lru_prev;
+
+  window_space -= WINDOW_SIZE;
+}
+
+/* Make W the most recently used window.  WINDOW_LOCK must be held.  */
+static void
+link_first (struct diskfs_window *w)
+{
+  w->lru_prev = NULL;
+  w->lru_next = lru_first;
+  if (lru_first)
+    lru_first->lru_prev = w;
+  else
+    lru_last = w;
+  lru_first = w;
+}
+
+static void
+free_windows (struct diskfs_window *w)
+{
+  while (w)
+    {
+      struct diskfs_window *next = w->next;
+      vm_deallocate (mach_task_self (), w->addr, WINDOW_SIZE);
+      free (w);
+      w = next;
+    }
+}
+
+/* Return in *WP a window of MEMOBJ, the memory of NP, mapped at OFFSET
+   with (at least) PROT, for the caller to use until it calls
+   release_window.  */
+static error_t
+get_window (struct node *np, memory_object_t memobj, vm_offset_t offset,
+	    vm_prot_t prot, struct diskfs_window **wp)
+{
+  struct diskfs_window *w, *victims = NULL;
+  error_t err;
+
+  pthread_mutex_lock (&window_lock);
+  for (w = np->windows; w; w = w->next)
+    if (w->offset == offset && (w->prot & prot) == prot)
+      {
+	w->users++;
+	if (w != lru_first)
+	  {
+	    w->lru_prev->lru_next = w->lru_next;
+	    if (w->lru_next)
+	      w->lru_next->lru_prev = w->lru_prev;
+	    else
+	      lru_last = w->lru_prev;
+	    link_first (w);
+	  }
+	pthread_mutex_unlock (&window_lock);
+	*wp = w;
+	return 0;
+      }
+  pthread_mutex_unlock (&window_lock);
+
+  w = malloc (sizeof *w);
+  if (! w)
+    return ENOMEM;
+
+  w->addr = 0;
+  err = vm_map (mach_task_self (), &w->addr, WINDOW_SIZE, 0, 1,
+		memobj, offset, 0, prot, prot, VM_INHERIT_NONE);
+  if (err)
+    {
+      free (w);
+      return err;
+    }
+  w->np = np;
+  w->offset = offset;
+  w->prot = prot;
+  w->users = 1;
+  w->dead = 0;
+
+  pthread_mutex_lock (&window_lock);
+  w->next = np->windows;
+  np->windows = w;
+  link_first (w);
+  window_space += WINDOW_SIZE;
+
+  /* Make room, sparing the windows in use.  */
+  while (window_space > diskfs_window_cache_size)
+    {
+      struct diskfs_window *victim;
+
+      for (victim = lru_last; victim && victim->users;
+	   victim = victim->lru_prev)
+	;
+      if (! victim)
+	break;
+
+      unlink_window (victim);
+      victim->next = victims;
+      victims = victim;
+    }
+  pthread_mutex_unlock (&window_lock);
+
+  free_windows (victims);
+
+  *wp = w;
+  return 0;
+}
+
+/* The caller is done with W.  If FAULTED, it is not to be used
+   again.  */
+static void
+release_window (struct diskfs_window *w, int faulted)
+{
+  int unmap = 0;
+
+  pthread_mutex_lock (&window_lock);
+  if (faulted && ! w->dead)
+    {
+      unlink_window (w);
+      w->dead = 1;
+    }
+  if (--w->users == 0 && w->dead)
+    unmap = 1;
+  pthread_mutex_unlock (&window_lock);
+
+  if (unmap)
+    {
+      w->next = NULL;
+      free_windows (w);
+    }
+}
+
+/* Copy *AMT bytes between DATA and ADDR in window W, from DATA if DIR
+   is set.  If this faults, return the error and set *AMT to the
+   number of bytes copied before.  PAGER is where the error is looked
+   up, if not null.  */
+static error_t
+window_memcpy (struct pager *pager, struct diskfs_window *w,
+	       vm_address_t addr, char *data, size_t *amt, int dir)
+{
+  error_t err = 0;
+  jmp_buf buf;
+
+  error_t copy (struct hurd_signal_preemptor *preemptor)
+    {
+      if (dir)
+	memcpy ((void *) addr, data, *amt);
+      else
+	memcpy (data, (void *) addr, *amt);
+      return 0;
+    }
+
+  void fault (int signo, long int sigcode, struct sigcontext *scp)
+    {
+      assert_backtrace (scp->sc_error == EKERN_MEMORY_ERROR);
+      err = (pager
+	     ? pager_get_error (pager, sigcode - w->addr + w->offset)
+	     : EIO);
+      *amt = (vm_address_t) sigcode > addr ? sigcode - addr : 0;
+      siglongjmp (buf, 1);
+    }
+
+  if (sigsetjmp (buf, 1) == 0)
+    {
+      sigset_t mask;
+      sigemptyset (&mask);
+      sigaddset (&mask, SIGSEGV);
+      sigaddset (&mask, SIGBUS);
+      hurd_catch_signal (mask, w->addr, w->addr + WINDOW_SIZE,
+			 &copy, (sighandler_t) &fault);
+    }
+
+  return err;
+}
+
+/* Copy *AMT bytes between DATA and OFFSET in MEMOBJ, the memory of NP,
+   as pager_memcpy does, but through windows kept mapped between calls.
+   PROT says which way, as for pager_memcpy.  NP must be locked.  */
+error_t
+_diskfs_window_memcpy (struct node *np, memory_object_t memobj,
+		       vm_offset_t offset, char *data, size_t *amt,
+		       vm_prot_t prot)
+{
+  struct pager *pager = diskfs_get_filemap_pager_struct (np);
+  int dir = prot & VM_PROT_WRITE;
+  size_t left = *amt;
+  error_t err = 0;
+
+  /* Big copies are better done by pager_memcpy, with vm_copy.  */
+  if (left >= 8 * vm_page_size
+      || diskfs_window_cache_size < WINDOW_SIZE)
+    return pager_memcpy (pager, memobj, offset, data, amt, prot);
+
+  while (left > 0)
+    {
+      vm_offset_t start = offset - offset % WINDOW_SIZE;
+      size_t n = start + WINDOW_SIZE - offset;
+      struct diskfs_window *w;
+
+      if (n > left)
+	n = left;
+
+      err = get_window (np, memobj, start, prot, &w);
+      if (err)
+	break;
+      err = window_memcpy (pager, w, w->addr + offset - start, data, &n, dir);
+      release_window (w, err != 0);
+
+      offset += n;
+      data += n;
+      left -= n;
+      if (err)
+	break;
+    }
+
+  *amt -= left;
+  return err;
+}
+
+/* Unmap the windows of NP.  */
+void
+_diskfs_drop_windows (struct node *np)
+{
+  struct diskfs_window *w, *next, *unused = NULL;
+
+  pthread_mutex_lock (&window_lock);
+  for (w = np->windows; w; w = next)
+    {
+      next = w->next;
+      unlink_window (w);
+      if (w->users)
+	/* The last user unmaps it.  */
+	w->dead = 1;
+      else
+	{
+	  w->next = unused;
+	  unused = w;
+	}
+    }
+  pthread_mutex_unlock (&window_lock);
+
+  free_windows (unused);
+}
@@ -125,6 +125,8 @@ periodic_sync (void *arg)
 		}
 	      pthread_rwlock_unlock (&diskfs_fsys_lock);
 	    }
+	  _diskfs_reap_nodes ();
+	  _diskfs_reap_peropens ();
 	  ports_end_rpc (pi, &link);
 	}
 
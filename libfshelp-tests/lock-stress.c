@@ -0,0 +1,134 @@
+/* Stress and time record locking.
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with the GNU Hurd.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "../libfshelp/fshelp.h"
+#include "../libfshelp/rlock.h"
+#include <errno.h>
+#include <error.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct rlock_box box;
+pthread_mutex_t box_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int nthreads;
+int nlocks;
+int rounds;
+
+/* Each thread owns a peropen and takes NLOCKS one byte write locks
+   spaced out so that they cannot be merged, interleaved with those of
+   the other threads, and then releases them again.  Locks held by the
+   other threads never overlap ours, so this measures the cost of
+   finding (no) conflicts among NTHREADS * NLOCKS locks.  */
+static void *
+worker (void *arg)
+{
+  int id = (intptr_t) arg;
+  struct rlock_peropen po;
+  struct flock64 lock;
+  error_t err;
+  int r, i;
+
+  err = fshelp_rlock_po_init (&po);
+  if (err)
+    error (1, err, "fshelp_rlock_po_init");
+
+  lock.l_whence = SEEK_SET;
+  lock.l_len = 1;
+
+  for (r = 0; r < rounds; r++)
+    {
+      lock.l_type = F_WRLCK;
+      for (i = 0; i < nlocks; i++)
+	{
+	  lock.l_start = 2 * ((loff_t) i * nthreads + id);
+	  pthread_mutex_lock (&box_lock);
+	  err = fshelp_rlock_tweak (&box, &box_lock, &po, O_RDWR, 0, 0,
+				    F_SETLKW64, &lock, MACH_PORT_NULL);
+	  pthread_mutex_unlock (&box_lock);
+	  if (err)
+	    error (1, err, "lock %lld", (long long) lock.l_start);
+	}
+
+      lock.l_type = F_UNLCK;
+      for (i = 0; i < nlocks; i++)
+	{
+	  lock.l_start = 2 * ((loff_t) i * nthreads + id);
+	  pthread_mutex_lock (&box_lock);
+	  err = fshelp_rlock_tweak (&box, &box_lock, &po, O_RDWR, 0, 0,
+				    F_SETLK64, &lock, MACH_PORT_NULL);
+	  pthread_mutex_unlock (&box_lock);
+	  if (err)
+	    error (1, err, "unlock %lld", (long long) lock.l_start);
+	}
+    }
+
+  pthread_mutex_lock (&box_lock);
+  fshelp_rlock_drop_peropen (&po);
+  pthread_mutex_unlock (&box_lock);
+  fshelp_rlock_po_fini (&po);
+  return NULL;
+}
+
+int
+main (int argc, char **argv)
+{
+  pthread_t *threads;
+  struct timespec begin, end;
+  double secs;
+  long long ops;
+  int i;
+
+  if (argc != 4)
+    error (1, 0, "Usage: %s threads locks-per-thread rounds", argv[0]);
+
+  nthreads = atoi (argv[1]);
+  nlocks = atoi (argv[2]);
+  rounds = atoi (argv[3]);
+  if (nthreads <= 0 || nlocks <= 0 || rounds <= 0)
+    error (1, 0, "All arguments must be positive");
+
+  fshelp_rlock_init (&box);
+
+  threads = calloc (nthreads, sizeof *threads);
+  if (! threads)
+    error (1, errno, "calloc");
+
+  clock_gettime (CLOCK_MONOTONIC, &begin);
+  for (i = 0; i < nthreads; i++)
+    {
+      error_t err = pthread_create (&threads[i], NULL, worker,
+				    (void *) (intptr_t) i);
+      if (err)
+	error (1, err, "pthread_create");
+    }
+  for (i = 0; i < nthreads; i++)
+    pthread_join (threads[i], NULL);
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  secs = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+  ops = 2LL * nthreads * nlocks * rounds;
+  printf ("%lld lock operations in %.3f s: %.0f ops/s\n",
+	  ops, secs, ops / secs);
+
+  if (box.locks)
+    error (1, 0, "locks left over");
+  return 0;
+}
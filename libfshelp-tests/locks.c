@@ -143,7 +143,7 @@ cmd_list (char *args)
       struct rlock_list *l;
 
       printf ("%3d:", i);
-      for (l = *peropens[i].locks; l; l = l->po.next)
+      for (l = _fshelp_rlock_po_first (&peropens[i]); l; l = l->po.next)
         {
 	  printf ("\tStart = %4ld; Length = %4ld; Type = ", (long)l->start, (long)l->len);
 	  switch (l->type)
@@ -259,7 +259,7 @@ error_t fshelp_acquire_lock (struct lock_box *box, int *user,
 /* Unique to a node; initialize with fshelp_rlock_init.  */
 struct rlock_box
 {
-  struct rlock_list *locks;	/* List of locks on the file.  */
+  struct rlock_list *locks;	/* Interval tree of locks on the file.  */
 };
 
 error_t fshelp_rlock_init (struct rlock_box *box);
@@ -281,7 +281,7 @@ struct rlock_peropen
 {
   /* This is a pointer to a pointer to a rlock_lock (and not a pointer
      to a rlock_list) as it really serves two functions:
-       o the list of locks owned by this peropen
+       o the root of the tree of locks owned by this peropen
        o the unique peropen identifier that all locks on this peropen share.  */
   struct rlock_list **locks;
 };
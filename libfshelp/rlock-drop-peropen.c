@@ -30,20 +30,15 @@ fshelp_rlock_drop_peropen (struct rlock_peropen *po)
   struct rlock_list *l;
   struct rlock_list *t;
 
-  for (l = *po->locks; l; l = t)
+  for (l = _fshelp_rlock_po_first (po); l; l = t)
     {
-      if (l->waiting)
-	{
-	  l->waiting = 0;
-	  pthread_cond_broadcast (&l->wait);
-	}
-
-      list_unlink (node, l);
-      pthread_cond_destroy(&l->wait);
+      _fshelp_rlock_tree_remove (l->box, l);
+      _fshelp_rlock_wake (l->box, l->start, rlock_end (l));
 
       t = l->po.next;
       free (l);
     }
+  *po->locks = NULL;
 
   return 0;
 }
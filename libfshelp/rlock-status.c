@@ -29,24 +29,29 @@ int fshelp_rlock_peropen_status (struct rlock_peropen *po)
   if (! *po->locks)
     return LOCK_UN;
 
-  for (l = *po->locks; l; l = l->po.next)
+  for (l = _fshelp_rlock_po_first (po); l; l = l->po.next)
     if (l->type == F_WRLCK)
       return LOCK_EX;
 
   return LOCK_SH;
 }
 
+static int
+tree_has_wrlck (struct rlock_list *l)
+{
+  return l && (l->type == F_WRLCK
+	       || tree_has_wrlck (l->node.left)
+	       || tree_has_wrlck (l->node.right));
+}
+
 /* Like fshelp_rlock_peropen_status except for all users of NODE.  */
 int fshelp_rlock_node_status (struct rlock_box *box)
 {
-  struct rlock_list *l;
-
   if (! box->locks)
     return LOCK_UN;
 
-  for (l = box->locks; l; l = l->node.next)
-    if (l->type == F_WRLCK)
-      return LOCK_EX;
+  if (tree_has_wrlck (box->locks))
+    return LOCK_EX;
 
   return LOCK_SH;
 }
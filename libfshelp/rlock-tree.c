@@ -0,0 +1,337 @@
+/* Interval tree and wait queue for record locks.
+
+   Copyright (C) 2026 Free Software Foundation
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 2, or (at your option)
+   any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with the GNU Hurd.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "fshelp.h"
+#include "rlock.h"
+
+#include <fcntl.h>
+#include <assert-backtrace.h>
+
+/* Both the tree of a box and the tree of a peropen are treaps: binary
+   search trees on (START, address) which are also heaps on a priority
+   derived from the address of each lock.  The priorities are as good as
+   random, so the expected depth is logarithmic, without the bookkeeping
+   of a strictly balanced tree.  The functions below take PO to say which
+   of the two trees of a lock they work on.  */
+
+static inline struct rlock_tree_link *
+link_of (struct rlock_list *l, int po)
+{
+  return po ? &l->po_node : &l->node;
+}
+
+#define LEFT(l, po) (link_of (l, po)->left)
+#define RIGHT(l, po) (link_of (l, po)->right)
+#define MAX_END(l, po) (link_of (l, po)->max_end)
+
+static inline uint32_t
+priority (struct rlock_list *l)
+{
+  return (uint32_t) ((uintptr_t) l >> 4) * 2654435761U;
+}
+
+/* Return whether A sorts before B.  */
+static inline int
+before (struct rlock_list *a, struct rlock_list *b)
+{
+  return a->start < b->start
+    || (a->start == b->start && (uintptr_t) a < (uintptr_t) b);
+}
+
+static inline void
+update (struct rlock_list *t, int po)
+{
+  struct rlock_list *l = LEFT (t, po), *r = RIGHT (t, po);
+
+  MAX_END (t, po) = rlock_end (t);
+  if (l && MAX_END (l, po) > MAX_END (t, po))
+    MAX_END (t, po) = MAX_END (l, po);
+  if (r && MAX_END (r, po) > MAX_END (t, po))
+    MAX_END (t, po) = MAX_END (r, po);
+}
+
+static struct rlock_list *
+rotate_right (struct rlock_list *t, int po)
+{
+  struct rlock_list *l = LEFT (t, po);
+  LEFT (t, po) = RIGHT (l, po);
+  RIGHT (l, po) = t;
+  update (t, po);
+  update (l, po);
+  return l;
+}
+
+static struct rlock_list *
+rotate_left (struct rlock_list *t, int po)
+{
+  struct rlock_list *r = RIGHT (t, po);
+  RIGHT (t, po) = LEFT (r, po);
+  LEFT (r, po) = t;
+  update (t, po);
+  update (r, po);
+  return r;
+}
+
+static struct rlock_list *
+tree_insert (struct rlock_list *t, struct rlock_list *l, int po)
+{
+  if (! t)
+    {
+      LEFT (l, po) = RIGHT (l, po) = NULL;
+      update (l, po);
+      return l;
+    }
+
+  if (before (l, t))
+    {
+      LEFT (t, po) = tree_insert (LEFT (t, po), l, po);
+      if (priority (LEFT (t, po)) > priority (t))
+	return rotate_right (t, po);
+    }
+  else
+    {
+      RIGHT (t, po) = tree_insert (RIGHT (t, po), l, po);
+      if (priority (RIGHT (t, po)) > priority (t))
+	return rotate_left (t, po);
+    }
+
+  update (t, po);
+  return t;
+}
+
+/* Join the trees A and B; everything in A sorts before B.  */
+static struct rlock_list *
+join (struct rlock_list *a, struct rlock_list *b, int po)
+{
+  if (! a)
+    return b;
+  if (! b)
+    return a;
+
+  if (priority (a) > priority (b))
+    {
+      RIGHT (a, po) = join (RIGHT (a, po), b, po);
+      update (a, po);
+      return a;
+    }
+  else
+    {
+      LEFT (b, po) = join (a, LEFT (b, po), po);
+      update (b, po);
+      return b;
+    }
+}
+
+static struct rlock_list *
+tree_remove (struct rlock_list *t, struct rlock_list *l, int po)
+{
+  assert_backtrace (t);
+
+  if (t == l)
+    {
+      t = join (LEFT (l, po), RIGHT (l, po), po);
+      LEFT (l, po) = RIGHT (l, po) = NULL;
+      return t;
+    }
+
+  if (before (l, t))
+    LEFT (t, po) = tree_remove (LEFT (t, po), l, po);
+  else
+    RIGHT (t, po) = tree_remove (RIGHT (t, po), l, po);
+
+  update (t, po);
+  return t;
+}
+
+static struct rlock_list *
+tree_conflict (struct rlock_list *t, void *po_id, loff_t start,
+	       loff_t end, int type)
+{
+  struct rlock_list *l;
+
+  /* Nothing in this subtree reaches START.  */
+  if (! t || t->node.max_end <= start)
+    return NULL;
+
+  l = tree_conflict (t->node.left, po_id, start, end, type);
+  if (l)
+    return l;
+
+  /* T and everything to its right begin at or after END.  */
+  if (t->start >= end)
+    return NULL;
+
+  if (t->po_id != po_id
+      && (t->type == F_WRLCK || type == F_WRLCK)
+      && rlock_end (t) > start)
+    return t;
+
+  return tree_conflict (t->node.right, po_id, start, end, type);
+}
+
+void
+_fshelp_rlock_tree_insert (struct rlock_box *box, struct rlock_list *l)
+{
+  box->locks = tree_insert (box->locks, l, 0);
+}
+
+void
+_fshelp_rlock_tree_remove (struct rlock_box *box, struct rlock_list *l)
+{
+  box->locks = tree_remove (box->locks, l, 0);
+}
+
+struct rlock_list *
+_fshelp_rlock_tree_conflict (struct rlock_box *box, void *po_id,
+			     loff_t start, loff_t end, int type)
+{
+  return tree_conflict (box->locks, po_id, start, end, type);
+}
+
+void
+_fshelp_rlock_po_insert (struct rlock_peropen *po, struct rlock_list *l)
+{
+  struct rlock_list *t, *prev = NULL, *next = NULL;
+
+  /* Find the neighbours L will have in the list.  */
+  for (t = *po->locks; t; )
+    if (before (l, t))
+      {
+	next = t;
+	t = t->po_node.left;
+      }
+    else
+      {
+	prev = t;
+	t = t->po_node.right;
+      }
+
+  *po->locks = tree_insert (*po->locks, l, 1);
+
+  l->po.next = next;
+  if (next)
+    next->po.prevp = &l->po.next;
+  l->po.prevp = prev ? &prev->po.next : NULL;
+  if (prev)
+    prev->po.next = l;
+}
+
+void
+_fshelp_rlock_po_remove (struct rlock_peropen *po, struct rlock_list *l)
+{
+  *po->locks = tree_remove (*po->locks, l, 1);
+
+  if (l->po.prevp)
+    *l->po.prevp = l->po.next;
+  if (l->po.next)
+    l->po.next->po.prevp = l->po.prevp;
+  l->po.next = NULL;
+  l->po.prevp = NULL;
+}
+
+struct rlock_list *
+_fshelp_rlock_po_first (struct rlock_peropen *po)
+{
+  struct rlock_list *l = *po->locks;
+
+  if (l)
+    while (l->po_node.left)
+      l = l->po_node.left;
+  return l;
+}
+
+struct rlock_list *
+_fshelp_rlock_po_find (struct rlock_peropen *po, loff_t start)
+{
+  struct rlock_list *t, *found = NULL;
+
+  /* As the locks do not overlap, their ends are in the same order as
+     their starts.  */
+  for (t = *po->locks; t; )
+    if (rlock_end (t) >= start)
+      {
+	found = t;
+	t = t->po_node.left;
+      }
+    else
+      t = t->po_node.right;
+
+  return found;
+}
+
+/* Threads blocked in F_SETLKW64, on all boxes.  There are rarely more
+   than a few, and keeping them here leaves struct rlock_box alone.  */
+struct rlock_waiter
+{
+  struct rlock_box *box;
+  loff_t start;
+  loff_t end;
+  pthread_cond_t wait;
+
+  struct rlock_waiter *next;
+  struct rlock_waiter **prevp;
+};
+
+static pthread_mutex_t waiters_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct rlock_waiter *waiters;
+
+error_t
+_fshelp_rlock_wait (struct rlock_box *box, pthread_mutex_t *mutex,
+		    loff_t start, loff_t end)
+{
+  struct rlock_waiter w;
+  int cancel;
+
+  w.box = box;
+  w.start = start;
+  w.end = end;
+  pthread_cond_init (&w.wait, NULL);
+
+  pthread_mutex_lock (&waiters_lock);
+  w.next = waiters;
+  if (w.next)
+    w.next->prevp = &w.next;
+  w.prevp = &waiters;
+  waiters = &w;
+  pthread_mutex_unlock (&waiters_lock);
+
+  /* Wakers hold MUTEX, so nothing is missed before we sleep.  */
+  cancel = pthread_hurd_cond_wait_np (&w.wait, mutex);
+
+  pthread_mutex_lock (&waiters_lock);
+  *w.prevp = w.next;
+  if (w.next)
+    w.next->prevp = w.prevp;
+  pthread_mutex_unlock (&waiters_lock);
+  pthread_cond_destroy (&w.wait);
+
+  return cancel ? EINTR : 0;
+}
+
+void
+_fshelp_rlock_wake (struct rlock_box *box, loff_t start, loff_t end)
+{
+  struct rlock_waiter *w;
+
+  pthread_mutex_lock (&waiters_lock);
+  for (w = waiters; w; w = w->next)
+    if (w->box == box && w->start < end && start < w->end)
+      pthread_cond_signal (&w->wait);
+  pthread_mutex_unlock (&waiters_lock);
+}
@@ -30,14 +30,6 @@
 #include <hurd.h>
 #include <hurd/process.h>
 
-static inline long overlap (loff_t start, loff_t len, struct rlock_list *l)
-{
-  return ((len == 0 && l->len == 0)
-	  || (len == 0 && l->start + l->len > start)
-	  || (l->len == 0 && start + len > l->start)
-	  || (l->start + l->len > start && start + len > l->start));
-}
-
 error_t
 fshelp_rlock_tweak (struct rlock_box *box, pthread_mutex_t *mutex,
 		    struct rlock_peropen *po, int open_mode,
@@ -55,32 +47,55 @@ fshelp_rlock_tweak (struct rlock_box *box, pthread_mutex_t *mutex,
       l->start = start;
       l->len = len;
       l->type = type;
+      l->box = box;
 
-      list_link (po, po->locks, l);
-      list_link (node, &box->locks, l);
+      _fshelp_rlock_po_insert (po, l);
+      _fshelp_rlock_tree_insert (box, l);
       return l;
     }
 
   inline void
   rele_lock (struct rlock_list *l, int wake_waiters)
     {
-      list_unlink (po, l);
-      list_unlink (node, l);
+      _fshelp_rlock_po_remove (po, l);
+      _fshelp_rlock_tree_remove (box, l);
 
-      if (wake_waiters && l->waiting)
-	pthread_cond_broadcast (&l->wait);
+      if (wake_waiters)
+	_fshelp_rlock_wake (box, l->start, rlock_end (l));
 
-      pthread_cond_destroy(&l->wait);
       free (l);
     }
 
+  /* Change the region locked by L to START and LEN, repositioning it
+     in the trees.  If WAKE_WAITERS, wake anyone waiting on the old
+     region.  */
+  inline void
+  resize_lock (struct rlock_list *l, loff_t start, loff_t len,
+	       int wake_waiters)
+    {
+      loff_t old_start = l->start;
+      loff_t old_end = rlock_end (l);
+
+      _fshelp_rlock_po_remove (po, l);
+      _fshelp_rlock_tree_remove (box, l);
+      l->start = start;
+      l->len = len;
+      _fshelp_rlock_po_insert (po, l);
+      _fshelp_rlock_tree_insert (box, l);
+
+      if (wake_waiters)
+	_fshelp_rlock_wake (box, old_start, old_end);
+    }
+
   error_t
   unlock_region (loff_t start, loff_t len)
     {
-      struct rlock_list *l;
+      struct rlock_list *l, *next;
 
-      for (l = *po->locks; l; l = l->po.next)
+      for (l = _fshelp_rlock_po_find (po, start); l; l = next)
 	{
+	  next = l->po.next;
+
 	  if (l->len != 0 && l->start + l->len <= start)
 	    /* We start after the locked region ends.  */
 	    {
@@ -109,15 +124,9 @@ fshelp_rlock_tweak (struct rlock_box *box, pthread_mutex_t *mutex,
 	      assert (len != 0);
 	      assert (l->len == 0 || start + len < l->start + l->len);
 
-	      if (l->len != 0)
-		l->len -= start + len - l->start;
-	      l->start = start + len;
-
-	      if (l->waiting)
-		{
-		  l->waiting = 0;
-		  pthread_cond_broadcast (&l->wait);
-		}
+	      resize_lock (l, start + len,
+			   l->len != 0 ? l->len - (start + len - l->start) : 0,
+			   1);
 	    }
 	  else if (l->start < start
 		   && ((start < l->start + l->len
@@ -128,13 +137,7 @@ fshelp_rlock_tweak (struct rlock_box *box, pthread_mutex_t *mutex,
 	      assert (len == 0
 		      || (l->len != 0 && l->start + l->len <= start + len));
 
-	      l->len = start - l->start;
-
-	      if (l->waiting)
-		{
-		  l->waiting = 0;
-		  pthread_cond_broadcast (&l->wait);
-		}
+	      resize_lock (l, l->start, start - l->start, 1);
 
 	      continue;
 	    }
@@ -157,7 +160,7 @@ fshelp_rlock_tweak (struct rlock_box *box, pthread_mutex_t *mutex,
 	      if (! upper_half)
 		return ENOMEM;
 
-	      l->len = start - l->start;
+	      resize_lock (l, l->start, start - l->start, 1);
 
 	      return 0;
 	    }
@@ -178,28 +181,20 @@ fshelp_rlock_tweak (struct rlock_box *box, pthread_mutex_t *mutex,
   inline struct rlock_list *
   find_conflict (loff_t start, loff_t len, int type)
     {
-      struct rlock_list *l;
-
-      for (l = box->locks; l; l = l->node.next)
-	{
-	  if (po->locks == l->po_id)
-	    continue;
-
-	  if ((l->type == F_WRLCK || type == F_WRLCK)
-	      && overlap (start, len, l))
-	    return l;
-	}
-
-      return NULL;
+      return _fshelp_rlock_tree_conflict (box, po->locks, start,
+					  len == 0 ? RLOCK_EOF : start + len,
+					  type);
     }
 
   inline error_t
   merge_in (loff_t start, loff_t len, int type)
     {
-      struct rlock_list *l;
+      struct rlock_list *l, *next;
 
-      for (l = *po->locks; l; l = l->po.next)
+      for (l = _fshelp_rlock_po_find (po, start); l; l = next)
 	{
+	  next = l->po.next;
+
 	  if (l->start <= start
 	      && (l->len == 0
 		  || (len != 0
@@ -240,17 +235,25 @@ fshelp_rlock_tweak (struct rlock_box *box, pthread_mutex_t *mutex,
 		    }
 		}
 
-	      if (head)
+	      if (head || tail)
 		{
-		  loff_t shift = start - l->start;
+		  loff_t new_start = l->start;
+		  loff_t new_len = l->len;
 
-		  if (l->len != 0)
-		    l->len -= shift;
-		  l->start += shift;
-		}
+		  if (head)
+		    {
+		      loff_t shift = start - l->start;
+
+		      if (new_len != 0)
+			new_len -= shift;
+		      new_start += shift;
+		    }
 
-	      if (tail)
-	        l->len = tail->start - l->start;
+		  if (tail)
+		    new_len = tail->start - new_start;
+
+		  resize_lock (l, new_start, new_len, 0);
+		}
 
 	      if (! tail)
 		/* There is a chance we can merge some more.  */
@@ -345,7 +348,7 @@ fshelp_rlock_tweak (struct rlock_box *box, pthread_mutex_t *mutex,
 		{
 		  assert (l->type == F_RDLCK);
 
-		  l->len -= l->start + l->len - start;
+		  resize_lock (l, l->start, start - l->start, 0);
 
 		  /* Don't create the lock now; we might be able to
 		     consume more locks.  */
@@ -369,9 +372,7 @@ fshelp_rlock_tweak (struct rlock_box *box, pthread_mutex_t *mutex,
 		  continue;
 		}
 	    }
-	  else if (start < l->start
-		   && (l->len == 0
-		       || l->start <= start + len))
+	  else if (start < l->start && l->start <= start + len)
 	    /* Our start falls before the locked region and our
 	       end falls (inclusively) between it or one byte before it.
 	       Note, we know that we do not consume the entire locked
@@ -383,9 +384,8 @@ fshelp_rlock_tweak (struct rlock_box *box, pthread_mutex_t *mutex,
 	      if (type == l->type)
 		/* Merge the two areas.  */
 		{
-		  if (l->len)
-		    l->len += l->start - start;
-		  l->start = start;
+		  resize_lock (l, start,
+			       l->len ? l->len + l->start - start : 0, 0);
 		  return 0;
 		}
 	      else if (l->start == start + len)
@@ -407,9 +407,8 @@ fshelp_rlock_tweak (struct rlock_box *box, pthread_mutex_t *mutex,
 		  if (! e)
 		    return ENOMEM;
 
-		  if (l->len)
-		    l->len -= common;
-		  l->start += common;
+		  resize_lock (l, l->start + common,
+			       l->len ? l->len - common : 0, 0);
 
 		  return 0;
 		}
@@ -541,9 +540,12 @@ retry:
         {
 	  if (cmd == F_SETLKW64)
 	    {
-	      e->waiting = 1;
-	      if (pthread_hurd_cond_wait_np (&e->wait, mutex))
-	        return EINTR;
+	      /* Wait until a lock overlapping our region goes away.  */
+	      error_t err = _fshelp_rlock_wait (box, mutex, start,
+						 len == 0
+						 ? RLOCK_EOF : start + len);
+	      if (err)
+	        return err;
 	      goto retry;
 	    }
 	  else
@@ -28,12 +28,24 @@
 #endif
 
 #include <pthread.h>
+#include <stdint.h>
 #include <string.h>
 
+/* These structures are private to libfshelp; only struct rlock_box and
+   struct rlock_peropen (in <hurd/fshelp.h>) are embedded by users, and
+   their layout does not depend on what is here.  */
+
 struct rlock_linked_list
 {
   struct rlock_list *next;
-  struct rlock_list **prevp;
+  struct rlock_list **prevp;	/* NULL for the first lock.  */
+};
+
+/* A lock's place in one of the treaps in rlock-tree.c.  */
+struct rlock_tree_link
+{
+  struct rlock_list *left, *right;
+  loff_t max_end;		/* Largest rlock_end of this subtree.  */
 };
 
 struct rlock_list
@@ -42,52 +54,75 @@ struct rlock_list
   loff_t len;
   int type;
 
-  struct rlock_linked_list node;
-  struct rlock_linked_list po;
+  /* Each lock is in two trees ordered by START: NODE links it into the
+     interval tree of all the locks of BOX, rooted at BOX->locks, and
+     PO_NODE into the tree of the locks of its peropen, rooted at
+     *PO_ID.  PO links the locks of the peropen in the same order.  */
+  struct rlock_tree_link node;
+  struct rlock_tree_link po_node;
+  struct rlock_box *box;
 
-  pthread_cond_t wait;
-  int waiting;
+  struct rlock_linked_list po;
 
   void *po_id;
 };
 
+/* The end used for locks that extend to the end of the file.  */
+#define RLOCK_EOF ((loff_t) (UINT64_MAX >> 1))
+
 FSHELP_EXTERN_INLINE error_t
 rlock_list_init (struct rlock_peropen *po, struct rlock_list *l)
 {
   memset (l, 0, sizeof (struct rlock_list));
-  pthread_cond_init (&l->wait, NULL);
   l->po_id = po->locks;
   return 0;
 }
 
-/* void list_list (X ={po,node}, struct rlock_list **head,
-		   struct rlock_list *node)
-
-   Insert a node in the given list, X, in sorted order.  */
-#define list_link(X, head, node)				\
-	do							\
-	  {							\
-	    struct rlock_list **e;				\
-	    for (e = head;					\
-		 *e && ((*e)->start < node->start);		\
-		 e = &(*e)->X.next)				\
-	      ;							\
-	    node->X.next = *e;					\
-	    if (node->X.next)					\
-	      node->X.next->X.prevp = &node->X.next;		\
-	    node->X.prevp = e;					\
-	    *e = node;						\
-	  }							\
-	while (0)
-
-/* void list_unlock (X = {po,node}, struct rlock_list *node)  */
-#define list_unlink(X, node)					\
-	do							\
-	  {							\
-	    *node->X.prevp = node->X.next;			\
-	    if (node->X.next)					\
-	      node->X.next->X.prevp = node->X.prevp;		\
-	  }							\
-	while (0)
+/* Return the first byte after the region locked by L.  */
+FSHELP_EXTERN_INLINE loff_t
+rlock_end (struct rlock_list *l)
+{
+  return l->len == 0 ? RLOCK_EOF : l->start + l->len;
+}
+
+/* Add L to the interval tree of BOX.  */
+void _fshelp_rlock_tree_insert (struct rlock_box *box, struct rlock_list *l);
+
+/* Remove L from the interval tree of BOX.  L's start must not have
+   changed since it was inserted.  */
+void _fshelp_rlock_tree_remove (struct rlock_box *box, struct rlock_list *l);
+
+/* Return the lowest lock in BOX not owned by PO_ID which conflicts
+   with a lock of type TYPE on [START, END), or NULL.  */
+struct rlock_list *_fshelp_rlock_tree_conflict (struct rlock_box *box,
+						void *po_id, loff_t start,
+						loff_t end, int type);
+
+/* Add L to the locks of the peropen PO, in order.  */
+void _fshelp_rlock_po_insert (struct rlock_peropen *po,
+			      struct rlock_list *l);
+
+/* Remove L from the locks of the peropen PO.  L's start must not have
+   changed since it was inserted.  */
+void _fshelp_rlock_po_remove (struct rlock_peropen *po,
+			      struct rlock_list *l);
+
+/* Return the first of the locks of PO, or NULL.  */
+struct rlock_list *_fshelp_rlock_po_first (struct rlock_peropen *po);
+
+/* Return the first of the locks of PO that ends at or after START, or
+   NULL.  The locks of a peropen never overlap, so this is where a walk
+   over the locks touching START has to begin.  */
+struct rlock_list *_fshelp_rlock_po_find (struct rlock_peropen *po,
+					  loff_t start);
+
+/* Wait on MUTEX until a lock in BOX overlapping [START, END) goes away
+   or shrinks.  Return EINTR if the wait was cancelled.  */
+error_t _fshelp_rlock_wait (struct rlock_box *box, pthread_mutex_t *mutex,
+			    loff_t start, loff_t end);
+
+/* Wake the threads waiting in BOX for a region overlapping
+   [START, END).  */
+void _fshelp_rlock_wake (struct rlock_box *box, loff_t start, loff_t end);
 
 #endif /* FSHELP_RLOCK_H */
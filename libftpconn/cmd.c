@@ -1,6 +1,6 @@
 /* Send commands to the ftp server
 
-   Copyright (C) 1997 Free Software Foundation, Inc.
+   Copyright (C) 1997, 2026 Free Software Foundation, Inc.
 
    Written by Miles Bader <miles@gnu.ai.mit.edu>
 
@@ -139,6 +139,18 @@ ftp_conn_cmd_reopen (struct ftp_conn *conn, const char *cmd, const char *arg,
   return err;
 }
 
+/* Send an ftp NOOP command to CONN's server, to check that the connection is
+   still alive and keep the server from timing it out.  */
+error_t
+ftp_conn_noop (struct ftp_conn *conn)
+{
+  int reply;
+  error_t err = ftp_conn_cmd (conn, "noop", 0, &reply, 0);
+  if (!err && !REPLY_IS_SUCCESS (reply))
+    err = unexpected_reply (conn, reply, 0, 0);
+  return err;
+}
+
 /* Send an ftp ABOR command to CONN's server, aborting any transfer in
    progress.  */
 void
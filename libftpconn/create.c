@@ -51,6 +51,8 @@ ftp_conn_create (const struct ftp_conn_params *params,
   new->hooks = hooks;
   new->syshooks_valid = 0;
   new->use_passive = 1;
+  new->mlsx_checked = 0;
+  new->use_mlsx = 0;
   new->actv_data_addr = 0;
   new->cwd = 0;
   new->type = 0;
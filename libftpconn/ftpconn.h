@@ -1,6 +1,6 @@
 /* Manage an ftp connection
 
-   Copyright (C) 1997,2001,02 Free Software Foundation, Inc.
+   Copyright (C) 1997,2001,02,2026 Free Software Foundation, Inc.
 
    Written by Miles Bader <miles@gnu.org>
 
@@ -186,6 +186,8 @@ struct ftp_conn
   void *hook;			/* Random user data. */
 
   int use_passive : 1;		/* If true, first try passive data conns.  */
+  int mlsx_checked : 1;		/* True if we know whether to use MLSx.  */
+  int use_mlsx : 1;		/* If true, get stats using MLSD and MLST.  */
 
   struct sockaddr *actv_data_addr;/* Address of port for active data conns.  */
 };
@@ -237,6 +239,10 @@ ftp_conn_cmd_reopen (struct ftp_conn *conn, const char *cmd, const char *arg,
 
 void ftp_conn_abort (struct ftp_conn *conn);
 
+/* Send an ftp NOOP command to CONN's server, to check that the connection is
+   still alive and keep the server from timing it out.  */
+error_t ftp_conn_noop (struct ftp_conn *conn);
+
 /* Sets CONN's syshooks to a copy of SYSHOOKS.  */
 void ftp_conn_set_syshooks (struct ftp_conn *conn,
 			    struct ftp_conn_syshooks *syshooks);
@@ -290,6 +296,12 @@ error_t ftp_conn_finish_transfer (struct ftp_conn *conn);
    over which the data can be read.  */
 error_t ftp_conn_start_retrieve (struct ftp_conn *conn, const char *name, int *data);
 
+/* Start retreiving file NAME over CONN from OFFSET bytes into it, returning
+   a file descriptor in DATA over which the data can be read.  If the server
+   doesn't support restarting transfers, EOPNOTSUPP is returned.  */
+error_t ftp_conn_start_retrieve_at (struct ftp_conn *conn, const char *name,
+				    off_t offset, int *data);
+
 /* Start retreiving a list of files in NAME over CONN, returning a file
    descriptor in DATA over which the data can be read.  */
 error_t ftp_conn_start_list (struct ftp_conn *conn, const char *name, int *data);
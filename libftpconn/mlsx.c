@@ -0,0 +1,312 @@
+/* Fetch file stats using MLSD and MLST (RFC 3659)
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <libgen.h>
+#ifdef HAVE_HURD_HURD_TYPES_H
+#include <hurd/hurd_types.h>
+#endif
+
+#include <ftpconn.h>
+#include "priv.h"
+
+/* Uid/gid to use when the server doesn't tell us.  */
+#define DEFAULT_UID 65535
+#define DEFAULT_GID 65535
+
+/* Parse the facts in the MLSx entry LINE into STAT, and return the name
+   following them in *NAME and, for symlinks whose target the server
+   reveals, the target in *SYMLINK_TARGET; both point into LINE, which is
+   modified.  If the entry is for the listed directory itself or its parent,
+   *SKIP is set to true.  */
+static error_t
+parse_facts (char *line, struct stat *stat,
+	     char **name, char **symlink_target, int *skip)
+{
+  char *p = line, *end;
+  mode_t type = S_IFREG, perms = 0;
+  int have_mode = 0;
+
+  memset (stat, 0, sizeof *stat);
+#ifdef FSTYPE_FTP
+  stat->st_fstype = FSTYPE_FTP;
+#endif
+  stat->st_nlink = 1;
+  stat->st_uid = DEFAULT_UID;
+  stat->st_gid = DEFAULT_GID;
+  *symlink_target = 0;
+  *skip = 0;
+
+  /* The facts are terminated by a space, and the name is the rest.  */
+  end = strchr (p, ' ');
+  if (! end)
+    return EGRATUITOUS;
+  *end = '\0';
+  *name = end + 1;
+
+  while (*p)
+    {
+      char *fact = p, *val;
+
+      p += strcspn (p, ";");
+      if (*p)
+	*p++ = '\0';
+
+      val = strchr (fact, '=');
+      if (! val)
+	continue;
+      *val++ = '\0';
+
+      if (strcasecmp (fact, "type") == 0)
+	{
+	  if (strcasecmp (val, "file") == 0)
+	    type = S_IFREG;
+	  else if (strcasecmp (val, "dir") == 0)
+	    type = S_IFDIR;
+	  else if (strcasecmp (val, "cdir") == 0
+		   || strcasecmp (val, "pdir") == 0)
+	    {
+	      type = S_IFDIR;
+	      *skip = 1;
+	    }
+	  else if (strncasecmp (val, "OS.unix=slink", 13) == 0
+		   || strncasecmp (val, "OS.unix=symlink", 15) == 0)
+	    {
+	      char *target = strchr (val, ':');
+	      type = S_IFLNK;
+	      if (target && target[1])
+		*symlink_target = target + 1;
+	    }
+	}
+      else if (strcasecmp (fact, "size") == 0)
+	stat->st_size = strtoll (val, 0, 10);
+      else if (strcasecmp (fact, "modify") == 0)
+	{
+	  struct tm tm;
+
+	  memset (&tm, 0, sizeof tm);
+	  if (sscanf (val, "%4d%2d%2d%2d%2d%2d",
+		      &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+		      &tm.tm_hour, &tm.tm_min, &tm.tm_sec) == 6)
+	    {
+	      tm.tm_year -= 1900;
+	      tm.tm_mon -= 1;
+	      /* MLSx times are always in UTC.  */
+	      stat->st_mtim.tv_sec = timegm (&tm);
+	    }
+	}
+      else if (strcasecmp (fact, "unix.mode") == 0)
+	{
+	  perms = strtoul (val, 0, 8) & ~S_IFMT;
+	  have_mode = 1;
+	}
+      else if (strcasecmp (fact, "unix.uid") == 0)
+	stat->st_uid = strtoul (val, 0, 10);
+      else if (strcasecmp (fact, "unix.gid") == 0)
+	stat->st_gid = strtoul (val, 0, 10);
+      else if (strcasecmp (fact, "perm") == 0 && !have_mode)
+	/* Only a rough guess, as it says what we may do, not who else may.  */
+	{
+	  if (strpbrk (val, "rl"))
+	    perms |= S_IRUSR | S_IRGRP | S_IROTH;
+	  if (strpbrk (val, "wacm"))
+	    perms |= S_IWUSR;
+	  if (strchr (val, 'e'))
+	    perms |= S_IXUSR | S_IXGRP | S_IXOTH;
+	}
+    }
+
+  if (! have_mode && ! perms)
+    perms = (type == S_IFDIR ? 0755 : 0644);
+  stat->st_mode = type | perms;
+  stat->st_blocks = stat->st_size >> 9;
+
+#ifdef HAVE_STAT_ST_AUTHOR
+  stat->st_author = stat->st_uid;
+#endif
+
+  /* atime and ctime are the same as mtime.  */
+  stat->st_atim = stat->st_ctim = stat->st_mtim;
+
+  return 0;
+}
+
+/* Get stats for the contents of the directory NAME with MLSD.  Set
+   *DELIVERED once ADD_STAT has been called.  */
+static error_t
+mlsd_get_stats (struct ftp_conn *conn, const char *name,
+		ftp_conn_add_stat_fun_t add_stat, void *hook, int *delivered)
+{
+  int fd;
+  FILE *listing;
+  char *line = 0;
+  size_t line_sz = 0;
+  ssize_t len;
+  error_t err = ftp_conn_start_transfer (conn, "mlsd", name,
+					 ftp_conn_poss_file_errs, &fd);
+  int (*icheck) (struct ftp_conn *conn) = conn->hooks->interrupt_check;
+
+  if (err)
+    return err;
+
+  listing = fdopen (fd, "r");
+  if (! listing)
+    {
+      err = errno;
+      close (fd);
+      ftp_conn_finish_transfer (conn);
+      return err;
+    }
+
+  while (!err && (len = getline (&line, &line_sz, listing)) > 0)
+    {
+      struct stat st;
+      char *entry_name, *symlink_target;
+      int skip;
+
+      while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+	line[--len] = '\0';
+      if (len == 0)
+	continue;
+
+      err = parse_facts (line, &st, &entry_name, &symlink_target, &skip);
+      if (!err && !skip)
+	{
+	  *delivered = 1;
+	  err = (*add_stat) (basename (entry_name), &st, symlink_target,
+			     hook);
+	}
+
+      if (!err && icheck && (*icheck) (conn))
+	err = EINTR;
+    }
+  if (!err && ferror (listing))
+    err = errno;
+
+  free (line);
+  fclose (listing);
+
+  if (err)
+    ftp_conn_finish_transfer (conn);
+  else
+    err = ftp_conn_finish_transfer (conn);
+
+  return err;
+}
+
+/* Get stats for the single file NAME with MLST.  Set *DELIVERED once
+   ADD_STAT has been called.  */
+static error_t
+mlst_get_stats (struct ftp_conn *conn, const char *name,
+		ftp_conn_add_stat_fun_t add_stat, void *hook, int *delivered)
+{
+  int reply;
+  const char *txt;
+  char *entry;
+  struct stat st;
+  char *entry_name, *symlink_target;
+  int skip;
+  error_t err = ftp_conn_cmd_reopen (conn, "mlst", name, &reply, &txt);
+
+  if (err)
+    return err;
+  if (! REPLY_IS_SUCCESS (reply))
+    return unexpected_reply (conn, reply, txt, ftp_conn_poss_file_errs);
+
+  /* The entry is the reply line starting with a space.  */
+  entry = strstr (txt, "\n ");
+  if (! entry)
+    return EGRATUITOUS;
+  entry = strndupa (entry + 2, strcspn (entry + 2, "\n"));
+
+  err = parse_facts (entry, &st, &entry_name, &symlink_target, &skip);
+  if (! err)
+    /* Like the unix hooks, give back the basename of what was asked.  */
+    {
+      *delivered = 1;
+      err = (*add_stat) (basename (strdupa (name)), &st, symlink_target,
+			 hook);
+    }
+
+  return err;
+}
+
+/* Find out whether CONN's server supports MLSD and MLST, which it should
+   advertise in its reply to FEAT, and set CONN's use_mlsx flag accordingly.  */
+static error_t
+check_mlsx (struct ftp_conn *conn)
+{
+  int reply;
+  const char *txt;
+  error_t err = ftp_conn_cmd_reopen (conn, "feat", 0, &reply, &txt);
+
+  if (err)
+    return err;
+
+  /* Each feature is on a line of its own, starting with a space.  */
+  conn->use_mlsx = REPLY_IS_SUCCESS (reply) && strcasestr (txt, "\n mlst");
+  conn->mlsx_checked = 1;
+
+  return 0;
+}
+
+/* Get a list of file-stat structures for NAME using the MLSD or MLST
+   commands, as ftp_conn_get_stats does.  If the server doesn't support
+   them, EOPNOTSUPP is returned, but only if ADD_STAT has not been
+   called yet, so that the caller can start again with LIST.  */
+error_t
+ftp_conn_mlsx_get_stats (struct ftp_conn *conn, const char *name, int contents,
+			 ftp_conn_add_stat_fun_t add_stat, void *hook)
+{
+  int delivered = 0;
+  error_t err;
+
+  if (! conn->mlsx_checked)
+    {
+      err = check_mlsx (conn);
+      if (err)
+	return err;
+    }
+  if (! conn->use_mlsx)
+    return EOPNOTSUPP;
+
+  if (contents)
+    err = mlsd_get_stats (conn, name, add_stat, hook, &delivered);
+  else
+    err = mlst_get_stats (conn, name, add_stat, hook, &delivered);
+
+  if (err == EGRATUITOUS)
+    /* We don't understand what the server says; don't try again.  */
+    {
+      conn->use_mlsx = 0;
+      if (! delivered)
+	err = EOPNOTSUPP;
+    }
+  else if (err == EOPNOTSUPP && delivered)
+    /* Don't let the caller fall back to LIST, which would give the
+       entries seen so far a second time.  */
+    err = EIO;
+
+  return err;
+}
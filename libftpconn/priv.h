@@ -1,6 +1,6 @@
 /* libftpconn private definitions
 
-   Copyright (C) 1997 Free Software Foundation, Inc.
+   Copyright (C) 1997, 2026 Free Software Foundation, Inc.
 
    Written by Miles Bader <miles@gnu.ai.mit.edu>
 
@@ -45,6 +45,8 @@
 
 #define REPLY_NEED_PASS	331	/* User name okay, need password */
 #define REPLY_NEED_ACCT 332	/* Need account for login */
+#define REPLY_PENDING	350	/* Requested file action pending further
+				   information */
 
 #define REPLY_CLOSED	421	/* Service not available, closing control connection */
 #define REPLY_ABORTED	426	/* Connection closed; transfer aborted */
@@ -93,6 +95,13 @@ extern const error_t ftp_conn_poss_file_errs[];
 
 error_t ftp_conn_get_pasv_addr (struct ftp_conn *conn, struct sockaddr **addr);
 
+/* Get a list of file-stat structures for NAME using the MLSD or MLST
+   commands, as ftp_conn_get_stats does.  If the server doesn't support
+   them, EOPNOTSUPP is returned.  */
+error_t ftp_conn_mlsx_get_stats (struct ftp_conn *conn, const char *name,
+				 int contents,
+				 ftp_conn_add_stat_fun_t add_stat, void *hook);
+
 error_t ftp_conn_send_actv_addr (struct ftp_conn *conn, struct sockaddr *addr);
 
 #endif /* __FTPCONN_PRIV_H__ */
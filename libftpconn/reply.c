@@ -145,6 +145,7 @@ ftp_conn_get_raw_reply (struct ftp_conn *conn, int *reply,
 {
   size_t reply_txt_offs = 0;	/* End of a multi-line reply in accum buf.  */
   int multi = 0;		/* If a multi-line reply, the reply code. */
+  int lines = 0;		/* Number of lines accumulated so far.  */
 
   if (!reply && !reply_txt)
     return 0;			/* nop */
@@ -164,8 +165,11 @@ ftp_conn_get_raw_reply (struct ftp_conn *conn, int *reply,
   do {									      \
     if (reply_txt)		/* Only accumulate if wanted.  */	      \
       {									      \
-	error_t err =							      \
-	  ftp_conn_add_reply_txt (conn, &reply_txt_offs, txt, len);	      \
+	error_t err = 0;						      \
+	if (lines++ > 0)	/* Separate lines with newlines.  */	      \
+	  err = ftp_conn_add_reply_txt (conn, &reply_txt_offs, "\n", 1);    \
+	if (! err)							      \
+	  err = ftp_conn_add_reply_txt (conn, &reply_txt_offs, txt, len);   \
 	if (err)							      \
 	  return err;							      \
       }									      \
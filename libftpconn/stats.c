@@ -1,6 +1,6 @@
 /* Fetch file stats
 
-   Copyright (C) 1997 Free Software Foundation, Inc.
+   Copyright (C) 1997, 2026 Free Software Foundation, Inc.
 
    Written by Miles Bader <miles@gnu.ai.mit.edu>
 
@@ -22,6 +22,7 @@
 #include <errno.h>
 
 #include <ftpconn.h>
+#include "priv.h"
 
 /* Start an operation to get a list of file-stat structures for NAME (this
    is often similar to ftp_conn_start_dir, but with OS-specific flags), and
@@ -67,8 +68,15 @@ ftp_conn_get_stats (struct ftp_conn *conn,
 {
   int fd;
   void *state;
-  error_t err = ftp_conn_start_get_stats (conn, name, contents, &fd, &state);
+  error_t err = ftp_conn_mlsx_get_stats (conn, name, contents, add_stat, hook);
 
+  if (err != EOPNOTSUPP)
+    /* MLSD and MLST give us names and stats in a single round trip, with a
+       well-defined format; only use the system-specific LIST parsing if the
+       server doesn't have them.  */
+    return err;
+
+  err = ftp_conn_start_get_stats (conn, name, contents, &fd, &state);
   if (err)
     return err;
 
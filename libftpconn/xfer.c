@@ -1,6 +1,6 @@
 /* Start/stop data channel transfer
 
-   Copyright (C) 1997,2002 Free Software Foundation, Inc.
+   Copyright (C) 1997,2002,2026 Free Software Foundation, Inc.
    Written by Miles Bader <miles@gnu.org>
 
    This program is free software; you can redistribute it and/or
@@ -18,6 +18,7 @@
    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
 
 #include <unistd.h>
+#include <stdio.h>
 #include <errno.h>
 #include <string.h>
 #include <netinet/in.h>
@@ -200,13 +201,14 @@ ftp_conn_abort_open_data (struct ftp_conn *conn, int data)
 }
 
 /* Start a transfer command CMD/ARG, returning a file descriptor in DATA.
-   POSS_ERRS is a list of errnos to try matching against any resulting error
-   text.  */
-error_t
-ftp_conn_start_transfer (struct ftp_conn *conn,
-			 const char *cmd, const char *arg,
-			 const error_t *poss_errs,
-			 int *data)
+   If OFFSET isn't zero, a REST command is sent first, so that the transfer
+   starts OFFSET bytes into the file.  POSS_ERRS is a list of errnos to try
+   matching against any resulting error text.  */
+static error_t
+ftp_conn_start_transfer_at (struct ftp_conn *conn,
+			    const char *cmd, const char *arg, off_t offset,
+			    const error_t *poss_errs,
+			    int *data)
 {
   error_t err = ftp_conn_start_open_data (conn, data);
 
@@ -215,7 +217,24 @@ ftp_conn_start_transfer (struct ftp_conn *conn,
       int reply;
       const char *txt;
 
-      err = ftp_conn_cmd (conn, cmd, arg, &reply, &txt);
+      if (offset > 0)
+	{
+	  char pos[sizeof (offset) * 3 + 1];
+
+	  snprintf (pos, sizeof pos, "%lld", (long long) offset);
+	  err = ftp_conn_cmd (conn, "rest", pos, &reply, &txt);
+	  if (!err && reply != REPLY_PENDING)
+	    {
+	      if (reply == REPLY_BAD_CMD)
+		/* Plenty of servers just don't know about REST.  */
+		err = EOPNOTSUPP;
+	      else
+		err = unexpected_reply (conn, reply, txt, 0);
+	    }
+	}
+
+      if (! err)
+	err = ftp_conn_cmd (conn, cmd, arg, &reply, &txt);
       if (!err && !REPLY_IS_PRELIM (reply))
 	err = unexpected_reply (conn, reply, txt, poss_errs);
 
@@ -228,6 +247,18 @@ ftp_conn_start_transfer (struct ftp_conn *conn,
   return err;
 }
 
+/* Start a transfer command CMD/ARG, returning a file descriptor in DATA.
+   POSS_ERRS is a list of errnos to try matching against any resulting error
+   text.  */
+error_t
+ftp_conn_start_transfer (struct ftp_conn *conn,
+			 const char *cmd, const char *arg,
+			 const error_t *poss_errs,
+			 int *data)
+{
+  return ftp_conn_start_transfer_at (conn, cmd, arg, 0, poss_errs, data);
+}
+
 /* Wait for the reply signalling the end of a data transfer.  */
 error_t
 ftp_conn_finish_transfer (struct ftp_conn *conn)
@@ -250,6 +281,19 @@ ftp_conn_start_retrieve (struct ftp_conn *conn, const char *name, int *data)
     ftp_conn_start_transfer (conn, "retr", name, ftp_conn_poss_file_errs, data);
 }
 
+/* Start retreiving file NAME over CONN from OFFSET bytes into it, returning
+   a file descriptor in DATA over which the data can be read.  If the server
+   doesn't support restarting transfers, EOPNOTSUPP is returned.  */
+error_t
+ftp_conn_start_retrieve_at (struct ftp_conn *conn, const char *name,
+			    off_t offset, int *data)
+{
+  if (! name || offset < 0)
+    return EINVAL;
+  return ftp_conn_start_transfer_at (conn, "retr", name, offset,
+				     ftp_conn_poss_file_errs, data);
+}
+
 /* Start retreiving a list of files in NAME over CONN, returning a file
    descriptor in DATA over which the data can be read.  */
 error_t
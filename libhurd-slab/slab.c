@@ -35,6 +35,16 @@
 
 #define SLAB_PAGES 4
 
+/* The number of objects a magazine holds at first, and at most.  */
+#define MAGAZINE_SIZE_MIN 8
+#define MAGAZINE_SIZE_MAX 64
+
+/* The depot is rebalanced every this many exchanges.  If more than
+   one in CONTENTION_RATIO of them had to wait for the lock, the
+   magazines are made bigger.  */
+#define REBALANCE_INTERVAL 128
+#define CONTENTION_RATIO 16
+
 
 /* Number of pages the slab allocator has allocated.  */
 static int __hurd_slab_nr_pages;
@@ -67,6 +77,27 @@ struct hurd_slab
   union hurd_bufctl *free_list;
 };
 
+/* A magazine: a stack of ROUNDS free objects, constructed and ready
+   to be handed out.  */
+struct hurd_slab_magazine
+{
+  struct hurd_slab_magazine *next;
+  int rounds;
+  void *objs[MAGAZINE_SIZE_MAX];
+};
+
+/* The magazines a thread has for a slab space.  Objects are
+   allocated from and deallocated to LOADED; PREVIOUS is swapped in
+   when LOADED runs empty or full.  Either may be null.  */
+struct hurd_slab_cache
+{
+  struct hurd_slab_space *space;
+  struct hurd_slab_magazine *loaded;
+  struct hurd_slab_magazine *previous;
+};
+
+static void cache_destroy (void *arg);
+
 /* Allocate a buffer in *PTR of size SIZE which must be a power of 2
    and self aligned (i.e. aligned on a SIZE byte boundary) for slab
    space SPACE.  Return 0 on success, an error code on failure.  */
@@ -225,10 +256,15 @@ init_space (hurd_slab_space_t space)
   space->full_refcount 
     = ((space->slab_size - sizeof (struct hurd_slab)) / size);
 
+  space->magazine_size = MAGAZINE_SIZE_MIN;
+  space->cache_key_valid = ! pthread_key_create (&space->cache_key,
+						 cache_destroy);
+
   /* FIXME: Notify pager's reap functionality about this slab
      space.  */
 
-  space->initialized = true;
+  /* Threads look at this without the lock before using the key.  */
+  __atomic_store_n (&space->initialized, true, __ATOMIC_RELEASE);
 }
 
 
@@ -306,6 +342,262 @@ grow (struct hurd_slab_space *space)
 }
 
 
+/* Allocate a new object from the slabs of SPACE.  SPACE's lock must
+   be held.  */
+static error_t
+slab_alloc (struct hurd_slab_space *space, void **buffer)
+{
+  error_t err;
+  union hurd_bufctl *bufctl;
+
+  /* If there is no slabs with free buffer, the cache has to be
+     expanded with another slab.  If the slab space has not yet been
+     initialized this is always true.  */
+  if (!space->first_free)
+    {
+      err = grow (space);
+      if (err)
+	return err;
+    }
+
+  /* Remove buffer from the free list and update the reference
+     counter.  If the reference counter will hit the top, it is
+     handled at the time of the next allocation.  */
+  bufctl = space->first_free->free_list;
+  space->first_free->free_list = bufctl->next;
+  space->first_free->refcount++;
+  bufctl->slab = space->first_free;
+
+  /* If the reference counter hits the top it means that there has
+     been an allocation boost, otherwise dealloc would have updated
+     the first_free pointer.  Find a slab with free objects.  */
+  if (space->first_free->refcount == space->full_refcount)
+    {
+      struct hurd_slab *new_first = space->slab_first;
+      while (new_first)
+	{
+	  if (new_first->refcount != space->full_refcount)
+	    break;
+	  new_first = new_first->next;
+	}
+      /* If first_free is set to NULL here it means that there are
+	 only empty slabs.  The next call to alloc will allocate a new
+	 slab if there was no call to dealloc in the meantime.  */
+      space->first_free = new_first;
+    }
+  *buffer = ((void *) bufctl) - (space->size - sizeof *bufctl);
+  return 0;
+}
+
+
+static inline void
+put_on_slab_list (struct hurd_slab *slab, union hurd_bufctl *bufctl)
+{
+  bufctl->next = slab->free_list;
+  slab->free_list = bufctl;
+  slab->refcount--;
+  assert_backtrace (slab->refcount >= 0);
+}
+
+
+/* Give the object BUFFER back to its slab in SPACE.  SPACE's lock
+   must be held.  */
+static void
+slab_dealloc (struct hurd_slab_space *space, void *buffer)
+{
+  struct hurd_slab *slab;
+  union hurd_bufctl *bufctl;
+
+  bufctl = (buffer + (space->size - sizeof *bufctl));
+  put_on_slab_list (slab = bufctl->slab, bufctl);
+
+  /* Try to have first_free always pointing at the slab that has the
+     most number of free objects.  So after this deallocation, update
+     the first_free pointer if reference counter drops below the
+     current reference counter of first_free.  */
+  if (!space->first_free 
+      || slab->refcount < space->first_free->refcount)
+    space->first_free = slab;
+}
+
+
+/* Put MAG into the depot of SPACE, with the full magazines if it
+   holds any object.  SPACE's lock must be held.  */
+static void
+depot_put (struct hurd_slab_space *space, struct hurd_slab_magazine *mag)
+{
+  if (mag->rounds)
+    {
+      mag->next = space->depot_full;
+      space->depot_full = mag;
+      space->depot_nr_full++;
+    }
+  else
+    {
+      mag->next = space->depot_empty;
+      space->depot_empty = mag;
+      space->depot_nr_empty++;
+    }
+}
+
+/* Take a full magazine out of the depot of SPACE if FULL, else an
+   empty one.  Return null if there is none.  SPACE's lock must be
+   held.  */
+static struct hurd_slab_magazine *
+depot_get (struct hurd_slab_space *space, bool full)
+{
+  struct hurd_slab_magazine *mag;
+
+  if (full)
+    {
+      mag = space->depot_full;
+      if (mag)
+	{
+	  space->depot_full = mag->next;
+	  if (--space->depot_nr_full < space->depot_min_full)
+	    space->depot_min_full = space->depot_nr_full;
+	}
+    }
+  else
+    {
+      mag = space->depot_empty;
+      if (mag)
+	{
+	  space->depot_empty = mag->next;
+	  if (--space->depot_nr_empty < space->depot_min_empty)
+	    space->depot_min_empty = space->depot_nr_empty;
+	}
+    }
+
+  return mag;
+}
+
+/* Release NR_FULL full and NR_EMPTY empty magazines from the depot of
+   SPACE, giving their objects back to the slabs.  SPACE's lock must
+   be held.  */
+static void
+trim_depot (struct hurd_slab_space *space, int nr_full, int nr_empty)
+{
+  struct hurd_slab_magazine *mag;
+
+  while (nr_full-- > 0 && (mag = depot_get (space, true)))
+    {
+      while (mag->rounds)
+	slab_dealloc (space, mag->objs[--mag->rounds]);
+      free (mag);
+    }
+
+  while (nr_empty-- > 0 && (mag = depot_get (space, false)))
+    free (mag);
+}
+
+/* Called every REBALANCE_INTERVAL exchanges with the depot of SPACE,
+   with SPACE's lock held.  The magazines that stayed in the depot all
+   along were not needed: give them back.  If threads had to wait for
+   the depot often, make the magazines bigger, so that they come less
+   often.  */
+static void
+rebalance (struct hurd_slab_space *space)
+{
+  if (space->contention > space->exchanges / CONTENTION_RATIO
+      && space->magazine_size < MAGAZINE_SIZE_MAX)
+    __atomic_store_n (&space->magazine_size, 2 * space->magazine_size,
+		      __ATOMIC_RELAXED);
+
+  trim_depot (space, space->depot_min_full, space->depot_min_empty);
+
+  space->depot_min_full = space->depot_nr_full;
+  space->depot_min_empty = space->depot_nr_empty;
+  space->exchanges = 0;
+  space->contention = 0;
+}
+
+/* Both magazines of CACHE, a thread's cache for SPACE, are empty if
+   FULL, else both are full (or missing).  Trade the previous one for
+   a full magazine from the depot if FULL, else for an empty one, and
+   make it the loaded one.  Return true if this was done.  Otherwise
+   return false with SPACE's lock held, so that the caller can go to
+   the slabs directly.  */
+static bool
+depot_exchange (struct hurd_slab_space *space, struct hurd_slab_cache *cache,
+		bool full)
+{
+  struct hurd_slab_magazine *mag;
+
+  if (pthread_mutex_trylock (&space->lock))
+    {
+      pthread_mutex_lock (&space->lock);
+      space->contention++;
+    }
+
+  if (++space->exchanges >= REBALANCE_INTERVAL)
+    rebalance (space);
+
+  mag = depot_get (space, full);
+  if (! mag && ! full)
+    {
+      mag = malloc (sizeof *mag);
+      if (mag)
+	mag->rounds = 0;
+    }
+  if (! mag)
+    return false;
+
+  if (cache->previous)
+    depot_put (space, cache->previous);
+  cache->previous = cache->loaded;
+  cache->loaded = mag;
+
+  pthread_mutex_unlock (&space->lock);
+  return true;
+}
+
+/* Called when a thread exits with its cache ARG for a slab space.  */
+static void
+cache_destroy (void *arg)
+{
+  struct hurd_slab_cache *cache = arg;
+  struct hurd_slab_space *space = cache->space;
+
+  pthread_mutex_lock (&space->lock);
+  if (cache->loaded)
+    depot_put (space, cache->loaded);
+  if (cache->previous)
+    depot_put (space, cache->previous);
+  pthread_mutex_unlock (&space->lock);
+
+  free (cache);
+}
+
+/* Return the calling thread's cache for SPACE, or null if it has
+   none and one cannot be made.  */
+static struct hurd_slab_cache *
+get_cache (struct hurd_slab_space *space)
+{
+  struct hurd_slab_cache *cache;
+
+  if (! __atomic_load_n (&space->initialized, __ATOMIC_ACQUIRE)
+      || ! space->cache_key_valid)
+    return NULL;
+
+  cache = pthread_getspecific (space->cache_key);
+  if (! cache)
+    {
+      cache = calloc (1, sizeof *cache);
+      if (! cache)
+	return NULL;
+      cache->space = space;
+      if (pthread_setspecific (space->cache_key, cache))
+	{
+	  free (cache);
+	  return NULL;
+	}
+    }
+
+  return cache;
+}
+
+
 /* Initialize the slab space SPACE.  */
 error_t
 hurd_slab_init (hurd_slab_space_t space, size_t size, size_t alignment,
@@ -394,6 +686,23 @@ hurd_slab_destroy (hurd_slab_space_t space)
   /* The caller wants to destroy the slab.  It can not be destroyed if
      there are any outstanding memory allocations.  */
   pthread_mutex_lock (&space->lock);
+
+  /* The objects cached by the calling thread and in the depot are
+     not allocated.  Those cached by other threads are.  */
+  if (space->cache_key_valid)
+    {
+      struct hurd_slab_cache *cache = pthread_getspecific (space->cache_key);
+      if (cache)
+	{
+	  if (cache->loaded)
+	    depot_put (space, cache->loaded);
+	  if (cache->previous)
+	    depot_put (space, cache->previous);
+	  cache->loaded = cache->previous = NULL;
+	}
+    }
+  trim_depot (space, space->depot_nr_full, space->depot_nr_empty);
+
   err = reap (space);
   if (err)
     {
@@ -409,6 +718,12 @@ hurd_slab_destroy (hurd_slab_space_t space)
       return EBUSY;
     }
 
+  if (space->cache_key_valid)
+    {
+      free (pthread_getspecific (space->cache_key));
+      pthread_key_delete (space->cache_key);
+    }
+
   /* FIXME: Remove slab space from pager's reap functionality.  */
 
   return 0;
@@ -433,62 +748,36 @@ hurd_slab_free (hurd_slab_space_t space)
 error_t
 hurd_slab_alloc (hurd_slab_space_t space, void **buffer)
 {
+  struct hurd_slab_cache *cache = get_cache (space);
   error_t err;
-  union hurd_bufctl *bufctl;
-
-  pthread_mutex_lock (&space->lock);
 
-  /* If there is no slabs with free buffer, the cache has to be
-     expanded with another slab.  If the slab space has not yet been
-     initialized this is always true.  */
-  if (!space->first_free)
-    {
-      err = grow (space);
-      if (err)
-	{
-	  pthread_mutex_unlock (&space->lock);
-	  return err;
-	}
-    }
-
-  /* Remove buffer from the free list and update the reference
-     counter.  If the reference counter will hit the top, it is
-     handled at the time of the next allocation.  */
-  bufctl = space->first_free->free_list;
-  space->first_free->free_list = bufctl->next;
-  space->first_free->refcount++;
-  bufctl->slab = space->first_free;
-
-  /* If the reference counter hits the top it means that there has
-     been an allocation boost, otherwise dealloc would have updated
-     the first_free pointer.  Find a slab with free objects.  */
-  if (space->first_free->refcount == space->full_refcount)
-    {
-      struct hurd_slab *new_first = space->slab_first;
-      while (new_first)
-	{
-	  if (new_first->refcount != space->full_refcount)
-	    break;
-	  new_first = new_first->next;
-	}
-      /* If first_free is set to NULL here it means that there are
-	 only empty slabs.  The next call to alloc will allocate a new
-	 slab if there was no call to dealloc in the meantime.  */
-      space->first_free = new_first;
-    }
-  *buffer = ((void *) bufctl) - (space->size - sizeof *bufctl);
+  if (! cache)
+    pthread_mutex_lock (&space->lock);
+  else
+    for (;;)
+      {
+	struct hurd_slab_magazine *mag = cache->loaded;
+
+	if (mag && mag->rounds > 0)
+	  {
+	    *buffer = mag->objs[--mag->rounds];
+	    return 0;
+	  }
+
+	if (cache->previous && cache->previous->rounds > 0)
+	  {
+	    cache->loaded = cache->previous;
+	    cache->previous = mag;
+	    continue;
+	  }
+
+	if (! depot_exchange (space, cache, true))
+	  break;
+      }
+
+  err = slab_alloc (space, buffer);
   pthread_mutex_unlock (&space->lock);
-  return 0;
-}
-
-
-static inline void
-put_on_slab_list (struct hurd_slab *slab, union hurd_bufctl *bufctl)
-{
-  bufctl->next = slab->free_list;
-  slab->free_list = bufctl;
-  slab->refcount--;
-  assert_backtrace (slab->refcount >= 0);
+  return err;
 }
 
 
@@ -496,23 +785,53 @@ put_on_slab_list (struct hurd_slab *slab, union hurd_bufctl *bufctl)
 void
 hurd_slab_dealloc (hurd_slab_space_t space, void *buffer)
 {
-  struct hurd_slab *slab;
-  union hurd_bufctl *bufctl;
+  struct hurd_slab_cache *cache;
 
   assert_backtrace (space->initialized);
 
-  pthread_mutex_lock (&space->lock);
+  cache = get_cache (space);
+  if (! cache)
+    pthread_mutex_lock (&space->lock);
+  else
+    for (;;)
+      {
+	struct hurd_slab_magazine *mag = cache->loaded;
+
+	if (mag && mag->rounds < __atomic_load_n (&space->magazine_size,
+						  __ATOMIC_RELAXED))
+	  {
+	    mag->objs[mag->rounds++] = buffer;
+	    return;
+	  }
+
+	if (cache->previous && cache->previous->rounds == 0)
+	  {
+	    cache->loaded = cache->previous;
+	    cache->previous = mag;
+	    continue;
+	  }
+
+	if (! depot_exchange (space, cache, false))
+	  break;
+      }
+
+  slab_dealloc (space, buffer);
+  pthread_mutex_unlock (&space->lock);
+}
 
-  bufctl = (buffer + (space->size - sizeof *bufctl));
-  put_on_slab_list (slab = bufctl->slab, bufctl);
 
-  /* Try to have first_free always pointing at the slab that has the
-     most number of free objects.  So after this deallocation, update
-     the first_free pointer if reference counter drops below the
-     current reference counter of first_free.  */
-  if (!space->first_free 
-      || slab->refcount < space->first_free->refcount)
-    space->first_free = slab;
+/* Give the objects in the depot of SPACE back to its slabs, and
+   release the memory of the slabs that have no objects allocated.  */
+error_t
+hurd_slab_reap (hurd_slab_space_t space)
+{
+  error_t err;
 
+  pthread_mutex_lock (&space->lock);
+  trim_depot (space, space->depot_nr_full, space->depot_nr_empty);
+  space->depot_min_full = space->depot_min_empty = 0;
+  err = reap (space);
   pthread_mutex_unlock (&space->lock);
+
+  return err;
 }
@@ -111,6 +111,37 @@ struct hurd_slab_space
   /* The size of one object.  Should include possible alignment as
      well as the size of the bufctl structure.  */
   size_t size;
+
+  /* Third part.  The magazine layer in front of the slabs.  Each
+     thread allocates from and deallocates to its own pair of
+     magazines without taking LOCK, and only exchanges a magazine with
+     the depot below when both are empty (or full).  */
+
+  /* The key to the calling thread's magazines.  Valid if
+     CACHE_KEY_VALID.  */
+  pthread_key_t cache_key;
+  bool cache_key_valid;
+
+  /* The number of objects a full magazine holds.  This grows when
+     threads contend for the depot.  */
+  int magazine_size;
+
+  /* The depot, protected by LOCK: magazines holding objects, and
+     empty ones, with their numbers.  */
+  struct hurd_slab_magazine *depot_full;
+  struct hurd_slab_magazine *depot_empty;
+  int depot_nr_full;
+  int depot_nr_empty;
+
+  /* The fewest magazines there were in each list of the depot since
+     it was last rebalanced.  That many were not needed.  */
+  int depot_min_full;
+  int depot_min_empty;
+
+  /* Exchanges with the depot since it was last rebalanced, and how
+     many of them had to wait for LOCK.  */
+  int exchanges;
+  int contention;
 };
 
 
@@ -168,7 +199,8 @@ error_t hurd_slab_init (hurd_slab_space_t space, size_t size, size_t alignment,
 			void *hook);
 
 /* Destroy all objects and the slab space SPACE.  Returns EBUSY if
-   there are still allocated objects in the slab.  The dual of
+   there are still allocated objects in the slab; objects cached by
+   threads other than the caller count as allocated.  The dual of
    hurd_slab_init.  */
 error_t hurd_slab_destroy (hurd_slab_space_t space);
 
@@ -177,6 +209,11 @@ error_t hurd_slab_alloc (hurd_slab_space_t space, void **buffer);
 
 /* Deallocate the object BUFFER from the slab space SPACE.  */
 void hurd_slab_dealloc (hurd_slab_space_t space, void *buffer);
+
+/* Give the objects in the depot of the slab space SPACE back to its
+   slabs, and release the memory of the slabs that have no objects
+   allocated.  Objects cached by threads are not affected.  */
+error_t hurd_slab_reap (hurd_slab_space_t space);
 
 /* Create a more strongly typed slab interface a la a C++ template.
 
@@ -129,5 +129,62 @@ error_t iohelp_return_malloced_buffer (char *buf, size_t len,
 				       mach_msg_type_number_t *rlen);
 
 
+/* Write DATA, LEN bytes long, to DEST at its file pointer with io_write
+   for an io_transfer server, returning the amount taken in *WRITTEN.
+   MACH_RCV_TIMED_OUT is returned if DEST does not answer in thirty
+   seconds, so that it cannot keep the server thread forever.  */
+error_t iohelp_transfer_write (io_t dest, const char *data, size_t len,
+			       vm_size_t *written);
+
+
+/* Readiness notifications (io_notify_request) */
+
+/* One registration made with io_notify_request.  */
+struct iohelp_notify
+{
+  struct iohelp_notify *next;
+  void *owner;			/* The object registered with.  */
+  mach_port_t port;		/* Where io_ready is sent.  */
+  natural_t cookie;
+  int select_type;		/* The conditions waited for.  */
+  int armed;			/* Whether io_ready may be sent.  */
+  int pending;			/* What io_ready could not yet tell.  */
+};
+
+/* Register in *LIST the interest of PORT in the conditions SELECT_TYPE
+   of OWNER, for io_ready messages carrying COOKIE, as io_notify_request
+   does, and arm the registration; READY holds the conditions already
+   true, and if any of them is waited for, io_ready is sent at once.
+   Registrations are told apart by OWNER as well as PORT, so that the
+   objects sharing *LIST, such as the reader and the writer of a pipe,
+   never replace or cancel those of each other.  The registrations of
+   *LIST still waiting to be told something because their port was full
+   are tried again first.  A send right for PORT is consumed on success.  The caller must hold the lock protecting
+   *LIST.  */
+error_t iohelp_notify_request (struct iohelp_notify **list, void *owner,
+			       mach_port_t port, int select_type,
+			       natural_t cookie, int ready);
+
+/* Return the conditions the armed registrations of *LIST wait for, so
+   that the caller need not find out which are true when that is
+   zero.  */
+int iohelp_notify_wanted (struct iohelp_notify **list);
+
+/* Send io_ready to the armed registrations of *LIST waiting for any of
+   the conditions READY, which are now true, and disarm them.  The
+   registrations whose port has died are dropped.  A registration whose
+   port was full stays armed, and what it was to be told is sent again
+   at the next call of this or iohelp_notify_request on *LIST, whatever
+   READY is then.  The caller must hold the lock protecting *LIST.  */
+void iohelp_notify_post (struct iohelp_notify **list, int ready);
+
+/* Drop the registrations of *LIST made for OWNER, which is going away.
+   The caller must hold the lock protecting *LIST.  */
+void iohelp_notify_cancel (struct iohelp_notify **list, void *owner);
+
+/* Drop all the registrations of *LIST.  */
+void iohelp_notify_clear (struct iohelp_notify **list);
+
+
 
 #endif
@@ -0,0 +1,184 @@
+/* Readiness notifications
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+#include "iohelp.h"
+
+#include <stdlib.h>
+#include "io_ready_U.h"
+
+static void
+notify_free (struct iohelp_notify *n)
+{
+  mach_port_deallocate (mach_task_self (), n->port);
+  free (n);
+}
+
+/* Send io_ready to N for READY and what is pending on it, and disarm
+   it.  Return zero if N is to be dropped, its port having died.  */
+static int
+notify_send (struct iohelp_notify *n, int ready)
+{
+  error_t err;
+
+  ready = (ready | n->pending) & n->select_type;
+  err = io_ready (n->port, 0, n->cookie, ready);
+  if (err == MACH_SEND_INVALID_DEST)
+    return 0;
+
+  if (err == MACH_SEND_TIMED_OUT)
+    /* The queue of N is full; keep N armed and send READY again at the
+       next request or post on its list, even if nothing N waits for
+       changes meanwhile.  */
+    n->pending = ready;
+  else
+    {
+      n->armed = 0;
+      n->pending = 0;
+    }
+  return 1;
+}
+
+/* Send again what could not be sent to the registrations of *LIST.  */
+static void
+notify_flush (struct iohelp_notify **list)
+{
+  struct iohelp_notify *n, **prevp = list;
+
+  while ((n = *prevp))
+    if (n->pending && ! notify_send (n, 0))
+      {
+	*prevp = n->next;
+	notify_free (n);
+      }
+    else
+      prevp = &n->next;
+}
+
+error_t
+iohelp_notify_request (struct iohelp_notify **list, void *owner,
+		       mach_port_t port, int select_type, natural_t cookie,
+		       int ready)
+{
+  struct iohelp_notify *n, **prevp;
+
+  if (! MACH_PORT_VALID (port))
+    return EINVAL;
+
+  /* The client may be re-arming after draining its port; those of its
+     registrations that found the port full can be told now.  */
+  notify_flush (list);
+
+  for (prevp = list; *prevp; prevp = &(*prevp)->next)
+    if ((*prevp)->owner == owner && (*prevp)->port == port)
+      break;
+  n = *prevp;
+
+  if (select_type == 0)
+    {
+      if (n)
+	{
+	  *prevp = n->next;
+	  notify_free (n);
+	}
+      mach_port_deallocate (mach_task_self (), port);
+      return 0;
+    }
+
+  if (n)
+    /* N already holds a reference to PORT.  */
+    mach_port_deallocate (mach_task_self (), port);
+  else
+    {
+      n = malloc (sizeof *n);
+      if (! n)
+	return ENOMEM;
+      n->owner = owner;
+      n->port = port;
+      n->next = *list;
+      *list = n;
+      prevp = list;
+    }
+
+  n->cookie = cookie;
+  n->select_type = select_type;
+  n->armed = 1;
+  n->pending = 0;
+
+  if ((ready & select_type) && ! notify_send (n, ready))
+    {
+      *prevp = n->next;
+      notify_free (n);
+    }
+
+  return 0;
+}
+
+int
+iohelp_notify_wanted (struct iohelp_notify **list)
+{
+  struct iohelp_notify *n;
+  int wanted = 0;
+
+  for (n = *list; n; n = n->next)
+    if (n->armed)
+      wanted |= n->select_type;
+
+  return wanted;
+}
+
+void
+iohelp_notify_post (struct iohelp_notify **list, int ready)
+{
+  struct iohelp_notify *n, **prevp = list;
+
+  while ((n = *prevp))
+    if (n->armed && ((n->select_type & ready) || n->pending)
+	&& ! notify_send (n, ready))
+      {
+	*prevp = n->next;
+	notify_free (n);
+      }
+    else
+      prevp = &n->next;
+}
+
+void
+iohelp_notify_cancel (struct iohelp_notify **list, void *owner)
+{
+  struct iohelp_notify *n, **prevp = list;
+
+  while ((n = *prevp))
+    if (n->owner == owner)
+      {
+	*prevp = n->next;
+	notify_free (n);
+      }
+    else
+      prevp = &n->next;
+}
+
+void
+iohelp_notify_clear (struct iohelp_notify **list)
+{
+  struct iohelp_notify *n;
+
+  while ((n = *list))
+    {
+      *list = n->next;
+      notify_free (n);
+    }
+}
@@ -0,0 +1,27 @@
+/* Writes for io_transfer
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+#include "iohelp.h"
+#include "transfer_io.h"
+
+/* The io_write stub used here times out (see the Makefile).  */
+error_t
+iohelp_transfer_write (io_t dest, const char *data, size_t len,
+		       vm_size_t *written)
+{
+  return transfer_io_write (dest, (data_t) data, len, -1, written);
+}
@@ -19,12 +19,39 @@
    along with this program; if not, write to the Free Software
    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
 
-#include "netfs.h"
+#include <stdio.h>
+#include <argz.h>
+#include "priv.h"
 
 /* Appends to ARGZ & ARGZ_LEN '\0'-separated options describing the standard
    netfs option state.  */
 error_t
 netfs_append_std_options (char **argz, size_t *argz_len)
 {
-  return 0;
+  char buf[100];
+  error_t err = 0;
+
+  if (netfs_attr_cache_timeout > 0)
+    {
+      snprintf (buf, sizeof buf, "--attr-cache-timeout=%d",
+		netfs_attr_cache_timeout);
+      err = argz_add (argz, argz_len, buf);
+    }
+  if (! err && netfs_lookup_cache_timeout > 0)
+    {
+      snprintf (buf, sizeof buf, "--lookup-cache-timeout=%d",
+		netfs_lookup_cache_timeout);
+      err = argz_add (argz, argz_len, buf);
+    }
+  if (! err && netfs_data_cache_size > 0)
+    {
+      snprintf (buf, sizeof buf, "--data-cache-size=%zu",
+		netfs_data_cache_size);
+      err = argz_add (argz, argz_len, buf);
+    }
+
+  if (! err)
+    err = _netfs_append_cache_stats (argz, argz_len);
+
+  return err;
 }
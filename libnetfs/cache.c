@@ -0,0 +1,745 @@
+/* Caching of stat information, lookups and file contents
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with the GNU Hurd.  If not, see <http://www.gnu.org/licenses/>.  */
+
+/* Three caches sit between the RPCs and the translator:
+
+   The stat information of a node, once got by netfs_validate_stat, is
+   used for netfs_node_attr_timeout seconds without asking again.
+
+   The results of netfs_attempt_lookup, nodes and ENOENT alike, are
+   kept by directory and name, for netfs_lookup_cache_timeout seconds
+   and as long as the modification time of the directory stays the same.
+   A lookup served from the cache checks search permission on the
+   directory itself, as the translator is not asked.
+
+   Contents of regular files read by io_read are kept in blocks of
+   DATA_BLOCK_SIZE bytes, up to netfs_data_cache_size bytes for all
+   files, least recently used ones going first.  They are dropped when
+   the modification time or the size of their file is seen to change.
+
+   Whatever is changed through netfs itself is forgotten at once; what
+   changes behind its back goes unnoticed until the timeouts run out,
+   or until the translator calls netfs_cache_invalidate or
+   netfs_cache_invalidate_name.  */
+
+#include "priv.h"
+#include <string.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <argz.h>
+#include <maptime.h>
+#include <hurd/ihash.h>
+
+/* Maximum number of lookup results kept.  */
+#define NAME_CACHE_SIZE 1024
+
+#define DATA_BLOCK_SIZE (16 * 1024)
+
+/* Reads bigger than this bypass the data cache; the translator is
+   better at them than a block at a time.  */
+#define DATA_CACHE_MAX_READ (4 * DATA_BLOCK_SIZE)
+
+int netfs_attr_cache_timeout;
+int netfs_lookup_cache_timeout;
+size_t netfs_data_cache_size;
+
+/* How well the caches have been doing.  The attribute counters are
+   updated atomically, the others under the lock of their cache.  */
+static struct stats
+{
+  unsigned long attr_hits;
+  unsigned long attr_misses;
+  unsigned long pos_hits;
+  unsigned long neg_hits;
+  unsigned long lookup_misses;
+  unsigned long data_hits;
+  unsigned long data_misses;
+} statistics;
+
+/* Return the current time, in microseconds.  */
+static unsigned long long
+now (void)
+{
+  struct timeval t;
+
+  maptime_read (netfs_mtime, &t);
+  return t.tv_sec * 1000000ULL + t.tv_usec;
+}
+
+static int
+same_time (const struct timespec *a, const struct timespec *b)
+{
+  return a->tv_sec == b->tv_sec && a->tv_nsec == b->tv_nsec;
+}
+
+
+/* Stat information.  */
+
+int __attribute__ ((weak))
+netfs_node_attr_timeout (struct node *np)
+{
+  return netfs_attr_cache_timeout;
+}
+
+static void drop_data (struct node *np);
+
+error_t
+_netfs_validate_stat (struct node *np, struct iouser *cred)
+{
+  error_t err;
+  int timeout;
+
+  if (np->stat_expires && now () < np->stat_expires)
+    {
+      __atomic_add_fetch (&statistics.attr_hits, 1, __ATOMIC_RELAXED);
+      return 0;
+    }
+
+  __atomic_add_fetch (&statistics.attr_misses, 1, __ATOMIC_RELAXED);
+  err = netfs_validate_stat (np, cred);
+  if (err)
+    {
+      np->stat_expires = 0;
+      return err;
+    }
+
+  timeout = netfs_node_attr_timeout (np);
+  np->stat_expires = timeout > 0 ? now () + timeout * 1000000ULL : 0;
+
+  /* Cached contents are only good for the file they were read from.
+     Blocks of NP are only added while it is locked, so if there seem
+     to be none, there are none.  */
+  if (__atomic_load_n (&np->data_blocks, __ATOMIC_RELAXED)
+      && (np->nn_stat.st_size != np->data_size
+	  || ! same_time (&np->nn_stat.st_mtim, &np->data_mtime)))
+    drop_data (np);
+
+  return 0;
+}
+
+void
+netfs_cache_invalidate (struct node *np)
+{
+  np->stat_expires = 0;
+  drop_data (np);
+}
+
+
+/* Lookups.  */
+
+/* What a lookup result is found by.  */
+struct name_key
+{
+  struct node *dir;
+  const char *name;
+  size_t name_len;
+};
+
+struct name_entry
+{
+  /* Pointing into this entry itself.  */
+  struct name_key key;
+
+  hurd_ihash_locp_t locp;
+
+  /* Links in the LRU list.  */
+  struct name_entry *next, *prev;
+
+  /* Null for a `negative' entry, recording that there is no such
+     name.  The entry holds a reference on NP and on KEY.DIR.  */
+  struct node *np;
+
+  /* The modification time of the directory when this entry was made.  */
+  struct timespec dir_mtime;
+
+  /* When the entry times out, as returned by now.  */
+  unsigned long long expires;
+
+  char name[];
+};
+
+static hurd_ihash_key_t name_hash (const void *);
+static int name_compare (const void *, const void *);
+
+static struct hurd_ihash name_cache =
+  HURD_IHASH_INITIALIZER_GKI (offsetof (struct name_entry, locp), NULL,
+			      NULL, name_hash, name_compare);
+
+/* The entries, most recently used first.  */
+static struct name_entry *name_mru, *name_lru;
+
+/* Bumped whenever entries are invalidated, so that lookups running at
+   that moment do not enter what they found.  */
+static unsigned int name_generation;
+
+static pthread_spinlock_t name_lock = PTHREAD_SPINLOCK_INITIALIZER;
+
+static hurd_ihash_key_t
+name_hash (const void *key)
+{
+  const struct name_key *k = key;
+  uint32_t h = hurd_ihash_hash32 (&k->dir, sizeof k->dir, 0);
+
+  return (hurd_ihash_key_t) hurd_ihash_hash32 (k->name, k->name_len, h);
+}
+
+static int
+name_compare (const void *key1, const void *key2)
+{
+  const struct name_key *k1 = key1, *k2 = key2;
+
+  return (k1->dir == k2->dir
+	  && k1->name_len == k2->name_len
+	  && memcmp (k1->name, k2->name, k1->name_len) == 0);
+}
+
+/* Unlink E from the LRU list.  NAME_LOCK must be held.  */
+static void
+unlink_lru (struct name_entry *e)
+{
+  if (e->prev)
+    e->prev->next = e->next;
+  else
+    name_mru = e->next;
+  if (e->next)
+    e->next->prev = e->prev;
+  else
+    name_lru = e->prev;
+}
+
+/* Make E the most recently used entry.  NAME_LOCK must be held.  */
+static void
+make_mru (struct name_entry *e)
+{
+  if (name_mru == e)
+    return;
+  if (e->prev || e->next || name_lru == e)
+    unlink_lru (e);
+  e->prev = NULL;
+  e->next = name_mru;
+  if (e->next)
+    e->next->prev = e;
+  else
+    name_lru = e;
+  name_mru = e;
+}
+
+/* Remove E from the cache, and put it on the list *DEAD, to be freed
+   once NAME_LOCK, which must be held, is released.  */
+static void
+drop_entry (struct name_entry *e, struct name_entry **dead)
+{
+  hurd_ihash_locp_remove (&name_cache, e->locp);
+  unlink_lru (e);
+  e->next = *dead;
+  *dead = e;
+}
+
+/* Free the entries on the list DEAD.  NAME_LOCK must not be held, as
+   releasing a node might need it.  */
+static void
+free_entries (struct name_entry *dead)
+{
+  struct name_entry *e, *next;
+
+  for (e = dead; e; e = next)
+    {
+      next = e->next;
+      if (e->np)
+	netfs_nrele (e->np);
+      netfs_nrele (e->key.dir);
+      free (e);
+    }
+}
+
+static struct name_entry *
+find_entry (struct node *dir, const char *name, size_t name_len)
+{
+  struct name_key key = { dir, name, name_len };
+
+  return hurd_ihash_find (&name_cache, (hurd_ihash_key_t) &key);
+}
+
+/* NAME has just been looked up in DIR, whose modification time was
+   DIR_MTIME, and found to be NP, or to be absent if NP is null.  The
+   caller holds references on DIR and NP.  GENERATION is the value
+   NAME_GENERATION had before the lookup.  */
+static void
+enter_entry (struct node *dir, const char *name, struct node *np,
+	     struct timespec dir_mtime, unsigned int generation)
+{
+  size_t name_len = strlen (name);
+  struct name_entry *e, *old, *dead = NULL;
+  unsigned long long t = now ();
+
+  e = malloc (sizeof *e + name_len + 1);
+  if (! e)
+    return;
+
+  memcpy (e->name, name, name_len + 1);
+  e->key.dir = dir;
+  e->key.name = e->name;
+  e->key.name_len = name_len;
+  e->np = np;
+  e->dir_mtime = dir_mtime;
+  e->expires = t + netfs_lookup_cache_timeout * 1000000ULL;
+  e->next = e->prev = NULL;
+  netfs_nref (dir);
+  if (np)
+    netfs_nref (np);
+
+  pthread_spin_lock (&name_lock);
+
+  if (generation != name_generation)
+    {
+      /* Something has been invalidated meanwhile; E may be stale
+	 already.  */
+      e->next = dead;
+      dead = e;
+      goto out;
+    }
+
+  old = find_entry (dir, e->name, name_len);
+  if (old)
+    drop_entry (old, &dead);
+
+  /* Make room, and get rid of the entries that have timed out and
+     have not been used since.  */
+  while (name_lru
+	 && (name_cache.nr_items >= NAME_CACHE_SIZE
+	     || name_lru->expires <= t))
+    drop_entry (name_lru, &dead);
+
+  if (hurd_ihash_add (&name_cache, (hurd_ihash_key_t) &e->key, e))
+    {
+      e->next = dead;
+      dead = e;
+    }
+  else
+    make_mru (e);
+
+ out:
+  pthread_spin_unlock (&name_lock);
+
+  free_entries (dead);
+}
+
+error_t
+_netfs_lookup (struct iouser *cred, struct node *dir, const char *name,
+	       struct node **np)
+{
+  struct name_entry *e;
+  struct timespec dir_mtime;
+  unsigned int generation;
+  error_t err;
+
+  /* `.' and `..' are left alone, so that the cache holds no cycles and
+     no references on parents.  */
+  if (netfs_lookup_cache_timeout <= 0
+      || (name[0] == '.'
+	  && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))))
+    return netfs_attempt_lookup (cred, dir, name, np);
+
+  /* Without current stat information for DIR, or search permission in
+     it, the translator is the one to decide.  */
+  if (_netfs_validate_stat (dir, cred)
+      || fshelp_access (&dir->nn_stat, S_IEXEC, cred))
+    return netfs_attempt_lookup (cred, dir, name, np);
+  dir_mtime = dir->nn_stat.st_mtim;
+
+  pthread_spin_lock (&name_lock);
+  e = find_entry (dir, name, strlen (name));
+  if (e && now () < e->expires && same_time (&e->dir_mtime, &dir_mtime))
+    {
+      make_mru (e);
+      *np = e->np;
+      if (*np)
+	{
+	  netfs_nref (*np);
+	  statistics.pos_hits++;
+	}
+      else
+	statistics.neg_hits++;
+      pthread_spin_unlock (&name_lock);
+
+      pthread_mutex_unlock (&dir->lock);
+      if (! *np)
+	return ENOENT;
+      pthread_mutex_lock (&(*np)->lock);
+      return 0;
+    }
+  statistics.lookup_misses++;
+  generation = name_generation;
+  pthread_spin_unlock (&name_lock);
+
+  err = netfs_attempt_lookup (cred, dir, name, np);
+  if (! err || err == ENOENT)
+    enter_entry (dir, name, err ? NULL : *np, dir_mtime, generation);
+  return err;
+}
+
+void
+netfs_cache_invalidate_name (struct node *dir, const char *name)
+{
+  struct name_entry *e, *next, *dead = NULL;
+
+  dir->stat_expires = 0;
+
+  pthread_spin_lock (&name_lock);
+  name_generation++;
+  if (name)
+    {
+      e = find_entry (dir, name, strlen (name));
+      if (e)
+	drop_entry (e, &dead);
+    }
+  else
+    for (e = name_mru; e; e = next)
+      {
+	next = e->next;
+	if (e->key.dir == dir)
+	  drop_entry (e, &dead);
+      }
+  pthread_spin_unlock (&name_lock);
+
+  free_entries (dead);
+}
+
+
+/* File contents.  */
+
+/* What a block is found by.  */
+struct data_key
+{
+  struct node *np;
+  loff_t offset;
+};
+
+struct netfs_data_block
+{
+  /* Where the block is in its file.  */
+  struct data_key key;
+
+  hurd_ihash_locp_t locp;
+
+  /* Links in the list of the blocks of the file.  */
+  struct netfs_data_block *next, **prevp;
+
+  /* Links in the LRU list.  */
+  struct netfs_data_block *lru_next, *lru_prev;
+
+  /* Bytes of DATA that are valid.  If less than DATA_BLOCK_SIZE, the
+     file ends there.  */
+  size_t len;
+
+  char data[DATA_BLOCK_SIZE];
+};
+
+static hurd_ihash_key_t data_hash (const void *);
+static int data_compare (const void *, const void *);
+
+static struct hurd_ihash data_cache =
+  HURD_IHASH_INITIALIZER_GKI (offsetof (struct netfs_data_block, locp), NULL,
+			      NULL, data_hash, data_compare);
+
+/* The blocks, most recently used first, and the bytes they take.  */
+static struct netfs_data_block *data_mru, *data_lru;
+static size_t data_space;
+
+/* Protects the blocks of all nodes and the above.  */
+static pthread_mutex_t data_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static hurd_ihash_key_t
+data_hash (const void *key)
+{
+  const struct data_key *k = key;
+  uint32_t h = hurd_ihash_hash32 (&k->np, sizeof k->np, 0);
+
+  return (hurd_ihash_key_t) hurd_ihash_hash32 (&k->offset, sizeof k->offset,
+					       h);
+}
+
+static int
+data_compare (const void *key1, const void *key2)
+{
+  const struct data_key *k1 = key1, *k2 = key2;
+
+  return k1->np == k2->np && k1->offset == k2->offset;
+}
+
+static void
+unlink_block_lru (struct netfs_data_block *b)
+{
+  if (b->lru_prev)
+    b->lru_prev->lru_next = b->lru_next;
+  else
+    data_mru = b->lru_next;
+  if (b->lru_next)
+    b->lru_next->lru_prev = b->lru_prev;
+  else
+    data_lru = b->lru_prev;
+}
+
+static void
+link_block_mru (struct netfs_data_block *b)
+{
+  b->lru_prev = NULL;
+  b->lru_next = data_mru;
+  if (data_mru)
+    data_mru->lru_prev = b;
+  else
+    data_lru = b;
+  data_mru = b;
+}
+
+/* Remove B from the cache, and put it on the list *DEAD, linked by
+   NEXT, to be freed once DATA_LOCK, which must be held, is released.  */
+static void
+drop_block (struct netfs_data_block *b, struct netfs_data_block **dead)
+{
+  hurd_ihash_locp_remove (&data_cache, b->locp);
+  unlink_block_lru (b);
+  *b->prevp = b->next;
+  if (b->next)
+    b->next->prevp = b->prevp;
+  data_space -= sizeof *b;
+
+  b->next = *dead;
+  *dead = b;
+}
+
+static void
+free_blocks (struct netfs_data_block *dead)
+{
+  struct netfs_data_block *b, *next;
+
+  for (b = dead; b; b = next)
+    {
+      next = b->next;
+      free (b);
+    }
+}
+
+/* Drop blocks, least recently used first, until they take no more
+   than SIZE bytes, sparing KEEP.  DATA_LOCK must be held.  */
+static void
+trim_blocks (size_t size, struct netfs_data_block *keep,
+	     struct netfs_data_block **dead)
+{
+  while (data_space > size && data_lru && data_lru != keep)
+    drop_block (data_lru, dead);
+}
+
+/* Forget the contents of NP.  */
+static void
+drop_data (struct node *np)
+{
+  struct netfs_data_block *dead = NULL;
+
+  pthread_mutex_lock (&data_lock);
+  while (np->data_blocks)
+    drop_block (np->data_blocks, &dead);
+  pthread_mutex_unlock (&data_lock);
+
+  free_blocks (dead);
+}
+
+error_t
+_netfs_read (struct iouser *cred, struct node *np,
+	     loff_t offset, size_t *len, void *data)
+{
+  char *p = data;
+  size_t left = *len;
+  error_t err;
+
+  if (netfs_data_cache_size < DATA_BLOCK_SIZE
+      || *len > DATA_CACHE_MAX_READ
+      || ! S_ISREG (np->nn_stat.st_mode))
+    return netfs_attempt_read (cred, np, offset, len, data);
+
+  /* This drops what is cached if the file has changed.  */
+  err = _netfs_validate_stat (np, cred);
+  if (err)
+    return err;
+
+  while (left > 0)
+    {
+      struct data_key key = { np, offset - offset % DATA_BLOCK_SIZE };
+      size_t skip = offset - key.offset, n;
+      struct netfs_data_block *b, *dead = NULL;
+      int eof;
+
+      pthread_mutex_lock (&data_lock);
+      b = hurd_ihash_find (&data_cache, (hurd_ihash_key_t) &key);
+      if (b)
+	{
+	  statistics.data_hits++;
+	  if (b != data_mru)
+	    {
+	      unlink_block_lru (b);
+	      link_block_mru (b);
+	    }
+	}
+      else
+	{
+	  statistics.data_misses++;
+	  pthread_mutex_unlock (&data_lock);
+
+	  /* Only readers of NP, which is locked, add blocks of it, so
+	     nobody else can add this one meanwhile.  */
+	  b = malloc (sizeof *b);
+	  if (! b)
+	    {
+	      err = ENOMEM;
+	      break;
+	    }
+	  b->len = DATA_BLOCK_SIZE;
+	  err = netfs_attempt_read (cred, np, key.offset, &b->len, b->data);
+	  if (err)
+	    {
+	      free (b);
+	      break;
+	    }
+	  b->key = key;
+
+	  pthread_mutex_lock (&data_lock);
+	  if (hurd_ihash_add (&data_cache, (hurd_ihash_key_t) &b->key, b))
+	    {
+	      /* Use it this once anyway.  */
+	      b->next = dead;
+	      dead = b;
+	    }
+	  else
+	    {
+	      if (! np->data_blocks)
+		{
+		  np->data_mtime = np->nn_stat.st_mtim;
+		  np->data_size = np->nn_stat.st_size;
+		}
+	      b->next = np->data_blocks;
+	      if (b->next)
+		b->next->prevp = &b->next;
+	      b->prevp = &np->data_blocks;
+	      np->data_blocks = b;
+	      link_block_mru (b);
+	      data_space += sizeof *b;
+	      trim_blocks (netfs_data_cache_size, b, &dead);
+	    }
+	}
+
+      n = b->len > skip ? b->len - skip : 0;
+      if (n > left)
+	n = left;
+      memcpy (p, b->data + skip, n);
+      eof = b->len < DATA_BLOCK_SIZE;
+      pthread_mutex_unlock (&data_lock);
+
+      free_blocks (dead);
+
+      p += n;
+      offset += n;
+      left -= n;
+      if (eof)
+	break;
+    }
+
+  /* What was read before an error is returned all the same.  */
+  if (err && left < *len)
+    err = 0;
+  *len -= left;
+  return err;
+}
+
+error_t
+_netfs_write (struct iouser *cred, struct node *np,
+	      loff_t offset, size_t *len, const void *data)
+{
+  error_t err = netfs_attempt_write (cred, np, offset, len, data);
+
+  /* Even a failed write may have changed some of the file.  */
+  netfs_cache_invalidate (np);
+  return err;
+}
+
+void
+_netfs_cache_drop_node (struct node *np)
+{
+  drop_data (np);
+}
+
+
+void
+_netfs_cache_resize (void)
+{
+  struct name_entry *e, *next, *dead_entries = NULL;
+  struct netfs_data_block *dead_blocks = NULL;
+
+  if (netfs_lookup_cache_timeout <= 0)
+    {
+      pthread_spin_lock (&name_lock);
+      name_generation++;
+      for (e = name_mru; e; e = next)
+	{
+	  next = e->next;
+	  drop_entry (e, &dead_entries);
+	}
+      pthread_spin_unlock (&name_lock);
+      free_entries (dead_entries);
+    }
+
+  pthread_mutex_lock (&data_lock);
+  trim_blocks (netfs_data_cache_size, NULL, &dead_blocks);
+  pthread_mutex_unlock (&data_lock);
+  free_blocks (dead_blocks);
+}
+
+error_t
+_netfs_append_cache_stats (char **argz, size_t *argz_len)
+{
+  char buf[100];
+  error_t err = 0;
+
+  if (netfs_attr_cache_timeout > 0)
+    {
+      snprintf (buf, sizeof buf, "--attr-cache-stats=%lu/%lu",
+		__atomic_load_n (&statistics.attr_hits, __ATOMIC_RELAXED),
+		__atomic_load_n (&statistics.attr_misses, __ATOMIC_RELAXED));
+      err = argz_add (argz, argz_len, buf);
+    }
+
+  if (! err && netfs_lookup_cache_timeout > 0)
+    {
+      pthread_spin_lock (&name_lock);
+      snprintf (buf, sizeof buf, "--lookup-cache-stats=%lu/%lu/%lu",
+		statistics.pos_hits, statistics.neg_hits,
+		statistics.lookup_misses);
+      pthread_spin_unlock (&name_lock);
+      err = argz_add (argz, argz_len, buf);
+    }
+
+  if (! err && netfs_data_cache_size > 0)
+    {
+      pthread_mutex_lock (&data_lock);
+      snprintf (buf, sizeof buf, "--data-cache-stats=%lu/%lu/%zu",
+		statistics.data_hits, statistics.data_misses, data_space);
+      pthread_mutex_unlock (&data_lock);
+      err = argz_add (argz, argz_len, buf);
+    }
+
+  return err;
+}
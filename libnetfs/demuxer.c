@@ -21,10 +21,12 @@
 #include "netfs.h"
 
 #include "io_S.h"
+#include "io_notify_S.h"
 #include "fs_S.h"
 #include "../libports/notify_S.h"
 #include "fsys_S.h"
 #include "../libports/interrupt_S.h"
+#include "../libports/rpcstats_S.h"
 #include "ifsock_S.h"
 
 int
@@ -33,10 +35,12 @@ netfs_demuxer (mach_msg_header_t *inp,
 {
   mig_routine_t routine;
   if ((routine = netfs_io_server_routine (inp)) ||
+      (routine = netfs_io_notify_server_routine (inp)) ||
       (routine = netfs_fs_server_routine (inp)) ||
       (routine = ports_notify_server_routine (inp)) ||
       (routine = netfs_fsys_server_routine (inp)) ||
       (routine = ports_interrupt_server_routine (inp)) ||
+      (routine = ports_rpcstats_server_routine (inp)) ||
       (routine = netfs_ifsock_server_routine (inp)))
     {
       (*routine) (inp, outp);
@@ -36,6 +36,14 @@ netfs_S_dir_link (struct protid *diruser, struct protid *fileuser,
   /* Note that nothing is locked here */
   err = netfs_attempt_link (diruser->user, diruser->po->np, 
 			    fileuser->po->np, name, excl);
+
+  pthread_mutex_lock (&diruser->po->np->lock);
+  netfs_cache_invalidate_name (diruser->po->np, name);
+  pthread_mutex_unlock (&diruser->po->np->lock);
+  pthread_mutex_lock (&fileuser->po->np->lock);
+  fileuser->po->np->stat_expires = 0;
+  pthread_mutex_unlock (&fileuser->po->np->lock);
+
   if (!err)
     mach_port_deallocate (mach_task_self (), fileuser->pi.port_right);
   return err;
@@ -22,7 +22,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <hurd/paths.h>
-#include "netfs.h"
+#include "priv.h"
 #include "fs_S.h"
 #include "callbacks.h"
 #include "misc.h"
@@ -172,7 +172,7 @@ netfs_S_dir_lookup (struct protid *dircred,
 	  }
       else
 	/* Attempt a lookup on the next pathname component. */
-	err = netfs_attempt_lookup (dircred->user, dnp, filename, &np);
+	err = _netfs_lookup (dircred->user, dnp, filename, &np);
 
       /* At this point, DNP is unlocked */
 
@@ -186,6 +186,7 @@ netfs_S_dir_lookup (struct protid *dircred,
 	  mode &= ~(S_IFMT | S_ISPARE | S_ISVTX);
 	  mode |= S_IFREG;
 	  pthread_mutex_lock (&dnp->lock);
+	  netfs_cache_invalidate_name (dnp, filename);
 	  err = netfs_attempt_create_file (dircred->user, dnp,
 					   filename, mode, &np);
 
@@ -205,7 +206,7 @@ netfs_S_dir_lookup (struct protid *dircred,
       if (err)
 	goto out;
 
-      err = netfs_validate_stat (np, dircred->user);
+      err = _netfs_validate_stat (np, dircred->user);
       if (err)
 	goto out;
 
@@ -412,7 +413,7 @@ netfs_S_dir_lookup (struct protid *dircred,
 
   if (mustbedir || (flags & O_DIRECTORY))
     {
-      err = netfs_validate_stat (np, dircred->user);
+      err = _netfs_validate_stat (np, dircred->user);
       if (err)
 	goto out;
       if (!S_ISDIR (np->nn_stat.st_mode))
@@ -34,6 +34,7 @@ netfs_S_dir_mkdir (struct protid *user, const_string_t name, mode_t mode)
 
   pthread_mutex_lock (&user->po->np->lock);
   err = netfs_attempt_mkdir (user->user, user->po->np, name, mode);
+  netfs_cache_invalidate_name (user->po->np, name);
   pthread_mutex_unlock (&user->po->np->lock);
   return err;
 }
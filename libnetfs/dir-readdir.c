@@ -20,7 +20,7 @@
 
 #include <fcntl.h>
 
-#include "netfs.h"
+#include "priv.h"
 #include "fs_S.h"
 
 kern_return_t
@@ -46,7 +46,7 @@ netfs_S_dir_readdir (struct protid *user,
   if ((user->po->openstat & O_READ) == 0)
     err = EBADF;
   if (!err)
-    err = netfs_validate_stat (np, user->user);
+    err = _netfs_validate_stat (np, user->user);
   if (!err && (np->nn_stat.st_mode & S_IFMT) != S_IFDIR)
     err = ENOTDIR;
   if (!err)
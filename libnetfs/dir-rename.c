@@ -36,6 +36,14 @@ netfs_S_dir_rename (struct protid *fromdiruser, const_string_t fromname,
   /* Note that nothing is locked here */
   err = netfs_attempt_rename (fromdiruser->user, fromdiruser->po->np, 
 			      fromname, todiruser->po->np, toname, excl);
+
+  pthread_mutex_lock (&fromdiruser->po->np->lock);
+  netfs_cache_invalidate_name (fromdiruser->po->np, fromname);
+  pthread_mutex_unlock (&fromdiruser->po->np->lock);
+  pthread_mutex_lock (&todiruser->po->np->lock);
+  netfs_cache_invalidate_name (todiruser->po->np, toname);
+  pthread_mutex_unlock (&todiruser->po->np->lock);
+
   if (!err)
     mach_port_deallocate (mach_task_self (), todiruser->pi.port_right);
   return err;
@@ -31,6 +31,7 @@ netfs_S_dir_rmdir (struct protid *diruser, const_string_t name)
 
   pthread_mutex_lock (&diruser->po->np->lock);
   err = netfs_attempt_rmdir (diruser->user, diruser->po->np, name);
+  netfs_cache_invalidate_name (diruser->po->np, name);
   pthread_mutex_unlock (&diruser->po->np->lock);
   return err;
 }
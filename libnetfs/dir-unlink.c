@@ -28,6 +28,7 @@ netfs_S_dir_unlink (struct protid *user, const_string_t name)
   
   pthread_mutex_lock (&user->po->np->lock);
   err = netfs_attempt_unlink (user->user, user->po->np, name);
+  netfs_cache_invalidate_name (user->po->np, name);
   pthread_mutex_unlock (&user->po->np->lock);
   return err;
 }
@@ -18,11 +18,12 @@
    along with this program; if not, write to the Free Software
    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
 
-#include "netfs.h"
+#include "priv.h"
 
 void
 netfs_drop_node (struct node *np)
 {
   fshelp_drop_transbox (&np->transbox);
+  _netfs_cache_drop_node (np);
   netfs_node_norefs (np);
 }
@@ -32,6 +32,7 @@ netfs_S_file_chflags (struct protid *user,
   
   pthread_mutex_lock (&user->po->np->lock);
   err = netfs_attempt_chflags (user->user, user->po->np, flags);
+  user->po->np->stat_expires = 0;
   pthread_mutex_unlock (&user->po->np->lock);
   return err;
 }
@@ -34,6 +34,7 @@ netfs_S_file_chmod (struct protid *user,
   
   pthread_mutex_lock (&user->po->np->lock);
   err = netfs_attempt_chmod (user->user, user->po->np, mode);
+  user->po->np->stat_expires = 0;
   pthread_mutex_unlock (&user->po->np->lock);
   return err;
 }
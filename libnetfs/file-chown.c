@@ -34,6 +34,7 @@ netfs_S_file_chown (struct protid *user,
   pthread_mutex_lock (&user->po->np->lock);
   err = netfs_attempt_chown (user->user, user->po->np,
 			     owner, group);
+  user->po->np->stat_expires = 0;
   pthread_mutex_unlock (&user->po->np->lock);
   return err;
 }
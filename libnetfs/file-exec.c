@@ -21,7 +21,7 @@
 
 /* Written by Michael I. Bushnell, p/BSG.  */
 
-#include "netfs.h"
+#include "priv.h"
 #include "execserver.h"
 #include "fs_S.h"
 #include <sys/stat.h>
@@ -110,7 +110,7 @@ netfs_S_file_exec_paths (struct protid *cred,
   mode = np->nn_stat.st_mode;
   uid = np->nn_stat.st_uid;
   gid = np->nn_stat.st_gid;
-  err = netfs_validate_stat (np, cred->user);
+  err = _netfs_validate_stat (np, cred->user);
   pthread_mutex_unlock (&np->lock);
 
   if (err)
@@ -21,7 +21,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <hurd/paths.h>
-#include "netfs.h"
+#include "priv.h"
 #include "fs_S.h"
 #include <sys/mman.h>
 #include <sys/sysmacros.h>
@@ -39,7 +39,7 @@ netfs_S_file_get_translator (struct protid *user,
 
   np = user->po->np;
   pthread_mutex_lock (&np->lock);
-  err = netfs_validate_stat (np, user->user);
+  err = _netfs_validate_stat (np, user->user);
 
   if (err)
     {
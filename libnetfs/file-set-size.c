@@ -34,6 +34,7 @@ netfs_S_file_set_size (struct protid *user,
   
   pthread_mutex_lock (&user->po->np->lock);
   err = netfs_attempt_set_size (user->user, user->po->np, size);
+  netfs_cache_invalidate (user->po->np);
   pthread_mutex_unlock (&user->po->np->lock);
   return err;
 }
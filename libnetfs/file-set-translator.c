@@ -19,7 +19,7 @@
    along with this program; if not, write to the Free Software
    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
 
-#include "netfs.h"
+#include "priv.h"
 #include "fs_S.h"
 #include <sys/sysmacros.h>
 #include <hurd/paths.h>
@@ -52,7 +52,7 @@ netfs_S_file_set_translator (struct protid *user,
       && ! (active_flags & FS_TRANS_ORPHAN))
     {
       /* Validate--user must be owner */
-      err = netfs_validate_stat (np, user->user);
+      err = _netfs_validate_stat (np, user->user);
       if (err)
 	goto out;
 
@@ -79,7 +79,7 @@ netfs_S_file_set_translator (struct protid *user,
   if ((passive_flags & FS_TRANS_SET)
       && (passive_flags & FS_TRANS_EXCL))
     {
-      err = netfs_validate_stat (np, user->user);
+      err = _netfs_validate_stat (np, user->user);
       if (!err && (np->nn_stat.st_mode & S_IPTRANS))
 	err = EBUSY;
       if (err)
@@ -161,7 +161,7 @@ netfs_S_file_set_translator (struct protid *user,
 	  break;
 
 	default:
-	  err = netfs_validate_stat (np, user->user);
+	  err = _netfs_validate_stat (np, user->user);
 	  if (!err)
 	    err = netfs_attempt_chmod (user->user, np,
 				       ((np->nn_stat.st_mode & ~S_IFMT)
@@ -176,6 +176,9 @@ netfs_S_file_set_translator (struct protid *user,
 				      passive, passivelen);
 	  break;
 	}
+
+      /* The mode may have changed.  */
+      netfs_cache_invalidate (np);
     }
 
   if (! err && user->po->path && active_flags & FS_TRANS_SET)
@@ -33,6 +33,17 @@ auth_t netfs_auth_server_port = 0;
 mach_port_t netfs_fsys_identity;
 volatile struct mapped_time_value *netfs_mtime;
 
+/* Only the control port and root users may look at or change the RPC
+   statistics.  */
+static int
+rpcstats_allowed (struct port_info *pi)
+{
+  if (pi->class == netfs_control_class)
+    return 1;
+  if (pi->class == netfs_protid_class)
+    return idvec_contains (((struct protid *) pi)->user->uids, 0);
+  return 0;
+}
 
 void
 netfs_init (void)
@@ -47,6 +58,7 @@ netfs_init (void)
   netfs_protid_class = ports_create_class (netfs_release_protid, 0);
   netfs_control_class = ports_create_class (0, 0);
   netfs_port_bucket = ports_create_bucket ();
+  ports_rpcstats_allowed = rpcstats_allowed;
   netfs_auth_server_port = getauth ();
   mach_port_allocate (mach_task_self (), MACH_PORT_RIGHT_RECEIVE, 
 		      &netfs_fsys_identity);
@@ -0,0 +1,45 @@
+/*
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+#include "netfs.h"
+#include "io_notify_S.h"
+#include <hurd/iohelp.h>
+
+kern_return_t
+netfs_S_io_notify_request (struct protid *user,
+			   mach_port_t notify,
+			   int select_type,
+			   natural_t cookie)
+{
+  struct iohelp_notify *once = NULL;
+  error_t err;
+
+  if (!user)
+    return EOPNOTSUPP;
+
+  /* As netfs_S_io_select finds, reading and writing never block, and
+     there is never urgent data: whatever is waited for is ready at once
+     or never, so the registration need not be kept.  */
+  err = iohelp_notify_request (&once, user->po, notify,
+			       select_type & ~SELECT_URG, cookie,
+			       SELECT_READ | SELECT_WRITE);
+  iohelp_notify_clear (&once);
+
+  return err;
+}
@@ -18,7 +18,7 @@
    along with this program; if not, write to the Free Software
    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
 
-#include "netfs.h"
+#include "priv.h"
 #include "io_S.h"
 #include <fcntl.h>
 #include <sys/mman.h>
@@ -92,7 +92,7 @@ netfs_S_io_read (struct protid *user,
     }
   else
     /* Read from a normal file.  */
-    err = netfs_attempt_read (user->user, node, start, &data_size, *data);
+    err = _netfs_read (user->user, node, start, &data_size, *data);
 
   if (offset == -1 && !err)
     user->po->filepointer += data_size;
@@ -19,7 +19,7 @@
    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
 
 #include <unistd.h>
-#include "netfs.h"
+#include "priv.h"
 #include "io_S.h"
 
 kern_return_t
@@ -45,7 +45,7 @@ netfs_S_io_seek (struct protid *user,
         np = user->po->np;
         pthread_mutex_lock (&np->lock);
 
-        err = netfs_validate_stat (np, user->user);
+        err = _netfs_validate_stat (np, user->user);
         if (!err)
 	  offset += np->nn_stat.st_size;
 
@@ -18,7 +18,7 @@
    along with this program; if not, write to the Free Software
    Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
 
-#include "netfs.h"
+#include "priv.h"
 #include "io_S.h"
 #include <fcntl.h>
 
@@ -48,7 +48,9 @@ netfs_S_io_write (struct protid *user,
     {
       if (user->po->openstat & O_APPEND)
 	{
-	  err = netfs_validate_stat (np, user->user);
+	  /* Anything may have been appended meanwhile.  */
+	  np->stat_expires = 0;
+	  err = _netfs_validate_stat (np, user->user);
 	  if (err)
 	    {
 	      pthread_mutex_unlock (&np->lock);
@@ -59,7 +61,7 @@ netfs_S_io_write (struct protid *user,
       off = user->po->filepointer;
     }
 
-  err =  netfs_attempt_write (user->user, np, off, amount, data);
+  err = _netfs_write (user->user, np, off, amount, data);
   if (offset == -1 && !err)
     user->po->filepointer += *amount;
   pthread_mutex_unlock (&np->lock);
@@ -29,6 +29,8 @@ init_node (struct node *np, struct netnode *nn)
   refcounts_init (&np->refcounts, 1, 0);
   np->sockaddr = MACH_PORT_NULL;
   np->owner = 0;
+  np->stat_expires = 0;
+  np->data_blocks = NULL;
 
   fshelp_transbox_init (&np->transbox, &np->lock, np);
   fshelp_rlock_init (&np->userlock);
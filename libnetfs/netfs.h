@@ -98,6 +98,16 @@ struct node
   struct conch conch;
 
   struct dirmod *dirmod_reqs;
+
+  /* Until when, in microseconds of the mapped time, NN_STAT may be used
+     without calling netfs_validate_stat again; see cache.c.  */
+  unsigned long long stat_expires;
+
+  /* Contents of the file cached by io_read, and the modification time
+     and size the file had when they were read.  */
+  struct netfs_data_block *data_blocks;
+  struct timespec data_mtime;
+  loff_t data_size;
 };
 
 struct netfs_control
@@ -330,6 +340,12 @@ error_t netfs_file_get_storage_info (struct iouser *cred,
    applicable. The default function always returns EOPNOTSUPP.  */
 error_t netfs_get_source (char *source, size_t source_len);
 
+/* The user may define this function.  Return the number of seconds
+   for which the stat information just got by netfs_validate_stat for
+   locked node NP may be used without calling it again.  The default
+   returns netfs_attr_cache_timeout.  */
+int netfs_node_attr_timeout (struct node *np);
+
 /* Option parsing */
 
 /* Parse and execute the runtime options in ARGZ & ARGZ_LEN.  EINVAL is
@@ -371,6 +387,34 @@ extern int netfs_maxsymlinks;
 
 /* Definitions provided by netfs. */
 
+/* Caching.  Translators whose netfs_validate_stat, netfs_attempt_lookup
+   and netfs_attempt_read are costly, typically because they talk to a
+   remote server, can have netfs remember their results for a while.
+   The caches are off unless these are set, by the translator or by the
+   standard options.  */
+
+/* Number of seconds for which stat information is kept.  */
+extern int netfs_attr_cache_timeout;
+
+/* Number of seconds for which the result of a lookup, be it a node or
+   ENOENT, is kept.  The cache holds a reference on the directory and
+   the node of each entry.  An entry also goes stale once the
+   modification time of its directory changes.  */
+extern int netfs_lookup_cache_timeout;
+
+/* Number of bytes of file contents kept.  They are read again when the
+   modification time or the size of the file is seen to change, so this
+   makes sense with an attribute cache.  */
+extern size_t netfs_data_cache_size;
+
+/* Forget the cached stat information and contents of locked node NP, for
+   instance because the translator has learned that it changed.  */
+void netfs_cache_invalidate (struct node *np);
+
+/* Forget the results of looking up NAME in locked directory DIR, or of
+   all names if NAME is null, and the stat information of DIR.  */
+void netfs_cache_invalidate_name (struct node *dir, const char *name);
+
 /* Given a netnode created by the user program, wraps it in a node
    structure.  The new node is not locked and has a single reference.
    If an error occurs, NULL is returned.  */
@@ -27,6 +27,27 @@
 
 extern volatile struct mapped_time_value *netfs_mtime;
 
+/* These do what netfs_validate_stat, netfs_attempt_lookup,
+   netfs_attempt_read and netfs_attempt_write do, with the same
+   arguments and locking, but go through the caches (see cache.c).  */
+error_t _netfs_validate_stat (struct node *np, struct iouser *cred);
+error_t _netfs_lookup (struct iouser *cred, struct node *dir,
+		       const char *name, struct node **np);
+error_t _netfs_read (struct iouser *cred, struct node *np,
+		     loff_t offset, size_t *len, void *data);
+error_t _netfs_write (struct iouser *cred, struct node *np,
+		      loff_t offset, size_t *len, const void *data);
+
+/* Free the cached contents of NP, which is being dropped.  */
+void _netfs_cache_drop_node (struct node *np);
+
+/* Make the caches fit their sizes and timeouts again, after these have
+   been changed.  */
+void _netfs_cache_resize (void);
+
+/* Append the statistics of the caches in use to ARGZ & ARGZ_LEN.  */
+error_t _netfs_append_cache_stats (char **argz, size_t *argz_len);
+
 static inline struct protid * __attribute__ ((unused))
 begin_using_protid_port (file_t port)
 {
@@ -1,6 +1,6 @@
 /* Parse standard run-time options
 
-   Copyright (C) 1995, 1996 Free Software Foundation, Inc.
+   Copyright (C) 1995, 1996, 2026 Free Software Foundation, Inc.
 
    This file is part of the GNU Hurd.
 
@@ -19,6 +19,89 @@
    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
 
 #include <argp.h>
-#include "netfs.h"
+#include <stdlib.h>
+#include "priv.h"
 
-const struct argp netfs_std_runtime_argp = { 0 };
+#define OPT_ATTR_CACHE_TIMEOUT		600
+#define OPT_LOOKUP_CACHE_TIMEOUT	601
+#define OPT_DATA_CACHE_SIZE		602
+#define OPT_CACHE_STATS			603
+
+static const struct argp_option
+std_runtime_options[] =
+{
+  {"attr-cache-timeout", OPT_ATTR_CACHE_TIMEOUT, "SEC", 0,
+   "Keep the stat information of files for SEC seconds (default 0)"},
+  {"lookup-cache-timeout", OPT_LOOKUP_CACHE_TIMEOUT, "SEC", 0,
+   "Keep the results of looking up names, found or not, for SEC"
+   " seconds (default 0)"},
+  {"data-cache-size", OPT_DATA_CACHE_SIZE, "BYTES", 0,
+   "Keep up to BYTES of the contents of files (default 0)"},
+  /* fsysopts shows how the caches have been doing with these; they
+     are ignored when set.  */
+  {"attr-cache-stats", OPT_CACHE_STATS, "STATS", OPTION_HIDDEN},
+  {"lookup-cache-stats", OPT_CACHE_STATS, "STATS", OPTION_HIDDEN},
+  {"data-cache-stats", OPT_CACHE_STATS, "STATS", OPTION_HIDDEN},
+  {0, 0}
+};
+
+struct parse_hook
+{
+  int attr_cache_timeout, lookup_cache_timeout;
+  long long data_cache_size;
+};
+
+static error_t
+parse_opt (int key, char *arg, struct argp_state *state)
+{
+  struct parse_hook *h = state->hook;
+
+  switch (key)
+    {
+    case OPT_ATTR_CACHE_TIMEOUT:
+      h->attr_cache_timeout = atoi (arg);
+      break;
+    case OPT_LOOKUP_CACHE_TIMEOUT:
+      h->lookup_cache_timeout = atoi (arg);
+      break;
+    case OPT_DATA_CACHE_SIZE:
+      h->data_cache_size = atoll (arg);
+      break;
+    case OPT_CACHE_STATS:
+      break;
+
+    case ARGP_KEY_INIT:
+      h = state->hook = malloc (sizeof (struct parse_hook));
+      if (! h)
+	return ENOMEM;
+      h->attr_cache_timeout = netfs_attr_cache_timeout;
+      h->lookup_cache_timeout = netfs_lookup_cache_timeout;
+      h->data_cache_size = netfs_data_cache_size;
+      break;
+
+    case ARGP_KEY_ERROR:
+      free (h);
+      break;
+
+    case ARGP_KEY_SUCCESS:
+      if (h->attr_cache_timeout < 0 || h->lookup_cache_timeout < 0
+	  || h->data_cache_size < 0)
+	{
+	  free (h);
+	  argp_error (state, "Cache timeouts and sizes cannot be negative");
+	  return EINVAL;
+	}
+      netfs_attr_cache_timeout = h->attr_cache_timeout;
+      netfs_lookup_cache_timeout = h->lookup_cache_timeout;
+      netfs_data_cache_size = h->data_cache_size;
+      free (h);
+      _netfs_cache_resize ();
+      break;
+
+    default:
+      return ARGP_ERR_UNKNOWN;
+    }
+  return 0;
+}
+
+const struct argp netfs_std_runtime_argp = { std_runtime_options, parse_opt };
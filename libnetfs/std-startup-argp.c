@@ -23,5 +23,10 @@
 #include <argp.h>
 #include "netfs.h"
 
+/* The options that can be changed at run time can be given at startup
+   too.  */
+static const struct argp_child
+startup_children[] = { {&netfs_std_runtime_argp}, {0} };
+
 const struct argp
-netfs_std_startup_argp = { 0 };
+netfs_std_startup_argp = { 0, 0, 0, 0, startup_children };
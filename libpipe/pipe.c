@@ -26,6 +26,7 @@
 #include <mach/mach_host.h>
 
 #include <hurd/hurd_types.h>
+#include <hurd/iohelp.h>
 
 #include "pipe.h"
 
@@ -66,6 +67,7 @@ pipe_create (struct pipe_class *class, struct pipe **pipe)
   pthread_cond_init (&new->pending_writes, NULL);
   pthread_cond_init (&new->pending_write_selects, NULL);
   new->pending_selects = NULL;
+  new->notify = NULL;
   pthread_mutex_init (&new->lock, NULL);
 
   pq_create (&new->queue);
@@ -81,6 +83,7 @@ pipe_create (struct pipe_class *class, struct pipe **pipe)
 void
 pipe_free (struct pipe *pipe)
 {
+  iohelp_notify_clear (&pipe->notify);
   pq_free (pipe->queue);
   free (pipe);
 }
@@ -122,11 +125,48 @@ pipe_remove_select_cond (struct pipe *pipe, struct pipe_select_cond *cond)
     }
 }
 
+/* Return what PIPE is ready for, as io_select would: SELECT_READ if
+   reading it would not block, and SELECT_WRITE if writing to it would
+   not.  */
+static int
+pipe_ready (struct pipe *pipe)
+{
+  int ready = 0;
+
+  if (pipe_is_readable (pipe, 1) || (pipe->flags & PIPE_BROKEN))
+    ready |= SELECT_READ;
+  if (pipe_readable (pipe, 1) < pipe->write_limit
+      || (pipe->flags & PIPE_BROKEN))
+    ready |= SELECT_WRITE;
+
+  return ready;
+}
+
+error_t
+pipe_notify_request (struct pipe *pipe, void *owner, mach_port_t port,
+		     int select_type, natural_t cookie)
+{
+  return iohelp_notify_request (&pipe->notify, owner, port, select_type,
+				cookie, pipe_ready (pipe));
+}
+
+void
+pipe_notify_cancel (struct pipe *pipe, void *owner)
+{
+  pthread_mutex_lock (&pipe->lock);
+  if (pipe->notify)
+    iohelp_notify_cancel (&pipe->notify, owner);
+  pthread_mutex_unlock (&pipe->lock);
+}
+
 static void
 pipe_select_cond_broadcast (struct pipe *pipe)
 {
   struct pipe_select_cond *cond, *last;
 
+  if (pipe->notify && iohelp_notify_wanted (&pipe->notify))
+    iohelp_notify_post (&pipe->notify, pipe_ready (pipe));
+
   cond = pipe->pending_selects;
 
   if (cond == NULL)
@@ -436,6 +476,61 @@ pipe_send (struct pipe *pipe, int noblock, void *source,
   return err;
 }
 
+/* Writes the DATA_LEN bytes at DATA, which the caller gives up, to PIPE,
+   which should be locked, by moving the pages into the queue instead of
+   copying them.  DATA must be page-aligned and vm_allocated in whole pages.
+   If successful, the pages belong to PIPE, and DATA_LEN is returned in
+   AMOUNT.  A write that doesn't fit under the write limit still goes in
+   whole once PIPE is empty, as moving pages costs the same whatever their
+   number.  EOPNOTSUPP is returned if the write is too small to be worth
+   it, or if NOBLOCK is true and it would have to wait for PIPE to drain;
+   on this or any other error, nothing is done and DATA still belongs to
+   the caller.  */
+error_t
+pipe_write_pages (struct pipe *pipe, int noblock, void *source,
+		  char *data, size_t data_len, size_t *amount)
+{
+  error_t err;
+  struct packet *packet;
+  size_t readable;
+
+  if (data_len < PACKET_SIZE_LARGE
+      || trunc_page ((vm_address_t) data) != (vm_address_t) data)
+    return EOPNOTSUPP;
+
+  err = pipe_wait_writable (pipe, noblock);
+  if (err)
+    return err;
+
+  /* The whole write goes in one packet.  If it doesn't fit next to what is
+     queued, wait for the reader to empty PIPE; without blocking, pipe_write
+     takes what fits instead.  */
+  while ((readable = pipe_readable (pipe, 1)) > 0
+	 && readable + data_len > pipe->write_limit)
+    {
+      if (noblock)
+	return EOPNOTSUPP;
+      if (pthread_hurd_cond_wait_np (&pipe->pending_writes, &pipe->lock))
+	return EINTR;
+      if (pipe->flags & PIPE_BROKEN)
+	return EPIPE;
+    }
+
+  packet = pq_queue (pipe->queue, PACKET_TYPE_DATA, source);
+  if (! packet)
+    return ENOBUFS;
+  packet_set_pages (packet, data, data_len);
+  *amount = data_len;
+
+  timestamp (&pipe->write_time);
+
+  pthread_cond_broadcast (&pipe->pending_reads);
+  pthread_cond_broadcast (&pipe->pending_read_selects);
+  pipe_select_cond_broadcast (pipe);
+
+  return 0;
+}
+
 /* Reads up to AMOUNT bytes from PIPE, which should be locked, into DATA, and
    returns the amount read in DATA_LEN.  If NOBLOCK is true, EWOULDBLOCK is
    returned instead of block when no data is immediately available.  If an
@@ -97,6 +97,9 @@ struct pipe
 
   struct pipe_select_cond *pending_selects;
 
+  /* Registrations made with pipe_notify_request.  */
+  struct iohelp_notify *notify;
+
   /* The maximum number of characters that this pipe will hold without
      further writes blocking.  */
   size_t write_limit;
@@ -248,6 +251,19 @@ error_t pipe_create (struct pipe_class *class, struct pipe **pipe);
 
 /* Free PIPE and any resources it holds.  */
 void pipe_free (struct pipe *pipe);
+
+/* Register the interest of PORT in the conditions SELECT_TYPE of PIPE,
+   as io_notify_request does, for OWNER; SELECT_READ is for its reader,
+   and SELECT_WRITE for its writer.  OWNER tells apart those sharing PIPE,
+   such as the two ends of a socket pair: a registration of PORT by one
+   never replaces or cancels that of another.  PIPE should be locked.  */
+error_t pipe_notify_request (struct pipe *pipe, void *owner,
+			     mach_port_t port, int select_type,
+			     natural_t cookie);
+
+/* Drop the registrations made on PIPE for OWNER, which no longer reads
+   or writes it.  PIPE should be unlocked.  */
+void pipe_notify_cancel (struct pipe *pipe, void *owner);
 
 /* Take any actions necessary when PIPE acquires its first reader.  */ 
 void _pipe_first_reader (struct pipe *pipe);
@@ -390,6 +406,18 @@ error_t pipe_send (struct pipe *pipe, int noblock, void *source,
 #define pipe_write(pipe, noblock, source, data, data_len, amount) \
   pipe_send (pipe, noblock, source, data, data_len, 0, 0, 0, 0, amount)
 
+/* Writes the DATA_LEN bytes at DATA, which the caller gives up, to PIPE,
+   which should be locked, by moving the pages into the queue instead of
+   copying them.  DATA must be page-aligned and vm_allocated in whole pages.
+   If successful, the pages belong to PIPE, and DATA_LEN is returned in
+   AMOUNT.  A write that doesn't fit under the write limit still goes in
+   whole once PIPE is empty.  EOPNOTSUPP is returned if the write is too
+   small to be worth it, or if NOBLOCK is true and it would have to wait
+   for PIPE to drain; on this or any other error, nothing is done and DATA
+   still belongs to the caller.  */
+error_t pipe_write_pages (struct pipe *pipe, int noblock, void *source,
+			  char *data, size_t data_len, size_t *amount);
+
 /* Reads up to AMOUNT bytes from PIPE, which should be locked, into DATA, and
    returns the amount read in DATA_LEN.  If NOBLOCK is true, EWOULDBLOCK is
    returned instead of block when no data is immediately available.  If an
@@ -350,6 +350,28 @@ packet_write (struct packet *packet,
   return 0;
 }
 
+/* Make the DATA_LEN bytes at DATA the contents of PACKET, which should be
+   empty, instead of copying them.  DATA must be page-aligned and
+   vm_allocated in whole pages; it now belongs to PACKET, and will be handed
+   out as is by packet_read.  */
+void
+packet_set_pages (struct packet *packet, char *data, size_t data_len)
+{
+  if (packet->buf_len > 0)
+    {
+      if (packet->buf_vm_alloced)
+	munmap (packet->buf, packet->buf_len);
+      else
+	free (packet->buf);
+    }
+
+  packet->buf = data;
+  packet->buf_len = round_page (data_len);
+  packet->buf_vm_alloced = 1;
+  packet->buf_start = data;
+  packet->buf_end = data + data_len;
+}
+
 /* Remove or peek up to AMOUNT bytes from the beginning of the data in PACKET, and
    puts it into *DATA, and the amount read into DATA_LEN.  If more than the
    original *DATA_LEN bytes are available, new memory is vm_allocated, and
@@ -91,6 +91,12 @@ packet_readable (struct packet *packet)
 error_t packet_write (struct packet *packet,
 		      const char *data, size_t data_len, size_t *amount);
 
+/* Make the DATA_LEN bytes at DATA the contents of PACKET, which should be
+   empty, instead of copying them.  DATA must be page-aligned and
+   vm_allocated in whole pages; it now belongs to PACKET, and will be handed
+   out as is by packet_read.  */
+void packet_set_pages (struct packet *packet, char *data, size_t data_len);
+
 /* Removes up to AMOUNT bytes from the beginning of the data in PACKET, and
    puts it into *DATA, and the amount read into DATA_LEN.  If more than the
    original *DATA_LEN bytes are available, new memory is vm_allocated, and
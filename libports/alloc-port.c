@@ -0,0 +1,89 @@
+/*
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+#include "ports.h"
+#include <hurd/slab.h>
+
+/* The alignment malloc would give.  */
+#define PORT_ALIGN 16
+
+/* Return the slab space of CLASS for ports of SIZE bytes, or null if
+   they cannot be allocated from one.  */
+static struct hurd_slab_space *
+class_slab (struct port_class *class, size_t size)
+{
+  size_t obj_size = __atomic_load_n (&class->obj_size, __ATOMIC_ACQUIRE);
+
+  if (! obj_size)
+    {
+      /* This is the first port of the class: its size will be that of
+	 the ports allocated from the slab.  Nearly all classes only
+	 have ports of one size.  */
+      pthread_mutex_lock (&_ports_lock);
+      if (! class->obj_size)
+	{
+	  struct hurd_slab_space *slab;
+
+	  if (hurd_slab_create (size, PORT_ALIGN, NULL, NULL, NULL, NULL,
+				NULL, &slab))
+	    slab = NULL;
+	  class->obj_slab = slab;
+	  __atomic_store_n (&class->obj_size, size, __ATOMIC_RELEASE);
+	}
+      obj_size = class->obj_size;
+      pthread_mutex_unlock (&_ports_lock);
+    }
+
+  return obj_size == size ? class->obj_slab : NULL;
+}
+
+/* Allocate SIZE bytes for a port in CLASS, with its flags cleared.  */
+struct port_info *
+_ports_alloc_port (struct port_class *class, size_t size)
+{
+  struct hurd_slab_space *slab;
+  struct port_info *pi;
+  void *buf;
+
+  if (size < sizeof (struct port_info))
+    size = sizeof (struct port_info);
+
+  slab = class_slab (class, size);
+  if (slab && ! hurd_slab_alloc (slab, &buf))
+    {
+      pi = buf;
+      pi->flags = PORT_FROM_SLAB;
+      return pi;
+    }
+
+  pi = malloc (size);
+  if (pi)
+    pi->flags = 0;
+  return pi;
+}
+
+/* Free the memory of PI, allocated with _ports_alloc_port.  */
+void
+_ports_free_port (struct port_info *pi)
+{
+  if (pi->flags & PORT_FROM_SLAB)
+    hurd_slab_dealloc (pi->class->obj_slab, pi);
+  else
+    free (pi);
+}
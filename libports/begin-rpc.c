@@ -26,8 +26,12 @@ error_t
 ports_begin_rpc (void *portstruct, mach_msg_id_t msg_id, struct rpc_info *info)
 {
   int *block_flags = 0;
+  uint64_t enter = 0;
 
   struct port_info *pi = portstruct;
+
+  if (__atomic_load_n (&ports_rpc_stats_enabled, __ATOMIC_RELAXED))
+    enter = _ports_rpc_clock ();
   
   pthread_mutex_lock (&_ports_lock);
   
@@ -104,5 +108,13 @@ ports_begin_rpc (void *portstruct, mach_msg_id_t msg_id, struct rpc_info *info)
 
   pthread_mutex_unlock (&_ports_lock);
 
+  info->msg_id = msg_id;
+  info->start = 0;
+  if (enter)
+    {
+      info->start = _ports_rpc_clock ();
+      info->queued = info->start - enter;
+    }
+
   return 0;
 }
@@ -64,5 +64,5 @@ _ports_complete_deallocate (struct port_info *pi)
   
   assert_backtrace (pi->current_rpcs == NULL);
 
-  free (pi);
+  _ports_free_port (pi);
 }
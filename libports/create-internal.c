@@ -41,10 +41,7 @@ _ports_create_port_internal (struct port_class *class,
   if (err)
     return err;
 
-  if (size < sizeof (struct port_info))
-    size = sizeof (struct port_info);
-
-  pi = malloc (size);
+  pi = _ports_alloc_port (class, size);
   if (! pi)
     {
       err = mach_port_mod_refs (mach_task_self (), port,
@@ -57,7 +54,6 @@ _ports_create_port_internal (struct port_class *class,
   refcounts_init (&pi->refcounts, 1, 0);
   pi->cancel_threshold = 0;
   pi->mscount = 0;
-  pi->flags = 0;
   pi->port_right = port;
   pi->current_rpcs = 0;
   pi->bucket = bucket;
@@ -124,7 +120,7 @@ _ports_create_port_internal (struct port_class *class,
   e = mach_port_mod_refs (mach_task_self (), port,
 			  MACH_PORT_RIGHT_RECEIVE, -1);
   assert_perror_backtrace (e);
-  free (pi);
+  _ports_free_port (pi);
 
   return err;
 }
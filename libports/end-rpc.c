@@ -25,6 +25,10 @@ ports_end_rpc (void *port, struct rpc_info *info)
 {
   struct port_info *pi = port;
 
+  if (info->start)
+    _ports_record_rpc (info->msg_id, info->queued,
+		       _ports_rpc_clock () - info->start);
+
   pthread_mutex_lock (&_ports_lock);
 
   if (info->notifies)
@@ -40,10 +40,7 @@ ports_import_port (struct port_class *class, struct port_bucket *bucket,
   if (err)
     return err;
 
-  if (size < sizeof (struct port_info))
-    size = sizeof (struct port_info);
-  
-  pi = malloc (size);
+  pi = _ports_alloc_port (class, size);
   if (! pi)
     return ENOMEM;
   
@@ -51,7 +48,8 @@ ports_import_port (struct port_class *class, struct port_bucket *bucket,
   refcounts_init (&pi->refcounts, 1 + !!stat.mps_srights, 0);
   pi->cancel_threshold = 0;
   pi->mscount = stat.mps_mscount;
-  pi->flags = stat.mps_srights ? PORT_HAS_SENDRIGHTS : 0;
+  if (stat.mps_srights)
+    pi->flags |= PORT_HAS_SENDRIGHTS;
   pi->port_right = port;
   pi->current_rpcs = 0;
   pi->bucket = bucket;
@@ -119,7 +117,7 @@ ports_import_port (struct port_class *class, struct port_bucket *bucket,
   err = EINTR;
  lose:
   pthread_mutex_unlock (&_ports_lock);
-  free (pi);
+  _ports_free_port (pi);
 
   return err;
 }
@@ -66,6 +66,7 @@ typedef struct port_info *port_info_t;
 
 /* FLAGS above are the following: */
 #define PORT_HAS_SENDRIGHTS	0x0001 /* send rights extant */
+#define PORT_FROM_SLAB		0x0002 /* allocated from the class's slab */
 #define PORT_INHIBITED		PORTS_INHIBITED
 #define PORT_BLOCKED		PORTS_BLOCKED
 #define PORT_INHIBIT_WAIT	PORTS_INHIBIT_WAIT
@@ -98,6 +99,11 @@ struct port_class
   void (*clean_routine) (void *);
   void (*dropweak_routine) (void *);
   struct ports_msg_id_range *uninhibitable_rpcs;
+
+  /* Ports of OBJ_SIZE bytes, the size of the first one made in this
+     class, are allocated from OBJ_SLAB unless it is null.  */
+  size_t obj_size;
+  struct hurd_slab_space *obj_slab;
 };
 /* FLAGS are the following: */
 #define PORT_CLASS_INHIBITED	PORTS_INHIBITED
@@ -112,6 +118,11 @@ struct rpc_info
   struct rpc_info *next, **prevp;
   struct rpc_notify *notifies;
   struct rpc_info *interrupted_next;
+
+  /* Used for the RPC statistics; START is zero if they are disabled.  */
+  mach_msg_id_t msg_id;
+  uint64_t start;		/* When the RPC began, in nanoseconds.  */
+  uint64_t queued;		/* Time spent blocked in ports_begin_rpc.  */
 };
 
 /* An rpc has requested interruption on a port notification.  */
@@ -463,6 +474,52 @@ ports_interrupt_self_on_notification (void *object,
 void ports_interrupt_notified_rpcs (void *object, mach_port_t port,
 				    mach_msg_id_t what);
 
+/* RPC statistics */
+
+/* The number of latency histogram buckets.  Bucket N counts RPCs that
+   took between 2^N and 2^(N+1) microseconds, except that bucket 0 also
+   counts faster ones and the last bucket slower ones.  */
+#define PORTS_RPC_STAT_BUCKETS 24
+
+/* What is gathered for each message id, and returned by rpcstats_get.  */
+struct ports_rpc_stat
+{
+  mach_msg_id_t msg_id;
+  uint32_t pad;
+  uint64_t count;		/* Number of completed RPCs.  */
+  uint64_t total_ns;		/* Time spent handling them.  */
+  uint64_t max_ns;		/* Longest one.  */
+  uint64_t queue_ns;		/* Time they waited for inhibitions.  */
+  uint64_t histogram[PORTS_RPC_STAT_BUCKETS];
+};
+
+/* Nonzero while ports_begin_rpc and ports_end_rpc gather statistics.
+   Use ports_enable_rpc_stats to change it.  */
+extern int ports_rpc_stats_enabled;
+
+/* Start (if ENABLE is nonzero) or stop gathering RPC statistics.  */
+void ports_enable_rpc_stats (int enable);
+
+/* Forget all RPC statistics gathered so far.  */
+void ports_reset_rpc_stats (void);
+
+/* rpcstats_get and rpcstats_control are refused with EPERM unless this
+   is set and returns nonzero for the port the request arrived on.  The
+   libraries set it to admit only control ports and root users.  */
+extern int (*ports_rpcstats_allowed) (struct port_info *pi);
+
+/* Merge the statistics of all threads into a malloc'd array of
+   *COUNT elements, returned in *STATS.  */
+error_t ports_get_rpc_stats (struct ports_rpc_stat **stats, size_t *count);
+
+/* Account for an RPC with message id MSG_ID that waited QUEUED and then
+   took SERVICE nanoseconds.  */
+void _ports_record_rpc (mach_msg_id_t msg_id, uint64_t queued,
+			uint64_t service);
+
+/* Return a monotonic time stamp in nanoseconds.  */
+uint64_t _ports_rpc_clock (void);
+
 /* Default servers */
 
 /* A notification server that calls the ports_do_mach_notify_* routines.  */
@@ -505,6 +562,8 @@ extern int _ports_flags;
 #define _PORTS_BLOCKED		PORTS_BLOCKED
 #define _PORTS_INHIBIT_WAIT	PORTS_INHIBIT_WAIT
 void _ports_complete_deallocate (struct port_info *);
+struct port_info *_ports_alloc_port (struct port_class *, size_t);
+void _ports_free_port (struct port_info *);
 error_t _ports_create_port_internal (struct port_class *, struct port_bucket *,
 				     size_t, void *, int);
 
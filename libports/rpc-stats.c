@@ -0,0 +1,290 @@
+/* Per-RPC statistics
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with the GNU Hurd.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "ports.h"
+#include "rpcstats_S.h"
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+int ports_rpc_stats_enabled;
+int (*ports_rpcstats_allowed) (struct port_info *pi);
+
+/* Each thread counts into its own table, so that recording an RPC only
+   takes an uncontended lock.  The tables are merged when somebody asks
+   for the statistics.  Tables of exited threads are kept (with their
+   counts) and handed to new threads.  */
+struct stats_table
+{
+  pthread_mutex_t lock;
+  struct hurd_ihash stats;	/* msg_id -> struct ports_rpc_stat */
+  struct stats_table *next;	/* In all_tables.  */
+  struct stats_table *next_free; /* In free_tables.  */
+};
+
+static pthread_mutex_t tables_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct stats_table *all_tables;
+static struct stats_table *free_tables;
+static pthread_key_t table_key;
+static pthread_once_t table_key_once = PTHREAD_ONCE_INIT;
+static __thread struct stats_table *thread_table;
+
+static void
+release_table (void *arg)
+{
+  struct stats_table *t = arg;
+
+  pthread_mutex_lock (&tables_lock);
+  t->next_free = free_tables;
+  free_tables = t;
+  pthread_mutex_unlock (&tables_lock);
+}
+
+static void
+create_table_key (void)
+{
+  pthread_key_create (&table_key, release_table);
+}
+
+static void
+free_stat (void *value, void *arg)
+{
+  free (value);
+}
+
+static struct stats_table *
+get_table (void)
+{
+  struct stats_table *t = thread_table;
+
+  if (t)
+    return t;
+
+  pthread_once (&table_key_once, create_table_key);
+
+  pthread_mutex_lock (&tables_lock);
+  t = free_tables;
+  if (t)
+    free_tables = t->next_free;
+  else
+    {
+      t = malloc (sizeof *t);
+      if (t)
+	{
+	  pthread_mutex_init (&t->lock, NULL);
+	  hurd_ihash_init (&t->stats, HURD_IHASH_NO_LOCP);
+	  hurd_ihash_set_cleanup (&t->stats, free_stat, NULL);
+	  t->next = all_tables;
+	  all_tables = t;
+	}
+    }
+  pthread_mutex_unlock (&tables_lock);
+
+  if (t)
+    {
+      pthread_setspecific (table_key, t);
+      thread_table = t;
+    }
+  return t;
+}
+
+uint64_t
+_ports_rpc_clock (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void
+_ports_record_rpc (mach_msg_id_t msg_id, uint64_t queued, uint64_t service)
+{
+  struct stats_table *t = get_table ();
+  struct ports_rpc_stat *s;
+  uint64_t us = service / 1000;
+  int bucket;
+
+  if (! t)
+    return;
+
+  bucket = us > 1 ? 63 - __builtin_clzll (us) : 0;
+  if (bucket >= PORTS_RPC_STAT_BUCKETS)
+    bucket = PORTS_RPC_STAT_BUCKETS - 1;
+
+  pthread_mutex_lock (&t->lock);
+  s = hurd_ihash_find (&t->stats, msg_id);
+  if (! s)
+    {
+      s = calloc (1, sizeof *s);
+      if (! s || hurd_ihash_add (&t->stats, msg_id, s))
+	{
+	  free (s);
+	  pthread_mutex_unlock (&t->lock);
+	  return;
+	}
+      s->msg_id = msg_id;
+    }
+  s->count++;
+  s->total_ns += service;
+  s->queue_ns += queued;
+  if (service > s->max_ns)
+    s->max_ns = service;
+  s->histogram[bucket]++;
+  pthread_mutex_unlock (&t->lock);
+}
+
+void
+ports_enable_rpc_stats (int enable)
+{
+  __atomic_store_n (&ports_rpc_stats_enabled, !!enable, __ATOMIC_RELAXED);
+}
+
+void
+ports_reset_rpc_stats (void)
+{
+  struct stats_table *t;
+
+  pthread_mutex_lock (&tables_lock);
+  for (t = all_tables; t; t = t->next)
+    {
+      pthread_mutex_lock (&t->lock);
+      hurd_ihash_destroy (&t->stats);
+      hurd_ihash_init (&t->stats, HURD_IHASH_NO_LOCP);
+      hurd_ihash_set_cleanup (&t->stats, free_stat, NULL);
+      pthread_mutex_unlock (&t->lock);
+    }
+  pthread_mutex_unlock (&tables_lock);
+}
+
+error_t
+ports_get_rpc_stats (struct ports_rpc_stat **stats, size_t *count)
+{
+  struct hurd_ihash merged = HURD_IHASH_INITIALIZER (HURD_IHASH_NO_LOCP);
+  struct stats_table *t;
+  struct ports_rpc_stat *result;
+  error_t err = 0;
+  size_t n = 0;
+
+  hurd_ihash_set_cleanup (&merged, free_stat, NULL);
+
+  pthread_mutex_lock (&tables_lock);
+  for (t = all_tables; t && !err; t = t->next)
+    {
+      pthread_mutex_lock (&t->lock);
+      HURD_IHASH_ITERATE (&t->stats, value)
+	{
+	  struct ports_rpc_stat *s = value;
+	  struct ports_rpc_stat *m = hurd_ihash_find (&merged, s->msg_id);
+	  int i;
+
+	  if (! m)
+	    {
+	      m = calloc (1, sizeof *m);
+	      if (! m)
+		err = ENOMEM;
+	      else if ((err = hurd_ihash_add (&merged, s->msg_id, m)))
+		free (m);
+	      if (err)
+		break;
+	      m->msg_id = s->msg_id;
+	    }
+
+	  m->count += s->count;
+	  m->total_ns += s->total_ns;
+	  m->queue_ns += s->queue_ns;
+	  if (s->max_ns > m->max_ns)
+	    m->max_ns = s->max_ns;
+	  for (i = 0; i < PORTS_RPC_STAT_BUCKETS; i++)
+	    m->histogram[i] += s->histogram[i];
+	}
+      pthread_mutex_unlock (&t->lock);
+    }
+  pthread_mutex_unlock (&tables_lock);
+
+  if (! err)
+    {
+      result = malloc ((merged.nr_items ?: 1) * sizeof *result);
+      if (! result)
+	err = ENOMEM;
+      else
+	{
+	  HURD_IHASH_ITERATE (&merged, value)
+	    result[n++] = *(struct ports_rpc_stat *) value;
+	  *stats = result;
+	  *count = n;
+	}
+    }
+
+  hurd_ihash_destroy (&merged);
+  return err;
+}
+
+kern_return_t
+ports_S_rpcstats_get (struct port_info *pi,
+		      data_t *data, mach_msg_type_number_t *datalen)
+{
+  struct ports_rpc_stat *stats;
+  size_t count, size;
+  error_t err;
+
+  if (! pi)
+    return EOPNOTSUPP;
+  if (! ports_rpcstats_allowed || ! (*ports_rpcstats_allowed) (pi))
+    return EPERM;
+
+  err = ports_get_rpc_stats (&stats, &count);
+  if (err)
+    return err;
+
+  size = count * sizeof *stats;
+  if (size > *datalen)
+    {
+      *data = mmap (0, size, PROT_READ|PROT_WRITE, MAP_ANON, 0, 0);
+      if (*data == MAP_FAILED)
+	{
+	  free (stats);
+	  return ENOMEM;
+	}
+    }
+  memcpy (*data, stats, size);
+  *datalen = size;
+
+  free (stats);
+  return 0;
+}
+
+kern_return_t
+ports_S_rpcstats_control (struct port_info *pi, int flags)
+{
+  if (! pi)
+    return EOPNOTSUPP;
+  if (! ports_rpcstats_allowed || ! (*ports_rpcstats_allowed) (pi))
+    return EPERM;
+
+  if ((flags & RPCSTATS_ENABLE) && (flags & RPCSTATS_DISABLE))
+    return EINVAL;
+
+  if (flags & RPCSTATS_RESET)
+    ports_reset_rpc_stats ();
+  if (flags & RPCSTATS_ENABLE)
+    ports_enable_rpc_stats (1);
+  if (flags & RPCSTATS_DISABLE)
+    ports_enable_rpc_stats (0);
+
+  return 0;
+}
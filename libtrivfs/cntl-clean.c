@@ -28,6 +28,10 @@ trivfs_clean_cntl (void *arg)
   mach_port_destroy (mach_task_self (), cntl->file_id);
   mach_port_deallocate (mach_task_self (), cntl->underlying);
 
+  pthread_mutex_lock (&_trivfs_notify_lock);
+  iohelp_notify_clear (&cntl->notify);
+  pthread_mutex_unlock (&_trivfs_notify_lock);
+
   trivfs_remove_control_port_class (cntl->pi.class);
   trivfs_remove_port_bucket (cntl->pi.bucket);
   trivfs_remove_protid_port_class (cntl->protid_class);
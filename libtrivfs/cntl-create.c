@@ -19,6 +19,23 @@
    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
 
 #include "trivfs.h"
+#include "mig-decls.h"
+
+/* Only control ports and root users may look at or change the RPC
+   statistics.  */
+static int
+rpcstats_allowed (struct port_info *pi)
+{
+  size_t i;
+
+  for (i = 0; i < trivfs_num_dynamic_control_port_classes; i++)
+    if (pi->class == trivfs_dynamic_control_port_classes[i])
+      return 1;
+  for (i = 0; i < trivfs_num_dynamic_protid_port_classes; i++)
+    if (pi->class == trivfs_dynamic_protid_port_classes[i])
+      return ((struct trivfs_protid *) pi)->isroot;
+  return 0;
+}
 
 /* Create a new trivfs control port, with underlying node UNDERLYING, and
    return it in CONTROL.  CONTROL_CLASS & CONTROL_BUCKET are passed to
@@ -85,6 +102,9 @@ trivfs_create_control (mach_port_t underlying,
 	}
 
       (*control)->hook = 0;
+      (*control)->notify = NULL;
+
+      ports_rpcstats_allowed = rpcstats_allowed;
     }
 
 out:
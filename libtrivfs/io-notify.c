@@ -0,0 +1,84 @@
+/*
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.  */
+
+#include "priv.h"
+#include "trivfs_io_notify_S.h"
+#include <fcntl.h>
+
+pthread_mutex_t _trivfs_notify_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The registration is made before asking trivfs_ready_hook what is
+   ready, and without holding _trivfs_notify_lock meanwhile, so that
+   the hook may take the locks of the user, which may be held when
+   calling trivfs_notify_ready; a change in between is then not missed,
+   though it may be told twice.  */
+kern_return_t __attribute__((weak))
+trivfs_S_io_notify_request (struct trivfs_protid *cred,
+			    mach_port_t reply,
+			    mach_msg_type_name_t replytype,
+			    mach_port_t notify,
+			    int select_type,
+			    natural_t cookie)
+{
+  struct trivfs_control *cntl;
+  error_t err;
+  int ready;
+
+  if (!cred)
+    return EOPNOTSUPP;
+  if (!trivfs_ready_hook)
+    return EOPNOTSUPP;
+
+  if (!(cred->po->openmodes & O_READ))
+    select_type &= ~(SELECT_READ | SELECT_URG);
+  if (!(cred->po->openmodes & O_WRITE))
+    select_type &= ~SELECT_WRITE;
+
+  cntl = cred->po->cntl;
+  pthread_mutex_lock (&_trivfs_notify_lock);
+  /* Registrations are kept per open, as the modes are.  */
+  err = iohelp_notify_request (&cntl->notify, cred->po, notify, select_type,
+			       cookie, 0);
+  pthread_mutex_unlock (&_trivfs_notify_lock);
+
+  if (!err && select_type)
+    {
+      ready = (*trivfs_ready_hook) (cntl);
+      if (ready)
+	trivfs_notify_ready (cntl, ready);
+    }
+
+  return err;
+}
+
+void
+_trivfs_notify_cancel (struct trivfs_peropen *po)
+{
+  pthread_mutex_lock (&_trivfs_notify_lock);
+  if (po->cntl->notify)
+    iohelp_notify_cancel (&po->cntl->notify, po);
+  pthread_mutex_unlock (&_trivfs_notify_lock);
+}
+
+void
+trivfs_notify_ready (struct trivfs_control *cntl, int ready)
+{
+  pthread_mutex_lock (&_trivfs_notify_lock);
+  if (cntl->notify)
+    iohelp_notify_post (&cntl->notify, ready);
+  pthread_mutex_unlock (&_trivfs_notify_lock);
+}
@@ -0,0 +1,89 @@
+/*
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   This program is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+#include "priv.h"
+#include "trivfs_io_transfer_S.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/param.h>
+
+/* How much is read from the object and written out at once.  */
+#define TRANSFER_CHUNK		(256 * 1024)
+
+/* A trivfs server has no memory object to hand out, so this just does
+   the io_read/io_write loop on behalf of the caller, reading with
+   trivfs_read_hook.  That still saves the caller a copy and a round trip
+   for each chunk.  Servers that don't set the hook may answer io_read
+   later from another thread, so for them this is not supported.  The
+   writes time out (see the Makefile), so an unresponsive destination
+   cannot keep this thread forever.  When reading at the file pointer,
+   data the destination does not accept is lost, as it would be for the
+   caller.  */
+kern_return_t
+trivfs_S_io_transfer (struct trivfs_protid *cred,
+		      mach_port_t reply,
+		      mach_msg_type_name_t replytype,
+		      mach_port_t destination,
+		      loff_t offset,
+		      vm_size_t amount,
+		      vm_size_t *transferred)
+{
+  vm_size_t done = 0;
+  error_t err = 0;
+
+  if (!cred)
+    return EOPNOTSUPP;
+  if (!trivfs_support_read || !trivfs_read_hook)
+    return EOPNOTSUPP;
+  if (!(cred->po->openmodes & O_READ))
+    return EBADF;
+
+  while (!err && done < amount)
+    {
+      data_t data = NULL;
+      mach_msg_type_number_t len = 0;
+      vm_size_t written;
+
+      err = (*trivfs_read_hook) (cred, &data, &len,
+				 offset == -1 ? -1 : offset + done,
+				 MIN (amount - done, TRANSFER_CHUNK));
+      if (err || len == 0)
+	break;
+
+      err = iohelp_transfer_write (destination, data, len, &written);
+      munmap (data, len);
+
+      if (!err)
+	{
+	  done += written;
+	  if (written < len)
+	    break;
+	}
+    }
+
+  if (done > 0)
+    /* Report what was transferred, even if something went wrong later.  */
+    err = 0;
+
+  if (!err)
+    {
+      *transferred = done;
+      mach_port_deallocate (mach_task_self (), destination);
+    }
+
+  return err;
+}
@@ -20,6 +20,42 @@
 #include <string.h>		/* For bcopy() */
 
 #include "priv.h"
+#include <hurd/slab.h>
+
+/* Peropens are allocated from PEROPEN_SLAB, or by malloc if it could
+   not be made.  */
+static struct hurd_slab_space *peropen_slab;
+static pthread_once_t peropen_slab_once = PTHREAD_ONCE_INIT;
+
+static void
+create_peropen_slab (void)
+{
+  if (hurd_slab_create (sizeof (struct trivfs_peropen), 0, NULL, NULL,
+			NULL, NULL, NULL, &peropen_slab))
+    peropen_slab = NULL;
+}
+
+static struct trivfs_peropen *
+alloc_peropen (void)
+{
+  void *buf;
+
+  pthread_once (&peropen_slab_once, create_peropen_slab);
+  if (! peropen_slab)
+    return malloc (sizeof (struct trivfs_peropen));
+
+  return hurd_slab_alloc (peropen_slab, &buf) ? NULL : buf;
+}
+
+/* Free the memory of PO, made by trivfs_open.  */
+void
+_trivfs_free_peropen (struct trivfs_peropen *po)
+{
+  if (peropen_slab)
+    hurd_slab_dealloc (peropen_slab, po);
+  else
+    free (po);
+}
 
 /* Return a new protid pointing to a new peropen in CRED, with REALNODE as
    the underlying node reference, with the given identity, and open flags in
@@ -32,7 +68,7 @@ trivfs_open (struct trivfs_control *cntl,
 	     struct trivfs_protid **cred)
 {
   error_t err = 0;
-  struct trivfs_peropen *po = malloc (sizeof (struct trivfs_peropen));
+  struct trivfs_peropen *po = alloc_peropen ();
 
   if (!po)
     return ENOMEM;
@@ -79,7 +115,7 @@ trivfs_open (struct trivfs_control *cntl,
   if (err)
     {
       ports_port_deref (cntl);
-      free (po);
+      _trivfs_free_peropen (po);
     }
 
   return err;
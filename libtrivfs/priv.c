@@ -50,6 +50,14 @@ void (*trivfs_protid_destroy_hook) (struct trivfs_protid *)
 void (*trivfs_peropen_destroy_hook) (struct trivfs_peropen *)
   __attribute__ ((weak));
 
+int (*trivfs_ready_hook) (struct trivfs_control *cntl)
+  __attribute__ ((weak));
+
+error_t (*trivfs_read_hook) (struct trivfs_protid *cred,
+			     data_t *data, mach_msg_type_number_t *datalen,
+			     loff_t offs, vm_size_t amount)
+  __attribute__ ((weak));
+
 error_t (*trivfs_getroot_hook) (struct trivfs_control *cntl,
 				mach_port_t reply_port,
 				mach_msg_type_name_t reply_port_type,
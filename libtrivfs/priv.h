@@ -32,4 +32,14 @@ _is_privileged (struct idvec *uids)
   return idvec_contains (uids, 0) || idvec_contains (uids, getuid ());
 }
 
+/* Free the memory of PO, made by trivfs_open.  */
+void _trivfs_free_peropen (struct trivfs_peropen *po);
+
+/* Protects the notify lists of all controls.  */
+extern pthread_mutex_t _trivfs_notify_lock;
+
+/* Drop the io_notify_request registrations made through PO, which is
+   about to be freed.  */
+void _trivfs_notify_cancel (struct trivfs_peropen *po);
+
 #endif
@@ -40,16 +40,18 @@ trivfs_clean_protid (void *arg)
           (*trivfs_peropen_destroy_hook) (cred->po);
           if (refcount_deref (&cred->po->refcnt) == 0)
             {
+              _trivfs_notify_cancel (cred->po);
               ports_port_deref (cntl);
-              free (cred->po);
+              _trivfs_free_peropen (cred->po);
             }
         }
     }
   else
     if (refcount_deref (&cred->po->refcnt) == 0)
       {
+        _trivfs_notify_cancel (cred->po);
         ports_port_deref (cntl);
-        free (cred->po);
+        _trivfs_free_peropen (cred->po);
       }
 
   iohelp_free_iouser (cred->user);
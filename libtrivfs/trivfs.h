@@ -72,6 +72,9 @@ struct trivfs_control
   mach_port_t file_id;
   mach_port_t underlying;
   void *hook;			/* for user use */
+
+  /* Registrations made with io_notify_request.  */
+  struct iohelp_notify *notify;
 };
 
 /* The user may define this variable.  Set this to the name of the
@@ -146,6 +149,22 @@ extern void (*trivfs_protid_destroy_hook) (struct trivfs_protid *);
    is about to be destroyed. */
 extern void (*trivfs_peropen_destroy_hook) (struct trivfs_peropen *);
 
+/* If this variable is set, io_notify_request is supported, and this is
+   called to find out which of SELECT_READ, SELECT_WRITE and SELECT_URG
+   could be done on CNTL without blocking; it must not block itself.
+   The user should then call trivfs_notify_ready whenever one of them may
+   have become true, as when waking the threads in trivfs_S_io_select.  */
+extern int (*trivfs_ready_hook) (struct trivfs_control *cntl);
+
+/* If this variable is set, io_transfer is supported, and this is called
+   to read from CRED as trivfs_S_io_read would, except that it must
+   always return the data itself rather than reply later.  *DATA is
+   passed in empty, and must be returned in memory from mmap.  */
+extern error_t (*trivfs_read_hook) (struct trivfs_protid *cred,
+				    data_t *data,
+				    mach_msg_type_number_t *datalen,
+				    loff_t offs, vm_size_t amount);
+
 typedef error_t (*trivfs_getroot_hook_fun) (struct trivfs_control *cntl,
 				       mach_port_t reply_port,
 				       mach_msg_type_name_t reply_port_type,
@@ -238,6 +257,11 @@ error_t trivfs_set_atime (struct trivfs_control *cntl);
 /* Call this to set mtime for the node to the current time. */
 error_t trivfs_set_mtime (struct trivfs_control *cntl);
 
+/* Call this to tell those registered with io_notify_request on CNTL
+   that READY (of SELECT_READ, SELECT_WRITE and SELECT_URG) can now be
+   done; see trivfs_ready_hook.  */
+void trivfs_notify_ready (struct trivfs_control *cntl, int ready);
+
 /* If this is defined or set to an argp structure, it will be used by the
    default trivfs_set_options to handle runtime options parsing.  Redefining
    this is the normal way to add option parsing to a trivfs program.  */
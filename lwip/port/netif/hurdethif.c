@@ -43,6 +43,8 @@
 #include <lwip/snmp.h>
 #include <lwip/ethip6.h>
 #include <lwip/etharp.h>
+#include <lwip/tcpip.h>
+#include <netif/ethernet.h>
 #include <lwip/sockets.h>
 #include <lwip/inet.h>
 
@@ -307,10 +309,11 @@ hurdethif_output (struct netif *netif, struct pbuf *p)
 }
 
 /*
- * Called from the demuxer when incoming data is ready
+ * Copy the frame in MSG into a pbuf chain, or return NULL if the
+ * pool has none left.
  */
-void
-hurdethif_input (struct netif *netif, struct net_rcv_msg *msg)
+static struct pbuf *
+hurdethif_input_pbuf (struct net_rcv_msg *msg)
 {
   struct pbuf *p, *q;
   uint16_t len;
@@ -363,28 +366,18 @@ hurdethif_input (struct netif *netif, struct net_rcv_msg *msg)
 	    q = q->next;
 	}
       while (1);
-
-      /* Pass the pbuf chain to he input function */
-      if (netif->input (p, netif) != ERR_OK)
-	{
-	  LWIP_DEBUGF (NETIF_DEBUG, ("hurdethif_input: IP input error\n"));
-	  pbuf_free (p);
-	  p = NULL;
-	}
     }
+
+  return p;
 }
 
-/* Demux incoming RPCs from the device */
-int
-hurdethif_demuxer (mach_msg_header_t * inp, mach_msg_header_t * outp)
+/* The interface whose read port received INP, or NULL */
+static struct netif *
+hurdethif_input_netif (mach_msg_header_t * inp)
 {
-  struct net_rcv_msg *msg = (struct net_rcv_msg *) inp;
   struct netif *netif;
   mach_port_t local_port;
 
-  if (inp->msgh_id != NET_RCV_MSG_ID)
-    return 0;
-
   if (MACH_MSGH_BITS_LOCAL (inp->msgh_bits) ==
       MACH_MSG_TYPE_PROTECTED_PAYLOAD)
     {
@@ -406,16 +399,7 @@ hurdethif_demuxer (mach_msg_header_t * inp, mach_msg_header_t * outp)
     if (local_port == netif_get_state (netif)->readptname)
       break;
 
-  if (!netif)
-    {
-      if (inp->msgh_remote_port != MACH_PORT_NULL)
-	mach_port_deallocate (mach_task_self (), inp->msgh_remote_port);
-      return 1;
-    }
-
-  hurdethif_input (netif, msg);
-
-  return 1;
+  return netif;
 }
 
 /*
@@ -541,11 +525,97 @@ hurdethif_device_init (struct netif *netif)
   return ERR_OK;
 }
 
+/* Frames taken from the read ports at each wakeup, at most */
+#define HURDETHIF_RX_BATCH 32
+
+static struct net_rcv_msg rx_msgs[HURDETHIF_RX_BATCH];
+
+/*
+ * Receive frames and pass them to the stack.
+ *
+ * Rather than handling one message per wakeup, take all those already
+ * queued on the read ports, up to HURDETHIF_RX_BATCH, copy them into
+ * pbufs from the pool, and pass them all to the stack taking the core
+ * lock once.
+ */
 static void *
 hurdethif_input_thread (void *arg)
 {
-  ports_manage_port_operations_one_thread (etherport_bucket,
-					   hurdethif_demuxer, 0);
+  struct pbuf *pbufs[HURDETHIF_RX_BATCH];
+  struct netif *netifs[HURDETHIF_RX_BATCH];
+  int stop = 0;
+
+  while (!stop)
+    {
+      int n, npbufs = 0, i;
+
+      for (n = 0; n < HURDETHIF_RX_BATCH; n++)
+	{
+	  error_t err;
+
+	  err = mach_msg (&rx_msgs[n].msg_hdr,
+			  MACH_RCV_MSG | (n ? MACH_RCV_TIMEOUT : 0),
+			  0, sizeof rx_msgs[n], etherport_bucket->portset,
+			  0, MACH_PORT_NULL);
+	  if (err == MACH_RCV_TIMED_OUT)
+	    break;
+	  if (err == MACH_RCV_TOO_LARGE)
+	    /* A message too large was destroyed: go on with the others */
+	    n--;
+	  else if (err)
+	    {
+	      /* Anything else would only happen again: pass on what has
+		 been received, and stop */
+	      error (0, err, "mach_msg");
+	      stop = 1;
+	      break;
+	    }
+	}
+
+      for (i = 0; i < n; i++)
+	{
+	  mach_msg_header_t *inp = &rx_msgs[i].msg_hdr;
+	  struct netif *netif;
+
+	  if (inp->msgh_id != NET_RCV_MSG_ID)
+	    {
+	      mach_msg_destroy (inp);
+	      continue;
+	    }
+
+	  netif = hurdethif_input_netif (inp);
+	  if (!netif)
+	    {
+	      if (inp->msgh_remote_port != MACH_PORT_NULL)
+		mach_port_deallocate (mach_task_self (), inp->msgh_remote_port);
+	      continue;
+	    }
+
+	  pbufs[npbufs] = hurdethif_input_pbuf (&rx_msgs[i]);
+	  if (pbufs[npbufs])
+	    netifs[npbufs++] = netif;
+	}
+
+#if LWIP_TCPIP_CORE_LOCKING
+      /* Run the stack on them here rather than posting each to the
+       * tcpip thread */
+      if (npbufs)
+	{
+	  LOCK_TCPIP_CORE ();
+	  for (i = 0; i < npbufs; i++)
+	    if (ethernet_input (pbufs[i], netifs[i]) != ERR_OK)
+	      pbuf_free (pbufs[i]);
+	  UNLOCK_TCPIP_CORE ();
+	}
+#else
+      for (i = 0; i < npbufs; i++)
+	if (netifs[i]->input (pbufs[i], netifs[i]) != ERR_OK)
+	  {
+	    LWIP_DEBUGF (NETIF_DEBUG, ("hurdethif_input: IP input error\n"));
+	    pbuf_free (pbufs[i]);
+	  }
+#endif
+    }
 
   return 0;
 }
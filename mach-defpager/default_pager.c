@@ -58,6 +58,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <time.h>
 
 #include <file_io.h>
 
@@ -67,11 +68,15 @@
 #include "exc_S.h"
 
 #include "priv.h"
+#include "zpool.h"
 
 #define debug 0
 
 struct partitions all_partitions;
 
+/* What default_pager_paging_stats reports.  */
+static struct default_pager_paging_stats paging_stats;
+
 static char my_name[] = "(default pager):";
 
 static void __attribute__ ((format (printf, 1, 2), unused))
@@ -197,6 +202,7 @@ new_partition (const char *name, struct file_direct *fdp,
 	part->bitmap	= (bm_entry_t *)malloc(bmsize);
 	part->going_away= FALSE;
 	part->file = fdp;
+	part->rotor	= 0;
 
 	memset ((char *)part->bitmap, 0, bmsize);
 
@@ -504,16 +510,23 @@ ddprintf ("choose_partition(%x,%d,%d)\n",size,cur_part,i);
 }
 
 /*
- * Allocate a page in a paging partition
+ * Allocate a page in a paging partition:
+ * page HINT if it is free, or else the page at SLOT in an
+ * entirely free bitmap entry, so that the pages of an object
+ * that are near each other stay together on disk, or else any.
+ * HINT and SLOT may be NO_BLOCK, for no preference.
  * The partition is returned unlocked.
  */
 vm_offset_t
 pager_alloc_page(p_index_t	pindex,
-	boolean_t	lock_it)
+	boolean_t	lock_it,
+	vm_offset_t	hint,
+	vm_offset_t	slot)
 {
 	int	bm_e;
 	int	bit;
 	int	limit;
+	int	i;
 	bm_entry_t	*bm;
 	partition_t	part;
 	static char	here[] = "%spager_alloc_page";
@@ -536,7 +549,40 @@ ddprintf ("pager_alloc_page(%d,%d)\n",pindex,lock_it);
 	    return (NO_BLOCK);
 	}
 
+	paging_stats.dps_allocs++;
 	limit = howmany(part->total_size, NB_BM);
+
+	/*
+	 * Right next to the neighbours?
+	 */
+	if (hint != NO_BLOCK && hint < part->total_size
+	    && (part->bitmap[hint / NB_BM] & (1U << (hint % NB_BM))) == 0) {
+	    bm = &part->bitmap[hint / NB_BM];
+	    bit = hint % NB_BM;
+	    paging_stats.dps_clustered_allocs++;
+	    goto found;
+	}
+
+	/*
+	 * Start a new cluster, looking for an empty entry from
+	 * where the last one was found.  A last entry that is only
+	 * partly in the partition doesn't count.
+	 */
+	if (slot != NO_BLOCK) {
+	    for (i = 0; i < limit; i++) {
+		bm_e = (part->rotor + i) % limit;
+		if (part->bitmap[bm_e] == 0
+		    && (bm_e + 1) * NB_BM <= part->total_size)
+		    break;
+	    }
+	    if (i < limit) {
+		part->rotor = bm_e + 1;
+		bm = &part->bitmap[bm_e];
+		bit = slot % NB_BM;
+		goto found;
+	    }
+	}
+
 	bm = part->bitmap;
 	for (bm_e = 0; bm_e < limit; bm_e++, bm++)
 	    if (*bm != BM_MASK)
@@ -546,7 +592,7 @@ ddprintf ("pager_alloc_page(%d,%d)\n",pindex,lock_it);
 	    panic(here,my_name);
 
 	/*
-	 * Find and set the proper bit
+	 * Find the proper bit
 	 */
 	{
 	    bm_entry_t	b = *bm;
@@ -556,15 +602,15 @@ ddprintf ("pager_alloc_page(%d,%d)\n",pindex,lock_it);
 		    break;
 	    if (bit == NB_BM)
 		panic(here,my_name);
-
-	    *bm = b | (1U<<bit);
-	    part->free--;
-
 	}
 
+found:
+	*bm |= 1U<<bit;
+	part->free--;
+
 	pthread_mutex_unlock(&part->p_lock);
 
-	return (bm_e*NB_BM+bit);
+	return ((bm - part->bitmap)*NB_BM+bit);
 }
 
 /*
@@ -1169,7 +1215,7 @@ pager_move_page(union dp_map	block)
 		return ret;
 
 	/* this unlocks the new partition */
-	new_offset = pager_alloc_page(new_pindex, FALSE);
+	new_offset = pager_alloc_page(new_pindex, FALSE, NO_BLOCK, NO_BLOCK);
 	if (new_offset == NO_BLOCK)
 		panic(here,my_name);
 
@@ -1296,10 +1342,42 @@ compute_checksum(addr, size)
 }
 #endif	 /* CHECKSUM */
 
+/*
+ * Return the block of partition PINDEX that would put entry
+ * INDEX of the block map MAPPTR, of SIZE entries, in line with
+ * its neighbours in the same group of NB_BM pages, or NO_BLOCK
+ * if none of them has a block there.
+ */
+static vm_offset_t
+cluster_hint(dp_map_t	mapptr,
+	vm_size_t	size,
+	vm_offset_t	index,
+	p_index_t	pindex)
+{
+	vm_offset_t	first, last, i;
+
+	first = index - index % NB_BM;
+	last = first + NB_BM;
+	if (last > size)
+	    last = size;
+
+	for (i = first; i < last; i++) {
+	    union dp_map	block = mapptr[i];
+
+	    if (i == index || no_block(block)
+		|| block.block.p_index != pindex
+		|| block.block.p_offset + index < i)
+		continue;
+	    return (block.block.p_offset + index - i);
+	}
+	return (NO_BLOCK);
+}
+
 /*
  * Given an offset within a paging object, find the
  * corresponding block within the paging partition.
- * Allocate a new block if necessary.
+ * Allocate a new block if necessary, next to those of
+ * the neighbouring pages if possible.
  *
  * WARNING: paging objects apparently may be extended
  * without notice!
@@ -1310,6 +1388,7 @@ pager_write_offset(dpager_t	pager,
 {
 	vm_offset_t	f_page;
 	dp_map_t	mapptr;
+	vm_size_t	map_size;
 	union dp_map	block;
 
 	invalidate_block(block);
@@ -1407,9 +1486,11 @@ pager_write_offset(dpager_t	pager,
 #endif	 /* CHECKSUM */
 	    }
 	    f_page %= PAGEMAP_ENTRIES;
+	    map_size = PAGEMAP_ENTRIES;
 	}
 	else {
 	    mapptr = pager_get_direct_map(pager);
+	    map_size = pager->size;
 	}
 
 	block = mapptr[f_page];
@@ -1418,7 +1499,10 @@ pager_write_offset(dpager_t	pager,
 	    vm_offset_t	off;
 
 	    /* get room now */
-	    off = pager_alloc_page(pager->cur_partition, TRUE);
+	    off = pager_alloc_page(pager->cur_partition, TRUE,
+				   cluster_hint(mapptr, map_size, f_page,
+						pager->cur_partition),
+				   f_page % NB_BM);
 	    if (off == NO_BLOCK) {
 		/*
 		 * Before giving up, try all other partitions.
@@ -1440,7 +1524,8 @@ dprintf("extending object %x (size %x) to %x.\n",
 		    pager->cur_partition = new_part;
 
 		    /* this unlocks the partition too */
-		    off = pager_alloc_page(pager->cur_partition, FALSE);
+		    off = pager_alloc_page(pager->cur_partition, FALSE,
+					   NO_BLOCK, f_page % NB_BM);
 
 		}
 
@@ -1589,10 +1674,42 @@ ok:
 #define	PAGER_ABSENT	1
 #define	PAGER_ERROR	2
 
+/*
+ * Most pages moved to or from a paging partition at once.
+ */
+#define	CLUSTER_SIZE	16
+
+/*
+ * Return how many of the pages after the one at OFFSET in DS,
+ * up to MAX of them, have blocks right after BLOCK, its own.
+ */
+static unsigned int
+contiguous_pages(dpager_t	ds,
+	vm_offset_t	offset,
+	union dp_map	block,
+	unsigned int	max)
+{
+	unsigned int	n;
+
+	for (n = 0; n < max; n++) {
+	    union dp_map	next;
+
+	    next = pager_read_offset(ds, offset + ptoa(n + 1));
+	    if (no_block(next)
+		|| next.block.p_index != block.block.p_index
+		|| next.block.p_offset != block.block.p_offset + n + 1)
+		break;
+	}
+	return (n);
+}
+
 /*
  * Read data from a default pager.  Addr is the address of a buffer
  * to fill.  Out_addr returns the buffer that contains the data;
  * if it is different from <addr>, it must be deallocated after use.
+ * Up to *ahead of the pages following the data are read with it if
+ * they are next to it on disk; they are returned right after it in
+ * the buffer at out_addr, and their number in *ahead.
  */
 int
 default_read(dpager_t	ds,
@@ -1602,7 +1719,8 @@ default_read(dpager_t	ds,
 	vm_offset_t		*out_addr,
 				/* returns pointer to data */
 	boolean_t		deallocate,
-	boolean_t		external)
+	boolean_t		external,
+	unsigned int		*ahead)
 {
 	union dp_map	block;
 	vm_offset_t	raddr;
@@ -1610,11 +1728,15 @@ default_read(dpager_t	ds,
 	int	rc;
 	boolean_t	first_time;
 	partition_t	part;
+	unsigned int	n;
 #ifdef	CHECKSUM
 	vm_size_t	original_size = size;
 #endif	 /* CHECKSUM */
 	vm_offset_t	original_offset = offset;
 
+	n = *ahead;
+	*ahead = 0;
+
 	/*
 	 * Find the block in the paging partition
 	 */
@@ -1632,6 +1754,9 @@ default_read(dpager_t	ds,
 	    return (PAGER_ABSENT);
 	}
 
+	if (n > 0)
+	    n = contiguous_pages(ds, offset, block, n);
+
 	/*
 	 * Read it, trying for the entire page.
 	 */
@@ -1641,12 +1766,36 @@ ddprintf ("default_read(%lx,%x,%lx,%d)\n",addr,size,offset,block.block.p_index);
 	first_time = TRUE;
 	*out_addr = addr;
 
+	if (n > 0) {
+	    /*
+	     * Read the following pages along with it.
+	     */
+	    rc = page_read_file_direct(part->file,
+				       offset,
+				       size + ptoa(n),
+				       &raddr,
+				       &rsize);
+	    paging_stats.dps_pagein_reads++;
+	    if (rc == 0 && rsize == size + ptoa(n)) {
+		*out_addr = raddr;
+		*ahead = n;
+		paging_stats.dps_readahead_pages += n;
+		goto done;
+	    }
+	    /*
+	     * Settle for just the page.
+	     */
+	    if (rc == 0)
+		(void) vm_deallocate(mach_task_self(), raddr, rsize);
+	}
+
 	do {
 	    rc = page_read_file_direct(part->file,
 				       offset,
 				       size,
 				       &raddr,
 				       &rsize);
+	    paging_stats.dps_pagein_reads++;
 	    if (rc != 0)
 		return (PAGER_ERROR);
 
@@ -1669,6 +1818,7 @@ ddprintf ("default_read(%lx,%x,%lx,%d)\n",addr,size,offset,block.block.p_index);
 	    size -= rsize;
 	} while (size != 0);
 
+done:
 #if	USE_PRECIOUS
 	if (deallocate)
 		pager_release_offset(ds, original_offset);
@@ -1691,62 +1841,87 @@ ddprintf ("default_read(%lx,%x,%lx,%d)\n",addr,size,offset,block.block.p_index);
 	return (PAGER_SUCCESS);
 }
 
+/*
+ * Write SIZE bytes of whole pages at ADDR to a default pager,
+ * at OFFSET.  Pages whose blocks follow each other on disk are
+ * written together, up to CLUSTER_SIZE of them at a time.
+ */
 int
 default_write(dpager_t	ds,
 	vm_offset_t	addr,
 	vm_size_t	size,
 	vm_offset_t	offset)
 {
-	union dp_map	block;
+	union dp_map	block, next;
 	partition_t		part;
 	mach_msg_type_number_t	wsize;
+	vm_size_t	cluster;
+	vm_offset_t	daddr;
 	int		rc;
 
 	ddprintf ("default_write: pager offset %lx\n", offset);
 
-	/*
-	 * Find block in paging partition
-	 */
-	block = pager_write_offset(ds, offset);
-	if ( no_block(block) )
-	    return (PAGER_ERROR);
+	while (size != 0) {
+	    /*
+	     * Find block in paging partition
+	     */
+	    block = pager_write_offset(ds, offset);
+	    if ( no_block(block) )
+		return (PAGER_ERROR);
 
-#ifdef	CHECKSUM
-	/*
-	 * Save checksum
-	 */
-	{
-	    int	checksum;
+	    /*
+	     * And those of the following pages, as long as
+	     * they are right after it.
+	     */
+	    for (cluster = vm_page_size;
+		 cluster < size && cluster < ptoa(CLUSTER_SIZE);
+		 cluster += vm_page_size) {
+		next = pager_write_offset(ds, offset + cluster);
+		if (no_block(next)
+		    || next.block.p_index != block.block.p_index
+		    || next.block.p_offset
+		       != block.block.p_offset + atop(cluster))
+		    break;
+	    }
 
-	    checksum = compute_checksum(addr, size);
-	    pager_put_checksum(ds, offset, checksum);
-	}
-#endif	 /* CHECKSUM */
-	offset = ptoa(block.block.p_offset);
-ddprintf ("default_write(%lx,%x,%lx,%d)\n",addr,size,offset,block.block.p_index);
-	part   = partition_of(block.block.p_index);
+#ifdef	CHECKSUM
+	    /*
+	     * Save checksums
+	     */
+	    {
+		vm_size_t	done;
 
-	/*
-	 * There are various assumptions made here,we
-	 * will not get into the next disk 'block' by
-	 * accident. It might well be non-contiguous.
-	 */
-	do {
-	    rc = page_write_file_direct(part->file,
-					offset,
-					addr,
-					size,
-					&wsize);
-	    if (rc != 0) {
-		dprintf("*** PAGER ERROR: default_write: ");
-		dprintf("ds=0x%p addr=0x%lx size=0x%x offset=0x%lx resid=0x%x\n",
-			ds, addr, size, offset, wsize);
-		return (PAGER_ERROR);
+		for (done = 0; done < cluster; done += vm_page_size)
+		    pager_put_checksum(ds, offset + done,
+				       compute_checksum(addr + done,
+							vm_page_size));
 	    }
-	    addr += wsize;
-	    offset += wsize;
-	    size -= wsize;
-	} while (size != 0);
+#endif	 /* CHECKSUM */
+	    daddr = ptoa(block.block.p_offset);
+ddprintf ("default_write(%lx,%x,%lx,%d)\n",addr,cluster,daddr,block.block.p_index);
+	    part   = partition_of(block.block.p_index);
+
+	    offset += cluster;
+	    size -= cluster;
+	    paging_stats.dps_pageout_writes++;
+
+	    do {
+		rc = page_write_file_direct(part->file,
+					    daddr,
+					    addr,
+					    cluster,
+					    &wsize);
+		if (rc != 0) {
+		    dprintf("*** PAGER ERROR: default_write: ");
+		    dprintf("ds=0x%p addr=0x%lx size=0x%x offset=0x%lx resid=0x%x\n",
+			    ds, addr, cluster, daddr, wsize);
+		    return (PAGER_ERROR);
+		}
+		addr += wsize;
+		daddr += wsize;
+		cluster -= wsize;
+	    } while (cluster != 0);
+	}
 	return (PAGER_SUCCESS);
 }
 
@@ -2311,6 +2486,20 @@ ddprintf ("seqnos_memory_object_terminate <%p>: pager_port_lock: <%p>[s:%d,r:%d,
 	pager_port_wait_for_readers(ds);
 	pager_port_wait_for_writers(ds);
 
+	/*
+	 *	Write what is waiting to be written, and forget
+	 *	what was read ahead.  Nobody else is writing now.
+	 */
+
+	if (ds->wb_buffer != 0) {
+		struct wb_cluster	c;
+
+		detach_cluster(ds, &c);
+		if (write_cluster(ds, &c) != PAGER_SUCCESS)
+			ds->errors++;
+	}
+	drop_readahead(ds);
+
 	/*
 	 *	After memory_object_terminate both memory_object_init
 	 *	and a no-senders notification are possible, so we need
@@ -2371,6 +2560,18 @@ void default_pager_no_senders(default_pager_t ds,
 	if (ds->pager_request != MACH_PORT_NULL)
 		panic(here,my_name);
 
+	/*
+	 *	Terminate has written the write-behind cluster;
+	 *	only pages read ahead since may be left.  Pages in
+	 *	the compressed pool are dropped before the object
+	 *	leaves the list, as the flush thread finds their
+	 *	objects through them while holding the list lock;
+	 *	then it may still be writing one.
+	 */
+	drop_readahead(ds);
+	zpool_drop(ds, 0, ~(vm_offset_t) 0);
+	pager_port_wait_for_writers(ds);
+
 	/*
 	 *	Unlock the pager (though there should be no one
 	 *	waiting for it).
@@ -2413,6 +2614,296 @@ void default_pager_no_senders(default_pager_t ds,
 	pthread_mutex_unlock(&all_pagers.lock);
 }
 
+/*
+ * Write-behind and read-ahead.
+ *
+ * Pages the kernel returns one at a time are gathered into a
+ * cluster of up to CLUSTER_SIZE pages of the object, which is
+ * written in one go once it is full, once a page that does not
+ * belong to it comes, or once it has not grown for a while.  Their
+ * blocks are allocated as they come, so that they end up next to
+ * each other on disk.
+ *
+ * When pageins of an object are sequential, the pages following
+ * the one asked for are read with it if they are next to it on disk,
+ * and kept here until the kernel asks for them.  Any pageout of the
+ * object makes them suspect; those it touches are forgotten.
+ */
+
+/*
+ * Most pages, wired like the rest of our memory, held in
+ * write-behind clusters and pages read ahead.
+ */
+#define	MAX_CLUSTER_PAGES	512
+
+static unsigned int	cluster_pages;
+static pthread_mutex_t	cluster_pages_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Take PAGES pages from what is left for clusters, if there are.
+ */
+static boolean_t
+cluster_reserve(unsigned int pages)
+{
+	boolean_t	ok;
+
+	pthread_mutex_lock(&cluster_pages_lock);
+	ok = (cluster_pages + pages <= MAX_CLUSTER_PAGES);
+	if (ok)
+	    cluster_pages += pages;
+	pthread_mutex_unlock(&cluster_pages_lock);
+	return (ok);
+}
+
+static void
+cluster_release(unsigned int pages)
+{
+	pthread_mutex_lock(&cluster_pages_lock);
+	cluster_pages -= pages;
+	pthread_mutex_unlock(&cluster_pages_lock);
+}
+
+/*
+ * A write-behind cluster taken off its object to be written.
+ */
+struct wb_cluster {
+	vm_offset_t	buffer;		/* 0 if none */
+	vm_offset_t	offset;
+	unsigned int	count;
+};
+
+/*
+ * Forget the pages read ahead for DS.  DS must be locked.
+ */
+static void
+drop_readahead(default_pager_t ds)
+{
+	if (ds->ra_buffer == 0)
+	    return;
+	(void) vm_deallocate(default_pager_self, ds->ra_buffer, ds->ra_size);
+	cluster_release(atop(ds->ra_size));
+	ds->ra_buffer = 0;
+	ds->ra_valid = 0;
+}
+
+/*
+ * Forget the pages read ahead for DS between OFFSET and
+ * OFFSET + SIZE.  DS must be locked.
+ */
+static void
+invalidate_readahead(default_pager_t ds,
+	vm_offset_t	offset,
+	vm_size_t	size)
+{
+	vm_offset_t	o;
+
+	if (ds->ra_buffer == 0)
+	    return;
+	for (o = offset; o < offset + size; o += vm_page_size)
+	    if (o >= ds->ra_offset && o < ds->ra_offset + ds->ra_size)
+		ds->ra_valid &= ~(1U << atop(o - ds->ra_offset));
+	if (ds->ra_valid == 0)
+	    drop_readahead(ds);
+}
+
+/*
+ * If the page at OFFSET in DS is in the compressed pool, in its
+ * write-behind cluster or has been read ahead, copy it to ADDR
+ * and return TRUE.  A page read ahead is handed out only once;
+ * if the kernel wants to write a page, it is taken out of the
+ * pool, and its block is released, as default_read does.  DS must
+ * be locked.
+ */
+static boolean_t
+cached_page(default_pager_t ds,
+	vm_offset_t	offset,
+	vm_offset_t	addr,
+	boolean_t	write)
+{
+	if (zpool_max != 0 && zpool_load(ds, offset, addr, write)) {
+#if	USE_PRECIOUS
+	    if (write && default_has_page(&ds->dpager, offset))
+		pager_release_offset(&ds->dpager, offset);
+#endif	/*USE_PRECIOUS*/
+	    paging_stats.dps_compressed_hits++;
+	    return (TRUE);
+	}
+
+	if (ds->wb_buffer != 0
+	    && offset >= ds->wb_offset
+	    && offset < ds->wb_offset + ptoa(ds->wb_count)) {
+	    memcpy((void *) addr,
+		   (void *) (ds->wb_buffer + offset - ds->wb_offset),
+		   vm_page_size);
+	    return (TRUE);
+	}
+
+	if (ds->ra_buffer != 0
+	    && offset >= ds->ra_offset
+	    && offset < ds->ra_offset + ds->ra_size
+	    && (ds->ra_valid & (1U << atop(offset - ds->ra_offset)))) {
+	    memcpy((void *) addr,
+		   (void *) (ds->ra_buffer + offset - ds->ra_offset),
+		   vm_page_size);
+	    invalidate_readahead(ds, offset, vm_page_size);
+#if	USE_PRECIOUS
+	    if (write)
+		pager_release_offset(&ds->dpager, offset);
+#endif	/*USE_PRECIOUS*/
+	    paging_stats.dps_readahead_hits++;
+	    return (TRUE);
+	}
+
+	return (FALSE);
+}
+
+/*
+ * Take the write-behind cluster off DS into C.  DS must be locked.
+ */
+static void
+detach_cluster(default_pager_t ds,
+	struct wb_cluster *c)
+{
+	c->buffer = ds->wb_buffer;
+	c->offset = ds->wb_offset;
+	c->count = ds->wb_count;
+	ds->wb_buffer = 0;
+	ds->wb_count = 0;
+
+	/*
+	 * Pages read from disk until these are written may be stale.
+	 */
+	ds->write_count++;
+}
+
+/*
+ * Gather the page at ADDR, returned for OFFSET in DS, into the
+ * write-behind cluster of DS, and return TRUE if it could be.
+ * A cluster that is to be written now is taken off DS into C.
+ * DS must be locked.
+ */
+static boolean_t
+gather_page(default_pager_t ds,
+	vm_offset_t	addr,
+	vm_offset_t	offset,
+	struct wb_cluster *c)
+{
+	union dp_map	block;
+
+	c->buffer = 0;
+
+	if (ds->wb_buffer != 0
+	    && offset >= ds->wb_offset
+	    && offset < ds->wb_offset + ptoa(ds->wb_count)) {
+	    /*
+	     * Returned again before being written.
+	     */
+	    memcpy((void *) (ds->wb_buffer + offset - ds->wb_offset),
+		   (void *) addr, vm_page_size);
+	    ds->wb_idle = FALSE;
+	    return (TRUE);
+	}
+
+	block = pager_write_offset(&ds->dpager, offset);
+	if (no_block(block))
+	    return (FALSE);
+
+	if (ds->wb_buffer == 0
+	    || offset != ds->wb_offset + ptoa(ds->wb_count)) {
+	    /*
+	     * Start a new cluster, sending the old one on its way.
+	     */
+	    if (ds->wb_buffer != 0)
+		detach_cluster(ds, c);
+	    if (! cluster_reserve(CLUSTER_SIZE))
+		return (FALSE);
+	    if (vm_allocate(default_pager_self, &ds->wb_buffer,
+			    ptoa(CLUSTER_SIZE), TRUE) != KERN_SUCCESS) {
+		ds->wb_buffer = 0;
+		cluster_release(CLUSTER_SIZE);
+		return (FALSE);
+	    }
+	    ds->wb_offset = offset;
+	    ds->wb_count = 0;
+	}
+
+	memcpy((void *) (ds->wb_buffer + ptoa(ds->wb_count)),
+	       (void *) addr, vm_page_size);
+	ds->wb_count++;
+	ds->wb_idle = FALSE;
+
+	if (ds->wb_count == CLUSTER_SIZE)
+	    detach_cluster(ds, c);
+	return (TRUE);
+}
+
+/*
+ * Write the cluster C of DS, and free it.  It must be the
+ * caller's turn to write pages of DS.
+ */
+static int
+write_cluster(default_pager_t ds,
+	struct wb_cluster *c)
+{
+	int	rc;
+
+	rc = default_write(&ds->dpager, c->buffer, ptoa(c->count), c->offset);
+	(void) vm_deallocate(default_pager_self, c->buffer, ptoa(CLUSTER_SIZE));
+	cluster_release(CLUSTER_SIZE);
+	return (rc);
+}
+
+/*
+ * Claim a turn to write pages of DS, and return its ticket.  Turns
+ * come in the order they are claimed, so that of two writes of the
+ * same page the later one stays.  DS must be locked.
+ */
+static unsigned int
+claim_writing(default_pager_t ds)
+{
+	return (ds->wb_ticket++);
+}
+
+/*
+ * Wait for the turn of TICKET to write pages of DS.  DS must be
+ * unlocked.
+ */
+static void
+wait_for_turn(default_pager_t ds,
+	unsigned int	ticket)
+{
+	dstruct_lock(ds);
+	while (ds->wb_turn != ticket)
+	    pthread_cond_wait(&ds->wb_next_turn, &ds->lock);
+	dstruct_unlock(ds);
+}
+
+/*
+ * End the current turn to write pages of DS.  DS must be unlocked.
+ */
+static void
+end_turn(default_pager_t ds)
+{
+	dstruct_lock(ds);
+	ds->wb_turn++;
+	pthread_cond_broadcast(&ds->wb_next_turn);
+	dstruct_unlock(ds);
+}
+
+static pthread_mutex_t	flush_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	flush_wakeup = PTHREAD_COND_INITIALIZER;
+
+/*
+ * Have the flush thread look at the compressed pool now.
+ */
+static void
+wake_flush_thread(void)
+{
+	pthread_mutex_lock(&flush_lock);
+	pthread_cond_signal(&flush_wakeup);
+	pthread_mutex_unlock(&flush_lock);
+}
+
 int		default_pager_pagein_count = 0;
 int		default_pager_pageout_count = 0;
 
@@ -2429,6 +2920,8 @@ seqnos_memory_object_data_request(default_pager_t	ds,
 	vm_offset_t		addr;
 	unsigned int 		errors;
 	kern_return_t		rc;
+	boolean_t		hit;
+	unsigned int		ahead, reserved, count;
 	static char		here[] = "%sdata_request";
 
 	if (length != vm_page_size)
@@ -2448,6 +2941,26 @@ ddprintf ("seqnos_memory_object_data_request <%p>: pager_port_lock: <%p>[s:%d,r:
 	 */
 	errors = ds->errors;
 
+	/*
+	 * The page may be waiting to be written, or have been read
+	 * ahead.  If not, read ahead of it when pageins are sequential.
+	 */
+	hit = FALSE;
+	reserved = 0;
+	if (errors == 0 && offset < ds->dpager.limit) {
+	    hit = cached_page(ds, offset, dpt->dpt_buffer,
+			      protection_required & VM_PROT_WRITE);
+	    if (! hit && offset == ds->ra_next) {
+		reserved = (ds->dpager.limit - offset - 1) / vm_page_size;
+		if (reserved > CLUSTER_SIZE - 1)
+		    reserved = CLUSTER_SIZE - 1;
+		if (reserved > 0 && ! cluster_reserve(reserved))
+		    reserved = 0;
+	    }
+	    ds->ra_next = offset + vm_page_size;
+	}
+	count = ds->write_count;
+
 ddprintf ("seqnos_memory_object_data_request <%p>: pager_port_unlock: <%p>[s:%d,r:%d,w:%d,l:%d]\n",
 	&ds, ds, ds->seqno, ds->readers, ds->writers, ds->lock.__held);
 	pager_port_unlock(ds);
@@ -2461,13 +2974,50 @@ ddprintf ("seqnos_memory_object_data_request <%p>: pager_port_unlock: <%p>[s:%d,
 	    goto done;
 	}
 
-	if (offset >= ds->dpager.limit)
+	ahead = reserved;
+	if (hit) {
+	    addr = dpt->dpt_buffer;
+	    rc = PAGER_SUCCESS;
+	}
+	else if (offset >= ds->dpager.limit)
 	  rc = PAGER_ERROR;
 	else
 	  rc = default_read(&ds->dpager, dpt->dpt_buffer,
 			    vm_page_size, offset,
 			    &addr, protection_required & VM_PROT_WRITE,
-			    ds->external);
+			    ds->external, &ahead);
+
+	if (reserved > ahead)
+	    cluster_release(reserved - ahead);
+
+	if (ahead > 0) {
+	    /*
+	     * Keep the pages read ahead, unless pages of the object
+	     * have been written meanwhile: they may be stale.  Those
+	     * waiting to be written are stale anyhow.
+	     */
+	    dstruct_lock(ds);
+	    if (ds->write_count == count) {
+		drop_readahead(ds);
+		ds->ra_buffer = addr + vm_page_size;
+		ds->ra_size = ptoa(ahead);
+		ds->ra_offset = offset + vm_page_size;
+		ds->ra_valid = (1U << ahead) - 1;
+		if (ds->wb_buffer != 0)
+		    invalidate_readahead(ds, ds->wb_offset,
+					 ptoa(ds->wb_count));
+		ahead = 0;
+	    }
+	    dstruct_unlock(ds);
+
+	    if (ahead > 0) {
+		(void) vm_deallocate(default_pager_self,
+				     addr + vm_page_size, ptoa(ahead));
+		cluster_release(ahead);
+	    }
+	}
+
+	paging_stats.dps_pageins++;
 
 	switch (rc) {
 	    case PAGER_SUCCESS:
@@ -2547,7 +3097,8 @@ ddprintf ("seqnos_memory_object_data_initialize <%p>: pager_port_unlock: <%p>[s:
 	     amount_sent < data_cnt;
 	     amount_sent += vm_page_size) {
 
-	     if (!default_has_page(&ds->dpager, offset + amount_sent)) {
+	     if (!default_has_page(&ds->dpager, offset + amount_sent)
+		 && !zpool_has(ds, offset + amount_sent)) {
 		if (default_write(&ds->dpager,
 				  addr + amount_sent,
 				  vm_page_size,
@@ -2569,9 +3120,9 @@ ddprintf ("seqnos_memory_object_data_initialize <%p>: pager_port_unlock: <%p>[s:
 }
 
 /*
- * memory_object_data_return: split up the stuff coming in from
- * a memory_object_data_write call
- * into individual pages and pass them off to default_write.
+ * memory_object_data_return: gather single pages coming in from
+ * a memory_object_data_write call into write-behind clusters, and
+ * pass the rest off to default_write.
  */
 kern_return_t
 seqnos_memory_object_data_return(default_pager_t	ds,
@@ -2583,9 +3134,11 @@ seqnos_memory_object_data_return(default_pager_t	ds,
 	boolean_t	dirty,
 	boolean_t	kernel_copy)
 {
-	register
-	vm_size_t	amount_sent;
 	static char	here[] = "%sdata_return";
+	struct wb_cluster	c;
+	struct zpage	*zp;
+	boolean_t	gathered;
+	unsigned int	ticket = 0;
 	int err;
 
 	(void) dirty;
@@ -2601,12 +3154,26 @@ seqnos_memory_object_data_return(default_pager_t	ds,
 	if (ds == DEFAULT_PAGER_NULL)
 	    panic(here,my_name);
 
+	/*
+	 * Compress single pages before locking the pager, to keep
+	 * them in the pool.
+	 */
+	zp = (data_cnt == vm_page_size) ? zpool_compress(addr) : NULL;
+
 	pager_port_lock(ds, seqno);
 	pager_port_start_write(ds);
 
+	/*
+	 * What was read ahead of these pages is stale now.
+	 */
+	ds->write_count++;
+	invalidate_readahead(ds, offset, data_cnt);
+
 	vm_size_t limit = ds->dpager.byte_limit;
-	pager_port_unlock(ds);
 	if ((limit != round_page(limit)) && (trunc_page(limit) == offset)) {
+	    pager_port_unlock(ds);
+	    if (zp != NULL)
+		zpool_discard(zp);
 	    assert_backtrace (trunc_page(limit) == offset);
 	    assert_backtrace (data_cnt == vm_page_size);
 
@@ -2625,24 +3192,74 @@ seqnos_memory_object_data_return(default_pager_t	ds,
 	    return(KERN_SUCCESS);
 	  }
 
-	for (amount_sent = 0;
-	     amount_sent < data_cnt;
-	     amount_sent += vm_page_size) {
+	c.buffer = 0;
 
-	    int result;
+	/*
+	 * A page waiting in the write-behind cluster is replaced
+	 * there; otherwise it goes to the pool if there is room.
+	 */
+	if (zp != NULL
+	    && ds->wb_buffer != 0
+	    && offset >= ds->wb_offset
+	    && offset < ds->wb_offset + ptoa(ds->wb_count)) {
+	    zpool_discard(zp);
+	    zp = NULL;
+	}
+	if (zp != NULL) {
+	    err = zpool_insert(ds, offset, zp);
+	    if (zpool_too_full())
+		wake_flush_thread();
+	    if (err == 0) {
+		pager_port_unlock(ds);
+		goto done;
+	    }
+	}
 
-	    result = default_write(&ds->dpager,
-			      addr + amount_sent,
-			      vm_page_size,
-			      offset + amount_sent);
-	    if (result != KERN_SUCCESS) {
+	/*
+	 * Older copies in the pool must not hide these.
+	 */
+	zpool_drop(ds, offset, offset + data_cnt);
+
+	gathered = (data_cnt == vm_page_size
+		    && gather_page(ds, addr, offset, &c));
+
+	/*
+	 * Pages written directly must not be overwritten later
+	 * by older copies waiting to be written.
+	 */
+	if (! gathered && ds->wb_buffer != 0
+	    && offset < ds->wb_offset + ptoa(ds->wb_count)
+	    && ds->wb_offset < offset + data_cnt)
+	    detach_cluster(ds, &c);
+
+	if (c.buffer != 0 || ! gathered)
+	    ticket = claim_writing(ds);
+	pager_port_unlock(ds);
+
+	if (c.buffer != 0 || ! gathered) {
+	    wait_for_turn(ds, ticket);
+
+	    if (c.buffer != 0 && write_cluster(ds, &c) != PAGER_SUCCESS) {
+		dstruct_lock(ds);
+		ds->errors++;
+		dstruct_unlock(ds);
+	    }
+
+	    if (! gathered
+		&& default_write(&ds->dpager, addr, data_cnt, offset)
+		   != PAGER_SUCCESS) {
 		dstruct_lock(ds);
 		ds->errors++;
 		dstruct_unlock(ds);
 	    }
-	    default_pager_pageout_count++;
+
+	    end_turn(ds);
 	}
 
+    done:
+	default_pager_pageout_count += atop(data_cnt);
+	paging_stats.dps_pageouts += atop(data_cnt);
+
 	pager_port_finish_write(ds);
 	err = vm_deallocate(default_pager_self, addr, data_cnt);
 	if (err != KERN_SUCCESS)
@@ -3024,6 +3641,165 @@ default_pager_initialize(mach_port_t	host_port)
 	}
 }
 
+/*
+ * Seconds a write-behind cluster may stay as it is before it
+ * is written.
+ */
+#define	WRITE_BEHIND_DELAY	1
+
+/*
+ * Write the write-behind clusters which have not grown since the
+ * last look.
+ */
+static void
+flush_idle_clusters(void)
+{
+	default_pager_t		*due;
+	struct wb_cluster	*clusters;
+	size_t			n, i;
+
+	/*
+	 * Collect the due clusters, starting a write on each of
+	 * their objects, which keeps them from being terminated.
+	 */
+	pthread_mutex_lock(&all_pagers.lock);
+	due = malloc(all_pagers.htable.nr_items * sizeof *due);
+	clusters = malloc(all_pagers.htable.nr_items * sizeof *clusters);
+	n = 0;
+	if (due != NULL && clusters != NULL)
+	    HURD_IHASH_ITERATE (&all_pagers.htable, val) {
+		default_pager_t	ds = (default_pager_t) val;
+
+		dstruct_lock(ds);
+		if (ds->wb_buffer != 0) {
+		    if (ds->wb_idle && ds->wb_ticket == ds->wb_turn) {
+			/*
+			 * Nobody else is in line to write, so
+			 * our turn is now.
+			 */
+			detach_cluster(ds, &clusters[n]);
+			(void) claim_writing(ds);
+			pager_port_start_write(ds);
+			due[n++] = ds;
+		    }
+		    else
+			ds->wb_idle = TRUE;
+		}
+		dstruct_unlock(ds);
+	    }
+	pthread_mutex_unlock(&all_pagers.lock);
+
+	for (i = 0; i < n; i++) {
+	    if (write_cluster(due[i], &clusters[i]) != PAGER_SUCCESS) {
+		dstruct_lock(due[i]);
+		due[i]->errors++;
+		dstruct_unlock(due[i]);
+	    }
+	    end_turn(due[i]);
+	    pager_port_finish_write(due[i]);
+	}
+
+	free(due);
+	free(clusters);
+}
+
+/*
+ * Write the oldest pages of the compressed pool to the paging
+ * partitions while the pool is too full, using the page at BUFFER.
+ * A page stays in the pool until it has been written, and then
+ * leaves it unless a newer copy has taken its place.
+ */
+static void
+evict_pages(vm_offset_t	buffer)
+{
+	void		*owner;
+	vm_offset_t	offset;
+
+	for (;;) {
+	    default_pager_t	ds;
+	    unsigned long	stamp;
+	    unsigned int	ticket;
+	    int			rc;
+
+	    /*
+	     * The objects of pages in the pool are in the list
+	     * as long as we hold its lock.
+	     */
+	    pthread_mutex_lock(&all_pagers.lock);
+	    if (! zpool_oldest(&owner, &offset)) {
+		pthread_mutex_unlock(&all_pagers.lock);
+		break;
+	    }
+	    ds = (default_pager_t) owner;
+	    dstruct_lock(ds);
+	    if (! zpool_peek(ds, offset, buffer, &stamp)) {
+		dstruct_unlock(ds);
+		pthread_mutex_unlock(&all_pagers.lock);
+		continue;
+	    }
+	    ticket = claim_writing(ds);
+	    pager_port_start_write(ds);
+	    dstruct_unlock(ds);
+	    pthread_mutex_unlock(&all_pagers.lock);
+
+	    wait_for_turn(ds, ticket);
+	    rc = default_write(&ds->dpager, buffer, vm_page_size, offset);
+	    end_turn(ds);
+
+	    if (rc == PAGER_SUCCESS) {
+		zpool_forget(ds, offset, stamp);
+		paging_stats.dps_compressed_evictions++;
+	    }
+	    pager_port_finish_write(ds);
+
+	    if (rc != PAGER_SUCCESS)
+		/*
+		 * No room on disk; keep them.
+		 */
+		break;
+	}
+}
+
+/*
+ * Write idle write-behind clusters, and the oldest pages of the
+ * compressed pool when it gets too full.
+ */
+static void *
+flush_thread(void *arg)
+{
+	vm_offset_t	buffer = 0;
+	time_t		last = time(NULL);
+
+	(void) arg;
+
+	default_pager_thread_privileges();
+
+	if (zpool_max != 0
+	    && vm_allocate(default_pager_self, &buffer, vm_page_size, TRUE)
+	       != KERN_SUCCESS)
+		panic(my_name);
+
+	while (1) {
+	    struct timespec	ts;
+
+	    pthread_mutex_lock(&flush_lock);
+	    clock_gettime(CLOCK_REALTIME, &ts);
+	    ts.tv_sec += WRITE_BEHIND_DELAY;
+	    pthread_cond_timedwait(&flush_wakeup, &flush_lock, &ts);
+	    pthread_mutex_unlock(&flush_lock);
+
+	    if (time(NULL) - last >= WRITE_BEHIND_DELAY) {
+		flush_idle_clusters();
+		last = time(NULL);
+	    }
+
+	    if (zpool_max != 0)
+		evict_pages(buffer);
+	}
+
+	return NULL;
+}
+
 /*
  * Initialize and Run the default pager
  */
@@ -3032,6 +3808,7 @@ default_pager(void)
 {
 	error_t err;
 	kern_return_t kr;
+	pthread_t flusher;
 	int i;
 
 	default_pager_thread_privileges();
@@ -3075,6 +3852,19 @@ default_pager(void)
 	if (kr != KERN_SUCCESS)
 		panic(my_name);
 
+	/*
+	 *	Start the thread that writes idle write-behind
+	 *	clusters.
+	 */
+
+	err = pthread_create(&flusher, NULL, flush_thread, NULL);
+	if (!err)
+		pthread_detach (flusher);
+	else {
+		errno = err;
+		perror ("pthread_create");
+	}
+
 	/*
 	 *	Now we create the threads that will actually
 	 *	manage objects.
@@ -3149,6 +3939,19 @@ S_default_pager_info (mach_port_t pager,
 	return KERN_SUCCESS;
 }
 
+kern_return_t
+S_default_pager_paging_stats (mach_port_t pager,
+			      default_pager_paging_stats_t *stats)
+{
+	if (pager != default_pager_default_port)
+		return KERN_INVALID_ARGUMENT;
+
+	*stats = paging_stats;
+	zpool_stats(&stats->dps_compressed_pages,
+		    &stats->dps_compressed_bytes);
+	return KERN_SUCCESS;
+}
+
 kern_return_t
 S_default_pager_storage_info (mach_port_t pager,
 			      vm_size_array_t *size,
@@ -3632,6 +4435,22 @@ S_default_pager_object_set_size (default_pager_t ds,
           ds->dpager.limit = rounded_limit;
 	}
 
+      /* Forget pages waiting to be written past the new end, and
+	 what was read ahead.  */
+      if (ds->wb_buffer != 0 && ds->wb_offset >= rounded_limit)
+	{
+	  (void) vm_deallocate (default_pager_self, ds->wb_buffer,
+				ptoa (CLUSTER_SIZE));
+	  cluster_release (CLUSTER_SIZE);
+	  ds->wb_buffer = 0;
+	  ds->wb_count = 0;
+	}
+      else if (ds->wb_buffer != 0
+	       && ds->wb_offset + ptoa (ds->wb_count) > rounded_limit)
+	ds->wb_count = atop (rounded_limit - ds->wb_offset);
+      drop_readahead (ds);
+      zpool_drop (ds, rounded_limit, ~(vm_offset_t) 0);
+
       /* Deallocate the old backing store pages and shrink the page map.  */
       if (ds->dpager.size > ds->dpager.limit / vm_page_size)
         pager_truncate (&ds->dpager, ds->dpager.limit / vm_page_size);
@@ -50,9 +50,9 @@ struct file_direct
   struct storage_run runs[0];
 };
 
-/* These are in fact only called to read or write a single page, from
-   default_pager.c::default_read/default_write.  The SIZE argument is
-   always vm_page_size and OFFSET is always page-aligned.  */
+/* These are called to read or write a cluster of whole pages, from
+   default_pager.c::default_read/default_write.  OFFSET and SIZE are
+   always page-aligned.  A cluster may span several runs.  */
 
 int page_read_file_direct (struct file_direct *fdp,
 			   vm_offset_t offset,
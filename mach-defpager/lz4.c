@@ -0,0 +1,216 @@
+/* LZ4 block compression for the compressed page pool.
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+/* A block is a series of sequences, each made of a token byte, whose
+   high nibble is the number of literals and low nibble the length of
+   the match less 4, followed by more length bytes if the literal
+   nibble is 15, the literals, the offset of the match back from here
+   in two bytes, little-endian, and more length bytes if the match
+   nibble is 15.  Length bytes are added up, and stop at one below 255.
+   The last sequence has only literals, and the last five bytes of the
+   data are always literals.
+
+   This is a greedy compressor with a single hash table: it finds
+   fewer matches than the reference one, but is as quick.  */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "lz4.h"
+
+#define MIN_MATCH	4
+#define LAST_LITERALS	5	/* The data ends with at least this many.  */
+#define MF_LIMIT	12	/* No match starts in this many last bytes.  */
+
+#define HASH_BITS	12
+
+static inline uint32_t
+hash4 (const unsigned char *p)
+{
+  uint32_t v;
+
+  memcpy (&v, p, sizeof v);
+  return (v * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/* Store the length LEN, less the 15 in the token, at OP; return the
+   next byte.  */
+static inline unsigned char *
+put_length (unsigned char *op, size_t len)
+{
+  for (; len >= 255; len -= 255)
+    *(op++) = 255;
+  *(op++) = len;
+  return op;
+}
+
+/* Store a sequence of the literals from ANCHOR to IP, and then a match
+   at OFFSET of MLEN bytes, if MLEN is not zero, at OP; return the next
+   byte, or 0 if OEND comes first.  */
+static unsigned char *
+put_sequence (unsigned char *op, unsigned char *oend,
+	      const unsigned char *anchor, const unsigned char *ip,
+	      size_t offset, size_t mlen)
+{
+  size_t lit = ip - anchor;
+  unsigned char *token;
+
+  /* Room for the most it can take.  */
+  if ((size_t) (oend - op) < 1 + lit / 255 + 1 + lit + 2 + mlen / 255 + 1)
+    return 0;
+
+  token = op++;
+  if (lit >= 15)
+    {
+      *token = 15 << 4;
+      op = put_length (op, lit - 15);
+    }
+  else
+    *token = lit << 4;
+  memcpy (op, anchor, lit);
+  op += lit;
+
+  if (mlen)
+    {
+      *(op++) = offset & 0xff;
+      *(op++) = offset >> 8;
+      mlen -= MIN_MATCH;
+      if (mlen >= 15)
+	{
+	  *token |= 15;
+	  op = put_length (op, mlen - 15);
+	}
+      else
+	*token |= mlen;
+    }
+
+  return op;
+}
+
+size_t
+lz4_compress (const void *src, size_t len, void *dst, size_t dst_len)
+{
+  const unsigned char *in = src, *ip = in, *anchor = in;
+  const unsigned char *end = in + len;
+  unsigned char *op = dst, *oend = op + dst_len;
+  uint16_t table[1 << HASH_BITS];
+
+  if (len > LZ4_MAX_INPUT)
+    return 0;
+
+  if (len > MF_LIMIT)
+    {
+      const unsigned char *mflimit = end - MF_LIMIT;
+      const unsigned char *matchlimit = end - LAST_LITERALS;
+
+      memset (table, 0, sizeof table);
+
+      while (ip < mflimit)
+	{
+	  const unsigned char *ref, *mp;
+	  uint32_t h = hash4 (ip);
+
+	  ref = in + table[h];
+	  table[h] = ip - in;
+	  if (ref >= ip || memcmp (ref, ip, MIN_MATCH))
+	    {
+	      ip++;
+	      continue;
+	    }
+
+	  for (mp = ip + MIN_MATCH, ref += MIN_MATCH;
+	       mp < matchlimit && *mp == *ref;
+	       mp++, ref++)
+	    ;
+
+	  op = put_sequence (op, oend, anchor, ip, mp - ref, mp - ip);
+	  if (! op)
+	    return 0;
+	  ip = anchor = mp;
+	}
+    }
+
+  op = put_sequence (op, oend, anchor, end, 0, 0);
+  if (! op)
+    return 0;
+  return op - (unsigned char *) dst;
+}
+
+/* Add the length bytes at *IP, before IEND, to *LEN; return -1 if they
+   run past IEND.  */
+static inline int
+get_length (const unsigned char **ip, const unsigned char *iend, size_t *len)
+{
+  unsigned char b;
+
+  do
+    {
+      if (*ip >= iend)
+	return -1;
+      b = *((*ip)++);
+      *len += b;
+    }
+  while (b == 255);
+  return 0;
+}
+
+int
+lz4_decompress (const void *src, size_t len, void *dst, size_t dst_len)
+{
+  const unsigned char *ip = src, *iend = ip + len;
+  unsigned char *op = dst, *oend = op + dst_len;
+
+  while (ip < iend)
+    {
+      unsigned int token = *(ip++);
+      size_t lit = token >> 4, mlen = token & 15, offset;
+      const unsigned char *ref;
+
+      if (lit == 15 && get_length (&ip, iend, &lit))
+	return -1;
+      if (lit > (size_t) (iend - ip) || lit > (size_t) (oend - op))
+	return -1;
+      memcpy (op, ip, lit);
+      op += lit;
+      ip += lit;
+
+      if (ip == iend)
+	/* The last sequence.  */
+	break;
+
+      if (iend - ip < 2)
+	return -1;
+      offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      if (offset == 0 || offset > (size_t) (op - (unsigned char *) dst))
+	return -1;
+
+      if (mlen == 15 && get_length (&ip, iend, &mlen))
+	return -1;
+      mlen += MIN_MATCH;
+      if (mlen > (size_t) (oend - op))
+	return -1;
+
+      /* The match may overlap what it produces.  */
+      for (ref = op - offset; mlen; mlen--)
+	*(op++) = *(ref++);
+    }
+
+  return op == oend ? 0 : -1;
+}
@@ -0,0 +1,37 @@
+/* LZ4 block compression for the compressed page pool.
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+#ifndef _lz4_h
+#define _lz4_h 1
+
+#include <stddef.h>
+
+/* The most bytes lz4_compress takes at once.  */
+#define LZ4_MAX_INPUT	65536
+
+/* Compress the LEN bytes at SRC, at most LZ4_MAX_INPUT, into the
+   DST_LEN bytes at DST, in the LZ4 block format.  Return the size of
+   the result, or 0 if it does not fit.  */
+size_t lz4_compress (const void *src, size_t len, void *dst, size_t dst_len);
+
+/* Decompress the LEN bytes at SRC into exactly DST_LEN bytes at DST.
+   Return 0, or -1 if SRC is not a valid block of that size.  */
+int lz4_decompress (const void *src, size_t len, void *dst, size_t dst_len);
+
+#endif /* _lz4_h */
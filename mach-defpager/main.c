@@ -48,6 +48,7 @@
 /* XXX */
 
 #include "default_pager.h"
+#include "zpool.h"
 
 const char *defpager_server_name = "mach-defpager";
 
@@ -79,12 +80,52 @@ static void
 nohandler (int sig)
 { }
 
+#define USAGE "Usage: %s [-d] [--compressed-pool=SIZE[K|M|G]]"
+
+/* Return the size given by ARG, a number of bytes with an optional
+   unit.  */
+static vm_size_t
+parse_size (const char *arg, const char *prog)
+{
+  char *end;
+  unsigned long long size;
+
+  size = strtoull (arg, &end, 0);
+  switch (*end)
+    {
+    case 'G': case 'g':
+      size <<= 10;
+      /* Fall through.  */
+    case 'M': case 'm':
+      size <<= 10;
+      /* Fall through.  */
+    case 'K': case 'k':
+      size <<= 10;
+      end++;
+      break;
+    }
+  if (end == arg || *end != '\0' || size != (vm_size_t) size)
+    error (1, 0, USAGE, prog);
+
+  return size;
+}
+
 int
 main (int argc, char **argv)
 {
   const task_t my_task = mach_task_self();
   error_t err;
   memory_object_t defpager;
+  int foreground = 0;
+  int i;
+
+  for (i = 1; i < argc; i++)
+    if (!strcmp (argv[i], "-d"))
+      foreground = 1;
+    else if (!strncmp (argv[i], "--compressed-pool=", 18))
+      zpool_max = parse_size (argv[i] + 18, argv[0]);
+    else
+      error (1, 0, USAGE, argv[0]);
 
   err = get_privileged_ports (&bootstrap_master_host_port,
 			      &bootstrap_master_device_port);
@@ -98,7 +139,7 @@ main (int argc, char **argv)
   if (MACH_PORT_VALID (defpager))
     error (2, 0, "Another default memory manager is already running");
 
-  if (!(argc == 2 && !strcmp (argv[1], "-d")))
+  if (!foreground)
     {
       /* We don't use the `daemon' function because we might exit back to the
 	 parent before the daemon has completed vm_set_default_memory_manager.
@@ -177,7 +218,7 @@ main (int argc, char **argv)
 
   default_pager_initialize (bootstrap_master_host_port);
 
-  if (!(argc == 2 && !strcmp (argv[1], "-d")))
+  if (!foreground)
     kill (getppid (), SIGUSR1);
 
   /*
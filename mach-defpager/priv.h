@@ -51,6 +51,11 @@
  * - part->p_lock
  * - all_pagers.lock
  * - dstruct_lock
+ *
+ * (from the flush thread writing out compressed pages)
+ * - all_pagers.lock
+ * - dstruct_lock
+ * - zpool_lock
  */
 
 /*
@@ -80,6 +85,8 @@ struct part {
 	bm_entry_t	*bitmap;	/* allocation map */
 	boolean_t	going_away;	/* destroy attempt in progress */
 	struct file_direct *file;	/* file paged to */
+	vm_size_t	rotor;		/* bitmap entry to look for free
+					   clusters from */
 };
 typedef	struct part	*partition_t;
 
@@ -202,6 +209,37 @@ struct dstruct {
 
 	unsigned int	errors;		/* Pageout error count */
 	struct dpager	dpager;		/* Actual pager */
+
+	/*
+	 * Pages returned by the kernel one at a time are gathered
+	 * here to be written as one cluster: WB_COUNT pages from
+	 * WB_OFFSET on, in WB_BUFFER.  They count as being in the
+	 * object, and are served from here until written.
+	 */
+	vm_offset_t	wb_buffer;
+	vm_offset_t	wb_offset;
+	unsigned int	wb_count;
+	boolean_t	wb_idle;	/* not grown since the last
+					   look by the flush thread */
+	unsigned int	wb_ticket;	/* Pages are written in turn, in
+					   the order of their tickets: */
+	unsigned int	wb_turn;	/* ... this one's turn is now */
+	pthread_cond_t	wb_next_turn;
+
+	/*
+	 * Pages read along with one the kernel asked for: those of
+	 * the RA_SIZE bytes from RA_OFFSET on, in RA_BUFFER, whose
+	 * bits are set in RA_VALID.
+	 */
+	vm_offset_t	ra_buffer;
+	vm_size_t	ra_size;
+	vm_offset_t	ra_offset;
+	unsigned int	ra_valid;
+	vm_offset_t	ra_next;	/* where a sequential pagein
+					   would come next */
+
+	unsigned int	write_count;	/* Bumped when pages are about
+					   to be written */
 };
 typedef struct dstruct *	default_pager_t;
 #define	DEFAULT_PAGER_NULL	((default_pager_t)0)
@@ -85,14 +85,14 @@ S_default_pager_paging_storage_new (mach_port_t pager,
   fdp->fd_size = 0;
   for (i = 0; i < nrun; i += 2)
     {
-      fdp->runs[i].start = runs[i];
-      fdp->runs[i].length = runs[i + 1];
-      if (fdp->runs[i].start + fdp->runs[i].length > devsize)
+      fdp->runs[i / 2].start = runs[i];
+      fdp->runs[i / 2].length = runs[i + 1];
+      if (fdp->runs[i / 2].start + fdp->runs[i / 2].length > devsize)
 	{
 	  free (fdp);
 	  return EINVAL;
 	}
-      fdp->fd_size += fdp->runs[i].length;
+      fdp->fd_size += fdp->runs[i / 2].length;
     }
 
   /* Now really do it.  */
@@ -113,7 +113,19 @@ S_default_pager_paging_storage (mach_port_t pager,
 }
 #endif
 
-/* Called to read a page from backing store.  */
+/* Find the run of FDP containing the record *OFFSET, and return it, with
+   *OFFSET made relative to its start.  */
+static struct storage_run *
+find_run (struct file_direct *fdp, recnum_t *offset)
+{
+  struct storage_run *r;
+
+  for (r = fdp->runs; *offset >= r->length; ++r)
+    *offset -= r->length;
+  return r;
+}
+
+/* Called to read whole pages from backing store.  */
 int
 page_read_file_direct (struct file_direct *fdp,
 		       vm_offset_t offset,
@@ -122,64 +134,64 @@ page_read_file_direct (struct file_direct *fdp,
 		       mach_msg_type_number_t *size_read)	/* out */
 {
   struct storage_run *r;
+  recnum_t rec;
   error_t err;
-  char *readloc;
-  char *page;
-  mach_msg_type_number_t nread;
+  vm_size_t done;
 
   assert_backtrace (page_aligned (offset));
-  assert_backtrace (size == vm_page_size);
+  assert_backtrace (page_aligned (size) && size > 0);
 
-  offset >>= fdp->bshift;
+  rec = offset >> fdp->bshift;
 
-  assert_backtrace (offset + (size >> fdp->bshift) <= fdp->fd_size);
+  assert_backtrace (rec + (size >> fdp->bshift) <= fdp->fd_size);
 
-  /* Find the run containing the beginning of the page.  */
-  for (r = fdp->runs; offset > r->length; ++r)
-    offset -= r->length;
+  r = find_run (fdp, &rec);
 
-  if (offset + (size >> fdp->bshift) <= r->length)
-    /* The first run contains the whole page.  */
-    return device_read (fdp->device, 0, r->start + offset,
+  if (rec + (size >> fdp->bshift) <= r->length)
+    /* The first run contains all of it.  */
+    return device_read (fdp->device, 0, r->start + rec,
 			size, (char **) addr, size_read);
 
-  /* Read the first part of the run.  */
-  err = device_read (fdp->device, 0, r->start + offset,
-		     (r->length - offset) << fdp->bshift,
-		     (char **) addr, &nread);
+  /* Gather the pieces from each run into one buffer.  */
+  err = vm_allocate (mach_task_self (), addr, size, TRUE);
   if (err)
     return err;
 
-  size -= nread;
-  readloc = (char *) *addr;
-  do
+  for (done = 0; done < size; )
     {
-      readloc += nread;
-      offset += nread >> fdp->bshift;
-      if (offset > r->length)
-	offset -= r++->length;
-
-      /* We always get another out-of-line page, so we have to copy
-	 out of that page and deallocate it.  */
-      err = device_read (fdp->device, 0, r->start + offset,
-			 (r->length - offset) << fdp->bshift,
+      char *page;
+      mach_msg_type_number_t nread;
+      vm_size_t segsize = (r->length - rec) << fdp->bshift;
+
+      if (segsize > size - done)
+	segsize = size - done;
+
+      err = device_read (fdp->device, 0, r->start + rec, segsize,
 			 &page, &nread);
+      if (!err && nread == 0)
+	err = EIO;
       if (err)
 	{
-	  vm_deallocate (mach_task_self (),
-			 (vm_address_t) *addr, vm_page_size);
+	  vm_deallocate (mach_task_self (), *addr, size);
 	  return err;
 	}
-      memcpy (readloc, page, nread);
-      vm_deallocate (mach_task_self (), (vm_address_t) page, vm_page_size);
-      size -= nread;
-    } while (size > 0);
+      memcpy ((char *) *addr + done, page, nread);
+      vm_deallocate (mach_task_self (), (vm_address_t) page, nread);
+
+      done += nread;
+      rec += nread >> fdp->bshift;
+      if (rec >= r->length)
+	{
+	  rec = 0;
+	  r++;
+	}
+    }
 
-  *size_read = vm_page_size;
+  *size_read = size;
   return 0;
 }
 
-/* Called to write a page to backing store.  */
+/* Called to write whole pages to backing store.  */
 int
 page_write_file_direct(struct file_direct *fdp,
 		       vm_offset_t offset,
@@ -188,67 +200,57 @@ page_write_file_direct(struct file_direct *fdp,
 		       mach_msg_type_number_t *size_written)	/* out */
 {
   struct storage_run *r;
+  recnum_t rec;
   error_t err;
+  vm_size_t done;
   int wrote;
 
   assert_backtrace (page_aligned (offset));
-  assert_backtrace (size == vm_page_size);
+  assert_backtrace (page_aligned (size) && size > 0);
 
-  offset >>= fdp->bshift;
+  rec = offset >> fdp->bshift;
 
-  assert_backtrace (offset + (size >> fdp->bshift) <= fdp->fd_size);
+  assert_backtrace (rec + (size >> fdp->bshift) <= fdp->fd_size);
 
-  /* Find the run containing the beginning of the page.  */
-  for (r = fdp->runs; offset > r->length; ++r)
-    offset -= r->length;
+  r = find_run (fdp, &rec);
 
-  if (offset + (size >> fdp->bshift) <= r->length)
+  if (rec + (size >> fdp->bshift) <= r->length)
     {
-      /* The first run contains the whole page.  */
-      err = device_write (fdp->device, 0, r->start + offset,
+      /* The first run contains all of it.  */
+      err = device_write (fdp->device, 0, r->start + rec,
 			  (char *) addr, size, &wrote);
       *size_written = wrote;
       return err;
     }
 
-  /* Write the first part of the run.  */
-  err = device_write (fdp->device, 0,
-		      r->start + offset, (char *) addr,
-		      (r->length - offset) << fdp->bshift,
-		      &wrote);
-  if (err)
-    return err;
-
-  size -= wrote;
-  do
+  for (done = 0; done < size; )
     {
-      mach_msg_type_number_t segsize;
-
-      addr += wrote;
-      offset += wrote >> fdp->bshift;
-      if (offset > r->length)
-	offset -= r++->length;
-
-      segsize = (r->length - offset) << fdp->bshift;
-      if (segsize > size)
-	segsize = size;
-      err = device_write (fdp->device, 0, r->start + offset,
-			  (char *) addr, segsize, &wrote);
+      vm_size_t segsize = (r->length - rec) << fdp->bshift;
+
+      if (segsize > size - done)
+	segsize = size - done;
+
+      err = device_write (fdp->device, 0, r->start + rec,
+			  (char *) addr + done, segsize, &wrote);
+      if (!err && wrote == 0)
+	err = EIO;
       if (err)
+	return err;
+
+      done += wrote;
+      rec += wrote >> fdp->bshift;
+      if (rec >= r->length)
 	{
-	  vm_deallocate (mach_task_self (),
-			 (vm_address_t) addr, vm_page_size);
-	  return err;
+	  rec = 0;
+	  r++;
 	}
+    }
 
-      size -= wrote;
-    } while (size > 0);
-
-  *size_written = vm_page_size;
+  *size_written = size;
   return 0;
 }
 
-
+
 /*
  * Destroy a paging_partition given a file name
  */
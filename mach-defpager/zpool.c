@@ -0,0 +1,371 @@
+/* Compressed pool of pages for Hurd version of Mach default pager.
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <hurd/ihash.h>
+
+#include "default_pager.h"
+#include "lz4.h"
+#include "zpool.h"
+
+vm_size_t zpool_max;
+
+/* What a page is found by.  */
+struct zkey
+{
+  void *owner;
+  vm_offset_t offset;
+};
+
+struct zpage
+{
+  struct zkey key;
+  hurd_ihash_locp_t locp;
+
+  /* Links in the list of pages in the pool, newest first.  */
+  struct zpage *next, *prev;
+
+  unsigned long stamp;		/* Tells copies of a page apart.  */
+  size_t len;			/* Of DATA.  */
+  unsigned char data[0];
+};
+
+/* What a page takes in the pool.  */
+#define ZPAGE_SIZE(zp)	(sizeof (struct zpage) + (zp)->len)
+
+/* Once the pool is fuller than HIGH_WATER, the oldest pages are written
+   out until it is down to LOW_WATER.  */
+#define HIGH_WATER	(zpool_max - zpool_max / 8)
+#define LOW_WATER	(zpool_max - zpool_max / 4)
+
+static hurd_ihash_key_t zkey_hash (const void *);
+static int zkey_compare (const void *, const void *);
+
+static struct hurd_ihash zpages =
+  HURD_IHASH_INITIALIZER_GKI (offsetof (struct zpage, locp), NULL, NULL,
+			      zkey_hash, zkey_compare);
+
+static struct zpage *newest, *oldest;
+static vm_size_t zpool_pages, zpool_bytes;
+static unsigned long next_stamp;
+
+/* Whether the oldest pages are being written out.  */
+static boolean_t draining;
+
+static pthread_mutex_t zpool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static hurd_ihash_key_t
+zkey_hash (const void *key)
+{
+  return (hurd_ihash_key_t) hurd_ihash_hash32 (key, sizeof (struct zkey), 0);
+}
+
+static int
+zkey_compare (const void *key1, const void *key2)
+{
+  const struct zkey *k1 = key1, *k2 = key2;
+
+  return k1->owner == k2->owner && k1->offset == k2->offset;
+}
+
+/* Return the page at OFFSET in OWNER, or 0.  ZPOOL_LOCK must be held.  */
+static struct zpage *
+find_page (void *owner, vm_offset_t offset)
+{
+  struct zkey key = { owner, offset };
+
+  return hurd_ihash_find (&zpages, (hurd_ihash_key_t) &key);
+}
+
+/* Unlink ZP from the list of pages.  ZPOOL_LOCK must be held.  */
+static void
+unlink_page (struct zpage *zp)
+{
+  if (zp->prev)
+    zp->prev->next = zp->next;
+  else
+    newest = zp->next;
+  if (zp->next)
+    zp->next->prev = zp->prev;
+  else
+    oldest = zp->prev;
+}
+
+/* Take ZP out of the pool.  ZPOOL_LOCK must be held.  */
+static void
+remove_page (struct zpage *zp)
+{
+  hurd_ihash_locp_remove (&zpages, zp->locp);
+  unlink_page (zp);
+  zpool_pages--;
+  zpool_bytes -= ZPAGE_SIZE (zp);
+}
+
+/* Make ZP, which is in the hash table, the newest page.  ZPOOL_LOCK
+   must be held.  */
+static void
+link_newest (struct zpage *zp)
+{
+  zp->prev = 0;
+  zp->next = newest;
+  if (newest)
+    newest->prev = zp;
+  else
+    oldest = zp;
+  newest = zp;
+}
+
+struct zpage *
+zpool_compress (vm_offset_t page)
+{
+  /* Pages that do not shrink by a quarter are not worth it.  */
+  size_t max = vm_page_size - vm_page_size / 4;
+  unsigned char buf[max];
+  struct zpage *zp;
+  size_t len;
+
+  if (zpool_max == 0)
+    return 0;
+
+  len = lz4_compress ((void *) page, vm_page_size, buf, max);
+  if (len == 0)
+    return 0;
+
+  zp = malloc (sizeof *zp + len);
+  if (! zp)
+    return 0;
+  zp->len = len;
+  memcpy (zp->data, buf, len);
+  return zp;
+}
+
+void
+zpool_discard (struct zpage *zp)
+{
+  free (zp);
+}
+
+error_t
+zpool_insert (void *owner, vm_offset_t offset, struct zpage *zp)
+{
+  struct zpage *old;
+  error_t err = 0;
+
+  zp->key.owner = owner;
+  zp->key.offset = offset;
+
+  pthread_mutex_lock (&zpool_lock);
+
+  old = find_page (owner, offset);
+  if (old)
+    remove_page (old);
+
+  if (zpool_bytes + ZPAGE_SIZE (zp) > zpool_max
+      || hurd_ihash_add (&zpages, (hurd_ihash_key_t) &zp->key, zp))
+    err = ENOSPC;
+  else
+    {
+      zp->stamp = next_stamp++;
+      link_newest (zp);
+      zpool_pages++;
+      zpool_bytes += ZPAGE_SIZE (zp);
+    }
+
+  pthread_mutex_unlock (&zpool_lock);
+
+  free (old);
+  if (err)
+    free (zp);
+  return err;
+}
+
+boolean_t
+zpool_load (void *owner, vm_offset_t offset, vm_offset_t page,
+	    boolean_t remove)
+{
+  struct zpage *zp;
+
+  pthread_mutex_lock (&zpool_lock);
+
+  zp = find_page (owner, offset);
+  if (zp)
+    {
+      if (lz4_decompress (zp->data, zp->len, (void *) page, vm_page_size))
+	panic ("corrupt compressed page at %lx in %p",
+	       (unsigned long) offset, owner);
+
+      if (remove)
+	remove_page (zp);
+      else
+	{
+	  /* Used again, so keep it longer.  */
+	  unlink_page (zp);
+	  link_newest (zp);
+	  zp = 0;
+	}
+      pthread_mutex_unlock (&zpool_lock);
+
+      free (zp);
+      return TRUE;
+    }
+
+  pthread_mutex_unlock (&zpool_lock);
+  return FALSE;
+}
+
+boolean_t
+zpool_peek (void *owner, vm_offset_t offset, vm_offset_t page,
+	    unsigned long *stamp)
+{
+  struct zpage *zp;
+
+  pthread_mutex_lock (&zpool_lock);
+
+  zp = find_page (owner, offset);
+  if (zp)
+    {
+      if (lz4_decompress (zp->data, zp->len, (void *) page, vm_page_size))
+	panic ("corrupt compressed page at %lx in %p",
+	       (unsigned long) offset, owner);
+      *stamp = zp->stamp;
+    }
+
+  pthread_mutex_unlock (&zpool_lock);
+
+  return zp != 0;
+}
+
+void
+zpool_forget (void *owner, vm_offset_t offset, unsigned long stamp)
+{
+  struct zpage *zp;
+
+  pthread_mutex_lock (&zpool_lock);
+
+  zp = find_page (owner, offset);
+  if (zp && zp->stamp == stamp)
+    remove_page (zp);
+  else
+    zp = 0;
+
+  pthread_mutex_unlock (&zpool_lock);
+
+  free (zp);
+}
+
+boolean_t
+zpool_has (void *owner, vm_offset_t offset)
+{
+  boolean_t has;
+
+  pthread_mutex_lock (&zpool_lock);
+  has = find_page (owner, offset) != 0;
+  pthread_mutex_unlock (&zpool_lock);
+
+  return has;
+}
+
+void
+zpool_drop (void *owner, vm_offset_t start, vm_offset_t end)
+{
+  struct zpage *zp, *next, *dead = 0;
+
+  if (zpool_max == 0)
+    return;
+
+  pthread_mutex_lock (&zpool_lock);
+
+  if (end - start < zpool_pages * vm_page_size)
+    /* Look the pages up.  */
+    for (; start < end; start += vm_page_size)
+      {
+	zp = find_page (owner, start);
+	if (zp)
+	  {
+	    remove_page (zp);
+	    zp->next = dead;
+	    dead = zp;
+	  }
+      }
+  else
+    /* Fewer pages in the pool than in the range.  */
+    for (zp = newest; zp; zp = next)
+      {
+	next = zp->next;
+	if (zp->key.owner == owner
+	    && zp->key.offset >= start && zp->key.offset < end)
+	  {
+	    remove_page (zp);
+	    zp->next = dead;
+	    dead = zp;
+	  }
+      }
+
+  pthread_mutex_unlock (&zpool_lock);
+
+  for (zp = dead; zp; zp = next)
+    {
+      next = zp->next;
+      free (zp);
+    }
+}
+
+boolean_t
+zpool_oldest (void **owner, vm_offset_t *offset)
+{
+  boolean_t found;
+
+  pthread_mutex_lock (&zpool_lock);
+
+  if (zpool_bytes > HIGH_WATER)
+    draining = TRUE;
+  else if (zpool_bytes <= LOW_WATER)
+    draining = FALSE;
+
+  found = draining && oldest;
+  if (found)
+    {
+      *owner = oldest->key.owner;
+      *offset = oldest->key.offset;
+    }
+
+  pthread_mutex_unlock (&zpool_lock);
+
+  return found;
+}
+
+boolean_t
+zpool_too_full (void)
+{
+  return zpool_max != 0 && zpool_bytes > HIGH_WATER;
+}
+
+void
+zpool_stats (vm_size_t *pages, vm_size_t *bytes)
+{
+  pthread_mutex_lock (&zpool_lock);
+  *pages = zpool_pages;
+  *bytes = zpool_bytes;
+  pthread_mutex_unlock (&zpool_lock);
+}
@@ -0,0 +1,84 @@
+/* Compressed pool of pages for Hurd version of Mach default pager.
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA. */
+
+#ifndef _zpool_h
+#define _zpool_h 1
+
+/* Pages paged out are kept here compressed, as long as there is room,
+   instead of being written to a paging partition; the oldest ones are
+   written out to make room.  A page is found by the object it belongs
+   to, its OWNER, and its offset in it.  */
+
+#include <mach.h>
+#include <errno.h>
+
+/* A compressed page.  */
+struct zpage;
+
+/* Most bytes the pool may take; 0 if there is no pool.  */
+extern vm_size_t zpool_max;
+
+/* Return the page at PAGE compressed, or 0 if it does not compress well
+   enough to be worth keeping, or there is no pool.  */
+struct zpage *zpool_compress (vm_offset_t page);
+
+/* Free ZP, which is not in the pool.  */
+void zpool_discard (struct zpage *zp);
+
+/* Make ZP the page at OFFSET in OWNER, replacing any it had, and return
+   0; or, if there is no room, free ZP, drop the page OWNER had there,
+   and return ENOSPC.  */
+error_t zpool_insert (void *owner, vm_offset_t offset, struct zpage *zp);
+
+/* If the pool has the page at OFFSET in OWNER, decompress it to PAGE,
+   and take it out of the pool if REMOVE is true.  Return whether it
+   had it.  */
+boolean_t zpool_load (void *owner, vm_offset_t offset, vm_offset_t page,
+		      boolean_t remove);
+
+/* If the pool has the page at OFFSET in OWNER, decompress it to PAGE,
+   return in *STAMP what tells this copy of it from later ones, and
+   return true; otherwise return false.  */
+boolean_t zpool_peek (void *owner, vm_offset_t offset, vm_offset_t page,
+		      unsigned long *stamp);
+
+/* Take the page at OFFSET in OWNER out of the pool if it is still the
+   copy zpool_peek returned STAMP for.  */
+void zpool_forget (void *owner, vm_offset_t offset, unsigned long stamp);
+
+/* Return whether the pool has the page at OFFSET in OWNER.  */
+boolean_t zpool_has (void *owner, vm_offset_t offset);
+
+/* Take the pages of OWNER from START, up to END, out of the pool.  */
+void zpool_drop (void *owner, vm_offset_t start, vm_offset_t end);
+
+/* Return in *OWNER and *OFFSET the page that has been in the pool the
+   longest, if the pool is fuller than it should be; otherwise, return
+   false.  Once the pool gets too full, this goes on until it is down
+   to a comfortable size.  */
+boolean_t zpool_oldest (void **owner, vm_offset_t *offset);
+
+/* Return whether the pool is full enough that the oldest pages should
+   be written out.  */
+boolean_t zpool_too_full (void);
+
+/* Return how many pages the pool has, and how many bytes they take.  */
+void zpool_stats (vm_size_t *pages, vm_size_t *bytes);
+
+#endif /* _zpool_h */
@@ -84,6 +84,13 @@ lookup_fhandle (struct fhandle *handle, struct node **npp)
   nn->dtrans = NOT_POSSIBLE;
   nn->dead_dir = 0;
   nn->dead_name = 0;
+  nn->ra_data = 0;
+  nn->ra_len = 0;
+  nn->next_read = 0;
+  nn->unstable = 0;
+  nn->unstable_len = 0;
+  nn->next_dirty = 0;
+  nn->lookup_entries = 0;
   
   hurd_ihash_add (&nodehash, (hurd_ihash_key_t) &nn->handle, np);
   netfs_nref_light (np);
@@ -120,6 +127,10 @@ forked_node_delete (void *arg)
 void
 netfs_node_norefs (struct node *np)
 {
+  /* There's no uncommitted data, as that holds a reference.  */
+  free (np->nn->ra_data);
+  np->nn->ra_data = 0;
+
   if (np->nn->dead_dir)
     {
       struct fnd *args;
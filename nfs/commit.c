@@ -0,0 +1,272 @@
+/* Committing data written UNSTABLE (NFSv3)
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+/* A server may answer an UNSTABLE write before the data is on disk,
+   which saves it a disk write per RPC; the data is made safe by a later
+   COMMIT covering many writes.  Until then, we keep a copy of it: if the
+   server has rebooted in between, as a changed write verifier shows,
+   the data may be gone and is written again.  */
+
+#include "nfs.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+
+/* How many seconds data may stay uncommitted, at most.  */
+#define COMMIT_DELAY 5
+
+/* A copy of data written UNSTABLE.  A node's list of them is newest
+   first.  */
+struct unstable_write
+{
+  struct unstable_write *next;
+  off_t offset;
+  size_t len;
+  char data[0];
+};
+
+/* The nodes with uncommitted data, oldest first, linked by their
+   NEXT_DIRTY fields.  Each one holds a reference on the node.
+   DIRTY_NODES_COND is signalled when the list becomes nonempty.  */
+static struct node *dirty_nodes;
+static pthread_mutex_t dirty_nodes_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dirty_nodes_cond = PTHREAD_COND_INITIALIZER;
+
+/* Reverse the list of writes LIST, and return the new head.  */
+static struct unstable_write *
+reverse_writes (struct unstable_write *list)
+{
+  struct unstable_write *w, *next, *rev = 0;
+
+  for (w = list; w; w = next)
+    {
+      next = w->next;
+      w->next = rev;
+      rev = w;
+    }
+  return rev;
+}
+
+/* The server has taken the LEN bytes DATA at OFFSET in NP as UNSTABLE,
+   giving back the write verifier VERF; keep a copy of them until they
+   have been committed.  NP must be locked.  */
+error_t
+note_unstable_write (struct node *np, off_t offset, size_t len,
+		     const void *data, const char *verf)
+{
+  struct netnode *nn = np->nn;
+  struct unstable_write *w;
+
+  w = malloc (sizeof *w + len);
+  if (! w)
+    return ENOMEM;
+  w->offset = offset;
+  w->len = len;
+  memcpy (w->data, data, len);
+
+  if (nn->unstable)
+    {
+      if (memcmp (nn->write_verf, verf, NFS3_WRITEVERFSIZE))
+	nn->verf_changed = 1;
+    }
+  else
+    {
+      struct node **npp;
+
+      memcpy (nn->write_verf, verf, NFS3_WRITEVERFSIZE);
+      nn->verf_changed = 0;
+      nn->unstable_stamp = mapped_time->seconds;
+
+      netfs_nref (np);
+      pthread_mutex_lock (&dirty_nodes_lock);
+      for (npp = &dirty_nodes; *npp; npp = &(*npp)->nn->next_dirty)
+	;
+      nn->next_dirty = 0;
+      *npp = np;
+      pthread_cond_signal (&dirty_nodes_cond);
+      pthread_mutex_unlock (&dirty_nodes_lock);
+    }
+
+  w->next = nn->unstable;
+  nn->unstable = w;
+  nn->unstable_len += len;
+
+  return 0;
+}
+
+/* Have the server commit what has been written UNSTABLE to NP, writing
+   it again if the server may have lost it.  NP must be locked, and the
+   caller must hold a reference on it besides the one the list of dirty
+   nodes has.  */
+error_t
+commit_node (struct iouser *cred, struct node *np)
+{
+  struct netnode *nn = np->nn;
+  struct unstable_write *w, *next;
+  struct node **npp;
+  int *p;
+  void *rpcbuf;
+  int same = 0;
+  error_t err;
+
+  if (! nn->unstable)
+    return 0;
+
+  p = nfs_initialize_rpc (NFS3PROC_COMMIT, cred, 0, &rpcbuf, np, -1);
+  if (! p)
+    return errno;
+
+  p = xdr_encode_fhandle (p, &nn->handle);
+  p = xdr_encode_64bit (p, 0);
+  *(p++) = 0;			/* All of the file.  */
+
+  err = conduct_rpc (&rpcbuf, &p);
+  if (!err)
+    {
+      err = nfs_error_trans (ntohl (*p));
+      p++;
+      p = process_wcc_stat (np, p, 0);
+      if (!err)
+	same = (!nn->verf_changed
+		&& memcmp (p, nn->write_verf, NFS3_WRITEVERFSIZE) == 0);
+    }
+  free (rpcbuf);
+
+  if (err)
+    return err;
+
+  if (! same)
+    /* The server rebooted since some of the data was written; write all
+       of it again, this time synchronously, and oldest first, so that
+       where writes overlap, the last one wins.  */
+    {
+      nn->unstable = reverse_writes (nn->unstable);
+      for (w = nn->unstable; w && !err; w = w->next)
+	{
+	  size_t len = w->len;
+
+	  err = write_data (cred, np, w->offset, &len, w->data, FILE_SYNC);
+	  if (!err && len < w->len)
+	    err = EIO;
+	}
+      nn->unstable = reverse_writes (nn->unstable);
+
+      if (err)
+	return err;
+    }
+
+  for (w = nn->unstable; w; w = next)
+    {
+      next = w->next;
+      free (w);
+    }
+  nn->unstable = 0;
+  nn->unstable_len = 0;
+
+  pthread_mutex_lock (&dirty_nodes_lock);
+  for (npp = &dirty_nodes; *npp; npp = &(*npp)->nn->next_dirty)
+    if (*npp == np)
+      {
+	*npp = nn->next_dirty;
+	break;
+      }
+  pthread_mutex_unlock (&dirty_nodes_lock);
+
+  /* The caller's reference keeps NP alive.  */
+  netfs_nrele (np);
+
+  return 0;
+}
+
+/* Commit every node with uncommitted data.  */
+error_t
+commit_all (void)
+{
+  struct node **nodes, *np;
+  size_t num = 0, i;
+  error_t err = 0;
+
+  pthread_mutex_lock (&dirty_nodes_lock);
+  for (np = dirty_nodes; np; np = np->nn->next_dirty)
+    num++;
+  nodes = alloca (num * sizeof *nodes);
+  for (i = 0, np = dirty_nodes; np; np = np->nn->next_dirty)
+    {
+      netfs_nref (np);
+      nodes[i++] = np;
+    }
+  pthread_mutex_unlock (&dirty_nodes_lock);
+
+  for (i = 0; i < num; i++)
+    {
+      error_t e;
+
+      pthread_mutex_lock (&nodes[i]->lock);
+      e = commit_node ((struct iouser *) -1, nodes[i]);
+      if (e && !err)
+	err = e;
+      netfs_nput (nodes[i]);
+    }
+
+  return err;
+}
+
+/* Dedicated thread to commit data that has been left uncommitted for
+   too long.  It is only started when NFSv3 is used, and sleeps while
+   there is nothing to commit.  */
+void *
+commit_thread (void *arg)
+{
+  (void) arg;
+
+  while (1)
+    {
+      struct node *np;
+      error_t err;
+
+      /* Find a node whose data has waited long enough.  */
+      pthread_mutex_lock (&dirty_nodes_lock);
+      while (! dirty_nodes)
+	pthread_cond_wait (&dirty_nodes_cond, &dirty_nodes_lock);
+      for (np = dirty_nodes; np; np = np->nn->next_dirty)
+	if (mapped_time->seconds - np->nn->unstable_stamp >= COMMIT_DELAY)
+	  break;
+      if (np)
+	netfs_nref (np);
+      pthread_mutex_unlock (&dirty_nodes_lock);
+
+      if (! np)
+	{
+	  sleep (1);
+	  continue;
+	}
+
+      pthread_mutex_lock (&np->lock);
+      err = commit_node ((struct iouser *) -1, np);
+      if (err)
+	/* Try again later.  */
+	np->nn->unstable_stamp = mapped_time->seconds;
+      netfs_nput (np);
+    }
+
+  return NULL;
+}
@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <device/device.h>
 #include "nfs.h"
+#include "mount.h"
 #include <netinet/in.h>
 #include <unistd.h>
 #include <string.h>
@@ -56,12 +57,24 @@ extern char *localhost (void);
 /* Default number of seconds to timeout cache negative dir hits. */
 #define DEFAULT_NAME_CACHE_NEG_TIMEOUT 3
 
+/* Default maximum number of dir cache entries. */
+#define DEFAULT_NAME_CACHE_SIZE 4096
+
 /* Default maximum number of bytes to read at once. */
 #define DEFAULT_READ_SIZE     8192
 
 /* Default maximum number of bytes to write at once. */
 #define DEFAULT_WRITE_SIZE    8192
 
+/* Default maximum number of READ or WRITE RPCs outstanding at once. */
+#define DEFAULT_RPC_WINDOW    8
+
+/* Default number of bytes to read ahead of sequential readers. */
+#define DEFAULT_READ_AHEAD    32768
+
+/* Default number of bytes to write UNSTABLE to a file before a COMMIT. */
+#define DEFAULT_COMMIT_SIZE   (1024 * 1024)
+
 
 /* Number of seconds to timeout cached stat information. */
 int stat_timeout = DEFAULT_STAT_TIMEOUT;
@@ -75,6 +88,9 @@ int name_cache_timeout = DEFAULT_NAME_CACHE_TIMEOUT;
 /* Number of seconds to timeout cached negative dir hits. */
 int name_cache_neg_timeout = DEFAULT_NAME_CACHE_NEG_TIMEOUT;
 
+/* Maximum number of dir cache entries. */
+int name_cache_size = DEFAULT_NAME_CACHE_SIZE;
+
 /* Number of seconds to wait for first retransmission of an RPC. */
 int initial_transmit_timeout = 1;
 
@@ -92,6 +108,15 @@ int read_size = DEFAULT_READ_SIZE;
 
 /* Maximum number of bytes to write at once. */
 int write_size = DEFAULT_WRITE_SIZE;
+
+/* Maximum number of READ or WRITE RPCs outstanding for one request. */
+int rpc_window = DEFAULT_RPC_WINDOW;
+
+/* Number of bytes to read ahead of sequential readers. */
+int read_ahead = DEFAULT_READ_AHEAD;
+
+/* Number of bytes to write UNSTABLE to a file before committing it. */
+int commit_size = DEFAULT_COMMIT_SIZE;
 
 #define OPT_SOFT	's'
 #define OPT_HARD	'h'
@@ -111,6 +136,12 @@ int write_size = DEFAULT_WRITE_SIZE;
 #define OPT_PMAP_PORT	-13
 #define OPT_NCACHE_TO	-14
 #define OPT_NCACHE_NEG_TO -15
+#define OPT_NCACHE_SIZE	-16
+#define OPT_NCACHE_STATS -17
+#define OPT_RPC_WINDOW	-18
+#define OPT_READ_AHEAD	-19
+#define OPT_COMMIT_SIZE	-20
+#define OPT_NFS_VERS	-21
 
 /* Return a string corresponding to the printed rep of DEFAULT_what */
 #define ___D(what) #what
@@ -136,6 +167,12 @@ static const struct argp_option common_options[] =
   {"write-size",	    OPT_WSIZE,	   "BYTES", 0,
      "Max packet size for writes (default " _D(WRITE_SIZE)")"},
   {"wsize",0,0,OPTION_ALIAS},
+  {"rpc-window",	    OPT_RPC_WINDOW, "RPCS", 0,
+     "Max reads or writes outstanding for one request (default "
+      _D(RPC_WINDOW) ")"},
+  {"commit-size",	    OPT_COMMIT_SIZE, "BYTES", 0,
+     "With NFSv3, write this much to a file unstably before committing it;"
+     " 0 to always write synchronously (default " _D(COMMIT_SIZE) ")"},
 
   {0,0,0,0,"Timeouts:",3},
   {"stat-timeout",	    OPT_STAT_TO,   "SEC", 0,
@@ -151,6 +188,16 @@ static const struct argp_option common_options[] =
   {"init-transmit-timeout", OPT_INIT_TR_TO,"SEC", 0}, 
   {"max-transmit-timeout",  OPT_MAX_TR_TO, "SEC", 0}, 
 
+  {0,0,0,0,"Caching:",4},
+  {"name-cache-size",	    OPT_NCACHE_SIZE, "ENTRIES", 0,
+     "Maximum number of directory cache entries (default "
+      _D(NAME_CACHE_SIZE) ")"},
+  {"read-ahead",	    OPT_READ_AHEAD, "BYTES", 0,
+     "Bytes to read ahead of sequential readers (default "
+      _D(READ_AHEAD) ")"},
+  /* Reported by fsysopts as POS/NEG/MISS, ignored when set.  */
+  {"name-cache-stats",	    OPT_NCACHE_STATS, "STATS", OPTION_HIDDEN},
+
   {0}
 };
 
@@ -170,6 +217,8 @@ parse_common_opt (int key, char *arg, struct argp_state *state)
 
     case OPT_RSIZE: read_size = atoi (arg); break;
     case OPT_WSIZE: write_size = atoi (arg); break;
+    case OPT_RPC_WINDOW: rpc_window = atoi (arg); break;
+    case OPT_COMMIT_SIZE: commit_size = atoi (arg); break;
 
     case OPT_STAT_TO: stat_timeout = atoi (arg); break;
     case OPT_CACHE_TO: cache_timeout = atoi (arg); break;
@@ -177,6 +226,9 @@ parse_common_opt (int key, char *arg, struct argp_state *state)
     case OPT_MAX_TR_TO: max_transmit_timeout = atoi (arg); break;
     case OPT_NCACHE_TO: name_cache_timeout = atoi (arg); break;
     case OPT_NCACHE_NEG_TO: name_cache_neg_timeout = atoi (arg); break;
+    case OPT_NCACHE_SIZE: name_cache_size = atoi (arg); break;
+    case OPT_READ_AHEAD: read_ahead = atoi (arg); break;
+    case OPT_NCACHE_STATS: break;
 
     default:
       return ARGP_ERR_UNKNOWN;
@@ -198,6 +250,8 @@ static const struct argp_option startup_options[] = {
   {"default-nfs-port",      OPT_NFS_PORT_D,"PORT", 0,
      "Port for nfs operations, if none can be found automatically"},
   {"nfs-program",           OPT_NFS_PROG,  "ID[.VERS]"},
+  {"nfs-version",           OPT_NFS_VERS,  "VERS", 0,
+     "Speak version VERS (2 or 3) of the NFS protocol (default 2)"},
 
   {"pmap-port",             OPT_PMAP_PORT,  "SVC|PORT"},
 
@@ -245,8 +299,13 @@ netfs_append_args (char **argz, size_t *argz_len)
   else
     err = argz_add (argz, argz_len, "--hard");
 
+  if (protocol_version != 2)
+    FOPT ("--nfs-version=%d", protocol_version);
+
   FOPT ("--read-size=%d", read_size);
   FOPT ("--write-size=%d", write_size);
+  FOPT ("--rpc-window=%d", rpc_window);
+  FOPT ("--commit-size=%d", commit_size);
 
   FOPT ("--stat-timeout=%d", stat_timeout);
   FOPT ("--cache-timeout=%d", cache_timeout);
@@ -254,6 +313,11 @@ netfs_append_args (char **argz, size_t *argz_len)
   FOPT ("--max-transmit-timeout=%d", max_transmit_timeout);
   FOPT ("--name-cache-timeout=%d", name_cache_timeout);
   FOPT ("--name-cache-neg-timeout=%d", name_cache_neg_timeout);
+  FOPT ("--name-cache-size=%d", name_cache_size);
+  FOPT ("--read-ahead=%d", read_ahead);
+
+  if (! err)
+    err = append_lookup_cache_stats (argz, argz_len);
 
   if (! err)
     err = netfs_append_std_options (argz, argz_len);
@@ -338,6 +402,24 @@ parse_startup_opt (int key, char *arg, struct argp_state *state)
       nfs_port = atoi (arg);
       break;
 
+    case OPT_NFS_VERS:
+      switch (atoi (arg))
+	{
+	case 2:
+	  protocol_version = 2;
+	  nfs_version = NFS_VERSION;
+	  mount_version = MOUNTVERS;
+	  break;
+	case 3:
+	  protocol_version = 3;
+	  nfs_version = NFS3_VERSION;
+	  mount_version = MOUNTVERS3;
+	  break;
+	default:
+	  argp_error (state, "%s: Unsupported NFS version", arg);
+	}
+      break;
+
     case ARGP_KEY_ARG:
       if (state->arg_num == 0)
 	remote_fs = arg;
@@ -431,6 +513,19 @@ main (int argc, char **argv)
 
   if (!netfs_root_node)
     exit (1);
+
+  /* Only NFSv3 writes data UNSTABLE, to be committed later.  */
+  if (protocol_version == 3)
+    {
+      err = pthread_create (&thread, NULL, commit_thread, NULL);
+      if (!err)
+	pthread_detach (thread);
+      else
+	{
+	  errno = err;
+	  perror ("pthread_create");
+	}
+    }
   
   netfs_startup (bootstrap, 0);
   
@@ -87,7 +87,7 @@ pmap_initialize_rpc (int procnum, void **buf)
 static int *
 mount_initialize_rpc (int procnum, void **buf)
 {
-  return initialize_rpc (MOUNTPROG, MOUNTVERS, procnum, 0, buf, 0, 0, -1);
+  return initialize_rpc (MOUNTPROG, mount_version, procnum, 0, buf, 0, 0, -1);
 }
 
 /* Using the mount protocol, lookup NAME at host HOST.
@@ -158,7 +158,7 @@ mount_root (char *name, char *host)
 	}
 
       *(p++) = htonl (MOUNTPROG);
-      *(p++) = htonl (MOUNTVERS);
+      *(p++) = htonl (mount_version);
       *(p++) = htonl (IPPROTO_UDP);
       *(p++) = htonl (0);
       err = conduct_rpc (&rpcbuf, &p);
@@ -212,7 +212,9 @@ mount_root (char *name, char *host)
       goto error_with_rpcbuf;
     }
 
-  /* Create the node for root */
+  /* Create the node for root.  A version 3 reply also lists the
+     authentication flavors the server accepts; AUTH_UNIX is the only
+     one we speak, so that list is ignored.  */
   xdr_decode_fhandle (p, &np);
   free (rpcbuf);
   pthread_mutex_unlock (&np->lock);
@@ -237,7 +239,7 @@ mount_root (char *name, char *host)
 	  goto error_with_rpcbuf;
 	}
       *(p++) = htonl (NFS_PROGRAM);
-      *(p++) = htonl (NFS_VERSION);
+      *(p++) = htonl (nfs_version);
       *(p++) = htonl (IPPROTO_UDP);
       *(p++) = htonl (0);
       err = conduct_rpc (&rpcbuf, &p);
@@ -1,6 +1,6 @@
 /* Directory name lookup caching
 
-   Copyright (C) 1996, 1997 Free Software Foundation, Inc.
+   Copyright (C) 1996, 1997, 2026 Free Software Foundation, Inc.
    Written by Thomas Bushnell, n/BSG, & Miles Bader.
 
    This file is part of the GNU Hurd.
@@ -21,45 +21,66 @@
 
 #include "nfs.h"
 #include <string.h>
-#include <cacheq.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <argz.h>
+#include <hurd/ihash.h>
 
-
-/* Maximum number of names to cache at any given time */
-#define MAXCACHE 200
 
 /* Maximum length of file name we bother caching */
 #define CACHE_NAME_LEN 100
 
+/* What a cache entry is found by.  */
+struct lookup_key
+{
+  const char *dir;		/* File handle of the directory.  */
+  size_t dir_len;
+  const char *name;		/* Name in the directory.  */
+  size_t name_len;
+};
+
 /* Cache entry */
 struct lookup_cache
 {
-  struct cacheq_hdr hdr;
+  /* Pointing into this entry itself.  */
+  struct lookup_key key;
+
+  hurd_ihash_locp_t locp;
+
+  /* Links in the LRU list.  */
+  struct lookup_cache *next, *prev;
+
+  /* Links in the list of the entries for NP.  */
+  struct lookup_cache *node_next, **node_prevp;
 
-  /* File handles and lengths for cache entries.  0 for NODE_CACHE_LEN
-     means a  */
+  /* File handle of the directory DIR_CACHE_FH.  */
   char dir_cache_fh[NFS3_FHSIZE];
-  size_t dir_cache_len;
 
   /* Zero means a `negative' entry -- recording that there's
      definitely no node with this name.  */
   struct node *np;
 
-  /* Name of the node NODE_CACHE_ID in the directory DIR_CACHE_ID.  Entries
-     with names too long to fit in this buffer aren't cached at all.  */
-  char name[CACHE_NAME_LEN];
-
-  /* Strlen of NAME.  If this is zero, it's an unused entry. */
-  size_t name_len;
+  /* The modification time of the directory when this entry was made.
+     Once the directory is seen to have changed, the entry is stale.  */
+  struct timespec dir_mtime;
 
   /* Time that this cache entry was created.  */
   time_t cache_stamp;
 
-  /* XXX */
-  int stati;
+  /* Name of the node NP in the directory.  */
+  char name[CACHE_NAME_LEN];
 };
 
-/* The contents of the cache in no particular order */
-static struct cacheq lookup_cache = { sizeof (struct lookup_cache) };
+static hurd_ihash_key_t lookup_cache_hash (const void *);
+static int lookup_cache_compare (const void *, const void *);
+
+/* The contents of the cache, by directory and name.  */
+static struct hurd_ihash lookup_cache =
+  HURD_IHASH_INITIALIZER_GKI (offsetof (struct lookup_cache, locp), NULL,
+			      NULL, lookup_cache_hash, lookup_cache_compare);
+
+/* The contents of the cache, most recently used first.  */
+static struct lookup_cache *lookup_cache_mru, *lookup_cache_lru;
 
 static pthread_spinlock_t cache_lock = PTHREAD_SPINLOCK_INITIALIZER;
 
@@ -72,172 +93,232 @@ static struct stats
   long fetch_errors;
 } statistics;
 
-#define PARTIAL_THRESH 100
-#define NPARTIALS (MAXCACHE / PARTIAL_THRESH)
-struct stats partial_stats [NPARTIALS];
 
-
+static hurd_ihash_key_t
+lookup_cache_hash (const void *key)
+{
+  const struct lookup_key *k = key;
+  uint32_t h = hurd_ihash_hash32 (k->dir, k->dir_len, 0);
+
+  return (hurd_ihash_key_t) hurd_ihash_hash32 (k->name, k->name_len, h);
+}
+
+static int
+lookup_cache_compare (const void *key1, const void *key2)
+{
+  const struct lookup_key *k1 = key1, *k2 = key2;
+
+  return (k1->name_len == k2->name_len
+	  && k1->dir_len == k2->dir_len
+	  && memcmp (k1->name, k2->name, k1->name_len) == 0
+	  && memcmp (k1->dir, k2->dir, k1->dir_len) == 0);
+}
+
+/* Unlink C from the LRU list.  CACHE_LOCK must be held.  */
+static void
+unlink_lru (struct lookup_cache *c)
+{
+  if (c->prev)
+    c->prev->next = c->next;
+  else
+    lookup_cache_mru = c->next;
+  if (c->next)
+    c->next->prev = c->prev;
+  else
+    lookup_cache_lru = c->prev;
+}
+
+/* Make C the most recently used entry.  CACHE_LOCK must be held.  */
+static void
+make_mru (struct lookup_cache *c)
+{
+  if (lookup_cache_mru == c)
+    return;
+  if (c->prev || c->next || lookup_cache_lru == c)
+    unlink_lru (c);
+  c->prev = 0;
+  c->next = lookup_cache_mru;
+  if (c->next)
+    c->next->prev = c;
+  else
+    lookup_cache_lru = c;
+  lookup_cache_mru = c;
+}
+
+/* Remove C from the cache, and return it for freeing once CACHE_LOCK,
+   which must be held, is released.  */
+static struct lookup_cache *
+drop_entry (struct lookup_cache *c)
+{
+  hurd_ihash_locp_remove (&lookup_cache, c->locp);
+  unlink_lru (c);
+  if (c->np)
+    {
+      *c->node_prevp = c->node_next;
+      if (c->node_next)
+	c->node_next->node_prevp = c->node_prevp;
+    }
+  return c;
+}
+
+/* Free the entries in the list LIST, linked by their NEXT fields, which
+   have been removed from the cache.  CACHE_LOCK must not be held, as
+   dropping a node reference might need it.  */
+static void
+free_entries (struct lookup_cache *list)
+{
+  struct lookup_cache *c, *next;
+
+  for (c = list; c; c = next)
+    {
+      next = c->next;
+      if (c->np)
+	netfs_nrele (c->np);
+      free (c);
+    }
+}
+
 /* If there's an entry for NAME, of length NAME_LEN, in directory DIR in the
    cache, return its entry, otherwise 0.  CACHE_LOCK must be held.  */
 static struct lookup_cache *
-find_cache (char *dir, size_t len, const char *name, size_t name_len)
+find_cache (const char *dir, size_t len, const char *name, size_t name_len)
 {
-  struct lookup_cache *c;
-  int i;
-
-  /* Search the list.  All unused entries are contiguous at the end of the
-     list, so we can stop searching when we see the first one.  */
-  for (i = 0, c = lookup_cache.mru; 
-       c && c->name_len; 
-       c = c->hdr.next, i++)
-    if (c->name_len == name_len
-	&& c->dir_cache_len == len
-	&& c->name[0] == name[0] 
-	&& memcmp (c->dir_cache_fh, dir, len) == 0
-	&& strcmp (c->name, name) == 0)
-      {
-	c->stati = i / PARTIAL_THRESH;
-	return c;
-      }
-  
-  return 0;
+  struct lookup_key key = { dir, len, name, name_len };
+
+  return hurd_ihash_find (&lookup_cache, (hurd_ihash_key_t) &key);
 }
-
+
 /* Node NP has just been found in DIR with NAME.  If NP is null, this
    name has been confirmed as absent in the directory.  DIR is the
-   fhandle of the directory and LEN is its length.  */
+   fhandle of the directory and LEN is its length, and DIR_MTIME its
+   modification time as last seen.  */
 void
-enter_lookup_cache (char *dir, size_t len, struct node *np, const char *name)
+enter_lookup_cache (char *dir, size_t len, struct timespec dir_mtime,
+		    struct node *np, const char *name)
 {
-  struct lookup_cache *c;
+  struct lookup_cache *c, *old, *dead = 0;
   size_t name_len = strlen (name);
-  
-  if (name_len > CACHE_NAME_LEN - 1)
-    return;
 
-  pthread_spin_lock (&cache_lock);
-
-  if (lookup_cache.length == 0)
-    /* There should always be an lru_cache; this being zero means that the
-       cache hasn't been initialized yet.  Do so.  */
-    cacheq_set_length (&lookup_cache, MAXCACHE);
+  if (name_len > CACHE_NAME_LEN - 1 || name_cache_size <= 0)
+    return;
 
-  /* See if there's an old entry for NAME in DIR.  If not, replace the least
-     recently used entry.  */
-  c = find_cache (dir, len, name, name_len) ?: lookup_cache.lru;
+  c = malloc (sizeof *c);
+  if (! c)
+    return;
 
   /* Fill C with the new entry.  */
   memcpy (c->dir_cache_fh, dir, len);
-  c->dir_cache_len = len;
-  if (c->np)
-    netfs_nrele (c->np);
+  strcpy (c->name, name);
+  c->key.dir = c->dir_cache_fh;
+  c->key.dir_len = len;
+  c->key.name = c->name;
+  c->key.name_len = name_len;
   c->np = np;
   if (c->np)
     netfs_nref (c->np);
-  strcpy (c->name, name);
-  c->name_len = name_len;
+  c->dir_mtime = dir_mtime;
   c->cache_stamp = mapped_time->seconds;
+  c->next = c->prev = 0;
 
-  /* Now C becomes the MRU entry!  */
-  cacheq_make_mru (&lookup_cache, c);
+  pthread_spin_lock (&cache_lock);
+
+  /* Replace any old entry for NAME in DIR.  */
+  old = find_cache (dir, len, name, name_len);
+  if (old)
+    {
+      drop_entry (old);
+      old->next = dead;
+      dead = old;
+    }
+
+  /* Make room by dropping the least recently used entries.  */
+  while (lookup_cache_lru
+	 && lookup_cache.nr_items >= (size_t) name_cache_size)
+    {
+      old = drop_entry (lookup_cache_lru);
+      old->next = dead;
+      dead = old;
+    }
+
+  if (hurd_ihash_add (&lookup_cache, (hurd_ihash_key_t) &c->key, c))
+    {
+      c->next = dead;
+      dead = c;
+    }
+  else
+    {
+      /* Now C becomes the MRU entry!  */
+      make_mru (c);
+      if (np)
+	{
+	  c->node_next = np->nn->lookup_entries;
+	  if (c->node_next)
+	    c->node_next->node_prevp = &c->node_next;
+	  c->node_prevp = &np->nn->lookup_entries;
+	  np->nn->lookup_entries = c;
+	}
+    }
 
   pthread_spin_unlock (&cache_lock);
+
+  free_entries (dead);
 }
-
+
 /* Purge all references in the cache to NAME within directory DIR. */
 void
 purge_lookup_cache (struct node *dp, const char *name, size_t namelen)
 {
-  struct lookup_cache *c, *next;
-  
+  struct lookup_cache *c;
+
   pthread_spin_lock (&cache_lock);
-  for (c = lookup_cache.mru; c; c = next)
+  c = find_cache (dp->nn->handle.data, dp->nn->handle.size, name, namelen);
+  if (c)
     {
-      /* Save C->hdr.next, since we may move C from this position. */
-      next = c->hdr.next;
-
-      if (c->name_len == namelen
-	  && c->dir_cache_len == dp->nn->handle.size
-	  && memcmp (c->dir_cache_fh, dp->nn->handle.data,
-	             c->dir_cache_len) == 0
-	  && strcmp (c->name, name) == 0)
-	{
-	  if (c->np)
-	    netfs_nrele (c->np);
-	  c->name_len = 0;
-	  c->np = 0;
-	  cacheq_make_lru (&lookup_cache, c); /* Use C as the next free
-						 entry. */
-	}
+      drop_entry (c);
+      c->next = 0;
     }
   pthread_spin_unlock (&cache_lock);
+
+  free_entries (c);
 }
 
 /* Purge all references in the cache to node NP. */
 void
 purge_lookup_cache_node (struct node *np)
 {
-  struct lookup_cache *c, *next;
-  
+  struct lookup_cache *c, *dead = 0;
+
+  /* NP may be cached under several names; its entries are all on its
+     own list.  */
   pthread_spin_lock (&cache_lock);
-  for (c = lookup_cache.mru; c; c = next)
+  while ((c = np->nn->lookup_entries))
     {
-      next = c->hdr.next;
-      
-      if (c->np == np)
-	{
-	  netfs_nrele (c->np);
-	  c->name_len = 0;
-	  c->np = 0;
-	  cacheq_make_lru (&lookup_cache, c);
-	}
+      drop_entry (c);
+      c->next = dead;
+      dead = c;
     }
   pthread_spin_unlock (&cache_lock);
-}
 
-
-
-/* Register a negative hit for an entry in the Nth stat class */
-void
-register_neg_hit (int n)
-{
-  int i;
-
-  statistics.neg_hits++;
-
-  for (i = 0; i < n; i++)
-    partial_stats[i].miss++;
-  for (; i < NPARTIALS; i++)
-    partial_stats[i].neg_hits++;
+  free_entries (dead);
 }
 
-/* Register a positive hit for an entry in the Nth stat class */
-void
-register_pos_hit (int n)
+/* Append to the argz string ARGZ of length ARGZ_LEN a description of how
+   well the cache has been doing, as an option for fsysopts to show.  */
+error_t
+append_lookup_cache_stats (char **argz, size_t *argz_len)
 {
-  int i;
+  char buf[100];
 
-  statistics.pos_hits++;
+  pthread_spin_lock (&cache_lock);
+  snprintf (buf, sizeof buf, "--name-cache-stats=%ld/%ld/%ld",
+	    statistics.pos_hits, statistics.neg_hits, statistics.miss);
+  pthread_spin_unlock (&cache_lock);
 
-  for (i = 0; i < n; i++)
-    partial_stats[i].miss++;
-  for (; i < NPARTIALS; i++)
-    partial_stats[i].pos_hits++;
-}
-  
-/* Register a miss */
-void
-register_miss (void)
-{
-  int i;
-  
-  statistics.miss++;
-  for (i = 0; i < NPARTIALS; i++)
-    partial_stats[i].miss++;
+  return argz_add (argz, argz_len, buf);
 }
 
 
-
+
 /* Scan the cache looking for NAME inside DIR.  If we know nothing
    about the entry, then return 0.  If the entry is confirmed to not
    exist, then return -1.  Otherwise, return NP for the entry, with
@@ -248,7 +329,7 @@ struct node *
 check_lookup_cache (struct node *dir, const char *name)
 {
   struct lookup_cache *c;
-  
+
   pthread_spin_lock (&cache_lock);
 
   c = find_cache (dir->nn->handle.data, dir->nn->handle.size,
@@ -256,49 +337,51 @@ check_lookup_cache (struct node *dir, const char *name)
   if (c)
     {
       int timeout = c->np
-	? name_cache_timeout 
+	? name_cache_timeout
 	: name_cache_neg_timeout;
 
-      /* Make sure the entry is still usable; if not, zap it now. */
-      if (mapped_time->seconds - c->cache_stamp >= timeout)
+      /* Make sure the entry is still usable; if not, zap it now.  It
+	 isn't once it has timed out, or the directory has changed
+	 since it was made.  */
+      if (mapped_time->seconds - c->cache_stamp >= timeout
+	  || c->dir_mtime.tv_sec != dir->nn_stat.st_mtim.tv_sec
+	  || c->dir_mtime.tv_nsec != dir->nn_stat.st_mtim.tv_nsec)
 	{
-	  register_neg_hit (c->stati);
-	  if (c->np)
-	    netfs_nrele (c->np);
-	  c->name_len = 0;
-	  c->np = 0;
-	  cacheq_make_lru (&lookup_cache, c);
+	  statistics.miss++;
+	  drop_entry (c);
+	  c->next = 0;
 	  pthread_spin_unlock (&cache_lock);
+	  free_entries (c);
 	  return 0;
 	}
 
-      cacheq_make_mru (&lookup_cache, c); /* Record C as recently used.  */
+      make_mru (c);		/* Record C as recently used.  */
 
       if (c->np == 0)
 	/* A negative cache entry.  */
 	{
-	  register_neg_hit (c->stati);
+	  statistics.neg_hits++;
 	  pthread_spin_unlock (&cache_lock);
 	  pthread_mutex_unlock (&dir->lock);
 	  return (struct node *)-1;
 	}
-      else 
+      else
 	{
 	  struct node *np;
-	  
+
 	  np = c->np;
 	  netfs_nref (np);
-	  register_pos_hit (c->stati);
+	  statistics.pos_hits++;
 	  pthread_spin_unlock (&cache_lock);
-	  
+
 	  pthread_mutex_unlock (&dir->lock);
 	  pthread_mutex_lock (&np->lock);
 
 	  return np;
 	}
     }
-  
-  register_miss ();
+
+  statistics.miss++;
   pthread_spin_unlock (&cache_lock);
 
   return 0;
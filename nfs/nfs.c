@@ -167,7 +167,7 @@ xdr_encode_data (int *p, const char *data, size_t len)
 int *
 xdr_encode_64bit (int *p, long long n)
 {
-  *(p++) = htonl (n & 0xffffffff00000000LL >> 32);
+  *(p++) = htonl ((n >> 32) & 0xffffffff);
   *(p++) = htonl (n & 0xffffffff);
   return p;
 }
@@ -422,7 +422,7 @@ xdr_decode_fhandle (int *p, struct node **npp)
   memcpy (&handle.data, p, handle.size);
   /* Enter into cache.  */
   lookup_fhandle (&handle, npp);
-  return p + handle.size / sizeof (int);
+  return p + INTSIZE (handle.size);
 }
 
 /* Decode *P into a stat structure; return the address of the
@@ -606,7 +606,7 @@ nfs_initialize_rpc (int rpc_proc, struct iouser *cred,
   else
     uid = gid = second_gid = -1;
 
-  return initialize_rpc (NFS_PROGRAM, NFS_VERSION, rpc_proc, len, bufp,
+  return initialize_rpc (NFS_PROGRAM, nfs_version, rpc_proc, len, bufp,
 			 uid, gid, second_gid);
 }
 
@@ -71,6 +71,33 @@ struct netnode
 
   struct user_pager_info *fileinfo;
 
+  /* Data read ahead of a sequential reader: RA_LEN bytes of the file
+     from RA_OFFSET, read at RA_STAMP while the file's mtime was RA_MTIME.
+     NEXT_READ is where a sequential reader would read next.  */
+  void *ra_data;
+  off_t ra_offset;
+  size_t ra_len;
+  time_t ra_stamp;
+  struct timespec ra_mtime;
+  off_t next_read;
+
+  /* Copies of what has been written UNSTABLE (NFSv3) but not yet
+     committed by the server, UNSTABLE_LEN bytes in all, the first of it
+     at UNSTABLE_STAMP.  WRITE_VERF is the verifier the server gave back;
+     VERF_CHANGED is set if it didn't always give back the same one.
+     While there is such data, the node is on the list of dirty nodes,
+     linked by NEXT_DIRTY.  */
+  struct unstable_write *unstable;
+  size_t unstable_len;
+  time_t unstable_stamp;
+  char write_verf[NFS3_WRITEVERFSIZE];
+  int verf_changed;
+  struct node *next_dirty;
+
+  /* The name cache entries naming this node, linked by their
+     NODE_NEXT fields; protected by the name cache's lock.  */
+  struct lookup_cache *lookup_entries;
+
   /* If this node has been renamed by "deletion" then
      this is the directory and the name in that directory
      which is holding the node */
@@ -101,6 +128,9 @@ extern int name_cache_timeout;
 /* How long to keep around negative dir cache entries */
 extern int name_cache_neg_timeout;
 
+/* How many dir cache entries to keep around at most */
+extern int name_cache_size;
+
 /* How long to wait for replies before re-sending RPC's. */
 extern int initial_transmit_timeout;
 extern int max_transmit_timeout;
@@ -117,6 +147,15 @@ extern int read_size;
 /* Maximum amout to write at once */
 extern int write_size;
 
+/* Maximum number of READ or WRITE RPCs outstanding for one request */
+extern int rpc_window;
+
+/* How much to read ahead of sequential readers */
+extern int read_ahead;
+
+/* How much to write UNSTABLE to a file before committing it (NFSv3) */
+extern int commit_size;
+
 /* Service name for portmapper */
 extern char *pmap_service_name;
 
@@ -164,6 +203,7 @@ extern int protocol_version;
 int hurd_mode_to_nfs_type (mode_t);
 int *xdr_encode_fhandle (int *, const struct fhandle *);
 int *xdr_encode_data (int *, const char *, size_t);
+int *xdr_encode_64bit (int *, long long);
 int *xdr_encode_string (int *, const char *);
 int *xdr_encode_sattr_mode (int *, mode_t);
 int *xdr_encode_sattr_ids (int *, u_int, u_int);
@@ -185,10 +225,17 @@ extern uint16_t mounted_nfs_port; /* host order */
 
 /* ops.c */
 int *register_fresh_stat (struct node *, int *);
+int *process_wcc_stat (struct node *, int *, int);
+error_t write_data (struct iouser *, struct node *, off_t, size_t *,
+		    const void *, int);
+void drop_read_ahead (struct node *);
 
 /* rpc.c */
 int *initialize_rpc (int, int, int, size_t, void **, uid_t, gid_t, gid_t);
 error_t conduct_rpc (void **, int **);
+error_t start_rpc (void *, int *);
+error_t finish_rpc (void **, int **);
+void abandon_rpc (void *);
 void *timeout_service_thread (void *);
 void *rpc_receive_thread (void *);
 
@@ -196,10 +243,19 @@ void *rpc_receive_thread (void *);
 void lookup_fhandle (struct fhandle *, struct node **);
 int *recache_handle (int *, struct node *);
 
+/* commit.c */
+error_t note_unstable_write (struct node *, off_t, size_t, const void *,
+			     const char *);
+error_t commit_node (struct iouser *, struct node *);
+error_t commit_all (void);
+void *commit_thread (void *);
+
 /* name-cache.c */
-void enter_lookup_cache (char *, size_t, struct node *, const char *);
+void enter_lookup_cache (char *, size_t, struct timespec, struct node *,
+			 const char *);
 void purge_lookup_cache (struct node *, const char *, size_t);
 struct node *check_lookup_cache (struct node *, const char *);
 void purge_lookup_cache_node (struct node *);
+error_t append_lookup_cache_stats (char **, size_t *);
 
 #endif /* NFS_NFS_H */
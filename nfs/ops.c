@@ -124,9 +124,9 @@ process_wcc_stat (struct node *np, int *p, int mod)
       if (attrs_exist)
 	{
 	  /* Just skip them for now */
-	  p += 2 * sizeof (int); /* size */
-	  p += 2 * sizeof (int); /* mtime */
-	  p += 2 * sizeof (int); /* atime */
+	  p += 2;		/* size */
+	  p += 2;		/* mtime */
+	  p += 2;		/* ctime */
 	}
 
       /* Now the post_op_attr */
@@ -338,6 +338,10 @@ netfs_attempt_set_size (struct iouser *cred, struct node *np,
   void *rpcbuf;
   error_t err;
 
+  /* Don't let uncommitted data be written again past the new end.  */
+  commit_node (cred, np);
+  drop_read_ahead (np);
+
   p = nfs_initialize_rpc (NFSPROC_SETATTR (protocol_version),
 			  cred, 0, &rpcbuf, np, -1);
   if (! p)
@@ -425,8 +429,8 @@ netfs_attempt_statfs (struct iouser *cred, struct node *np,
 error_t
 netfs_attempt_sync (struct iouser *cred, struct node *np, int wait)
 {
-  /* We are already completely synchronous. */
-  return 0;
+  /* Everything is written synchronously but for UNSTABLE writes.  */
+  return commit_node (cred, np);
 }
 
 /* Implement the netfs_attempt_syncfs callback as described in
@@ -434,159 +438,402 @@ netfs_attempt_sync (struct iouser *cred, struct node *np, int wait)
 error_t
 netfs_attempt_syncfs (struct iouser *cred, int wait)
 {
-  return 0;
+  return commit_all ();
 }
 
-/* Implement the netfs_attempt_read callback as described in
-   <hurd/netfs.h>.  */
-error_t
-netfs_attempt_read (struct iouser *cred, struct node *np,
-		    off_t offset, size_t *len, void *data)
+/* The most READ or WRITE RPCs ever outstanding for one request.  */
+#define MAX_RPC_WINDOW 32
+
+/* Return how many READ or WRITE RPCs to keep outstanding at once.  */
+static inline int
+window_size (void)
 {
-  int *p;
-  void *rpcbuf;
-  size_t trans_len;
-  error_t err;
-  size_t amt, thisamt;
-  int eof;
+  if (rpc_window < 1)
+    return 1;
+  if (rpc_window > MAX_RPC_WINDOW)
+    return MAX_RPC_WINDOW;
+  return rpc_window;
+}
 
-  for (amt = *len; amt;)
+/* Throw away the N RPCs outstanding in the circular buffer WINDOW of
+   NWINDOW entries, starting at FIRST.  */
+static void
+abandon_window (void **window, int nwindow, int first, int n)
+{
+  while (n-- > 0)
     {
-      thisamt = amt;
-      if (thisamt > read_size)
-	thisamt = read_size;
+      abandon_rpc (window[first]);
+      first = (first + 1) % nwindow;
+    }
+}
 
-      p = nfs_initialize_rpc (NFSPROC_READ (protocol_version),
-			      cred, 0, &rpcbuf, np, -1);
-      if (! p)
-        return errno;
+/* Read up to *LEN bytes of NP at OFFSET into DATA, with several READ
+   RPCs outstanding at once, so that a large read takes little more
+   than one round trip.  Set *LEN to the amount read, which is less at
+   the end of the file or if an error stopped us part way; in the latter
+   case, the error is only returned if nothing was read.  */
+static error_t
+read_data (struct iouser *cred, struct node *np,
+	   off_t offset, size_t *len, void *data)
+{
+  void *window[MAX_RPC_WINDOW];
+  size_t amts[MAX_RPC_WINDOW];
+  int nwindow = window_size ();
+  int first = 0, n = 0;
+  size_t sent = 0, done = 0;
+  error_t err = 0;
+  int eof = 0;
 
-      p = xdr_encode_fhandle (p, &np->nn->handle);
-      *(p++) = htonl (offset);
-      *(p++) = htonl (thisamt);
-      if (protocol_version == 2)
-	*(p++) = 0;
+  while (n > 0 || (!err && !eof && sent < *len))
+    {
+      int *p;
+      void *rpcbuf;
+      size_t thisamt, trans_len;
 
-      err = conduct_rpc (&rpcbuf, &p);
-      if (!err)
+      /* Keep the window full.  */
+      while (!err && !eof && sent < *len && n < nwindow)
 	{
-	  err = nfs_error_trans (ntohl (*p));
-	  p++;
+	  thisamt = *len - sent;
+	  if (thisamt > read_size)
+	    thisamt = read_size;
 
-	  if (!err || protocol_version == 3)
-	    p = process_returned_stat (np, p, !err);
+	  p = nfs_initialize_rpc (NFSPROC_READ (protocol_version),
+				  cred, 0, &rpcbuf, np, -1);
+	  if (! p)
+	    {
+	      err = errno;
+	      break;
+	    }
+
+	  p = xdr_encode_fhandle (p, &np->nn->handle);
+	  if (protocol_version == 2)
+	    {
+	      *(p++) = htonl (offset + sent);
+	      *(p++) = htonl (thisamt);
+	      *(p++) = 0;
+	    }
+	  else
+	    {
+	      p = xdr_encode_64bit (p, offset + sent);
+	      *(p++) = htonl (thisamt);
+	    }
 
+	  err = start_rpc (rpcbuf, p);
 	  if (err)
 	    {
 	      free (rpcbuf);
-	      return err;
+	      break;
 	    }
 
-	  trans_len = ntohl (*p);
-	  p++;
-	  if (trans_len > thisamt)
-	    trans_len = thisamt;	/* ??? */
+	  window[(first + n) % nwindow] = rpcbuf;
+	  amts[(first + n) % nwindow] = thisamt;
+	  n++;
+	  sent += thisamt;
+	}
 
-	  if (protocol_version == 3)
-	    {
-	      eof = ntohl (*p);
-	      p++;
-	    }
-	  else
-	    eof = (trans_len < thisamt);
+      if (n == 0)
+	break;
+
+      /* Take the replies in order.  */
+      rpcbuf = window[first];
+      thisamt = amts[first];
+      first = (first + 1) % nwindow;
+      n--;
+
+      err = finish_rpc (&rpcbuf, &p);
+      if (!err)
+	{
+	  err = nfs_error_trans (ntohl (*p));
+	  p++;
 
-	  memcpy (data, p, trans_len);
+	  if (!err || protocol_version == 3)
+	    p = process_returned_stat (np, p, !err);
+	}
+      if (err)
+	{
 	  free (rpcbuf);
+	  abandon_window (window, nwindow, first, n);
+	  n = 0;
+	  break;
+	}
 
-	  data += trans_len;
-	  offset += trans_len;
-	  amt -= trans_len;
+      trans_len = ntohl (*p);
+      p++;
+      if (trans_len > thisamt)
+	trans_len = thisamt;	/* ??? */
 
-	  if (eof)
-	    {
-	      *len -= amt;
-	      return 0;
-	    }
+      if (protocol_version == 3)
+	{
+	  eof = ntohl (*p);
+	  p++;
+	  p++;			/* Skip the length of the data.  */
+	}
+      else
+	eof = (trans_len < thisamt);
+
+      memcpy (data + done, p, trans_len);
+      free (rpcbuf);
+      done += trans_len;
+
+      if (eof || trans_len == 0)
+	{
+	  eof = 1;
+	  abandon_window (window, nwindow, first, n);
+	  n = 0;
+	}
+      else if (trans_len < thisamt)
+	{
+	  /* The server sent less than we asked for, though this isn't
+	     the end of the file; everything after has to be asked for
+	     again from here.  */
+	  abandon_window (window, nwindow, first, n);
+	  n = 0;
+	  sent = done;
 	}
     }
+
+  if (err && done == 0)
+    return err;
+
+  *len = done;
   return 0;
 }
 
-/* Implement the netfs_attempt_write callback as described in
+/* Forget what has been read ahead in NP.  */
+void
+drop_read_ahead (struct node *np)
+{
+  free (np->nn->ra_data);
+  np->nn->ra_data = 0;
+  np->nn->ra_len = 0;
+}
+
+/* Implement the netfs_attempt_read callback as described in
    <hurd/netfs.h>.  */
 error_t
-netfs_attempt_write (struct iouser *cred, struct node *np,
-		     off_t offset, size_t *len, const void *data)
+netfs_attempt_read (struct iouser *cred, struct node *np,
+		    off_t offset, size_t *len, void *data)
 {
-  int *p;
-  void *rpcbuf;
-  error_t err;
-  size_t amt, thisamt;
-  size_t count;
+  struct netnode *nn = np->nn;
+  size_t got = 0, amt, ahead = 0;
+  void *buf = 0;
+  error_t err = 0;
+
+  /* Data read ahead is good until it times out or the file is seen to
+     have changed.  */
+  if (nn->ra_data
+      && (mapped_time->seconds - nn->ra_stamp >= cache_timeout
+	  || nn->ra_mtime.tv_sec != np->nn_stat.st_mtim.tv_sec
+	  || nn->ra_mtime.tv_nsec != np->nn_stat.st_mtim.tv_nsec))
+    drop_read_ahead (np);
 
-  for (amt = *len; amt;)
+  if (nn->ra_data
+      && offset >= nn->ra_offset && offset < nn->ra_offset + nn->ra_len)
     {
-      thisamt = amt;
-      if (thisamt > write_size)
-	thisamt = write_size;
+      got = nn->ra_offset + nn->ra_len - offset;
+      if (got > *len)
+	got = *len;
+      memcpy (data, nn->ra_data + (offset - nn->ra_offset), got);
+    }
 
-      p = nfs_initialize_rpc (NFSPROC_WRITE (protocol_version),
-			      cred, thisamt, &rpcbuf, np, -1);
-      if (! p)
-        return errno;
+  amt = *len - got;
+  if (amt > 0 && read_ahead > 0 && offset == nn->next_read)
+    {
+      /* A sequential reader; fetch what it will want next along with
+	 what it wants now, as the window sends it all at once.  Don't
+	 go far beyond what we last knew to be the end of the file.  */
+      ahead = amt + read_ahead;
+      if (offset + got + ahead > np->nn_stat.st_size)
+	ahead = (np->nn_stat.st_size > offset + got + amt
+		 ? np->nn_stat.st_size - offset - got : amt);
+      if (ahead > amt)
+	buf = malloc (ahead);
+    }
 
-      p = xdr_encode_fhandle (p, &np->nn->handle);
-      if (protocol_version == 2)
-	*(p++) = 0;
-      *(p++) = htonl (offset);
-      if (protocol_version == 2)
-	*(p++) = 0;
-      if (protocol_version == 3)
-	*(p++) = htonl (FILE_SYNC);
-      p = xdr_encode_data (p, data, thisamt);
+  if (buf)
+    {
+      err = read_data (cred, np, offset + got, &ahead, buf);
+      if (err)
+	{
+	  free (buf);
+	  amt = 0;
+	}
+      else
+	{
+	  if (amt > ahead)
+	    amt = ahead;
+	  memcpy (data + got, buf, amt);
+
+	  drop_read_ahead (np);
+	  nn->ra_data = buf;
+	  nn->ra_offset = offset + got;
+	  nn->ra_len = ahead;
+	  nn->ra_stamp = mapped_time->seconds;
+	  nn->ra_mtime = np->nn_stat.st_mtim;
+	}
+    }
+  else if (amt > 0)
+    {
+      err = read_data (cred, np, offset + got, &amt, data + got);
+      if (err)
+	amt = 0;
+    }
 
-      err = conduct_rpc (&rpcbuf, &p);
+  if (err && got == 0)
+    return err;
+
+  *len = got + amt;
+  nn->next_read = offset + *len;
+  return 0;
+}
+
+/* Write *LEN bytes from DATA to NP at OFFSET, with several WRITE RPCs
+   outstanding at once.  In NFSv3, ask that the data be written STABLE
+   (UNSTABLE, DATA_SYNC, or FILE_SYNC) at least, and keep a copy of
+   anything written UNSTABLE until it is committed.  Set *LEN to the
+   amount written; if the write was interrupted part way, that is
+   returned, otherwise any error is.  */
+error_t
+write_data (struct iouser *cred, struct node *np,
+	    off_t offset, size_t *len, const void *data, int stable)
+{
+  void *window[MAX_RPC_WINDOW];
+  size_t amts[MAX_RPC_WINDOW];
+  int nwindow = window_size ();
+  int first = 0, n = 0;
+  size_t sent = 0, done = 0;
+  error_t err = 0;
+
+  while (n > 0 || (!err && sent < *len))
+    {
+      int *p;
+      void *rpcbuf;
+      size_t thisamt, count;
+      int committed;
+
+      /* Keep the window full.  */
+      while (!err && sent < *len && n < nwindow)
+	{
+	  thisamt = *len - sent;
+	  if (thisamt > write_size)
+	    thisamt = write_size;
+
+	  p = nfs_initialize_rpc (NFSPROC_WRITE (protocol_version),
+				  cred, thisamt, &rpcbuf, np, -1);
+	  if (! p)
+	    {
+	      err = errno;
+	      break;
+	    }
+
+	  p = xdr_encode_fhandle (p, &np->nn->handle);
+	  if (protocol_version == 2)
+	    {
+	      *(p++) = 0;
+	      *(p++) = htonl (offset + sent);
+	      *(p++) = 0;
+	    }
+	  else
+	    {
+	      p = xdr_encode_64bit (p, offset + sent);
+	      *(p++) = htonl (thisamt);
+	      *(p++) = htonl (stable);
+	    }
+	  p = xdr_encode_data (p, data + sent, thisamt);
+
+	  err = start_rpc (rpcbuf, p);
+	  if (err)
+	    {
+	      free (rpcbuf);
+	      break;
+	    }
+
+	  window[(first + n) % nwindow] = rpcbuf;
+	  amts[(first + n) % nwindow] = thisamt;
+	  n++;
+	  sent += thisamt;
+	}
+
+      if (n == 0)
+	break;
+
+      /* Take the replies in order.  */
+      rpcbuf = window[first];
+      thisamt = amts[first];
+      first = (first + 1) % nwindow;
+      n--;
+
+      err = finish_rpc (&rpcbuf, &p);
       if (!err)
 	{
 	  err = nfs_error_trans (ntohl (*p));
 	  p++;
 	  if (!err || protocol_version == 3)
 	    p = process_wcc_stat (np, p, !err);
-	  if (!err)
+	}
+      if (!err)
+	{
+	  if (protocol_version == 3)
 	    {
-	      if (protocol_version == 3)
-		{
-		  count = ntohl (*p);
-		  p++;
-		  p++;		/* ignore COMMITTED */
-		  /* ignore verf for now */
-		  p += NFS3_WRITEVERFSIZE / sizeof (int);
-		}
-	      else
-		/* assume it wrote the whole thing */
+	      count = ntohl (*p);
+	      p++;
+	      committed = ntohl (*p);
+	      p++;
+	      if (count > thisamt)
 		count = thisamt;
+	      if (committed == UNSTABLE)
+		err = note_unstable_write (np, offset + done, count,
+					   data + done, (char *) p);
+	    }
+	  else
+	    /* assume it wrote the whole thing */
+	    count = thisamt;
 
-	      amt -= count;
-	      data += count;
-	      offset += count;
+	  if (!err)
+	    done += count;
+	  if (!err && count < thisamt)
+	    {
+	      /* Stop at the gap; whatever was sent after it is left for
+		 the caller to write again.  */
+	      free (rpcbuf);
+	      abandon_window (window, nwindow, first, n);
+	      n = 0;
+	      break;
 	    }
 	}
-
       free (rpcbuf);
 
-      if (err == EINTR && amt != *len)
-	{
-	  *len -= amt;
-	  return 0;
-	}
-
       if (err)
 	{
-	  *len = 0;
-	  return err;
+	  abandon_window (window, nwindow, first, n);
+	  n = 0;
 	}
     }
-  return 0;
+
+  if (err == EINTR && done)
+    err = 0;
+  *len = err ? 0 : done;
+  return err;
+}
+
+/* Implement the netfs_attempt_write callback as described in
+   <hurd/netfs.h>.  */
+error_t
+netfs_attempt_write (struct iouser *cred, struct node *np,
+		     off_t offset, size_t *len, const void *data)
+{
+  error_t err;
+
+  drop_read_ahead (np);
+
+  err = write_data (cred, np, offset, len, data,
+		    commit_size > 0 ? UNSTABLE : FILE_SYNC);
+
+  /* Commit in batches; if this fails, it's tried again later.  */
+  if (!err && np->nn->unstable_len >= commit_size)
+    commit_node (cred, np);
+
+  return err;
 }
 
 /* See if NAME exists in DIR for CRED.  If so, return EEXIST.  */
@@ -637,6 +884,7 @@ netfs_attempt_lookup (struct iouser *cred, struct node *np,
   error_t err;
   char dirhandle[NFS3_FHSIZE];
   size_t dirlen;
+  struct timespec dirmtime;
 
   /* Check the cache first. */
   *newnp = check_lookup_cache (np, name);
@@ -663,6 +911,7 @@ netfs_attempt_lookup (struct iouser *cred, struct node *np,
 
   dirlen = np->nn->handle.size;
   memcpy (dirhandle, np->nn->handle.data, dirlen);
+  dirmtime = np->nn_stat.st_mtim;
 
   pthread_mutex_unlock (&np->lock);
 
@@ -684,6 +933,7 @@ netfs_attempt_lookup (struct iouser *cred, struct node *np,
 	    pthread_mutex_unlock (&(*newnp)->lock);
 	  pthread_mutex_lock (&np->lock);
 	  p = process_returned_stat (np, p, 0); /* XXX Do we have to lock np? */
+	  dirmtime = np->nn_stat.st_mtim;
 	  pthread_mutex_unlock (&np->lock);
 	  if (*newnp)
 	    pthread_mutex_lock (&(*newnp)->lock);
@@ -693,7 +943,7 @@ netfs_attempt_lookup (struct iouser *cred, struct node *np,
     *newnp = 0;
 
   /* Notify the cache of the hit or miss. */
-  enter_lookup_cache (dirhandle, dirlen, *newnp, name);
+  enter_lookup_cache (dirhandle, dirlen, dirmtime, *newnp, name);
 
   free (rpcbuf);
 
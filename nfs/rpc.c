@@ -42,6 +42,13 @@ struct rpc_list
 {
   struct rpc_list *next, **prevp;
   void *reply;
+
+  /* The length of the message, when it was last sent, how long to wait
+     before sending it again, and how many times it has been sent.  */
+  size_t len;
+  time_t lasttrans;
+  int timeout;
+  int ntransmit;
 };
 
 /* A list of all pending RPCs.  */
@@ -166,6 +173,72 @@ link_rpc (struct rpc_list **list, struct rpc_list *hdr)
   *list = hdr;
 }
 
+/* Send the RPC HDR (again).  The rpc_list's lock (OUTSTANDING_LOCK)
+   must be held.  */
+static error_t
+transmit_rpc (struct rpc_list *hdr)
+{
+  size_t cc;
+
+  /* If we've sent enough, give up.  */
+  if (mounted_soft && hdr->ntransmit == soft_retries)
+    return ETIMEDOUT;
+
+  hdr->lasttrans = mapped_time->seconds;
+  hdr->ntransmit++;
+  cc = write (main_udp_socket, (void *) hdr + sizeof (struct rpc_list),
+	      hdr->len);
+  if (cc == -1)
+    return errno;
+  else
+    assert_backtrace (cc == hdr->len);
+
+  return 0;
+}
+
+/* Send the specified RPC message, without waiting for the reply, so that
+   several can be outstanding at once.  RPCBUF is the initialized buffer
+   from a previous initialize_rpc call; P, the payload, points past the
+   filledin args.  If this succeeds, the reply must be collected with
+   finish_rpc or thrown away with abandon_rpc; otherwise, the caller
+   still has to free RPCBUF.  */
+error_t
+start_rpc (void *rpcbuf, int *p)
+{
+  struct rpc_list *hdr = rpcbuf;
+  error_t err;
+
+  hdr->len = (void *) p - rpcbuf - sizeof (struct rpc_list);
+  hdr->timeout = initial_transmit_timeout;
+  hdr->ntransmit = 0;
+
+  pthread_mutex_lock (&outstanding_lock);
+  link_rpc (&outstanding_rpcs, hdr);
+  err = transmit_rpc (hdr);
+  if (err)
+    unlink_rpc (hdr);
+  pthread_mutex_unlock (&outstanding_lock);
+
+  return err;
+}
+
+/* Throw away the RPC RPCBUF sent by start_rpc, and its reply if there
+   is one yet.  */
+void
+abandon_rpc (void *rpcbuf)
+{
+  struct rpc_list *hdr = rpcbuf;
+
+  pthread_mutex_lock (&outstanding_lock);
+  if (hdr->reply)
+    free (hdr->reply);
+  else
+    unlink_rpc (hdr);
+  pthread_mutex_unlock (&outstanding_lock);
+
+  free (hdr);
+}
+
 /* Send the specified RPC message.  *RPCBUF is the initialized buffer
    from a previous initialize_rpc call; *PP, the payload, points past
    the filledin args.  Set *PP to the address of the reply contents
@@ -174,73 +247,56 @@ link_rpc (struct rpc_list **list, struct rpc_list *hdr)
    *RPCBUF will be freed by this routine.  */
 error_t
 conduct_rpc (void **rpcbuf, int **pp)
+{
+  error_t err = start_rpc (*rpcbuf, *pp);
+
+  if (err)
+    return err;
+
+  return finish_rpc (rpcbuf, pp);
+}
+
+/* Wait for the reply to the RPC *RPCBUF sent by start_rpc, sending it
+   again as need be.  Otherwise like conduct_rpc.  */
+error_t
+finish_rpc (void **rpcbuf, int **pp)
 {
   struct rpc_list *hdr = *rpcbuf;
   error_t err;
-  size_t cc, nc;
-  int timeout = initial_transmit_timeout;
-  time_t lasttrans;
-  int ntransmit = 0;
   int *p;
   int xid;
   int n;
-  int cancel;
-  
-  pthread_mutex_lock (&outstanding_lock);
-
-  link_rpc (&outstanding_rpcs, hdr);
 
   xid = * (int *) (*rpcbuf + sizeof (struct rpc_list));
 
-  do
+  pthread_mutex_lock (&outstanding_lock);
+
+  /* hdr->reply will have been filled in by rpc_receive_thread, if it
+     has been filled in, then the rpc has been fulfilled, otherwise,
+     retransmit once the timeout has passed and continue to wait.  */
+  while (!hdr->reply)
     {
-      /* If we've sent enough, give up.  */
-      if (mounted_soft && ntransmit == soft_retries)
+      if (mapped_time->seconds - hdr->lasttrans >= hdr->timeout)
 	{
-	  unlink_rpc (hdr);
-	  pthread_mutex_unlock (&outstanding_lock);
-	  return ETIMEDOUT;
-	}
+	  hdr->timeout *= 2;
+	  if (hdr->timeout > max_transmit_timeout)
+	    hdr->timeout = max_transmit_timeout;
 
-      /* Issue the RPC.  */
-      lasttrans = mapped_time->seconds;
-      ntransmit++;
-      nc = (void *) *pp - *rpcbuf - sizeof (struct rpc_list);
-      cc = write (main_udp_socket, *rpcbuf + sizeof (struct rpc_list), nc);
-      if (cc == -1)
-	{
-	  unlink_rpc (hdr);
-	  pthread_mutex_unlock (&outstanding_lock);
-	  return errno;
+	  err = transmit_rpc (hdr);
+	  if (err)
+	    {
+	      unlink_rpc (hdr);
+	      pthread_mutex_unlock (&outstanding_lock);
+	      return err;
+	    }
 	}
-      else 
-	assert_backtrace (cc == nc);
-      
-      /* Wait for reply.  */
-      cancel = 0;
-      while (!hdr->reply
-	     && (mapped_time->seconds - lasttrans < timeout)
-	     && !cancel)
-	cancel = pthread_hurd_cond_wait_np (&rpc_wakeup, &outstanding_lock);
-  
-      if (cancel)
+      else if (pthread_hurd_cond_wait_np (&rpc_wakeup, &outstanding_lock))
 	{
 	  unlink_rpc (hdr);
 	  pthread_mutex_unlock (&outstanding_lock);
 	  return EINTR;
 	}
-
-      /* hdr->reply will have been filled in by rpc_receive_thread,
-         if it has been filled in, then the rpc has been fulfilled,
-         otherwise, retransmit and continue to wait.  */
-      if (!hdr->reply)
-	{
-	  timeout *= 2;
-	  if (timeout > max_transmit_timeout)
-	    timeout = max_transmit_timeout;
-	}
     }
-  while (!hdr->reply);
 
   pthread_mutex_unlock (&outstanding_lock);
 
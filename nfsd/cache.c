@@ -124,43 +124,61 @@ idspec_lookup (int nuids, int ngids, int *uids, int *gids)
   return i;
 }
 
+/* Decode the credentials and verifier of an RPC call at P, going no
+   further than END, into *CREDP and return the next thing to come after
+   them.  If they run past END, set *CREDP to 0 and return 0.  */
 int *
-process_cred (int *p, struct idspec **credp)
+process_cred (int *p, int *end, struct idspec **credp)
 {
   int type;
-  int len;
-  int *uid;
-  int *gids;
-  int ngids;
+  size_t len;
+  int *uid = 0;
+  int *gids = 0;
+  unsigned int ngids = 0;
   int firstgid;
   int i;
 
+  *credp = 0;
+  if (p + 2 > end)
+    return 0;
   type = ntohl (*p);
   p++;
 
   if (type != AUTH_UNIX)
     {
-      int size = ntohl (*p);
+      len = ntohl (*p);
       p++;
-      *credp = idspec_lookup (0, 0, 0, 0);
-      p += INTSIZE (size);
+      if (len > (char *) end - (char *) p)
+	return 0;
+      p += INTSIZE (len);
     }
   else
     {
       p++;			/* Skip size.  */
+      if (p + 2 > end)
+	return 0;
       p++;			/* Skip seconds.  */
       len = ntohl (*p);
       p++;
+      if (len > (char *) end - (char *) p)
+	return 0;
       p += INTSIZE (len);	/* Skip hostname.  */
 
+      /* uid, gid, and the length of the other gids.  */
+      if (p + 3 > end)
+	return 0;
       uid = p++;		/* Remember location of uid.  */
-      *uid = ntohl (*uid);
 
       firstgid = *(p++);	/* Remember first gid.  */
       gids = p;			/* Here is where the array will start.  */
       ngids = ntohl (*p);
       p++;
 
+      /* At most 16 are allowed, so anything more is garbage.  */
+      if (ngids > 16 || p + ngids > end)
+	return 0;
+      *uid = ntohl (*uid);
+
       /* Now swap the first gid to be the first element of the
 	 array.  */
       *gids = firstgid;
@@ -171,16 +189,22 @@ process_cred (int *p, struct idspec **credp)
 	gids[i] = ntohl (gids[i]);
 
       p += ngids - 1;
-
-      *credp = idspec_lookup (1, ngids, uid, gids);
     }
 
   /* Next is the verf field; skip it entirely.  */
+  if (p + 2 > end)
+    return 0;
   p++;				/* Skip ID.  */
   len = htonl (*p);
   p++;
+  if (len > (char *) end - (char *) p)
+    return 0;
   p += INTSIZE (len);
 
+  if (type != AUTH_UNIX)
+    *credp = idspec_lookup (0, 0, 0, 0);
+  else
+    *credp = idspec_lookup (1, ngids, uid, gids);
   return p;
 }
 
@@ -269,14 +293,38 @@ fh_hash (char *fhandle, struct idspec *i)
   return hash % FHHASH_TABLE_SIZE;
 }
 
+/* Look up the file handle at P, of protocol version VERSION, for the
+   user I, and return the next thing to come after it.  If the handle
+   runs past END, set *CP to 0 and return 0.  */
 int *
-lookup_cache_handle (int *p, struct cache_handle **cp, struct idspec *i)
+lookup_cache_handle (int *p, int *end, struct cache_handle **cp,
+		     struct idspec *i, int version)
 {
   int hash;
   struct cache_handle *c;
   fsys_t fsys;
   file_t port;
 
+  *cp = 0;
+  if (version == 3)
+    {
+      /* A version 3 handle has its length in front; anything but the
+	 length of ours can't be one of ours.  */
+      size_t len;
+
+      if (p >= end)
+	return 0;
+      len = ntohl (*p);
+      p++;
+      if (len > NFS3_FHSIZE || len > (char *) end - (char *) p)
+	return 0;
+      if (len != NFS2_FHSIZE)
+	return p + INTSIZE (len);
+    }
+
+  if (p + INTSIZE (NFS2_FHSIZE) > end)
+    return 0;
+
   hash = fh_hash ((char *)p, i);
   pthread_mutex_lock (&fhhashlock);
   for (c = fhhashtable[hash]; c; c = c->next)
@@ -20,6 +20,9 @@
 
 #include <string.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <netinet/tcp.h>
 
 #include "nfsd.h"
 
@@ -35,190 +38,602 @@
 #include <rpc/rpc_msg.h>
 #undef malloc
 
-void *
-server_loop (void *arg)
+/* The most requests from one TCP connection waiting to be carried out;
+   past this, we stop reading from it.  */
+#define MAX_PENDING 64
+
+/* A reply waiting to be sent on a TCP connection.  */
+struct tcp_reply
+{
+  struct tcp_reply *next;
+  size_t len;
+  char data[0];
+};
+
+/* A connection from a client over TCP.  */
+struct tcp_conn
+{
+  int fd;
+  struct sockaddr_in peer;
+
+  /* Protects the fields below; never held while using FD.  */
+  pthread_mutex_t lock;
+  int references;
+  int reading;			/* Nonzero until the reader gives up.  */
+  int pending;			/* Requests not yet answered on FD.  */
+  pthread_cond_t wakeup;	/* Signalled as PENDING drops.  */
+
+  /* Replies for the writer thread to send, oldest first.  */
+  struct tcp_reply *replies, **replies_tail;
+  pthread_cond_t replies_wakeup; /* Signalled as REPLIES fills.  */
+};
+
+/* A request from a TCP connection waiting for a worker.  */
+struct tcp_request
+{
+  struct tcp_request *next;
+  struct tcp_conn *conn;
+  size_t len;
+  char data[0];
+};
+
+/* The requests waiting for a worker, oldest first.  */
+static struct tcp_request *tcp_queue, **tcp_queue_tail = &tcp_queue;
+static pthread_mutex_t tcp_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t tcp_queue_wakeup = PTHREAD_COND_INITIALIZER;
+
+/* Carry out the RPC request in BUF, LEN bytes long, which came from
+   SENDER, and return the reply, locked, for the caller to send and then
+   release with release_cached_reply.  If nothing should be sent back,
+   return 0.  */
+static struct cached_reply *
+process_request (char *buf, size_t len, struct sockaddr_in *sender)
 {
-  int fd = (int) arg;
-  char buf[MAXIOSIZE];
   int xid;
   int *p, *r;
   char *rbuf;
   struct cached_reply *cr;
   int program;
-  struct sockaddr_in sender;
-  int version;
+  int version, low, high;
   int procedure;
   struct proctable *table = 0;
   struct procedure *proc;
   struct idspec *cred;
   struct cache_handle *c, fakec;
-  error_t err;
+  error_t err = 0;
+  int n;
+  int *end;
+
+  memset (&fakec, 0, sizeof (struct cache_handle));
+
+  p = (int *) buf;
+  end = (int *) (buf + (len & ~(sizeof (int) - 1)));
+  proc = 0;
+  /* XID, CALL, RPC version, program, version and procedure.  */
+  if (len < 6 * sizeof (int))
+    return 0;
+  xid = *(p++);
+
+  /* Ignore things that aren't proper RPCs.  */
+  if (ntohl (*p) != CALL)
+    return 0;
+  p++;
+
+  cr = check_cached_replies (xid, sender);
+  if (cr->data)
+    /* This transacation has already completed.  */
+    return cr;
+
+  r = (int *) (rbuf = malloc (MAXIOSIZE));
+
+  if (ntohl (*p) != RPC_MSG_VERSION)
+    {
+      /* Reject RPC.  */
+      *(r++) = xid;
+      *(r++) = htonl (REPLY);
+      *(r++) = htonl (MSG_DENIED);
+      *(r++) = htonl (RPC_MISMATCH);
+      *(r++) = htonl (RPC_MSG_VERSION);
+      *(r++) = htonl (RPC_MSG_VERSION);
+      goto send_reply;
+    }
+  p++;
+
+  program = ntohl (*p);
+  p++;
+  switch (program)
+    {
+    case MOUNTPROG:
+      low = MOUNTVERS;
+      high = MOUNTVERS3;
+      table = &mounttable;
+      break;
+
+    case NFS_PROGRAM:
+      low = NFS_VERSION;
+      high = NFS3_VERSION;
+      break;
+
+    case PMAPPROG:
+      low = high = PMAPVERS;
+      table = &pmaptable;
+      break;
+
+    default:
+      /* Program unavailable.  */
+      *(r++) = xid;
+      *(r++) = htonl (REPLY);
+      *(r++) = htonl (MSG_ACCEPTED);
+      *(r++) = htonl (AUTH_NULL);
+      *(r++) = htonl (0);
+      *(r++) = htonl (PROG_UNAVAIL);
+      goto send_reply;
+    }
+
+  version = ntohl (*p);
+  if (version < low || version > high)
+    {
+      /* Program mismatch.  */
+      *(r++) = xid;
+      *(r++) = htonl (REPLY);
+      *(r++) = htonl (MSG_ACCEPTED);
+      *(r++) = htonl (AUTH_NULL);
+      *(r++) = htonl (0);
+      *(r++) = htonl (PROG_MISMATCH);
+      *(r++) = htonl (low);
+      *(r++) = htonl (high);
+      goto send_reply;
+    }
+  p++;
+
+  if (program == NFS_PROGRAM)
+    table = (version == NFS3_VERSION ? &nfs3table : &nfs2table);
+
+  procedure = htonl (*p);
+  p++;
+  if (procedure < table->min
+      || procedure > table->max
+      || table->procs[procedure - table->min].func == 0)
+    {
+      /* Procedure unavailable.  */
+      *(r++) = xid;
+      *(r++) = htonl (REPLY);
+      *(r++) = htonl (MSG_ACCEPTED);
+      *(r++) = htonl (AUTH_NULL);
+      *(r++) = htonl (0);
+      *(r++) = htonl (PROC_UNAVAIL);
+      *(r++) = htonl (table->min);
+      *(r++) = htonl (table->max);
+      goto send_reply;
+    }
+  proc = &table->procs[procedure - table->min];
+
+  p = process_cred (p, end, &cred);
+  if (!p)
+    goto garbage_args;
+
+  if (proc->need_handle)
+    {
+      p = lookup_cache_handle (p, end, &c, cred, version);
+      if (!p)
+	{
+	  cred_rele (cred);
+	  goto garbage_args;
+	}
+    }
+  else
+    {
+      fakec.ids = cred;
+      c = &fakec;
+    }
+
+  if (proc->alloc_reply)
+    {
+      size_t amt;
+      amt = (*proc->alloc_reply) (p, end, version) + 256;
+      if (amt > MAXIOSIZE)
+	{
+	  free (rbuf);
+	  r = (int *) (rbuf = malloc (amt));
+	}
+    }
+
+  /* Fill in beginning of reply.  */
+  *(r++) = xid;
+  *(r++) = htonl (REPLY);
+  *(r++) = htonl (MSG_ACCEPTED);
+  *(r++) = htonl (AUTH_NULL);
+  *(r++) = htonl (0);
+  *(r++) = htonl (SUCCESS);
+  if (!proc->process_error)
+    /* The function does its own error processing, and only fails if
+       its arguments are garbage.  */
+    err = (*proc->func) (c, p, end, &r, version);
+  else
+    {
+      if (c)
+	{
+	  /* Assume success for now and patch it later if necessary.  */
+	  int *errloc = r;
+	  *(r++) = htonl (0);
+	  /* Call processing function, its output after error code.  */
+	  err = (*proc->func) (c, p, end, &r, version);
+	  if (err)
+	    {
+	      r = errloc;	/* Back up, patch error code, discard rest.  */
+	      *(r++) = htonl (nfs_error_trans (err, version));
+	    }
+	}
+      else
+	{
+	  err = ESTALE;
+	  *(r++) = htonl (nfs_error_trans (ESTALE, version));
+	}
+
+      /* Results that come even with an error, such as attributes in
+	 version 3, are left out.  */
+      if (err)
+	for (n = 0; n < proc->fail_size; n++)
+	  *(r++) = 0;
+    }
+
+  cred_rele (cred);
+  if (c && c != &fakec)
+    cache_handle_rele (c);
+
+  if (err != EBADRPC)
+    goto send_reply;
+
+ garbage_args:
+  /* Whatever was put in the reply goes.  */
+  r = (int *) rbuf;
+  *(r++) = xid;
+  *(r++) = htonl (REPLY);
+  *(r++) = htonl (MSG_ACCEPTED);
+  *(r++) = htonl (AUTH_NULL);
+  *(r++) = htonl (0);
+  *(r++) = htonl (GARBAGE_ARGS);
+
+ send_reply:
+  cr->data = rbuf;
+  cr->len = (char *)r - rbuf;
+  return cr;
+}
+
+void *
+server_loop (void *arg)
+{
+  int fd = (int) arg;
+  char *buf;
+  struct cached_reply *cr;
+  struct sockaddr_in sender;
   socklen_t addrlen;
   int cc;
 
-  memset (&fakec, 0, sizeof (struct cache_handle));
+  buf = malloc (MAXIOSIZE);
+  if (! buf)
+    return 0;
 
   for (;;)
     {
-      p = (int *) buf;
-      proc = 0;
       addrlen = sizeof (struct sockaddr_in);
       cc = recvfrom (fd, buf, MAXIOSIZE, 0, &sender, &addrlen);
       if (cc == -1)
 	continue;		/* Ignore errors.  */
-      xid = *(p++);
 
-      /* Ignore things that aren't proper RPCs.  */
-      if (ntohl (*p) != CALL)
+      cr = process_request (buf, cc, &sender);
+      if (cr)
+	{
+	  sendto (fd, cr->data, cr->len, 0,
+		  (struct sockaddr *) &sender, addrlen);
+	  release_cached_reply (cr);
+	}
+    }
+}
+
+/* Read exactly LEN bytes from FD into BUF; return nonzero if they
+   can't be had.  */
+static int
+read_fully (int fd, void *buf, size_t len)
+{
+  while (len > 0)
+    {
+      ssize_t cc = read (fd, buf, len);
+      if (cc == -1 && errno == EINTR)
 	continue;
-      p++;
+      if (cc <= 0)
+	return 1;
+      buf += cc;
+      len -= cc;
+    }
+  return 0;
+}
 
-      cr = check_cached_replies (xid, &sender);
-      if (cr->data)
-	/* This transacation has already completed.  */
-	goto repost_reply;
+/* Send the record of LEN bytes at DATA on FD; return nonzero if the
+   connection is gone.  */
+static int
+send_record (int fd, char *data, size_t len)
+{
+  uint32_t mark = htonl (0x80000000 | len);
+  struct iovec iov[2];
+  int i = 0;
 
-      r = (int *) (rbuf = malloc (MAXIOSIZE));
+  iov[0].iov_base = &mark;
+  iov[0].iov_len = sizeof mark;
+  iov[1].iov_base = data;
+  iov[1].iov_len = len;
 
-      if (ntohl (*p) != RPC_MSG_VERSION)
+  while (i < 2)
+    {
+      ssize_t cc = writev (fd, &iov[i], 2 - i);
+      if (cc == -1 && errno == EINTR)
+	continue;
+      if (cc <= 0)
+	return 1;
+      for (; i < 2 && cc >= iov[i].iov_len; i++)
+	cc -= iov[i].iov_len;
+      if (i < 2)
 	{
-	  /* Reject RPC.  */
-	  *(r++) = xid;
-	  *(r++) = htonl (REPLY);
-	  *(r++) = htonl (MSG_DENIED);
-	  *(r++) = htonl (RPC_MISMATCH);
-	  *(r++) = htonl (RPC_MSG_VERSION);
-	  *(r++) = htonl (RPC_MSG_VERSION);
-	  goto send_reply;
+	  iov[i].iov_base += cc;
+	  iov[i].iov_len -= cc;
 	}
-      p++;
+    }
+  return 0;
+}
 
-      program = ntohl (*p);
-      p++;
-      switch (program)
+/* Drop a reference to CONN, which must be locked; this unlocks it.  */
+static void
+tcp_conn_rele (struct tcp_conn *conn)
+{
+  if (--conn->references == 0)
+    {
+      pthread_mutex_unlock (&conn->lock);
+      close (conn->fd);
+      free (conn);
+    }
+  else
+    pthread_mutex_unlock (&conn->lock);
+}
+
+/* Send the replies queued on the TCP connection ARG, in order, until the
+   reader has given up and every request has been answered.  Only this
+   thread writes to the socket, so a client slow to read its replies holds
+   up nobody but itself.  */
+static void *
+tcp_conn_writer (void *arg)
+{
+  struct tcp_conn *conn = arg;
+  int broken = 0;
+
+  pthread_mutex_lock (&conn->lock);
+  for (;;)
+    {
+      struct tcp_reply *reply;
+      int sent = 0;
+
+      while (! conn->replies && (conn->reading || conn->pending))
+	pthread_cond_wait (&conn->replies_wakeup, &conn->lock);
+      if (! conn->replies)
+	break;
+
+      reply = conn->replies;
+      conn->replies = 0;
+      conn->replies_tail = &conn->replies;
+      pthread_mutex_unlock (&conn->lock);
+
+      while (reply)
 	{
-	case MOUNTPROG:
-	  version = MOUNTVERS;
-	  table = &mounttable;
-	  break;
-
-	case NFS_PROGRAM:
-	  version = NFS_VERSION;
-	  table = &nfs2table;
-	  break;
-
-	case PMAPPROG:
-	  version = PMAPVERS;
-	  table = &pmaptable;
-	  break;
-
-	default:
-	  /* Program unavailable.  */
-	  *(r++) = xid;
-	  *(r++) = htonl (REPLY);
-	  *(r++) = htonl (MSG_ACCEPTED);
-	  *(r++) = htonl (AUTH_NULL);
-	  *(r++) = htonl (0);
-	  *(r++) = htonl (PROG_UNAVAIL);
-	  goto send_reply;
+	  struct tcp_reply *next = reply->next;
+
+	  /* Once a send fails, the rest are only thrown away; the reader
+	     will notice too.  */
+	  if (! broken)
+	    broken = send_record (conn->fd, reply->data, reply->len);
+	  free (reply);
+	  reply = next;
+	  sent++;
 	}
 
-      if (ntohl (*p) != version)
+      pthread_mutex_lock (&conn->lock);
+      conn->pending -= sent;
+      pthread_cond_signal (&conn->wakeup);
+    }
+
+  tcp_conn_rele (conn);
+  return 0;
+}
+
+/* Read the requests coming on the TCP connection ARG, and queue them for
+   the workers, until the client goes away.  */
+static void *
+tcp_conn_loop (void *arg)
+{
+  struct tcp_conn *conn = arg;
+
+  for (;;)
+    {
+      struct tcp_request *req = 0;
+      size_t len = 0, size = 0;
+      uint32_t mark;
+      int last = 0;
+
+      /* Gather the fragments of a record.  */
+      while (!last)
 	{
-	  /* Program mismatch.  */
-	  *(r++) = xid;
-	  *(r++) = htonl (REPLY);
-	  *(r++) = htonl (MSG_ACCEPTED);
-	  *(r++) = htonl (AUTH_NULL);
-	  *(r++) = htonl (0);
-	  *(r++) = htonl (PROG_MISMATCH);
-	  *(r++) = htonl (version);
-	  *(r++) = htonl (version);
-	  goto send_reply;
+	  size_t frag;
+
+	  if (read_fully (conn->fd, &mark, sizeof mark))
+	    goto out;
+	  mark = ntohl (mark);
+	  last = mark & 0x80000000;
+	  frag = mark & 0x7fffffff;
+
+	  if (len + frag > MAXIOSIZE)
+	    /* Nothing we can make sense of.  */
+	    goto out;
+	  if (! req || len + frag > size)
+	    {
+	      struct tcp_request *new;
+
+	      size = last ? len + frag : MAXIOSIZE;
+	      new = realloc (req, sizeof *req + size);
+	      if (! new)
+		goto out;
+	      req = new;
+	    }
+	  if (read_fully (conn->fd, req->data + len, frag))
+	    goto out;
+	  len += frag;
 	}
-      p++;
 
-      procedure = htonl (*p);
-      p++;
-      if (procedure < table->min
-	  || procedure > table->max
-	  || table->procs[procedure - table->min].func == 0)
+      req->conn = conn;
+      req->len = len;
+      req->next = 0;
+
+      pthread_mutex_lock (&conn->lock);
+      while (conn->pending >= MAX_PENDING)
+	pthread_cond_wait (&conn->wakeup, &conn->lock);
+      conn->pending++;
+      pthread_mutex_unlock (&conn->lock);
+
+      pthread_mutex_lock (&tcp_queue_lock);
+      *tcp_queue_tail = req;
+      tcp_queue_tail = &req->next;
+      pthread_cond_signal (&tcp_queue_wakeup);
+      pthread_mutex_unlock (&tcp_queue_lock);
+      continue;
+
+    out:
+      free (req);
+      break;
+    }
+
+  shutdown (conn->fd, SHUT_RD);
+  pthread_mutex_lock (&conn->lock);
+  conn->reading = 0;
+  pthread_cond_signal (&conn->replies_wakeup);
+  tcp_conn_rele (conn);
+  return 0;
+}
+
+/* Carry out requests that have come over TCP, forever.  */
+void *
+tcp_worker (void *arg)
+{
+  for (;;)
+    {
+      struct tcp_request *req;
+      struct tcp_conn *conn;
+      struct cached_reply *cr;
+      struct tcp_reply *reply;
+
+      pthread_mutex_lock (&tcp_queue_lock);
+      while (! tcp_queue)
+	pthread_cond_wait (&tcp_queue_wakeup, &tcp_queue_lock);
+      req = tcp_queue;
+      tcp_queue = req->next;
+      if (! tcp_queue)
+	tcp_queue_tail = &tcp_queue;
+      pthread_mutex_unlock (&tcp_queue_lock);
+
+      conn = req->conn;
+      cr = process_request (req->data, req->len, &conn->peer);
+
+      /* Hand the reply to the connection's writer rather than sending it
+	 here, so that this thread is free for the next request however
+	 slowly the client reads.  */
+      reply = 0;
+      if (cr)
 	{
-	  /* Procedure unavailable.  */
-	  *(r++) = xid;
-	  *(r++) = htonl (REPLY);
-	  *(r++) = htonl (MSG_ACCEPTED);
-	  *(r++) = htonl (AUTH_NULL);
-	  *(r++) = htonl (0);
-	  *(r++) = htonl (PROC_UNAVAIL);
-	  *(r++) = htonl (table->min);
-	  *(r++) = htonl (table->max);
-	  goto send_reply;
+	  reply = malloc (sizeof *reply + cr->len);
+	  if (reply)
+	    {
+	      reply->next = 0;
+	      reply->len = cr->len;
+	      memcpy (reply->data, cr->data, cr->len);
+	    }
+	  release_cached_reply (cr);
 	}
-      proc = &table->procs[procedure - table->min];
-
-      p = process_cred (p, &cred);
+      free (req);
 
-      if (proc->need_handle)
-	p = lookup_cache_handle (p, &c, cred);
+      /* While PENDING counts this request, the writer, which holds a
+	 reference, is still there.  */
+      pthread_mutex_lock (&conn->lock);
+      if (reply)
+	{
+	  *conn->replies_tail = reply;
+	  conn->replies_tail = &reply->next;
+	}
       else
 	{
-	  fakec.ids = cred;
-	  c = &fakec;
+	  /* Nothing to send; the client will retransmit if it cares.  */
+	  conn->pending--;
+	  pthread_cond_signal (&conn->wakeup);
 	}
+      pthread_cond_signal (&conn->replies_wakeup);
+      pthread_mutex_unlock (&conn->lock);
+    }
+
+  return 0;
+}
 
-      if (proc->alloc_reply)
+/* Take connections on the TCP socket ARG, forever, with a thread to read
+   each one.  */
+void *
+tcp_accept_loop (void *arg)
+{
+  int fd = (int) arg;
+
+  for (;;)
+    {
+      struct tcp_conn *conn;
+      socklen_t addrlen = sizeof conn->peer;
+      pthread_t thread;
+      int one = 1;
+
+      conn = malloc (sizeof *conn);
+      if (! conn)
 	{
-	  size_t amt;
-	  amt = (*proc->alloc_reply) (p, version) + 256;
-	  if (amt > MAXIOSIZE)
-	    {
-	      free (rbuf);
-	      r = (int *) (rbuf = malloc (amt));
-	    }
+	  sleep (1);
+	  continue;
 	}
 
-      /* Fill in beginning of reply.  */
-      *(r++) = xid;
-      *(r++) = htonl (REPLY);
-      *(r++) = htonl (MSG_ACCEPTED);
-      *(r++) = htonl (AUTH_NULL);
-      *(r++) = htonl (0);
-      *(r++) = htonl (SUCCESS);
-      if (!proc->process_error)
-	/* The function does its own error processing, and we ignore
-	   its return value.  */
-	(void) (*proc->func) (c, p, &r, version);
-      else
+      conn->fd = accept (fd, (struct sockaddr *) &conn->peer, &addrlen);
+      if (conn->fd == -1)
 	{
-	  if (c)
-	    {
-	      /* Assume success for now and patch it later if necessary.  */
-	      int *errloc = r;
-	      *(r++) = htonl (0);
-	      /* Call processing function, its output after error code.  */
-	      err = (*proc->func) (c, p, &r, version);
-	      if (err)
-		{
-		  r = errloc;	/* Back up, patch error code, discard rest.  */
-		  *(r++) = htonl (nfs_error_trans (err, version));
-		}
-	    }
-	  else
-	    *(r++) = htonl (nfs_error_trans (ESTALE, version));
+	  free (conn);
+	  continue;
 	}
+      setsockopt (conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
 
-      cred_rele (cred);
-      if (c && c != &fakec)
-	cache_handle_rele (c);
+      pthread_mutex_init (&conn->lock, NULL);
+      pthread_cond_init (&conn->wakeup, NULL);
+      pthread_cond_init (&conn->replies_wakeup, NULL);
+      conn->references = 2;
+      conn->reading = 1;
+      conn->pending = 0;
+      conn->replies = 0;
+      conn->replies_tail = &conn->replies;
 
-    send_reply:
-      cr->data = rbuf;
-      cr->len = (char *)r - rbuf;
+      if (pthread_create (&thread, NULL, tcp_conn_writer, conn))
+	{
+	  close (conn->fd);
+	  free (conn);
+	  continue;
+	}
+      pthread_detach (thread);
 
-    repost_reply:
-      sendto (fd, cr->data, cr->len, 0,
-	      (struct sockaddr *) &sender, addrlen);
-      release_cached_reply (cr);
+      if (pthread_create (&thread, NULL, tcp_conn_loop, conn))
+	{
+	  /* Let the writer go, and CONN with it.  */
+	  pthread_mutex_lock (&conn->lock);
+	  conn->reading = 0;
+	  pthread_cond_signal (&conn->replies_wakeup);
+	  tcp_conn_rele (conn);
+	  continue;
+	}
+      pthread_detach (thread);
     }
+
+  return 0;
 }
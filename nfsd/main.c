@@ -31,20 +31,22 @@
 volatile struct mapped_time_value *mapped_time;
 
 int main_udp_socket, pmap_udp_socket;
+int main_tcp_socket;
 struct sockaddr_in main_address, pmap_address;
+int write_verifier[NFS3_WRITEVERFSIZE / sizeof (int)];
 static char index_file[] = LOCALSTATEDIR "/state/misc/nfsd.index";
 char *index_file_name = index_file;
 
 auth_t authserver;
 
-/* Launch a server loop thread */
+/* Launch a server loop thread running FN on SOCKET */
 static void
-create_server_thread (int socket)
+create_server_thread (void *(*fn) (void *), int socket)
 {
   pthread_t thread;
   int fail;
 
-  fail = pthread_create (&thread, NULL, server_loop, (void *) socket);
+  fail = pthread_create (&thread, NULL, fn, (void *) socket);
   if (fail)
     error (1, fail, "Creating main server thread");
 
@@ -58,6 +60,7 @@ main (int argc, char **argv)
 {
   int nthreads;
   int fail;
+  int one = 1;
 
   if (argc > 2)
     {
@@ -88,6 +91,21 @@ main (int argc, char **argv)
   if (fail)
     error (1, errno, "Binding NFS socket");
 
+  main_tcp_socket = socket (PF_INET, SOCK_STREAM, 0);
+  fail = setsockopt (main_tcp_socket, SOL_SOCKET, SO_REUSEADDR,
+		     &one, sizeof one);
+  if (!fail)
+    fail = bind (main_tcp_socket, (struct sockaddr *)&main_address,
+		 sizeof (struct sockaddr_in));
+  if (!fail)
+    fail = listen (main_tcp_socket, SOMAXCONN);
+  if (fail)
+    error (1, errno, "Binding NFS TCP socket");
+
+  /* Anything that changes from one run to the next will do.  */
+  write_verifier[0] = mapped_time->seconds;
+  write_verifier[1] = getpid ();
+
   fail = bind (pmap_udp_socket, (struct sockaddr *)&pmap_address,
 	       sizeof (struct sockaddr_in));
   if (fail)
@@ -95,10 +113,14 @@ main (int argc, char **argv)
 
   init_filesystems ();
 
-  create_server_thread (pmap_udp_socket);
+  create_server_thread (server_loop, pmap_udp_socket);
+  create_server_thread (tcp_accept_loop, main_tcp_socket);
 
   while (nthreads--)
-    create_server_thread (main_udp_socket);
+    {
+      create_server_thread (server_loop, main_udp_socket);
+      create_server_thread (tcp_worker, -1);
+    }
 
   for (;;)
     {
@@ -31,7 +31,8 @@
 #define ID_KEEP_TIMEOUT 3600	/* one hour */
 #define FH_KEEP_TIMEOUT 600	/* ten minutes */
 #define REPLY_KEEP_TIMEOUT 120	/* two minutes */
-#define MAXIOSIZE 10240
+#define MAXDATA 65536		/* Most data to read or write at once.  */
+#define MAXIOSIZE (MAXDATA + 1024)
 
 struct idspec
 {
@@ -69,12 +70,16 @@ struct cached_reply
   char *data;
 };
 
+/* FUNC and ALLOC_REPLY are given the arguments of the call, up to END,
+   just after the last of them; FUNC returns EBADRPC if they run past
+   it, or don't otherwise make sense as XDR, and ALLOC_REPLY returns 0.  */
 struct procedure
 {
-  error_t (*func) (struct cache_handle *, int *, int **, int);
-  size_t (*alloc_reply) (int *, int);
+  error_t (*func) (struct cache_handle *, int *, int *, int **, int);
+  size_t (*alloc_reply) (int *, int *, int);
   int need_handle;
   int process_error;
+  int fail_size;		/* Words of empty results after an error.  */
 };
 
 struct proctable
@@ -93,6 +98,14 @@ extern volatile struct mapped_time_value *mapped_time;
 extern int main_udp_socket, pmap_udp_socket;
 extern struct sockaddr_in main_address, pmap_address;
 
+/* Listening socket for RPCs over TCP, on the same port as
+   MAIN_UDP_SOCKET.  */
+extern int main_tcp_socket;
+
+/* Given back to NFSv3 clients with unstable writes; it changes when we
+   restart, telling them to write anything not committed again.  */
+extern int write_verifier[NFS3_WRITEVERFSIZE / sizeof (int)];
+
 /* Name of the file on disk containing the filesystem index table */
 extern char *index_file_name;
 
@@ -101,11 +114,12 @@ extern auth_t authserver;
 
 
 /* cache.c */
-int *process_cred (int *, struct idspec **);
+int *process_cred (int *, int *, struct idspec **);
 void cred_rele (struct idspec *);
 void cred_ref (struct idspec *);
 void scan_creds (void);
-int *lookup_cache_handle (int *, struct cache_handle **, struct idspec *);
+int *lookup_cache_handle (int *, int *, struct cache_handle **,
+			  struct idspec *, int);
 void cache_handle_rele (struct cache_handle *);
 void scan_fhs (void);
 struct cache_handle *create_cached_handle (int, struct cache_handle *, file_t);
@@ -115,18 +129,26 @@ void scan_replies (void);
 
 /* loop.c */
 void * server_loop (void *);
+void * tcp_accept_loop (void *);
+void * tcp_worker (void *);
 
 /* ops.c */
 extern struct proctable nfs2table, mounttable, pmaptable;
+error_t set_times (mach_port_t, struct timespec, struct timespec);
+
+/* ops3.c */
+extern struct proctable nfs3table;
 
 /* xdr.c */
 int nfs_error_trans (error_t, int);
 int *encode_fattr (int *, struct stat *, int version);
-int *decode_name (int *, char **);
-int *encode_fhandle (int *, char *);
+int *decode_name (int *, int *, char **);
+int *encode_fhandle (int *, char *, int);
 int *encode_string (int *, char *);
 int *encode_data (int *, char *, size_t);
 int *encode_statfs (int *, struct statfs *);
+int *encode_64bit (int *, long long);
+int *decode_64bit (int *, long long *);
 
 /* fsys.c */
 fsys_t lookup_filesystem (int);
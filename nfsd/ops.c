@@ -32,11 +32,13 @@
 #include "nfsd.h"
 #include "../nfs/mount.h" /* XXX */
 #include <rpc/xdr.h>
+#include <rpc/auth.h>
 #include <rpc/pmap_prot.h>
 
 static error_t
 op_null (struct cache_handle *c,
 	 int *p,
+	 int *end,
 	 int **reply,
 	 int version)
 {
@@ -46,6 +48,7 @@ op_null (struct cache_handle *c,
 static error_t
 op_getattr (struct cache_handle *c,
 	    int *p,
+	    int *end,
 	    int **reply,
 	    int version)
 {
@@ -58,6 +61,29 @@ op_getattr (struct cache_handle *c,
   return err;
 }
 
+/* Set the access and modification times of PORT to ATIME and MTIME.  */
+error_t
+set_times (mach_port_t port, struct timespec atime, struct timespec mtime)
+{
+  error_t err;
+
+#ifdef HAVE_FILE_UTIMENS
+  err = file_utimens (port, atime, mtime);
+
+  if (err == MIG_BAD_ID || err == EOPNOTSUPP)
+#endif
+    {
+      time_value_t atim, mtim;
+
+      TIMESPEC_TO_TIME_VALUE (&atim, &atime);
+      TIMESPEC_TO_TIME_VALUE (&mtim, &mtime);
+
+      err = file_utimes (port, atim, mtim);
+    }
+
+  return err;
+}
+
 static error_t
 complete_setattr (mach_port_t port,
 		  int *p)
@@ -119,21 +145,7 @@ complete_setattr (mach_port_t port,
       || atime.tv_nsec != st.st_atim.tv_nsec
       || mtime.tv_sec != st.st_mtim.tv_sec
       || mtime.tv_nsec != st.st_mtim.tv_nsec)
-    {
-#ifdef HAVE_FILE_UTIMENS
-      err = file_utimens (port, atime, mtime);
-
-      if (err == MIG_BAD_ID || err == EOPNOTSUPP)
-#endif
-        {
-          time_value_t atim, mtim;
-
-          TIMESPEC_TO_TIME_VALUE (&atim, &atime);
-          TIMESPEC_TO_TIME_VALUE (&mtim, &mtime);
-
-          err = file_utimes (port, atim, mtim);
-        }
-    }
+    err = set_times (port, atime, mtime);
 
   return err;
 }
@@ -141,6 +153,7 @@ complete_setattr (mach_port_t port,
 static error_t
 op_setattr (struct cache_handle *c,
 	    int *p,
+	    int *end,
 	    int **reply,
 	    int version)
 {
@@ -148,6 +161,9 @@ op_setattr (struct cache_handle *c,
   mode_t mode;
   struct stat st;
 
+  /* A whole sattr.  */
+  if (p + 8 > end)
+    return EBADRPC;
   mode = ntohl (*p);
   p++;
   if (mode != -1)
@@ -167,6 +183,7 @@ op_setattr (struct cache_handle *c,
 static error_t
 op_lookup (struct cache_handle *c,
 	   int *p,
+	   int *end,
 	   int **reply,
 	   int version)
 {
@@ -178,7 +195,8 @@ op_lookup (struct cache_handle *c,
   struct cache_handle *newc;
   struct stat st;
 
-  decode_name (p, &name);
+  if (! decode_name (p, end, &name))
+    return EBADRPC;
 
   err = dir_lookup (c->port, name, O_NOTRANS, 0, &do_retry, retry_name,
 		    &newport);
@@ -199,7 +217,7 @@ op_lookup (struct cache_handle *c,
   newc = create_cached_handle (c->handle.fs, c, newport);
   if (!newc)
     return ESTALE;
-  *reply = encode_fhandle (*reply, newc->handle.array);
+  *reply = encode_fhandle (*reply, newc->handle.array, version);
   *reply = encode_fattr (*reply, &st, version);
   return 0;
 }
@@ -207,6 +225,7 @@ op_lookup (struct cache_handle *c,
 static error_t
 op_readlink (struct cache_handle *c,
 	     int *p,
+	     int *end,
 	     int **reply,
 	     int version)
 {
@@ -238,15 +257,21 @@ op_readlink (struct cache_handle *c,
 }
 
 static size_t
-count_read_buffersize (int *p, int version)
+count_read_buffersize (int *p, int *end, int version)
 {
+  size_t count;
+
+  if (p + 2 > end)
+    return 0;
   p++;			/* Skip OFFSET.  */
-  return ntohl (*p);	/* Return COUNT.  */
+  count = ntohl (*p);	/* Return COUNT.  */
+  return count > MAXDATA ? MAXDATA : count;
 }
 
 static error_t
 op_read (struct cache_handle *c,
 	 int *p,
+	 int *end,
 	 int **reply,
 	 int version)
 {
@@ -257,10 +282,15 @@ op_read (struct cache_handle *c,
   struct stat st;
   error_t err;
 
+  /* OFFSET, COUNT and TOTALCOUNT.  */
+  if (p + 3 > end)
+    return EBADRPC;
   offset = ntohl (*p);
   p++;
   count = ntohl (*p);
   p++;
+  if (count > MAXDATA)
+    count = MAXDATA;
 
   err = io_read (c->port, &bp, &buflen, offset, count);
   if (err)
@@ -286,6 +316,7 @@ op_read (struct cache_handle *c,
 static error_t
 op_write (struct cache_handle *c,
 	  int *p,
+	  int *end,
 	  int **reply,
 	  int version)
 {
@@ -296,13 +327,19 @@ op_write (struct cache_handle *c,
   char *bp;
   struct stat st;
 
+  if (p + 4 > end)
+    return EBADRPC;
   p++;
   offset = ntohl (*p);
   p++;
   p++;
   count = ntohl (*p);
   p++;
-  bp = (char *) *reply;
+  if (count > MAXDATA)
+    return EINVAL;
+  if (INTSIZE (count) > end - p)
+    return EBADRPC;
+  bp = (char *) p;
 
   while (count)
     {
@@ -328,6 +365,7 @@ op_write (struct cache_handle *c,
 static error_t
 op_create (struct cache_handle *c,
 	   int *p,
+	   int *end,
 	   int **reply,
 	   int version)
 {
@@ -342,7 +380,12 @@ op_create (struct cache_handle *c,
   int statchanged = 0;
   off_t size;
 
-  p = decode_name (p, &name);
+  p = decode_name (p, end, &name);
+  if (!p || p + 8 > end)
+    {
+      free (name);
+      return EBADRPC;
+    }
   mode = ntohl (*p);
   p++;
 
@@ -394,7 +437,7 @@ op_create (struct cache_handle *c,
   if (!newc)
     return ESTALE;
 
-  *reply = encode_fhandle (*reply, newc->handle.array);
+  *reply = encode_fhandle (*reply, newc->handle.array, version);
   *reply = encode_fattr (*reply, &st, version);
   return 0;
 }
@@ -402,13 +445,15 @@ op_create (struct cache_handle *c,
 static error_t
 op_remove (struct cache_handle *c,
 	   int *p,
+	   int *end,
 	   int **reply,
 	   int version)
 {
   error_t err;
   char *name;
 
-  decode_name (p, &name);
+  if (! decode_name (p, end, &name))
+    return EBADRPC;
 
   err = dir_unlink (c->port, name);
   free (name);
@@ -419,6 +464,7 @@ op_remove (struct cache_handle *c,
 static error_t
 op_rename (struct cache_handle *fromc,
 	   int *p,
+	   int *end,
 	   int **reply,
 	   int version)
 {
@@ -426,11 +472,17 @@ op_rename (struct cache_handle *fromc,
   char *fromname, *toname;
   error_t err = 0;
 
-  p = decode_name (p, &fromname);
-  p = lookup_cache_handle (p, &toc, fromc->ids);
-  decode_name (p, &toname);
-
-  if (!toc)
+  toc = 0;
+  toname = 0;
+  p = decode_name (p, end, &fromname);
+  if (p)
+    p = lookup_cache_handle (p, end, &toc, fromc->ids, version);
+  if (p)
+    p = decode_name (p, end, &toname);
+
+  if (!p)
+    err = EBADRPC;
+  else if (!toc)
     err = ESTALE;
   if (!err)
     err = dir_rename (fromc->port, fromname, toc->port, toname, 0);
@@ -442,6 +494,7 @@ op_rename (struct cache_handle *fromc,
 static error_t
 op_link (struct cache_handle *filec,
 	 int *p,
+	 int *end,
 	 int **reply,
 	 int version)
 {
@@ -449,10 +502,14 @@ op_link (struct cache_handle *filec,
   char *name;
   error_t err = 0;
 
-  p = lookup_cache_handle (p, &dirc, filec->ids);
-  decode_name (p, &name);
+  name = 0;
+  p = lookup_cache_handle (p, end, &dirc, filec->ids, version);
+  if (p)
+    p = decode_name (p, end, &name);
 
-  if (!dirc)
+  if (!p)
+    err = EBADRPC;
+  else if (!dirc)
     err = ESTALE;
   if (!err)
     err = dir_link (dirc->port, filec->port, name, 1);
@@ -464,6 +521,7 @@ op_link (struct cache_handle *filec,
 static error_t
 op_symlink (struct cache_handle *c,
 	    int *p,
+	    int *end,
 	    int **reply,
 	    int version)
 {
@@ -474,8 +532,16 @@ op_symlink (struct cache_handle *c,
   size_t len;
   char *buf;
 
-  p = decode_name (p, &name);
-  p = decode_name (p, &target);
+  target = 0;
+  p = decode_name (p, end, &name);
+  if (p)
+    p = decode_name (p, end, &target);
+  if (!p || p + 8 > end)
+    {
+      free (name);
+      free (target);
+      return EBADRPC;
+    }
   mode = ntohl (*p);
   p++;
   if (mode == -1)
@@ -507,6 +573,7 @@ op_symlink (struct cache_handle *c,
 static error_t
 op_mkdir (struct cache_handle *c,
 	  int *p,
+	  int *end,
 	  int **reply,
 	  int version)
 {
@@ -519,7 +586,12 @@ op_mkdir (struct cache_handle *c,
   struct cache_handle *newc;
   error_t err;
 
-  p = decode_name (p, &name);
+  p = decode_name (p, end, &name);
+  if (!p || p + 8 > end)
+    {
+      free (name);
+      return EBADRPC;
+    }
   mode = ntohl (*p);
   p++;
 
@@ -551,7 +623,7 @@ op_mkdir (struct cache_handle *c,
   newc = create_cached_handle (c->handle.fs, c, newport);
   if (!newc)
     return ESTALE;
-  *reply = encode_fhandle (*reply, newc->handle.array);
+  *reply = encode_fhandle (*reply, newc->handle.array, version);
   *reply = encode_fattr (*reply, &st, version);
   return 0;
 }
@@ -559,13 +631,15 @@ op_mkdir (struct cache_handle *c,
 static error_t
 op_rmdir (struct cache_handle *c,
 	  int *p,
+	  int *end,
 	  int **reply,
 	  int version)
 {
   char *name;
   error_t err;
 
-  decode_name (p, &name);
+  if (! decode_name (p, end, &name))
+    return EBADRPC;
 
   err = dir_rmdir (c->port, name);
   free (name);
@@ -575,6 +649,7 @@ op_rmdir (struct cache_handle *c,
 static error_t
 op_readdir (struct cache_handle *c,
 	    int *p,
+	    int *end,
 	    int **reply,
 	    int version)
 {
@@ -589,10 +664,14 @@ op_readdir (struct cache_handle *c,
   int *replystart;
   int *r;
 
+  if (p + 2 > end)
+    return EBADRPC;
   cookie = ntohl (*p);
   p++;
   count = ntohl (*p);
   p++;
+  if (count > MAXDATA)
+    count = MAXDATA;
 
   buf = (char *) 0;
   bufsize = 0;
@@ -637,15 +716,21 @@ op_readdir (struct cache_handle *c,
 }
 
 static size_t
-count_readdir_buffersize (int *p, int version)
+count_readdir_buffersize (int *p, int *end, int version)
 {
+  size_t count;
+
+  if (p + 2 > end)
+    return 0;
   p++;			/* Skip COOKIE.  */
-  return ntohl (*p);	/* Return COUNT.  */
+  count = ntohl (*p);	/* Return COUNT.  */
+  return count > MAXDATA ? MAXDATA : count;
 }
 
 static error_t
 op_statfs (struct cache_handle *c,
 	   int *p,
+	   int *end,
 	   int **reply,
 	   int version)
 {
@@ -661,6 +746,7 @@ op_statfs (struct cache_handle *c,
 static error_t
 op_mnt (struct cache_handle *c,
 	int *p,
+	int *end,
 	int **reply,
 	int version)
 {
@@ -668,7 +754,8 @@ op_mnt (struct cache_handle *c,
   struct cache_handle *newc;
   char *name;
 
-  decode_name (p, &name);
+  if (! decode_name (p, end, &name))
+    return EBADRPC;
 
   root = file_name_lookup (name, 0, 0);
   if (!root)
@@ -681,18 +768,30 @@ op_mnt (struct cache_handle *c,
   free (name);
   if (!newc)
     return ESTALE;
-  *reply = encode_fhandle (*reply, newc->handle.array);
+  if (version == MOUNTVERS3)
+    {
+      *reply = encode_fhandle (*reply, newc->handle.array, 3);
+      /* The one flavor of authentication we take.  */
+      *(*reply)++ = htonl (1);
+      *(*reply)++ = htonl (AUTH_UNIX);
+    }
+  else
+    *reply = encode_fhandle (*reply, newc->handle.array, 2);
   return 0;
 }
 
 static error_t
 op_getport (struct cache_handle *c,
 	    int *p,
+	    int *end,
 	    int **reply,
 	    int version)
 {
   int prog, vers, prot;
 
+  /* PROG, VERS, PROT and PORT.  */
+  if (p + 4 > end)
+    return EBADRPC;
   prog = ntohl (*p);
   p++;
   vers = ntohl (*p);
@@ -700,12 +799,15 @@ op_getport (struct cache_handle *c,
   prot = ntohl (*p);
   p++;
 
-  if (prot != IPPROTO_UDP)
+  /* Everything but the portmapper is served on NFS_PORT, over both UDP
+     and TCP.  */
+  if (prot != IPPROTO_UDP && prot != IPPROTO_TCP)
     *(*reply)++ = htonl (0);
-  else if ((prog == MOUNTPROG && vers == MOUNTVERS)
-	   || (prog == NFS_PROGRAM && vers == NFS_VERSION))
+  else if ((prog == MOUNTPROG && vers >= MOUNTVERS && vers <= MOUNTVERS3)
+	   || (prog == NFS_PROGRAM
+	       && (vers == NFS_VERSION || vers == NFS3_VERSION)))
     *(*reply)++ = htonl (NFS_PORT);
-  else if (prog == PMAPPROG && vers == PMAPVERS)
+  else if (prog == PMAPPROG && vers == PMAPVERS && prot == IPPROTO_UDP)
     *(*reply)++ = htonl (PMAPPORT);
   else
     *(*reply)++ = 0;
@@ -0,0 +1,1159 @@
+/* ops3.c NFS daemon protocol operations, version 3 (RFC 1813).
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111, USA. */
+
+#include <hurd/io.h>
+#include <hurd/fs.h>
+#include <fcntl.h>
+#include <hurd/paths.h>
+#include <hurd.h>
+#include <dirent.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/statfs.h>
+
+#include "nfsd.h"
+
+/* Bits in the PROPERTIES of an FSINFO reply.  */
+#define FSF3_LINK	0x0001
+#define FSF3_SYMLINK	0x0002
+#define FSF3_HOMOGENEOUS 0x0008
+#define FSF3_CANSETTIME	0x0010
+
+/* Room taken in a READDIR or READDIRPLUS reply by everything but the
+   entries, and by each entry but for its name.  */
+#define READDIR_OVERHEAD	(4 * (3 + 22 + 2 + 2))
+#define READDIR_ENTRY_SIZE	(4 * (1 + 2 + 1 + 2))
+#define READDIRPLUS_ENTRY_SIZE	(READDIR_ENTRY_SIZE \
+				 + 4 * (1 + 21 + 1 + 1 + INTSIZE (NFS2_FHSIZE)))
+
+/* A sattr3: which attributes to set, and to what.  */
+struct sattr3
+{
+  int set_mode, set_uid, set_gid, set_size;
+  mode_t mode;
+  uid_t uid;
+  gid_t gid;
+  off_t size;
+  int set_atime, set_mtime;	/* enum sattr_time_how */
+  struct timespec atime, mtime;
+};
+
+/* Encode the attributes of PORT as a post_op_attr into P and return the
+   next thing to come after it.  */
+static int *
+encode_post_op_attr (int *p, file_t port)
+{
+  struct stat st;
+
+  if (port != MACH_PORT_NULL && !io_stat (port, &st))
+    {
+      *(p++) = htonl (1);
+      return encode_fattr (p, &st, 3);
+    }
+
+  *(p++) = 0;
+  return p;
+}
+
+/* Encode the wcc_data of PORT into P and return the next thing to come
+   after it.  We don't look at the attributes before an operation, so
+   there are only those after it.  */
+static int *
+encode_wcc_data (int *p, file_t port)
+{
+  *(p++) = 0;			/* No pre_op_attr.  */
+  return encode_post_op_attr (p, port);
+}
+
+/* Decode P into SA and return the next thing to come after it, or 0 if
+   it runs past END.  */
+static int *
+decode_sattr3 (int *p, int *end, struct sattr3 *sa)
+{
+  long long size;
+
+  if (p >= end)
+    return 0;
+  sa->set_mode = ntohl (*p);
+  p++;
+  if (sa->set_mode)
+    {
+      if (p >= end)
+	return 0;
+      sa->mode = ntohl (*(p++));
+    }
+
+  if (p >= end)
+    return 0;
+  sa->set_uid = ntohl (*p);
+  p++;
+  if (sa->set_uid)
+    {
+      if (p >= end)
+	return 0;
+      sa->uid = ntohl (*(p++));
+    }
+
+  if (p >= end)
+    return 0;
+  sa->set_gid = ntohl (*p);
+  p++;
+  if (sa->set_gid)
+    {
+      if (p >= end)
+	return 0;
+      sa->gid = ntohl (*(p++));
+    }
+
+  if (p >= end)
+    return 0;
+  sa->set_size = ntohl (*p);
+  p++;
+  if (sa->set_size)
+    {
+      if (p + 2 > end)
+	return 0;
+      p = decode_64bit (p, &size);
+      sa->size = size;
+    }
+
+  if (p >= end)
+    return 0;
+  sa->set_atime = ntohl (*p);
+  p++;
+  if (sa->set_atime == SET_TO_CLIENT_TIME)
+    {
+      if (p + 2 > end)
+	return 0;
+      sa->atime.tv_sec = ntohl (*(p++));
+      sa->atime.tv_nsec = ntohl (*(p++));
+    }
+
+  if (p >= end)
+    return 0;
+  sa->set_mtime = ntohl (*p);
+  p++;
+  if (sa->set_mtime == SET_TO_CLIENT_TIME)
+    {
+      if (p + 2 > end)
+	return 0;
+      sa->mtime.tv_sec = ntohl (*(p++));
+      sa->mtime.tv_nsec = ntohl (*(p++));
+    }
+
+  return p;
+}
+
+/* Set the attributes of PORT as SA says.  Unless SET_MODE is set, any
+   mode in SA is left alone.  */
+static error_t
+apply_sattr3 (file_t port, struct sattr3 *sa, int set_mode)
+{
+  struct stat st;
+  error_t err;
+
+  err = io_stat (port, &st);
+  if (err)
+    return err;
+
+  if (set_mode && sa->set_mode && sa->mode != (st.st_mode & 07777))
+    err = file_chmod (port, sa->mode);
+
+  if (!err && (sa->set_uid || sa->set_gid))
+    {
+      uid_t uid = sa->set_uid ? sa->uid : st.st_uid;
+      gid_t gid = sa->set_gid ? sa->gid : st.st_gid;
+
+      if (uid != st.st_uid || gid != st.st_gid)
+	err = file_chown (port, uid, gid);
+    }
+
+  if (!err && sa->set_size && sa->size != st.st_size)
+    err = file_set_size (port, sa->size);
+
+  if (!err && (sa->set_atime || sa->set_mtime))
+    {
+      struct timespec now, atime = st.st_atim, mtime = st.st_mtim;
+
+      now.tv_sec = mapped_time->seconds;
+      now.tv_nsec = mapped_time->microseconds * 1000;
+
+      if (sa->set_atime == SET_TO_SERVER_TIME)
+	atime = now;
+      else if (sa->set_atime == SET_TO_CLIENT_TIME)
+	atime = sa->atime;
+      if (sa->set_mtime == SET_TO_SERVER_TIME)
+	mtime = now;
+      else if (sa->set_mtime == SET_TO_CLIENT_TIME)
+	mtime = sa->mtime;
+
+      err = set_times (port, atime, mtime);
+    }
+
+  return err;
+}
+
+/* Look up NAME in DIR, with FLAGS and MODE as for dir_lookup, and return
+   the port in *PORT.  Only plain files in the same filesystem are
+   found.  */
+static error_t
+lookup (file_t dir, char *name, int flags, mode_t mode, file_t *port)
+{
+  retry_type do_retry;
+  char retry_name [1024];
+  error_t err;
+
+  err = dir_lookup (dir, name, flags | O_NOTRANS, mode, &do_retry,
+		    retry_name, port);
+
+  /* Block attempts to bounce out of this filesystem by any technique.  */
+  if (!err
+      && (do_retry != FS_RETRY_NORMAL
+	  || retry_name[0] != '\0'))
+    {
+      mach_port_deallocate (mach_task_self (), *port);
+      err = EACCES;
+    }
+
+  return err;
+}
+
+/* Encode a handle for PORT, as a post_op_fh3, into P and return the next
+   thing to come after it.  PORT is consumed.  C is the handle PORT was
+   found through.  */
+static int *
+encode_post_op_fh (int *p, struct cache_handle *c, file_t port)
+{
+  struct cache_handle *newc;
+
+  newc = create_cached_handle (c->handle.fs, c, port);
+  if (! newc)
+    {
+      *(p++) = 0;
+      return p;
+    }
+
+  *(p++) = htonl (1);
+  p = encode_fhandle (p, newc->handle.array, 3);
+  cache_handle_rele (newc);
+  return p;
+}
+
+/* Encode a handle for the new file PORT and its attributes into P, as
+   the CREATE, MKDIR and SYMLINK replies have them, and return the next
+   thing to come after them.  PORT is consumed.  */
+static int *
+encode_new_handle (int *p, struct cache_handle *c, file_t port)
+{
+  struct stat st;
+
+  if (io_stat (port, &st))
+    {
+      mach_port_deallocate (mach_task_self (), port);
+      *(p++) = 0;		/* No handle.  */
+      *(p++) = 0;		/* No attributes.  */
+      return p;
+    }
+
+  p = encode_post_op_fh (p, c, port);
+  *(p++) = htonl (1);
+  return encode_fattr (p, &st, 3);
+}
+
+static error_t
+op_getattr3 (struct cache_handle *c,
+	     int *p,
+	     int *end,
+	     int **reply,
+	     int version)
+{
+  struct stat st;
+  error_t err;
+
+  err = io_stat (c->port, &st);
+  if (!err)
+    *reply = encode_fattr (*reply, &st, version);
+  return err;
+}
+
+/* This does its own error processing, to give back NFSERR_NOT_SYNC.  */
+static error_t
+op_setattr3 (struct cache_handle *c,
+	     int *p,
+	     int *end,
+	     int **reply,
+	     int version)
+{
+  struct sattr3 sa;
+  struct stat st;
+  int status = NFS_OK;
+  error_t err = 0;
+
+  if (! c)
+    {
+      *(*reply)++ = htonl (NFSERR_STALE);
+      *reply = encode_wcc_data (*reply, MACH_PORT_NULL);
+      return 0;
+    }
+
+  p = decode_sattr3 (p, end, &sa);
+  if (!p || p >= end)
+    return EBADRPC;
+
+  /* The guard: only go ahead if the ctime is as the client thinks.  */
+  if (ntohl (*p))
+    {
+      p++;
+      if (p + 2 > end)
+	return EBADRPC;
+      err = io_stat (c->port, &st);
+      if (!err
+	  && (st.st_ctim.tv_sec != ntohl (p[0])
+	      || st.st_ctim.tv_nsec != ntohl (p[1])))
+	status = NFSERR_NOT_SYNC;
+    }
+
+  if (!err && status == NFS_OK)
+    err = apply_sattr3 (c->port, &sa, 1);
+  if (err)
+    status = nfs_error_trans (err, version);
+
+  *(*reply)++ = htonl (status);
+  *reply = encode_wcc_data (*reply, c->port);
+  return 0;
+}
+
+static error_t
+op_lookup3 (struct cache_handle *c,
+	    int *p,
+	    int *end,
+	    int **reply,
+	    int version)
+{
+  error_t err;
+  char *name;
+  file_t newport;
+  struct cache_handle *newc;
+  struct stat st;
+
+  if (! decode_name (p, end, &name))
+    return EBADRPC;
+  err = lookup (c->port, name, 0, 0, &newport);
+  free (name);
+
+  if (!err)
+    {
+      err = io_stat (newport, &st);
+      if (err)
+	mach_port_deallocate (mach_task_self (), newport);
+    }
+  if (err)
+    return err;
+
+  newc = create_cached_handle (c->handle.fs, c, newport);
+  if (!newc)
+    return ESTALE;
+  *reply = encode_fhandle (*reply, newc->handle.array, version);
+  cache_handle_rele (newc);
+
+  *(*reply)++ = htonl (1);
+  *reply = encode_fattr (*reply, &st, version);
+  *reply = encode_post_op_attr (*reply, c->port);
+  return 0;
+}
+
+static error_t
+op_access3 (struct cache_handle *c,
+	    int *p,
+	    int *end,
+	    int **reply,
+	    int version)
+{
+  int want, allowed, access = 0;
+  struct stat st;
+  error_t err;
+
+  if (p >= end)
+    return EBADRPC;
+  want = ntohl (*p);
+
+  err = io_stat (c->port, &st);
+  if (!err)
+    err = file_check_access (c->port, &allowed);
+  if (err)
+    return err;
+
+  if (allowed & O_READ)
+    access |= ACCESS3_READ;
+  if (allowed & O_WRITE)
+    access |= ACCESS3_MODIFY | ACCESS3_EXTEND;
+  if (S_ISDIR (st.st_mode))
+    {
+      if (allowed & O_EXEC)
+	access |= ACCESS3_LOOKUP;
+      if (allowed & O_WRITE)
+	access |= ACCESS3_DELETE;
+    }
+  else if (allowed & O_EXEC)
+    access |= ACCESS3_EXECUTE;
+
+  *(*reply)++ = htonl (1);
+  *reply = encode_fattr (*reply, &st, version);
+  *(*reply)++ = htonl (access & want);
+  return 0;
+}
+
+static error_t
+op_readlink3 (struct cache_handle *c,
+	      int *p,
+	      int *end,
+	      int **reply,
+	      int version)
+{
+  char buf[2048], *transp = buf;
+  mach_msg_type_number_t len = sizeof (buf);
+  error_t err;
+
+  err = file_get_translator (c->port, &transp, &len);
+  if (!err
+      && (len < sizeof (_HURD_SYMLINK)
+	  || memcmp (transp, _HURD_SYMLINK, sizeof (_HURD_SYMLINK))))
+    err = EINVAL;
+
+  if (!err)
+    {
+      *reply = encode_post_op_attr (*reply, c->port);
+      *reply = encode_string (*reply, transp + sizeof (_HURD_SYMLINK));
+    }
+
+  if (transp != buf)
+    munmap (transp, len);
+
+  return err;
+}
+
+static size_t
+count_read3_buffersize (int *p, int *end, int version)
+{
+  size_t count;
+
+  if (p + 3 > end)
+    return 0;
+  p += 2;			/* Skip OFFSET.  */
+  count = ntohl (*p);		/* Return COUNT.  */
+  return count > MAXDATA ? MAXDATA : count;
+}
+
+static error_t
+op_read3 (struct cache_handle *c,
+	  int *p,
+	  int *end,
+	  int **reply,
+	  int version)
+{
+  long long offset;
+  size_t count;
+  char buf[2048], *bp = buf;
+  mach_msg_type_number_t buflen = sizeof (buf);
+  struct stat st;
+  error_t err;
+
+  if (p + 3 > end)
+    return EBADRPC;
+  p = decode_64bit (p, &offset);
+  count = ntohl (*p);
+  p++;
+  if (count > MAXDATA)
+    count = MAXDATA;
+
+  err = io_read (c->port, &bp, &buflen, offset, count);
+  if (err)
+    {
+      if (bp != buf)
+	munmap (bp, buflen);
+      return err;
+    }
+
+  err = io_stat (c->port, &st);
+  if (err)
+    {
+      if (bp != buf)
+	munmap (bp, buflen);
+      return err;
+    }
+
+  *(*reply)++ = htonl (1);
+  *reply = encode_fattr (*reply, &st, version);
+  *(*reply)++ = htonl (buflen);
+  *(*reply)++ = htonl (offset + buflen >= st.st_size);
+  *reply = encode_data (*reply, bp, buflen);
+
+  if (bp != buf)
+    munmap (bp, buflen);
+
+  return 0;
+}
+
+static error_t
+op_write3 (struct cache_handle *c,
+	   int *p,
+	   int *end,
+	   int **reply,
+	   int version)
+{
+  long long offset;
+  size_t count, left;
+  int stable;
+  error_t err;
+  mach_msg_type_number_t amt;
+  char *bp;
+
+  /* OFFSET, COUNT, STABLE, and the length of the data.  */
+  if (p + 5 > end)
+    return EBADRPC;
+  p = decode_64bit (p, &offset);
+  p++;				/* Skip COUNT; the data has its own.  */
+  stable = ntohl (*p);
+  p++;
+  count = ntohl (*p);
+  p++;
+  if (count > MAXDATA)
+    return EINVAL;
+  if (INTSIZE (count) > end - p)
+    return EBADRPC;
+  bp = (char *) p;
+
+  for (left = count; left; )
+    {
+      err = io_write (c->port, bp, left, offset, &amt);
+      if (err)
+	return err;
+      if (amt == 0)
+	return EIO;
+      left -= amt;
+      bp += amt;
+      offset += amt;
+    }
+
+  /* Data written UNSTABLE is left for a COMMIT to put on disk.  */
+  if (stable != UNSTABLE)
+    {
+      file_sync (c->port, 1, 0);
+      stable = FILE_SYNC;
+    }
+
+  *reply = encode_wcc_data (*reply, c->port);
+  *(*reply)++ = htonl (count);
+  *(*reply)++ = htonl (stable);
+  memcpy (*reply, write_verifier, NFS3_WRITEVERFSIZE);
+  *reply += INTSIZE (NFS3_WRITEVERFSIZE);
+  return 0;
+}
+
+static error_t
+op_create3 (struct cache_handle *c,
+	    int *p,
+	    int *end,
+	    int **reply,
+	    int version)
+{
+  error_t err;
+  char *name;
+  file_t newport;
+  int how, verf[2];
+  struct sattr3 sa;
+  struct stat st;
+
+  p = decode_name (p, end, &name);
+  if (!p || p >= end)
+    {
+      free (name);
+      return EBADRPC;
+    }
+  how = ntohl (*p);
+  p++;
+
+  if (how == EXCLUSIVE)
+    {
+      if (p + INTSIZE (NFS3_CREATEVERFSIZE) > end)
+	{
+	  free (name);
+	  return EBADRPC;
+	}
+      /* The verifier is kept in the times of the new file, so that the
+	 request can be recognized if it comes again.  */
+      memcpy (verf, p, NFS3_CREATEVERFSIZE);
+      err = lookup (c->port, name, O_CREAT | O_EXCL, 0600, &newport);
+      if (err == EEXIST)
+	{
+	  err = lookup (c->port, name, 0, 0, &newport);
+	  if (!err)
+	    {
+	      err = io_stat (newport, &st);
+	      if (!err
+		  && (st.st_atim.tv_sec != verf[0]
+		      || st.st_mtim.tv_sec != verf[1]))
+		err = EEXIST;
+	      if (err)
+		mach_port_deallocate (mach_task_self (), newport);
+	    }
+	}
+      else if (!err)
+	{
+	  struct timespec atime = { verf[0], 0 }, mtime = { verf[1], 0 };
+	  err = set_times (newport, atime, mtime);
+	  if (err)
+	    {
+	      mach_port_deallocate (mach_task_self (), newport);
+	      dir_unlink (c->port, name);
+	    }
+	}
+    }
+  else if (! decode_sattr3 (p, end, &sa))
+    err = EBADRPC;
+  else
+    {
+      err = lookup (c->port, name,
+		    O_CREAT | (how == GUARDED ? O_EXCL : 0),
+		    sa.set_mode ? sa.mode : 0644, &newport);
+      if (!err)
+	{
+	  err = apply_sattr3 (newport, &sa, 0);
+	  if (err)
+	    {
+	      mach_port_deallocate (mach_task_self (), newport);
+	      dir_unlink (c->port, name);
+	    }
+	}
+    }
+  free (name);
+
+  if (err)
+    return err;
+
+  *reply = encode_new_handle (*reply, c, newport);
+  *reply = encode_wcc_data (*reply, c->port);
+  return 0;
+}
+
+static error_t
+op_mkdir3 (struct cache_handle *c,
+	   int *p,
+	   int *end,
+	   int **reply,
+	   int version)
+{
+  char *name;
+  struct sattr3 sa;
+  file_t newport;
+  error_t err;
+
+  p = decode_name (p, end, &name);
+  if (!p || ! decode_sattr3 (p, end, &sa))
+    {
+      free (name);
+      return EBADRPC;
+    }
+
+  err = dir_mkdir (c->port, name, sa.set_mode ? sa.mode : 0755);
+  if (!err)
+    err = lookup (c->port, name, 0, 0, &newport);
+  free (name);
+  if (err)
+    return err;
+
+  /* The mode was given at creation.  */
+  apply_sattr3 (newport, &sa, 0);
+
+  *reply = encode_new_handle (*reply, c, newport);
+  *reply = encode_wcc_data (*reply, c->port);
+  return 0;
+}
+
+static error_t
+op_symlink3 (struct cache_handle *c,
+	     int *p,
+	     int *end,
+	     int **reply,
+	     int version)
+{
+  char *name, *target;
+  struct sattr3 sa;
+  error_t err;
+  file_t newport = MACH_PORT_NULL;
+  size_t len;
+  char *buf;
+
+  target = 0;
+  p = decode_name (p, end, &name);
+  if (p)
+    p = decode_sattr3 (p, end, &sa);
+  if (p)
+    p = decode_name (p, end, &target);
+  if (!p)
+    {
+      free (name);
+      free (target);
+      return EBADRPC;
+    }
+
+  len = strlen (target) + 1;
+  buf = alloca (sizeof (_HURD_SYMLINK) + len);
+  memcpy (buf, _HURD_SYMLINK, sizeof (_HURD_SYMLINK));
+  memcpy (buf + sizeof (_HURD_SYMLINK), target, len);
+
+  err = dir_mkfile (c->port, O_WRITE, sa.set_mode ? sa.mode : 0777,
+		    &newport);
+  if (!err)
+    err = file_set_translator (newport,
+			       FS_TRANS_EXCL|FS_TRANS_SET,
+			       FS_TRANS_EXCL|FS_TRANS_SET, 0,
+			       buf, sizeof (_HURD_SYMLINK) + len,
+			       MACH_PORT_NULL, MACH_MSG_TYPE_COPY_SEND);
+  if (!err)
+    err = dir_link (c->port, newport, name, 1);
+
+  free (name);
+  free (target);
+
+  if (err)
+    {
+      if (newport != MACH_PORT_NULL)
+	mach_port_deallocate (mach_task_self (), newport);
+      return err;
+    }
+
+  *reply = encode_new_handle (*reply, c, newport);
+  *reply = encode_wcc_data (*reply, c->port);
+  return 0;
+}
+
+static error_t
+op_mknod3 (struct cache_handle *c,
+	   int *p,
+	   int *end,
+	   int **reply,
+	   int version)
+{
+  return EOPNOTSUPP;
+}
+
+static error_t
+op_remove3 (struct cache_handle *c,
+	    int *p,
+	    int *end,
+	    int **reply,
+	    int version)
+{
+  error_t err;
+  char *name;
+
+  if (! decode_name (p, end, &name))
+    return EBADRPC;
+  err = dir_unlink (c->port, name);
+  free (name);
+
+  if (!err)
+    *reply = encode_wcc_data (*reply, c->port);
+  return err;
+}
+
+static error_t
+op_rmdir3 (struct cache_handle *c,
+	   int *p,
+	   int *end,
+	   int **reply,
+	   int version)
+{
+  error_t err;
+  char *name;
+
+  if (! decode_name (p, end, &name))
+    return EBADRPC;
+  err = dir_rmdir (c->port, name);
+  free (name);
+
+  if (!err)
+    *reply = encode_wcc_data (*reply, c->port);
+  return err;
+}
+
+static error_t
+op_rename3 (struct cache_handle *fromc,
+	    int *p,
+	    int *end,
+	    int **reply,
+	    int version)
+{
+  struct cache_handle *toc;
+  char *fromname, *toname;
+  error_t err = 0;
+
+  toc = 0;
+  toname = 0;
+  p = decode_name (p, end, &fromname);
+  if (p)
+    p = lookup_cache_handle (p, end, &toc, fromc->ids, version);
+  if (p)
+    p = decode_name (p, end, &toname);
+
+  if (!p)
+    err = EBADRPC;
+  else if (!toc)
+    err = ESTALE;
+  if (!err)
+    err = dir_rename (fromc->port, fromname, toc->port, toname, 0);
+  free (fromname);
+  free (toname);
+
+  if (!err)
+    {
+      *reply = encode_wcc_data (*reply, fromc->port);
+      *reply = encode_wcc_data (*reply, toc->port);
+    }
+  if (toc)
+    cache_handle_rele (toc);
+  return err;
+}
+
+static error_t
+op_link3 (struct cache_handle *filec,
+	  int *p,
+	  int *end,
+	  int **reply,
+	  int version)
+{
+  struct cache_handle *dirc;
+  char *name;
+  error_t err = 0;
+
+  name = 0;
+  p = lookup_cache_handle (p, end, &dirc, filec->ids, version);
+  if (p)
+    p = decode_name (p, end, &name);
+
+  if (!p)
+    err = EBADRPC;
+  else if (!dirc)
+    err = ESTALE;
+  if (!err)
+    err = dir_link (dirc->port, filec->port, name, 1);
+  free (name);
+
+  if (!err)
+    {
+      *reply = encode_post_op_attr (*reply, filec->port);
+      *reply = encode_wcc_data (*reply, dirc->port);
+    }
+  if (dirc)
+    cache_handle_rele (dirc);
+  return err;
+}
+
+/* Encode the entries in directory C from COOKIE on into *REPLY, in no
+   more than COUNT bytes, for READDIR, or for READDIRPLUS if PLUS is
+   set.  DIRCOUNT is how much of the directory to read.  */
+static error_t
+encode_entries (struct cache_handle *c, long long cookie,
+		size_t dircount, size_t count, int **reply, int plus)
+{
+  error_t err;
+  char *buf = 0;
+  size_t bufsize = 0;
+  struct dirent *dp;
+  int nentries, i;
+  size_t used = READDIR_OVERHEAD;
+  int *r;
+
+  if (count > MAXDATA)
+    count = MAXDATA;
+
+  err = dir_readdir (c->port, &buf, &bufsize, cookie, -1, dircount,
+		     &nentries);
+  if (err)
+    {
+      if (buf)
+	munmap (buf, bufsize);
+      return err;
+    }
+
+  r = encode_post_op_attr (*reply, c->port);
+  memset (r, 0, NFS3_COOKIEVERFSIZE);	/* We have no cookie verifier.  */
+  r += INTSIZE (NFS3_COOKIEVERFSIZE);
+
+  for (i = 0, dp = (struct dirent *) buf;
+       (char *)dp < buf + bufsize && i < nentries;
+       i++, dp = (struct dirent *) ((char *)dp + dp->d_reclen))
+    {
+      size_t namelen = strlen (dp->d_name);
+      size_t size = ((plus ? READDIRPLUS_ENTRY_SIZE : READDIR_ENTRY_SIZE)
+		     + 4 * INTSIZE (namelen));
+
+      if (i > 0 && used + size > count)
+	break;
+      used += size;
+
+      *(r++) = htonl (1);			/* Entry present.  */
+      r = encode_64bit (r, dp->d_ino);
+      r = encode_string (r, dp->d_name);
+      r = encode_64bit (r, cookie + i + 1);	/* Next entry.  */
+
+      if (plus)
+	{
+	  file_t port;
+	  struct stat st;
+
+	  if (lookup (c->port, dp->d_name, 0, 0, &port))
+	    {
+	      *(r++) = 0;		/* No attributes.  */
+	      *(r++) = 0;		/* No handle.  */
+	    }
+	  else if (io_stat (port, &st))
+	    {
+	      mach_port_deallocate (mach_task_self (), port);
+	      *(r++) = 0;
+	      *(r++) = 0;
+	    }
+	  else
+	    {
+	      *(r++) = htonl (1);
+	      r = encode_fattr (r, &st, 3);
+	      r = encode_post_op_fh (r, c, port);
+	    }
+	}
+    }
+
+  *(r++) = htonl (0);			/* No more entries.  */
+  *(r++) = htonl (nentries == 0);	/* EOF?  */
+
+  *reply = r;
+
+  if (buf)
+    munmap (buf, bufsize);
+
+  return 0;
+}
+
+static size_t
+count_readdir3_buffersize (int *p, int *end, int version)
+{
+  size_t count;
+
+  if (p + 3 + INTSIZE (NFS3_COOKIEVERFSIZE) > end)
+    return 0;
+  p += 2;			/* Skip COOKIE.  */
+  p += INTSIZE (NFS3_COOKIEVERFSIZE);	/* Skip COOKIEVERF.  */
+  count = ntohl (*p);		/* Return COUNT.  */
+  return count > MAXDATA ? MAXDATA : count;
+}
+
+static error_t
+op_readdir3 (struct cache_handle *c,
+	     int *p,
+	     int *end,
+	     int **reply,
+	     int version)
+{
+  long long cookie;
+  size_t count;
+
+  if (p + 3 + INTSIZE (NFS3_COOKIEVERFSIZE) > end)
+    return EBADRPC;
+  p = decode_64bit (p, &cookie);
+  p += INTSIZE (NFS3_COOKIEVERFSIZE);
+  count = ntohl (*p);
+
+  return encode_entries (c, cookie, count, count, reply, 0);
+}
+
+static size_t
+count_readdirplus3_buffersize (int *p, int *end, int version)
+{
+  size_t count;
+
+  if (p + 4 + INTSIZE (NFS3_COOKIEVERFSIZE) > end)
+    return 0;
+  p += 2;			/* Skip COOKIE.  */
+  p += INTSIZE (NFS3_COOKIEVERFSIZE);	/* Skip COOKIEVERF.  */
+  p++;				/* Skip DIRCOUNT.  */
+  count = ntohl (*p);		/* Return MAXCOUNT.  */
+  return count > MAXDATA ? MAXDATA : count;
+}
+
+static error_t
+op_readdirplus3 (struct cache_handle *c,
+		 int *p,
+		 int *end,
+		 int **reply,
+		 int version)
+{
+  long long cookie;
+  size_t dircount, maxcount;
+
+  if (p + 4 + INTSIZE (NFS3_COOKIEVERFSIZE) > end)
+    return EBADRPC;
+  p = decode_64bit (p, &cookie);
+  p += INTSIZE (NFS3_COOKIEVERFSIZE);
+  dircount = ntohl (*p);
+  p++;
+  maxcount = ntohl (*p);
+
+  return encode_entries (c, cookie, dircount, maxcount, reply, 1);
+}
+
+static error_t
+op_fsstat3 (struct cache_handle *c,
+	    int *p,
+	    int *end,
+	    int **reply,
+	    int version)
+{
+  struct statfs st;
+  error_t err;
+
+  err = file_statfs (c->port, &st);
+  if (err)
+    return err;
+
+  *reply = encode_post_op_attr (*reply, c->port);
+  *reply = encode_64bit (*reply, (long long) st.f_blocks * st.f_bsize);
+  *reply = encode_64bit (*reply, (long long) st.f_bfree * st.f_bsize);
+  *reply = encode_64bit (*reply, (long long) st.f_bavail * st.f_bsize);
+  *reply = encode_64bit (*reply, st.f_files);
+  *reply = encode_64bit (*reply, st.f_ffree);
+  *reply = encode_64bit (*reply, st.f_ffree);
+  *(*reply)++ = htonl (0);	/* Nothing stays the same for long.  */
+  return 0;
+}
+
+static error_t
+op_fsinfo3 (struct cache_handle *c,
+	    int *p,
+	    int *end,
+	    int **reply,
+	    int version)
+{
+  int *r;
+
+  r = encode_post_op_attr (*reply, c->port);
+  *(r++) = htonl (MAXDATA);	/* rtmax */
+  *(r++) = htonl (MAXDATA);	/* rtpref */
+  *(r++) = htonl (512);		/* rtmult */
+  *(r++) = htonl (MAXDATA);	/* wtmax */
+  *(r++) = htonl (MAXDATA);	/* wtpref */
+  *(r++) = htonl (512);		/* wtmult */
+  *(r++) = htonl (8192);	/* dtpref */
+  r = encode_64bit (r, 0x7fffffffffffffffLL);	/* maxfilesize */
+  *(r++) = htonl (0);		/* time_delta: seconds */
+  *(r++) = htonl (1);		/* and nanoseconds */
+  *(r++) = htonl (FSF3_LINK | FSF3_SYMLINK | FSF3_HOMOGENEOUS
+		  | FSF3_CANSETTIME);
+  *reply = r;
+  return 0;
+}
+
+static error_t
+op_pathconf3 (struct cache_handle *c,
+	      int *p,
+	      int *end,
+	      int **reply,
+	      int version)
+{
+  int link_max, name_max;
+
+  if (io_pathconf (c->port, _PC_LINK_MAX, &link_max))
+    link_max = 1;
+  if (io_pathconf (c->port, _PC_NAME_MAX, &name_max))
+    name_max = NFS_MAXNAMLEN;
+
+  *reply = encode_post_op_attr (*reply, c->port);
+  *(*reply)++ = htonl (link_max);
+  *(*reply)++ = htonl (name_max);
+  *(*reply)++ = htonl (1);	/* no_trunc */
+  *(*reply)++ = htonl (1);	/* chown_restricted */
+  *(*reply)++ = htonl (0);	/* case_insensitive */
+  *(*reply)++ = htonl (1);	/* case_preserving */
+  return 0;
+}
+
+static error_t
+op_commit3 (struct cache_handle *c,
+	    int *p,
+	    int *end,
+	    int **reply,
+	    int version)
+{
+  error_t err;
+
+  /* The range given doesn't matter, as the whole file is synced.  */
+  err = file_sync (c->port, 1, 0);
+  if (err)
+    return err;
+
+  *reply = encode_wcc_data (*reply, c->port);
+  memcpy (*reply, write_verifier, NFS3_WRITEVERFSIZE);
+  *reply += INTSIZE (NFS3_WRITEVERFSIZE);
+  return 0;
+}
+
+static error_t
+op_null3 (struct cache_handle *c,
+	  int *p,
+	  int *end,
+	  int **reply,
+	  int version)
+{
+  return 0;
+}
+
+
+/* The last field is how many words of empty results follow an error:
+   one for a post_op_attr, two for a wcc_data.  */
+struct proctable nfs3table =
+{
+  NFS3PROC_NULL,		/* First proc.  */
+  NFS3PROC_COMMIT,		/* Last proc.  */
+  {
+    { op_null3, 0, 0, 0, 0},
+    { op_getattr3, 0, 1, 1, 0},
+    { op_setattr3, 0, 1, 0, 0},
+    { op_lookup3, 0, 1, 1, 1},
+    { op_access3, 0, 1, 1, 1},
+    { op_readlink3, 0, 1, 1, 1},
+    { op_read3, count_read3_buffersize, 1, 1, 1},
+    { op_write3, 0, 1, 1, 2},
+    { op_create3, 0, 1, 1, 2},
+    { op_mkdir3, 0, 1, 1, 2},
+    { op_symlink3, 0, 1, 1, 2},
+    { op_mknod3, 0, 1, 1, 2},
+    { op_remove3, 0, 1, 1, 2},
+    { op_rmdir3, 0, 1, 1, 2},
+    { op_rename3, 0, 1, 1, 4},
+    { op_link3, 0, 1, 1, 3},
+    { op_readdir3, count_readdir3_buffersize, 1, 1, 1},
+    { op_readdirplus3, count_readdirplus3_buffersize, 1, 1, 1},
+    { op_fsstat3, 0, 1, 1, 1},
+    { op_fsinfo3, 0, 1, 1, 1},
+    { op_pathconf3, 0, 1, 1, 1},
+    { op_commit3, 0, 1, 1, 2},
+  }
+};
@@ -22,6 +22,7 @@
 
 #include <sys/stat.h>
 #include <sys/statfs.h>
+#include <sys/sysmacros.h>
 #include <string.h>
 #include "nfsd.h"
 
@@ -72,39 +73,85 @@ encode_fattr (int *p, struct stat *st, int version)
   *(p++) = htonl (st->st_nlink);
   *(p++) = htonl (st->st_uid);
   *(p++) = htonl (st->st_gid);
-  *(p++) = htonl (st->st_size);
-  *(p++) = htonl (st->st_blksize);
-  *(p++) = htonl (st->st_rdev);
-  *(p++) = htonl (st->st_blocks);
-  *(p++) = htonl (st->st_fsid);
-  *(p++) = htonl (st->st_ino);
-  *(p++) = htonl (st->st_atim.tv_sec);
-  *(p++) = htonl (st->st_atim.tv_nsec / 1000);
-  *(p++) = htonl (st->st_mtim.tv_sec);
-  *(p++) = htonl (st->st_mtim.tv_nsec / 1000);
-  *(p++) = htonl (st->st_ctim.tv_sec);
-  *(p++) = htonl (st->st_ctim.tv_nsec / 1000);
+  if (version == 2)
+    {
+      *(p++) = htonl (st->st_size);
+      *(p++) = htonl (st->st_blksize);
+      *(p++) = htonl (st->st_rdev);
+      *(p++) = htonl (st->st_blocks);
+      *(p++) = htonl (st->st_fsid);
+      *(p++) = htonl (st->st_ino);
+      *(p++) = htonl (st->st_atim.tv_sec);
+      *(p++) = htonl (st->st_atim.tv_nsec / 1000);
+      *(p++) = htonl (st->st_mtim.tv_sec);
+      *(p++) = htonl (st->st_mtim.tv_nsec / 1000);
+      *(p++) = htonl (st->st_ctim.tv_sec);
+      *(p++) = htonl (st->st_ctim.tv_nsec / 1000);
+    }
+  else
+    {
+      p = encode_64bit (p, st->st_size);
+      p = encode_64bit (p, (long long) st->st_blocks * 512);
+      *(p++) = htonl (major (st->st_rdev));
+      *(p++) = htonl (minor (st->st_rdev));
+      p = encode_64bit (p, st->st_fsid);
+      p = encode_64bit (p, st->st_ino);
+      *(p++) = htonl (st->st_atim.tv_sec);
+      *(p++) = htonl (st->st_atim.tv_nsec);
+      *(p++) = htonl (st->st_mtim.tv_sec);
+      *(p++) = htonl (st->st_mtim.tv_nsec);
+      *(p++) = htonl (st->st_ctim.tv_sec);
+      *(p++) = htonl (st->st_ctim.tv_nsec);
+    }
   return p;
 }
 
-/* Decode P into NAME and return the next thing to come after it.  */
+/* Encode the 64 bit integer N into P and return the next thing to come
+   after it.  */
 int *
-decode_name (int *p, char **name)
+encode_64bit (int *p, long long n)
 {
-  int len;
-  
+  *(p++) = htonl ((n >> 32) & 0xffffffff);
+  *(p++) = htonl (n & 0xffffffff);
+  return p;
+}
+
+/* Decode P into the 64 bit integer *N and return the next thing to come
+   after it.  */
+int *
+decode_64bit (int *p, long long *n)
+{
+  *n = ((long long) ntohl (p[0]) << 32) | (unsigned int) ntohl (p[1]);
+  return p + 2;
+}
+
+/* Decode P into NAME and return the next thing to come after it.  If
+   the name runs past END, set NAME to 0 and return 0.  */
+int *
+decode_name (int *p, int *end, char **name)
+{
+  size_t len;
+
+  *name = 0;
+  if (p >= end)
+    return 0;
   len = ntohl (*p);
   p++;
+  if (len > (char *) end - (char *) p)
+    return 0;
   *name = malloc (len + 1);
   memcpy (*name, p, len);
   (*name)[len] = '\0';
   return p + INTSIZE (len);
 }
 
-/* Encode HANDLE into P and return the next thing to come after it.  */
+/* Encode HANDLE into P and return the next thing to come after it.
+   In version 3, handles can vary in length, but ours never do.  */
 int *
-encode_fhandle (int *p, char *handle)
+encode_fhandle (int *p, char *handle, int version)
 {
+  if (version == 3)
+    *(p++) = htonl (NFS2_FHSIZE);
   memcpy (p, handle, NFS2_FHSIZE);
   return p + INTSIZE (NFS2_FHSIZE);
 }
@@ -210,6 +257,12 @@ nfs_error_trans (error_t err, int version)
 	  
 	case EOPNOTSUPP:
 	  return NFSERR_NOTSUPP;	/* Are we sure here?  */
+
+	case EMLINK:
+	  return NFSERR_MLINK;
+
+	case EFBIG:
+	  return NFSERR_FBIG;
 	  
 	default:
 	  return NFSERR_IO;
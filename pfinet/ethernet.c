@@ -30,20 +30,46 @@
 #include <string.h>
 #include <error.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 
 #include <linux/netdevice.h>
 #include <linux/etherdevice.h>
 #include <linux/if_arp.h>
 
+#include "net_frames_U.h"
 
 struct port_class *etherreadclass;
 
+/* Bytes and frames sent with one device_write_frames, at most.  */
+#define ETHERNET_TX_BYTES (64 * 1024)
+#define ETHERNET_TX_FRAMES 64
+
+/* Frames queued for transmission.  */
+struct ether_tx_batch
+{
+  char *data;
+  size_t size;
+  int lengths[ETHERNET_TX_FRAMES];
+  int count;
+};
+
 struct ether_device
 {
   struct ether_device *next;
   device_t ether_port;
   struct port_info *readpt;
   mach_port_t readptname;
+
+  /* ethernet_xmit queues frames in TX_FILL, and ethernet_tx_thread
+     sends them from the other batch, taking TX_FILL once it is done;
+     these, and TX_DEAD, are protected by TX_LOCK.  */
+  pthread_mutex_t tx_lock;
+  pthread_cond_t tx_queued, tx_taken;
+  struct ether_tx_batch tx_batch[2];
+  struct ether_tx_batch *tx_fill;
+  int tx_dead;			/* ETHER_PORT has to be reopened.  */
+  int tx_frames;		/* ETHER_PORT takes device_write_frames.  */
+
   struct device dev;
 };
 
@@ -98,29 +124,13 @@ static int bpf_ether_filter_len = sizeof (bpf_ether_filter) / (sizeof (short));
 static struct port_bucket *etherport_bucket;
 
 
-static void *
-ethernet_thread (void *arg)
+/* The device whose read port received INP, or null.  */
+static struct device *
+ethernet_input_device (mach_msg_header_t *inp)
 {
-  ports_manage_port_operations_one_thread (etherport_bucket,
-					   ethernet_demuxer,
-					   0);
-  return NULL;
-}
-
-int
-ethernet_demuxer (mach_msg_header_t *inp,
-		  mach_msg_header_t *outp)
-{
-  struct net_rcv_msg *msg = (struct net_rcv_msg *) inp;
-  struct sk_buff *skb;
-  int datalen;
   struct ether_device *edev;
-  struct device *dev = 0;
   mach_port_t local_port;
 
-  if (inp->msgh_id != NET_RCV_MSG_ID)
-    return 0;
-
   if (MACH_MSGH_BITS_LOCAL (inp->msgh_bits) ==
       MACH_MSG_TYPE_PROTECTED_PAYLOAD)
     {
@@ -140,20 +150,35 @@ ethernet_demuxer (mach_msg_header_t *inp,
 
   for (edev = ether_dev; edev; edev = edev->next)
     if (local_port == edev->readptname)
-      dev = &edev->dev;
+      return &edev->dev;
+
+  return NULL;
+}
+
+/* Copy the frame in MSG into a buffer and drop it on the queue of
+   net_bh.  NET_BH_LOCK must be held.  */
+static void
+ethernet_input (struct net_rcv_msg *msg)
+{
+  mach_msg_header_t *inp = &msg->msg_hdr;
+  struct sk_buff *skb;
+  struct device *dev;
+  int datalen;
 
+  dev = ethernet_input_device (inp);
   if (! dev)
     {
       if (inp->msgh_remote_port != MACH_PORT_NULL)
 	mach_port_deallocate (mach_task_self (), inp->msgh_remote_port);
-      return 1;
+      return;
     }
 
   datalen = ETH_HLEN
     + msg->packet_type.msgt_number - sizeof (struct packet_header);
 
-  pthread_mutex_lock (&net_bh_lock);
   skb = alloc_skb (NET_IP_ALIGN + datalen, GFP_ATOMIC);
+  if (! skb)
+    return;
   skb_reserve(skb, NET_IP_ALIGN);
   skb_put (skb, datalen);
   skb->dev = dev;
@@ -167,9 +192,60 @@ ethernet_demuxer (mach_msg_header_t *inp,
   /* Drop it on the queue. */
   skb->protocol = eth_type_trans (skb, dev);
   netif_rx (skb);
-  pthread_mutex_unlock (&net_bh_lock);
+}
+
+/* Frames taken from the read ports at each wakeup, at most.  */
+#define ETHERNET_RX_BATCH 32
+
+static struct net_rcv_msg rx_msgs[ETHERNET_RX_BATCH];
+
+/* Receive frames and drop them on the queue of net_bh.  Rather than
+   handling one message per wakeup, take all those already queued on
+   the read ports, up to ETHERNET_RX_BATCH, and queue their frames
+   taking net_bh_lock once, which also wakes net_bh once for them.  */
+static void *
+ethernet_thread (void *arg)
+{
+  int stop = 0;
 
-  return 1;
+  while (! stop)
+    {
+      int n, i;
+
+      for (n = 0; n < ETHERNET_RX_BATCH; n++)
+	{
+	  error_t err;
+
+	  err = mach_msg (&rx_msgs[n].msg_hdr,
+			  MACH_RCV_MSG | (n ? MACH_RCV_TIMEOUT : 0),
+			  0, sizeof rx_msgs[n], etherport_bucket->portset,
+			  0, MACH_PORT_NULL);
+	  if (err == MACH_RCV_TIMED_OUT)
+	    break;
+	  if (err == MACH_RCV_TOO_LARGE)
+	    /* A message too large was destroyed: go on with the
+	       others.  */
+	    n--;
+	  else if (err)
+	    {
+	      /* Anything else would only happen again: pass on what has
+		 been received, and stop.  */
+	      error (0, err, "mach_msg");
+	      stop = 1;
+	      break;
+	    }
+	}
+
+      pthread_mutex_lock (&net_bh_lock);
+      for (i = 0; i < n; i++)
+	if (rx_msgs[i].msg_hdr.msgh_id == NET_RCV_MSG_ID)
+	  ethernet_input (&rx_msgs[i]);
+	else
+	  mach_msg_destroy (&rx_msgs[i].msg_hdr);
+      pthread_mutex_unlock (&net_bh_lock);
+    }
+
+  return NULL;
 }
 
 
@@ -268,37 +344,121 @@ ethernet_close (struct device *dev)
   return 0;
 }
 
-/* Transmit an ethernet frame */
-int
-ethernet_xmit (struct sk_buff *skb, struct device *dev)
+/* Send the frames of BATCH to PORT, the port of EDEV: in one message
+   if it takes device_write_frames, else one by one.  */
+static error_t
+ethernet_send_batch (struct ether_device *edev, mach_port_t port,
+		     struct ether_tx_batch *batch)
 {
   error_t err;
-  struct ether_device *edev = (struct ether_device *) dev->priv;
-  int count;
-  unsigned tried = 0;
+  size_t offset = 0;
+  int count, i;
 
-  do
+  if (edev->tx_frames)
     {
-      tried++;
-      err = device_write (edev->ether_port, D_NOWAIT, 0, (io_buf_ptr_t) skb->data, skb->len, &count);
-      if (err == EMACH_SEND_INVALID_DEST || err == EMIG_SERVER_DIED)
-	{
-	  /* Device probably just died, try to reopen it.  */
+      err = device_write_frames (port, D_NOWAIT, batch->data, batch->size,
+				 batch->lengths, batch->count, &count);
+      if (err != MIG_BAD_ID && err != EOPNOTSUPP)
+	return err;
+      edev->tx_frames = 0;
+    }
 
-	  if (tried == 2)
-	    /* Too many tries, abort */
-	    break;
+  for (i = 0; i < batch->count; i++)
+    {
+      err = device_write (port, D_NOWAIT, 0, batch->data + offset,
+			  batch->lengths[i], &count);
+      if (err)
+	return err;
+      offset += batch->lengths[i];
+    }
+
+  return 0;
+}
 
-	  ethernet_close (dev);
-	  ethernet_open (dev);
+/* Send the frames ethernet_xmit queues for the device ARG.  The frames
+   queued while a batch is being sent make up the next one, so that a
+   lone frame goes out at once, but a bulk sender costs one message per
+   ETHERNET_TX_BYTES.  */
+static void *
+ethernet_tx_thread (void *arg)
+{
+  struct ether_device *edev = arg;
+
+  pthread_mutex_lock (&edev->tx_lock);
+  while (1)
+    {
+      struct ether_tx_batch *batch = edev->tx_fill;
+      mach_port_t port = edev->ether_port;
+      error_t err;
+
+      if (batch->count == 0)
+	{
+	  pthread_cond_wait (&edev->tx_queued, &edev->tx_lock);
+	  continue;
 	}
-      else
+
+      edev->tx_fill = (batch == &edev->tx_batch[0]
+		       ? &edev->tx_batch[1] : &edev->tx_batch[0]);
+      pthread_cond_broadcast (&edev->tx_taken);
+
+      /* Keep our own reference, in case ethernet_xmit reopens the
+	 device meanwhile.  */
+      if (mach_port_mod_refs (mach_task_self (), port,
+			      MACH_PORT_RIGHT_SEND, 1))
+	port = MACH_PORT_NULL;
+      pthread_mutex_unlock (&edev->tx_lock);
+
+      err = ethernet_send_batch (edev, port, batch);
+      mach_port_deallocate (mach_task_self (), port);
+
+      pthread_mutex_lock (&edev->tx_lock);
+      if (err == EMACH_SEND_INVALID_DEST || err == EMIG_SERVER_DIED)
+	/* Device probably just died; the frames are lost, and the next
+	   call to ethernet_xmit reopens it.  */
+	edev->tx_dead = 1;
+      batch->size = 0;
+      batch->count = 0;
+    }
+
+  return NULL;
+}
+
+/* Transmit an ethernet frame: queue it for ethernet_tx_thread, waiting
+   if the queue is full.  */
+int
+ethernet_xmit (struct sk_buff *skb, struct device *dev)
+{
+  struct ether_device *edev = (struct ether_device *) dev->priv;
+  struct ether_tx_batch *batch;
+
+  pthread_mutex_lock (&edev->tx_lock);
+
+  if (edev->tx_dead)
+    {
+      /* Device probably just died, try to reopen it.  */
+      edev->tx_dead = 0;
+      ethernet_close (dev);
+      ethernet_open (dev);
+    }
+
+  if (skb->len <= ETHERNET_TX_BYTES)
+    {
+      batch = edev->tx_fill;
+      while (batch->count == ETHERNET_TX_FRAMES
+	     || batch->size + skb->len > ETHERNET_TX_BYTES)
 	{
-	  assert_perror_backtrace (err);
-	  assert_backtrace (count == skb->len);
+	  pthread_cond_wait (&edev->tx_taken, &edev->tx_lock);
+	  batch = edev->tx_fill;
 	}
+
+      memcpy (batch->data + batch->size, skb->data, skb->len);
+      batch->size += skb->len;
+      batch->lengths[batch->count++] = skb->len;
+      if (batch->count == 1)
+	pthread_cond_signal (&edev->tx_queued);
     }
-  while (err);
+
+  pthread_mutex_unlock (&edev->tx_lock);
 
   dev_kfree_skb (skb);
   return 0;
@@ -329,6 +489,8 @@ setup_ethernet_device (char *name, struct device **device)
   error_t err;
   struct ether_device *edev;
   struct device *dev;
+  pthread_t thread;
+  int i;
 
   edev = calloc (1, sizeof (struct ether_device));
   if (!edev)
@@ -336,6 +498,20 @@ setup_ethernet_device (char *name, struct device **device)
   edev->next = ether_dev;
   ether_dev = edev;
 
+  pthread_mutex_init (&edev->tx_lock, NULL);
+  pthread_cond_init (&edev->tx_queued, NULL);
+  pthread_cond_init (&edev->tx_taken, NULL);
+  for (i = 0; i < 2; i++)
+    {
+      /* Page-aligned, so that it is sent by copy-on-write.  */
+      edev->tx_batch[i].data = mmap (NULL, ETHERNET_TX_BYTES,
+				     PROT_READ | PROT_WRITE, MAP_ANON, 0, 0);
+      if (edev->tx_batch[i].data == MAP_FAILED)
+	error (2, errno, "%s", name);
+    }
+  edev->tx_fill = &edev->tx_batch[0];
+  edev->tx_frames = 1;
+
   *device = dev = &edev->dev;
 
   dev->name = strdup (name);
@@ -401,4 +577,9 @@ setup_ethernet_device (char *name, struct device **device)
      and tells the protocol stacks about the device.  */
   err = - register_netdevice (dev);
   assert_perror_backtrace (err);
+
+  err = pthread_create (&thread, NULL, ethernet_tx_thread, edev);
+  if (err)
+    error (2, err, "pthread_create");
+  pthread_detach (thread);
 }
@@ -96,7 +96,7 @@ extern pthread_mutex_t global_lock;
 static inline int
 interruptible_sleep_on_timeout (struct wait_queue **p, struct timespec *tsp)
 {
-  pthread_cond_t **condp = (void *) p, *c;
+  struct wait_cond **condp = (void *) p, *c;
   int isroot;
   struct wait_queue **next_wait;
   error_t err;
@@ -106,14 +106,16 @@ interruptible_sleep_on_timeout (struct wait_queue **p, struct timespec *tsp)
     {
       c = malloc (sizeof **condp);
       assert_backtrace (c);
-      pthread_cond_init (c, NULL);
+      pthread_cond_init (&c->cond, NULL);
+      c->sock = NULL;
+      c->notify = NULL;
       *condp = c;
     }
 
   isroot = current->isroot;	/* This is our context that needs switched.  */
   next_wait = current->next_wait; /* This too, for multiple schedule calls.  */
   current->next_wait = 0;
-  err = pthread_hurd_cond_timedwait_np(c, &global_lock, tsp);
+  err = pthread_hurd_cond_timedwait_np(&c->cond, &global_lock, tsp);
   if (err == EINTR)
     current->signal = 1;	/* We got cancelled, mark it for later.  */
   current->isroot = isroot;	/* Switch back to our context.  */
@@ -121,12 +123,18 @@ interruptible_sleep_on_timeout (struct wait_queue **p, struct timespec *tsp)
   return (err == ETIMEDOUT);
 }
 
+extern void sock_notify (struct wait_cond *);
+
 static inline void
 wake_up_interruptible (struct wait_queue **p)
 {
-  pthread_cond_t **condp = (void *) p, *c = *condp;
+  struct wait_cond **condp = (void *) p, *c = *condp;
   if (c)
-    pthread_cond_broadcast (c);
+    {
+      pthread_cond_broadcast (&c->cond);
+      if (c->notify)
+	sock_notify (c);
+    }
 }
 #define wake_up		wake_up_interruptible
 
@@ -8,7 +8,7 @@
    The actual wait queue is a `struct wait_queue *' stored somewhere.
    We ignore these structures provided by the waiters entirely.
    In the `struct wait_queue *' that is the "head of the wait queue" slot,
-   we actually store a `pthread_cond_t *' pointing to malloc'd storage.  */
+   we actually store a `struct wait_cond *' pointing to malloc'd storage.  */
 
 struct wait_queue
 {
@@ -16,6 +16,20 @@ struct wait_queue
   struct wait_queue *next;	/* NULL */
 };
 
+struct socket;
+struct iohelp_notify;
+
+struct wait_cond
+{
+  pthread_cond_t cond;
+
+  /* For the wait queue of a socket, the socket, and the registrations
+     made with io_notify_request on it, which are checked by sock_notify
+     at every wakeup.  */
+  struct socket *sock;
+  struct iohelp_notify *notify;
+};
+
 
 struct select_table_elt
 {
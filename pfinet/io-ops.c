@@ -27,12 +27,14 @@
 #include <net/sock.h>
 
 #include "io_S.h"
+#include "io_notify_S.h"
 #include <netinet/in.h>
 #include <fcntl.h>
 #include <string.h>
 #include <unistd.h>
 #include <mach/notify.h>
 #include <sys/mman.h>
+#include <hurd/iohelp.h>
 
 kern_return_t
 S_io_write (struct sock_user *user,
@@ -334,6 +336,58 @@ S_io_select_timeout (struct sock_user *user,
   return io_select_common (user, reply, reply_type, &ts, select_type);
 }
 
+/* What SOCK is ready for, as io_select_common finds it; on an error,
+   anything, so that the error is seen.  */
+static int
+sock_ready (struct socket *sock)
+{
+  int avail;
+
+  avail = (*sock->ops->poll) ((void *) 0xdeadbeef, sock, (void *) 0xdeadbead);
+  if (avail & POLLERR)
+    avail |= SELECT_READ | SELECT_WRITE | SELECT_URG;
+
+  return avail;
+}
+
+/* Tell those registered with io_notify_request on the socket whose wait
+   queue is C what it is ready for now.  This is called by
+   wake_up_interruptible, with global_lock held.  */
+void
+sock_notify (struct wait_cond *c)
+{
+  if (c->sock && c->sock->ops && iohelp_notify_wanted (&c->notify))
+    iohelp_notify_post (&c->notify, sock_ready (c->sock));
+}
+
+kern_return_t
+S_io_notify_request (struct sock_user *user,
+		     mach_port_t notify,
+		     int select_type,
+		     natural_t cookie)
+{
+  struct wait_cond *c;
+  error_t err;
+
+  if (!user)
+    return EOPNOTSUPP;
+
+  pthread_mutex_lock (&global_lock);
+  become_task (user);
+
+  assert_backtrace (user->sock->ops->poll);
+
+  c = (struct wait_cond *) user->sock->wait;
+  err = iohelp_notify_request (&c->notify, user->sock, notify,
+			       select_type & (SELECT_READ | SELECT_WRITE
+					      | SELECT_URG),
+			       cookie, sock_ready (user->sock));
+
+  pthread_mutex_unlock (&global_lock);
+
+  return err;
+}
+
 kern_return_t
 S_io_stat (struct sock_user *user,
 	   struct stat *st)
@@ -78,6 +78,24 @@ extern atomic_t ip_frag_mem;
 
 static kmem_cache_t *skbuff_head_cache;
 
+#ifdef _HURD_
+/*
+ *	The data of buffers the size of a received Ethernet frame comes
+ *	from skbuff_data_cache, which skb_init fills beforehand, so that
+ *	receiving frames recycles buffers instead of calling malloc and
+ *	free for each.  Buffers keep the size they were allocated with,
+ *	which tells where they go back to.  The reference count after
+ *	the data fits in the 16 extra bytes, which keep the free list
+ *	link aligned.
+ */
+#define SKB_DATA_CACHE_SIZE	1536
+#define SKB_DATA_PREALLOC	256
+#define skb_data_cached(size)	((size) > SKB_DATA_CACHE_SIZE / 2 && \
+				 (size) <= SKB_DATA_CACHE_SIZE)
+
+static kmem_cache_t *skbuff_data_cache;
+#endif
+
 /*
  *	Keep out-of-line to prevent kernel bloat.
  *	__builtin_return_address is not used because it is not always
@@ -137,6 +155,11 @@ struct sk_buff *alloc_skb(unsigned int size,int gfp_mask)
 
 	/* Get the DATA. Size must match skb_add_mtu(). */
 	size = ((size + 15) & ~15); 
+#ifdef _HURD_
+	if (skb_data_cached(size))
+		data = kmem_cache_alloc(skbuff_data_cache, gfp_mask);
+	else
+#endif
 	data = kmalloc(size + sizeof(atomic_t), gfp_mask);
 	if (data == NULL)
 		goto nodata;
@@ -204,8 +227,14 @@ static inline void skb_headerinit(void *p, kmem_cache_t *cache,
  */
 void kfree_skbmem(struct sk_buff *skb)
 {
-	if (!skb->cloned || atomic_dec_and_test(skb_datarefp(skb)))  
+	if (!skb->cloned || atomic_dec_and_test(skb_datarefp(skb))) {
+#ifdef _HURD_
+		if (skb_data_cached(skb->end - skb->head))
+			kmem_cache_free(skbuff_data_cache, skb->head);
+		else
+#endif
 		kfree(skb->head);
+	}
 
 	kmem_cache_free(skbuff_head_cache, skb);
 	atomic_dec(&net_skbcount);
@@ -382,4 +411,22 @@ void __init skb_init(void)
 					      skb_headerinit, NULL);
 	if (!skbuff_head_cache)
 		panic("cannot create skbuff cache");
+#ifdef _HURD_
+	skbuff_data_cache = kmem_cache_create("skbuff_data_cache",
+					      SKB_DATA_CACHE_SIZE + 16,
+					      0, 0, NULL, NULL);
+	if (!skbuff_data_cache)
+		panic("cannot create skbuff data cache");
+	{
+		void *bufs[SKB_DATA_PREALLOC];
+		int i;
+
+		for (i = 0; i < SKB_DATA_PREALLOC; i++)
+			bufs[i] = kmem_cache_alloc(skbuff_data_cache,
+						   GFP_KERNEL);
+		for (i = 0; i < SKB_DATA_PREALLOC; i++)
+			if (bufs[i])
+				kmem_cache_free(skbuff_data_cache, bufs[i]);
+	}
+#endif
 }
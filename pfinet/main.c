@@ -81,6 +81,7 @@ const char *argp_program_version = STANDARD_HURD_VERSION (pfinet);
 extern struct argp pfinet_argp;
 
 #include "io_S.h"
+#include "io_notify_S.h"
 #include "socket_S.h"
 #include "pfinet_S.h"
 #include "iioctl_S.h"
@@ -111,6 +112,7 @@ pfinet_demuxer (mach_msg_header_t *inp,
 
       mig_routine_t routine;
       if ((routine = io_server_routine (inp)) ||
+          (routine = io_notify_server_routine (inp)) ||
           (routine = socket_server_routine (inp)) ||
           (routine = pfinet_server_routine (inp)) ||
           (routine = rioctl_server_routine (inp)) ||
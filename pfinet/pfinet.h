@@ -73,7 +73,6 @@ extern uid_t pfinet_owner;
 extern uid_t pfinet_group;
 
 void ethernet_initialize (void);
-int ethernet_demuxer (mach_msg_header_t *, mach_msg_header_t *);
 void setup_ethernet_device (char *, struct device **);
 void setup_dummy_device (char *, struct device **);
 void setup_tunnel_device (char *, struct device **);
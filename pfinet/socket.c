@@ -23,6 +23,7 @@
 
 #include <linux/socket.h>
 #include <linux/net.h>
+#include <hurd/iohelp.h>
 
 #ifndef NPROTO
 #define NPROTO (PF_INET + 1)
@@ -44,13 +45,15 @@ sock_alloc (void)
 {
   static ino_t nextino;		/* locked by global_lock */
   struct socket *sock;
-  pthread_cond_t *c;
+  struct wait_cond *c;
 
-  sock = malloc (sizeof *sock + sizeof (pthread_cond_t));
+  sock = malloc (sizeof *sock + sizeof (struct wait_cond));
   if (!sock)
     return 0;
   c = (void *) &sock[1];
-  pthread_cond_init (c, NULL);
+  pthread_cond_init (&c->cond, NULL);
+  c->sock = sock;
+  c->notify = NULL;
   memset (sock, 0, sizeof *sock);
   sock->state = SS_UNCONNECTED;
   sock->identity = MACH_PORT_NULL;
@@ -109,6 +112,9 @@ sock_release (struct socket *sock)
   if (sock->state != SS_UNCONNECTED)
     sock->state = SS_DISCONNECTING;
 
+  /* Nobody is left to be told about the wakeups of the release.  */
+  iohelp_notify_clear (&((struct wait_cond *) sock->wait)->notify);
+
   if (sock->ops)
     sock->ops->release(sock, NULL);
 
@@ -21,6 +21,7 @@
 #include <pthread.h>
 #include <assert-backtrace.h>
 #include <stdlib.h>
+#include <hurd/iohelp.h>
 
 #include "connq.h"
 
@@ -41,6 +42,9 @@ struct connq
   pthread_cond_t connectors;
   unsigned num_connectors;
 
+  /* Registrations made with connq_notify_request.  */
+  struct iohelp_notify *notify;
+
   pthread_mutex_t lock;
 };
 
@@ -117,6 +121,7 @@ connq_create (struct connq **cq)
 
   new->num_listeners = 0;
   new->num_connectors = 0;
+  new->notify = NULL;
 
   pthread_mutex_init (&new->lock, NULL);
   pthread_cond_init (&new->listeners, NULL);
@@ -135,8 +140,43 @@ connq_destroy (struct connq *cq)
   assert_backtrace (! cq->head);
   assert_backtrace (cq->count == 0);
 
+  iohelp_notify_clear (&cq->notify);
   free (cq);
 }
+
+/* Whether connq_listen would find a connection request on CQ at once.
+   CQ must be locked.  */
+static inline int
+connq_ready (struct connq *cq)
+{
+  return cq->count > 0 || cq->num_connectors > 0;
+}
+
+/* Tell those registered with connq_notify_request on CQ that a
+   connection request is there.  CQ must be locked.  */
+static void
+connq_notify (struct connq *cq)
+{
+  if (cq->notify)
+    iohelp_notify_post (&cq->notify, SELECT_READ);
+}
+
+/* Register the interest of PORT in the connection requests on CQ, if
+   SELECT_TYPE includes SELECT_READ, as io_notify_request does.  */
+error_t
+connq_notify_request (struct connq *cq, mach_port_t port, int select_type,
+		      natural_t cookie)
+{
+  error_t err;
+
+  pthread_mutex_lock (&cq->lock);
+  err = iohelp_notify_request (&cq->notify, NULL, port,
+			       select_type & SELECT_READ, cookie,
+			       connq_ready (cq) ? SELECT_READ : 0);
+  pthread_mutex_unlock (&cq->lock);
+
+  return err;
+}
 
 /* ---------------------------------------------------------------- */
 
@@ -240,6 +280,7 @@ connq_connect (struct connq *cq, int noblock)
     }
 
   cq->num_connectors ++;
+  connq_notify (cq);
 
   while (cq->count + cq->num_connectors > cq->max + cq->num_listeners)
     /* The queue is full and there is no immediate listener to service
@@ -275,6 +316,7 @@ connq_connect_complete (struct connq *cq, struct sock *sock)
   cq->num_connectors --;
 
   connq_request_enqueue (cq, req);
+  connq_notify (cq);
 
   if (cq->num_listeners > 0)
     /* Wake a listener up.  We must consume the listener ref here as
@@ -22,6 +22,7 @@
 #define __CONNQ_H__
 
 #include <errno.h>
+#include <mach.h>
 
 /* Forward.  */
 struct connq;
@@ -60,4 +61,10 @@ void connq_connect_cancel (struct connq *cq);
    connections that are past the new length remain.  */
 error_t connq_set_length (struct connq *cq, int length);
 
+/* Register the interest of PORT in the connection requests on CQ, if
+   SELECT_TYPE includes SELECT_READ, as io_notify_request does; a send
+   right for PORT is consumed on success.  */
+error_t connq_notify_request (struct connq *cq, mach_port_t port,
+			      int select_type, natural_t cookie);
+
 #endif /* __CONNQ_H__ */
@@ -30,6 +30,7 @@
 #include <hurd/hurd_types.h>
 #include <hurd/auth.h>
 #include <hurd/pipe.h>
+#include <hurd/iohelp.h>
 #include <mach/notify.h>
 
 #include "sock.h"
@@ -37,6 +38,7 @@
 #include "sserver.h"
 
 #include "io_S.h"
+#include "io_notify_S.h"
 
 /* Read data from an IO object.  If offset if -1, read from the object
    maintained file pointer.  If the object is not seekable, offset is
@@ -82,15 +84,20 @@ S_io_read (struct sock_user *user,
 kern_return_t
 S_io_write (struct sock_user *user,
 	    const_data_t data, mach_msg_type_number_t data_len,
+	    boolean_t data_copy,
 	    off_t offset, vm_size_t *amount)
 {
   error_t err;
   struct pipe *pipe;
+  /* If DATA came out-of-line, it is ours, and can be given to the pipe;
+     but only if we succeed, as otherwise the request is destroyed with
+     it.  */
+  int own_data = !data_copy && data_len > 0;
 
   if (!user)
-    return EOPNOTSUPP;
-
-  err = sock_acquire_write_pipe (user->sock, &pipe);
+    err = EOPNOTSUPP;
+  else
+    err = sock_acquire_write_pipe (user->sock, &pipe);
   if (!err)
     {
       struct addr *source_addr;
@@ -105,8 +112,20 @@ S_io_write (struct sock_user *user,
 
       if (!err)
 	{
-	  err = pipe_write (pipe, user->sock->flags & PFLOCAL_SOCK_NONBLOCK,
-			    source_addr, data, data_len, amount);
+	  int noblock = user->sock->flags & PFLOCAL_SOCK_NONBLOCK;
+
+	  err = EOPNOTSUPP;
+	  if (own_data)
+	    /* Try to move the pages into the pipe instead of copying them.  */
+	    {
+	      err = pipe_write_pages (pipe, noblock, source_addr,
+				      (char *) data, data_len, amount);
+	      if (!err)
+		own_data = 0;
+	    }
+	  if (err == EOPNOTSUPP)
+	    err = pipe_write (pipe, noblock, source_addr, data, data_len,
+			      amount);
 	  if (err && source_addr)
 	    ports_port_deref (source_addr);
 	}
@@ -114,6 +133,9 @@ S_io_write (struct sock_user *user,
       pipe_release_writer (pipe);
     }
 
+  if (own_data && !err)
+    munmap ((void *) data, data_len);
+
   return err;
 }
 
@@ -298,6 +320,94 @@ S_io_select_timeout (struct sock_user *user,
 {
   return io_select_common (user, reply, reply_type, &ts, select_type);
 }
+
+/* Register the interest of NOTIFY in the conditions SELECT_TYPE of the
+   socket, as io_select_common tests them: on the listen queue of a
+   socket accepting connections, else on each of its pipes for its
+   direction.  */
+kern_return_t
+S_io_notify_request (struct sock_user *user, mach_port_t notify,
+		     int select_type, natural_t cookie)
+{
+  error_t err;
+  struct sock *sock;
+  struct pipe *read_pipe, *write_pipe;
+  int ready = 0;
+
+  if (!user)
+    return EOPNOTSUPP;
+
+  select_type &= SELECT_READ | SELECT_WRITE;
+
+  sock = user->sock;
+  pthread_mutex_lock (&sock->lock);
+
+  if (sock->listen_queue)
+    {
+      err = connq_notify_request (sock->listen_queue, notify, select_type,
+				  cookie);
+      pthread_mutex_unlock (&sock->lock);
+      return err;
+    }
+
+  read_pipe = sock->read_pipe;
+  write_pipe = sock->write_pipe;
+  if (! read_pipe)
+    ready |= SELECT_READ;
+  if (! write_pipe)
+    ready |= SELECT_WRITE;
+  if (read_pipe && read_pipe == write_pipe)
+    /* A socket connected to itself: one registration does for both
+       directions.  */
+    write_pipe = NULL;
+
+  if (ready & select_type)
+    /* Nothing to wait for, so answer at once.  */
+    {
+      struct iohelp_notify *once = NULL;
+
+      err = iohelp_notify_request (&once, sock, notify, select_type, cookie,
+				   ready);
+      iohelp_notify_clear (&once);
+      pthread_mutex_unlock (&sock->lock);
+      return err;
+    }
+
+  /* Each pipe keeps a registration of its own, with a send right for
+     NOTIFY, and is told to drop it if its direction is not waited for.
+     They are made for SOCK, so that those of the socket at the other end
+     of a pipe, which may well use the same NOTIFY, are left alone.  */
+  err = 0;
+  if (read_pipe && write_pipe)
+    err = mach_port_mod_refs (mach_task_self (), notify,
+			      MACH_PORT_RIGHT_SEND, 1);
+  else if (! read_pipe && ! write_pipe)
+    /* Nothing to cancel.  */
+    mach_port_deallocate (mach_task_self (), notify);
+
+  if (! err && read_pipe)
+    {
+      pipe_acquire_reader (read_pipe);
+      err = pipe_notify_request (read_pipe, sock, notify,
+				 write_pipe
+				 ? select_type & SELECT_READ : select_type,
+				 cookie);
+      pipe_release_reader (read_pipe);
+      if (err && write_pipe)
+	mach_port_deallocate (mach_task_self (), notify);
+    }
+  if (! err && write_pipe)
+    {
+      pipe_acquire_writer (write_pipe);
+      err = pipe_notify_request (write_pipe, sock, notify,
+				 select_type & SELECT_WRITE, cookie);
+      pipe_release_writer (write_pipe);
+    }
+
+  pthread_mutex_unlock (&sock->lock);
+
+  return err;
+}
 
 static inline void
 copy_time (time_value_t *from, time_t *to_sec, long *to_nsec)
@@ -482,12 +592,25 @@ S_io_restrict_auth (struct sock_user *user,
 		    mach_port_t *new_port,
 		    mach_msg_type_name_t *new_port_type,
 		    const uid_t *uids, mach_msg_type_number_t num_uids,
-		    const uid_t *gids, mach_msg_type_number_t num_gids)
+		    boolean_t uids_copy,
+		    const uid_t *gids, mach_msg_type_number_t num_gids,
+		    boolean_t gids_copy)
 {
+  error_t err;
+
   if (!user)
     return EOPNOTSUPP;
   *new_port_type = MACH_MSG_TYPE_MAKE_SEND;
-  return sock_create_port (user->sock, new_port);
+  err = sock_create_port (user->sock, new_port);
+
+  /* The ids are not needed, but those that came out-of-line are ours once
+     we succeed; otherwise the request is destroyed with them.  */
+  if (!err && !uids_copy && num_uids > 0)
+    munmap ((void *) uids, num_uids * sizeof *uids);
+  if (!err && !gids_copy && num_gids > 0)
+    munmap ((void *) gids, num_gids * sizeof *gids);
+
+  return err;
 }
 
 kern_return_t
@@ -447,7 +447,10 @@ sock_connect (struct sock *sock1, struct sock *sock2)
   pthread_mutex_unlock (&socket_pair_lock);
 
   if (old_sock1_write_pipe)
-    pipe_remove_writer (old_sock1_write_pipe);
+    {
+      pipe_notify_cancel (old_sock1_write_pipe, sock1);
+      pipe_remove_writer (old_sock1_write_pipe);
+    }
 
   return err;
 }
@@ -487,9 +490,15 @@ sock_shutdown (struct sock *sock, unsigned flags)
   pthread_mutex_unlock (&sock->lock);
   
   if (read_pipe)
-    pipe_remove_reader (read_pipe);
+    {
+      pipe_notify_cancel (read_pipe, sock);
+      pipe_remove_reader (read_pipe);
+    }
   if (write_pipe)
-    pipe_remove_writer (write_pipe);
+    {
+      pipe_notify_cancel (write_pipe, sock);
+      pipe_remove_writer (write_pipe);
+    }
 }
 
 /* ---------------------------------------------------------------- */
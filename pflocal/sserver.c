@@ -33,6 +33,7 @@ static int sock_server_active = 0;
 static pthread_spinlock_t sock_server_active_lock = PTHREAD_SPINLOCK_INITIALIZER;
 
 #include "io_S.h"
+#include "io_notify_S.h"
 #include "fs_S.h"
 #include "socket_S.h"
 #include "../libports/interrupt_S.h"
@@ -44,6 +45,7 @@ sock_demuxer (mach_msg_header_t *inp, mach_msg_header_t *outp)
 {
   mig_routine_t routine;
   if ((routine = io_server_routine (inp)) ||
+      (routine = io_notify_server_routine (inp)) ||
       (routine = fs_server_routine (inp)) ||
       (routine = socket_server_routine (inp)) ||
       (routine = ports_interrupt_server_routine (inp)) ||
@@ -39,6 +39,7 @@ const char *argp_program_version = STANDARD_HURD_VERSION (proc);
 #include "process_S.h"
 #include "../libports/interrupt_S.h"
 #include "../libports/notify_S.h"
+#include "../libports/rpcstats_S.h"
 #include "proc_exc_S.h"
 #include "task_notify_S.h"
 
@@ -57,6 +58,13 @@ struct proc *kernel_proc;
 
 pthread_mutex_t global_lock;
 
+/* Only root processes may look at or change the RPC statistics.  */
+static int
+rpcstats_allowed (struct port_info *pi)
+{
+  return pi->class == proc_class && check_uid ((struct proc *) pi, 0);
+}
+
 int
 message_demuxer (mach_msg_header_t *inp,
 		 mach_msg_header_t *outp)
@@ -65,6 +73,7 @@ message_demuxer (mach_msg_header_t *inp,
   if ((routine = process_server_routine (inp)) ||
       (routine = ports_notify_server_routine (inp)) ||
       (routine = ports_interrupt_server_routine (inp)) ||
+      (routine = ports_rpcstats_server_routine (inp)) ||
       (routine = proc_exc_server_routine (inp)) ||
       (routine = task_notify_server_routine (inp)))
     {
@@ -188,6 +197,7 @@ main (int argc, char **argv, char **envp)
   proc_class = ports_create_class (0, 0);
   generic_port_class = ports_create_class (0, 0);
   exc_class = ports_create_class (exc_clean, 0);
+  ports_rpcstats_allowed = rpcstats_allowed;
   ports_create_port (generic_port_class, proc_bucket,
 		     sizeof (struct port_info), &genport);
   generic_port = ports_get_right (genport);
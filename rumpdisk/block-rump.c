@@ -20,10 +20,12 @@
 
 #include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <mach.h>
 #include <mach/gnumach.h>
@@ -39,6 +41,8 @@
 #include <rump/rump_syscalls.h>
 #include <rump/rumperrno2host.h>
 
+#include "block-rump.h"
+#include "device_reply_U.h"
 #include "ioccom-rump.h"
 #define DIOCGMEDIASIZE  _IOR('d', 132, off_t)
 #define DIOCGSECTORSIZE _IOR('d', 133, unsigned int)
@@ -50,10 +54,18 @@
 
 #ifdef _RUMP_SATA
 #define RUMP_TYPE_STRING "rump SATA/IDE"
+#define TEST_DISK_NAME "wd0"
 #else
 #define RUMP_TYPE_STRING "rump USB"
+#define TEST_DISK_NAME "sd0"
 #endif
 
+/* Size of the bounce buffers used for writes from unaligned memory.  */
+#define BOUNCE_SIZE (128 * 1024)
+
+int rumpdisk_queue_depth = 8;
+const char *rumpdisk_test_file;
+
 static bool disabled;
 
 static mach_port_t master_host;
@@ -75,6 +87,23 @@ struct block_data
   struct block_data *next;
 };
 
+/* A device_read or device_write waiting for an I/O thread.  */
+struct io_request
+{
+  struct block_data *bd;	/* holds a reference */
+  mach_port_t reply_port;
+  mach_msg_type_name_t reply_port_type;
+  int write;
+  recnum_t bn;
+  unsigned int count;
+  io_buf_ptr_t data;		/* what to write; ours */
+  struct io_request *next;
+};
+
+static pthread_mutex_t request_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t request_wakeup = PTHREAD_COND_INITIALIZER;
+static struct io_request *request_head, **request_tailp = &request_head;
+
 /* Return a send right associated with network device ND.  */
 static mach_port_t
 rumpdisk_dev_to_port (void *nd)
@@ -151,11 +180,38 @@ dev_mode_to_rump_mode (const dev_mode_t mode)
   return ret;
 }
 
+static void start_io_threads (void);
+
 static void
 rumpdisk_device_init (void)
 {
   mach_port_t device_master;
 
+  if (rumpdisk_test_file)
+    {
+      /* Serve the file instead of whatever disks rump may find.  */
+      char dev_name[DISK_NAME_LEN];
+      int err;
+
+      get_privileged_ports (&master_host, NULL);
+      rump_init ();
+
+      translate_name (dev_name, DISK_NAME_LEN, TEST_DISK_NAME);
+      err = rump_pub_etfs_register (dev_name, rumpdisk_test_file,
+				    RUMP_ETFS_BLK);
+      if (err)
+	{
+	  fprintf (stderr, "Cannot use %s as " TEST_DISK_NAME ": %s\n",
+		   rumpdisk_test_file, strerror (rump_errno2host (err)));
+	  fflush (stderr);
+	  disabled = 1;
+	  return;
+	}
+
+      start_io_threads ();
+      return;
+    }
+
   if (! get_privileged_ports (&master_host, &device_master))
     {
       device_t device;
@@ -189,6 +245,7 @@ rumpdisk_device_init (void)
 	}
     }
   rump_init ();
+  start_io_threads ();
 }
 
 static io_return_t
@@ -278,6 +335,12 @@ rumpdisk_device_open (mach_port_t reply_port, mach_msg_type_name_t reply_port_ty
     }
 
   ret = rump_sys_ioctl (fd, DIOCGSECTORSIZE, &block_size);
+  if (ret < 0 && rumpdisk_test_file)
+    {
+      /* The file may not know about disk geometry.  */
+      block_size = 512;
+      ret = 0;
+    }
   if (ret < 0)
     {
       mach_print ("DIOCGSECTORSIZE ioctl fails\n");
@@ -293,6 +356,15 @@ rumpdisk_device_open (mach_port_t reply_port, mach_msg_type_name_t reply_port_ty
   }
 
   ret = rump_sys_ioctl (fd, DIOCGMEDIASIZE, &media_size);
+  if (ret < 0 && rumpdisk_test_file)
+    {
+      struct stat st;
+      if (stat (rumpdisk_test_file, &st) == 0)
+	{
+	  media_size = st.st_size;
+	  ret = 0;
+	}
+    }
   if (ret < 0)
     {
       mach_print ("DIOCGMEDIASIZE ioctl fails\n");
@@ -327,19 +399,16 @@ rumpdisk_device_open (mach_port_t reply_port, mach_msg_type_name_t reply_port_ty
   return D_SUCCESS;
 }
 
+/* Write COUNT bytes at DATA to block BN of BD.  Data that is not
+   page-aligned is copied through *BOUNCE, which is allocated on first use
+   and kept by the caller for the next request.  */
 static io_return_t
-rumpdisk_device_write (void *d, mach_port_t reply_port,
-		       mach_msg_type_name_t reply_port_type, dev_mode_t mode,
-		       recnum_t bn, io_buf_ptr_t data, unsigned int count,
-		       int *bytes_written)
+do_write (struct block_data *bd, recnum_t bn, io_buf_ptr_t data,
+	  unsigned int count, void **bounce, int *bytes_written)
 {
-  struct block_data *bd = d;
   ssize_t written;
   int pagesize = sysconf (_SC_PAGE_SIZE);
 
-  if ((bd->mode & D_WRITE) == 0)
-    return D_INVALID_OPERATION;
-
   pthread_rwlock_rdlock (&rumpdisk_rwlock);
   /* Ensure device is still open */
   if (! bd->taken)
@@ -351,30 +420,48 @@ rumpdisk_device_write (void *d, mach_port_t reply_port,
   if ((vm_offset_t) data % pagesize)
     {
       /* Not aligned, have to copy to aligned buffer.  */
-      vm_address_t buf;
-      rpc_phys_addr_t pap;
-      kern_return_t ret;
-      int err;
-
-      /* While at it, make it contiguous */
-      ret = vm_allocate_contiguous (master_host, mach_task_self (), &buf, &pap, count, 0, 0x100000000ULL, 0);
-      if (ret != KERN_SUCCESS)
+      if (! *bounce)
 	{
-	  pthread_rwlock_unlock (&rumpdisk_rwlock);
-	  return ENOMEM;
+	  vm_address_t buf;
+	  kern_return_t ret;
+
+	  if (MACH_PORT_VALID (master_host))
+	    {
+	      /* While at it, make it contiguous */
+	      rpc_phys_addr_t pap;
+	      ret = vm_allocate_contiguous (master_host, mach_task_self (),
+					    &buf, &pap, BOUNCE_SIZE,
+					    0, 0x100000000ULL, 0);
+	    }
+	  else
+	    ret = vm_allocate (mach_task_self (), &buf, BOUNCE_SIZE, TRUE);
+	  if (ret != KERN_SUCCESS)
+	    {
+	      pthread_rwlock_unlock (&rumpdisk_rwlock);
+	      return ENOMEM;
+	    }
+	  *bounce = (void *) buf;
 	}
 
-      memcpy ((void*) buf, data, count);
+      written = 0;
+      while (written < count)
+	{
+	  size_t todo = count - written;
+	  ssize_t done;
 
-      written = rump_sys_pwrite (bd->rump_fd, (const void *)buf, (size_t)count, (off_t)bn * bd->block_size);
-      err = errno;
+	  if (todo > BOUNCE_SIZE)
+	    todo = BOUNCE_SIZE;
 
-      vm_deallocate (mach_task_self (), (vm_address_t) buf, count);
+	  memcpy (*bounce, data + written, todo);
+	  done = rump_sys_pwrite (bd->rump_fd, *bounce, todo,
+				  (off_t)bn * bd->block_size + written);
+	  if (done < 0)
+	    {
+	      pthread_rwlock_unlock (&rumpdisk_rwlock);
+	      return rump_errno2host (errno);
+	    }
 
-      if (written < 0)
-	{
-	  pthread_rwlock_unlock (&rumpdisk_rwlock);
-	  return rump_errno2host (err);
+	  written += done;
 	}
     }
   else
@@ -410,20 +497,17 @@ rumpdisk_device_write (void *d, mach_port_t reply_port,
 	}
     }
 
-  vm_deallocate (mach_task_self (), (vm_address_t) data, count);
-
   *bytes_written = (int)written;
   pthread_rwlock_unlock (&rumpdisk_rwlock);
   return D_SUCCESS;
 }
 
+/* Read COUNT bytes from block BN of BD into fresh memory, returned in
+   *DATA.  */
 static io_return_t
-rumpdisk_device_read (void *d, mach_port_t reply_port,
-		      mach_msg_type_name_t reply_port_type, dev_mode_t mode,
-		      recnum_t bn, int count, io_buf_ptr_t * data,
-		      unsigned *bytes_read)
+do_read (struct block_data *bd, recnum_t bn, int count, io_buf_ptr_t *data,
+	 unsigned *bytes_read)
 {
-  struct block_data *bd = d;
   vm_address_t buf;
   int pagesize = sysconf (_SC_PAGE_SIZE);
   int npages = (count + pagesize - 1) / pagesize;
@@ -431,12 +515,6 @@ rumpdisk_device_read (void *d, mach_port_t reply_port,
   ssize_t done, err;
   kern_return_t ret;
 
-  if ((bd->mode & D_READ) == 0)
-    return D_INVALID_OPERATION;
-
-  if (count == 0)
-    return D_SUCCESS;
-
   pthread_rwlock_rdlock (&rumpdisk_rwlock);
   /* Ensure device is still open */
   if (! bd->taken)
@@ -486,6 +564,152 @@ rumpdisk_device_read (void *d, mach_port_t reply_port,
   return D_SUCCESS;
 }
 
+/* Each I/O thread serves one request at a time, so there are up to
+   RUMPDISK_QUEUE_DEPTH requests in flight in the rump drivers.  Each
+   thread keeps its own bounce buffer, so the buffers form a pool that is
+   allocated once instead of per request.  */
+static void *
+io_thread (void *arg)
+{
+  void *bounce = NULL;
+
+  for (;;)
+    {
+      struct io_request *req;
+      io_return_t err;
+
+      pthread_mutex_lock (&request_lock);
+      while (! request_head)
+	pthread_cond_wait (&request_wakeup, &request_lock);
+      req = request_head;
+      request_head = req->next;
+      if (! request_head)
+	request_tailp = &request_head;
+      pthread_mutex_unlock (&request_lock);
+
+      if (req->write)
+	{
+	  int written = 0;
+
+	  err = do_write (req->bd, req->bn, req->data, req->count,
+			  &bounce, &written);
+	  vm_deallocate (mach_task_self (), (vm_address_t) req->data,
+			 req->count);
+	  ds_device_write_reply (req->reply_port, req->reply_port_type,
+				 err, written);
+	}
+      else
+	{
+	  io_buf_ptr_t data = 0;
+	  unsigned int nread = 0;
+
+	  err = do_read (req->bd, req->bn, req->count, &data, &nread);
+	  ds_device_read_reply (req->reply_port, req->reply_port_type,
+				err, data, nread);
+	}
+
+      ports_port_deref (req->bd);
+      free (req);
+    }
+
+  return NULL;
+}
+
+static void
+start_io_threads (void)
+{
+  int i;
+
+  for (i = 0; i < rumpdisk_queue_depth; i++)
+    {
+      pthread_t t;
+      int err = pthread_create (&t, NULL, io_thread, NULL);
+      if (err)
+	{
+	  /* Fewer threads still work, and none means synchronous I/O.  */
+	  rumpdisk_queue_depth = i;
+	  break;
+	}
+      pthread_detach (t);
+    }
+}
+
+/* Hand a request to the I/O threads; they will send the reply.  */
+static io_return_t
+queue_request (struct block_data *bd, mach_port_t reply_port,
+	       mach_msg_type_name_t reply_port_type, int write,
+	       recnum_t bn, unsigned int count, io_buf_ptr_t data)
+{
+  struct io_request *req = malloc (sizeof *req);
+
+  if (! req)
+    return D_NO_MEMORY;
+
+  ports_port_ref (bd);
+  req->bd = bd;
+  req->reply_port = reply_port;
+  req->reply_port_type = reply_port_type;
+  req->write = write;
+  req->bn = bn;
+  req->count = count;
+  req->data = data;
+  req->next = NULL;
+
+  pthread_mutex_lock (&request_lock);
+  *request_tailp = req;
+  request_tailp = &req->next;
+  pthread_cond_signal (&request_wakeup);
+  pthread_mutex_unlock (&request_lock);
+
+  return MIG_NO_REPLY;
+}
+
+static io_return_t
+rumpdisk_device_write (void *d, mach_port_t reply_port,
+		       mach_msg_type_name_t reply_port_type, dev_mode_t mode,
+		       recnum_t bn, io_buf_ptr_t data, unsigned int count,
+		       int *bytes_written)
+{
+  struct block_data *bd = d;
+  io_return_t err;
+  void *bounce = NULL;
+
+  if ((bd->mode & D_WRITE) == 0)
+    return D_INVALID_OPERATION;
+
+  if (rumpdisk_queue_depth > 0 && MACH_PORT_VALID (reply_port))
+    return queue_request (bd, reply_port, reply_port_type, 1,
+			  bn, count, data);
+
+  err = do_write (bd, bn, data, count, &bounce, bytes_written);
+  if (bounce)
+    vm_deallocate (mach_task_self (), (vm_address_t) bounce, BOUNCE_SIZE);
+  if (err == D_SUCCESS)
+    vm_deallocate (mach_task_self (), (vm_address_t) data, count);
+  return err;
+}
+
+static io_return_t
+rumpdisk_device_read (void *d, mach_port_t reply_port,
+		      mach_msg_type_name_t reply_port_type, dev_mode_t mode,
+		      recnum_t bn, int count, io_buf_ptr_t * data,
+		      unsigned *bytes_read)
+{
+  struct block_data *bd = d;
+
+  if ((bd->mode & D_READ) == 0)
+    return D_INVALID_OPERATION;
+
+  if (count == 0)
+    return D_SUCCESS;
+
+  if (rumpdisk_queue_depth > 0 && MACH_PORT_VALID (reply_port))
+    return queue_request (bd, reply_port, reply_port_type, 0,
+			  bn, count, 0);
+
+  return do_read (bd, bn, count, data, bytes_read);
+}
+
 static io_return_t
 rumpdisk_device_set_status (void *d, dev_flavor_t flavor, dev_status_t status,
 			    mach_msg_type_number_t status_count)
@@ -533,10 +757,9 @@ rumpdisk_device_get_status (void *d, dev_flavor_t flavor, dev_status_t status,
 /* FIXME:
  * Long term strategy:
  *
- * Call rump_sys_aio_read/write and return MIG_NO_REPLY from
- * device_read/write, and send the mig reply once the aio request has
- * completed. That way, only the aio request will be kept in rumpdisk
- * memory instead of a whole thread structure.
+ * Call rump_sys_aio_read/write instead of keeping a pool of I/O threads
+ * blocked in rump_sys_pread/pwrite.  That way, only the aio request will
+ * be kept in rumpdisk memory instead of a whole thread structure.
  */
 static struct machdev_device_emulation_ops rump_block_emulation_ops = {
   rumpdisk_device_init,
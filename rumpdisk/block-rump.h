@@ -20,4 +20,12 @@
 
 void rump_register_block (void);
 
+/* The number of I/O threads, i.e. of requests that can be in flight at
+   once.  With 0, requests are served synchronously by the RPC threads.  */
+extern int rumpdisk_queue_depth;
+
+/* If set, this file is served as the only disk, to allow testing and
+   benchmarking without real hardware.  */
+extern const char *rumpdisk_test_file;
+
 #endif
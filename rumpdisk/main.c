@@ -44,6 +44,10 @@ static const struct argp_option options[] = {
   {"host-priv-port",	'h', "PORT", 0, "Host private port PORT"},
   {"device-master-port",'d', "PORT", 0, "Device master port PORT"},
   {"next-task",		'N', "TASK", 0, "Next bootstrap task TASK"},
+  {"queue-depth",	'q', "N", 0,
+   "Keep up to N requests in flight (default 8; 0 for synchronous I/O)"},
+  {"test-file",		'f', "FILE", 0,
+   "Serve FILE as the only disk instead of probing hardware"},
   {0}
 };
 
@@ -59,6 +63,8 @@ parse_opt (int key, char *arg, struct argp_state *state)
     int host_priv;
     int dev_master;
     int next_task;
+    int queue_depth;
+    const char *test_file;
   } *values = state->hook;
 
   switch (key)
@@ -72,6 +78,14 @@ parse_opt (int key, char *arg, struct argp_state *state)
     case 'N':
       values->next_task = atoi(arg);
       break;
+    case 'q':
+      values->queue_depth = atoi(arg);
+      if (values->queue_depth < 0)
+	argp_error (state, "negative queue depth");
+      break;
+    case 'f':
+      values->test_file = arg;
+      break;
 
     case ARGP_KEY_INIT:
       state->child_inputs[0] = state->input;
@@ -80,6 +94,7 @@ parse_opt (int key, char *arg, struct argp_state *state)
         return ENOMEM;
       state->hook = values;
       memset (values, 0, sizeof *values);
+      values->queue_depth = rumpdisk_queue_depth;
       break;
 
     case ARGP_KEY_SUCCESS:
@@ -87,6 +102,8 @@ parse_opt (int key, char *arg, struct argp_state *state)
       _hurd_host_priv = values->host_priv;
       _hurd_device_master = values->dev_master;
       bootstrap_resume_task = values->next_task;
+      rumpdisk_queue_depth = values->queue_depth;
+      rumpdisk_test_file = values->test_file;
       break;
 
     default:
@@ -102,6 +102,20 @@ trivfs_S_io_read (struct trivfs_protid *cred,
   return 0;
 }
 
+/* storeio always has the data of a read at hand, so libtrivfs can do
+   io_transfer with plain io_read.  */
+static error_t
+read_hook (struct trivfs_protid *cred, data_t *data,
+	   mach_msg_type_number_t *datalen, loff_t offs, vm_size_t amount)
+{
+  return trivfs_S_io_read (cred, MACH_PORT_NULL, MACH_MSG_TYPE_PORT_NONE,
+			   data, datalen, offs, amount);
+}
+
+error_t (*trivfs_read_hook) (struct trivfs_protid *cred,
+			     data_t *data, mach_msg_type_number_t *datalen,
+			     loff_t offs, vm_size_t amount) = read_hook;
+
 /* Tell how much data can be read from the object without blocking for
    a "long time" (this should be the same meaning of "long time" used
    by the nonblocking flag.  */
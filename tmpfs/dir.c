@@ -24,11 +24,41 @@
 #include "tmpfs.h"
 #include <stdlib.h>
 
+/* Hash and compare functions for the per-directory name index.  Keys
+   are pointers to the NUL-terminated names.  */
+static hurd_ihash_key_t
+dirent_hash (const void *key)
+{
+  const char *name = key;
+  return (hurd_ihash_key_t) hurd_ihash_hash32 (name, strlen (name), 0);
+}
+
+static int
+dirent_compare (const void *key1, const void *key2)
+{
+  return strcmp (key1, key2) == 0;
+}
+
+/* Release the name index of directory DN, if any.  */
+void
+tmpfs_dir_free_index (struct disknode *dn)
+{
+  if (dn->u.dir.index != 0)
+    {
+      hurd_ihash_free (dn->u.dir.index);
+      dn->u.dir.index = 0;
+    }
+}
+
 error_t
 diskfs_init_dir (struct node *dp, struct node *pdp, struct protid *cred)
 {
   dp->dn->u.dir.dotdot = pdp->dn;
   dp->dn->u.dir.entries = 0;
+  dp->dn->u.dir.tailp = &dp->dn->u.dir.entries;
+  dp->dn->u.dir.index = 0;
+  dp->dn->u.dir.cursor = 0;
+  dp->dn->u.dir.next_serial = 0;
 
   /* Increase hardlink count for parent directory */
   pdp->dn_stat.st_nlink++;
@@ -114,8 +144,17 @@ diskfs_get_directs (struct node *dp, int entry, int n,
       entp = (void *) entp + entp->d_reclen;
     }
 
-  /* Skip ahead to the desired entry.  */
-  for (d = dp->dn->u.dir.entries; i < entry && d != 0; d = d->next)
+  /* Skip ahead to the desired entry.  Sequential readers ask for the
+     entry where the previous call stopped, so resume from the cursor
+     instead of walking the list from its head.  */
+  d = dp->dn->u.dir.entries;
+  if (dp->dn->u.dir.cursor != 0
+      && i <= dp->dn->u.dir.cursor_pos && dp->dn->u.dir.cursor_pos <= entry)
+    {
+      d = dp->dn->u.dir.cursor;
+      i = dp->dn->u.dir.cursor_pos;
+    }
+  for (; i < entry && d != 0; d = d->next)
     ++i;
 
   if (i < entry)
@@ -140,6 +179,10 @@ diskfs_get_directs (struct node *dp, int entry, int n,
       entp = (void *) entp + rlen;
     }
 
+  /* Remember where to continue.  */
+  dp->dn->u.dir.cursor = d;
+  dp->dn->u.dir.cursor_pos = i;
+
   *datacnt = (char *) entp - *data;
   *amt = i - entry;
 
@@ -149,7 +192,7 @@ diskfs_get_directs (struct node *dp, int entry, int n,
 
 struct dirstat
 {
-  struct tmpfs_dirent **prevp;
+  struct tmpfs_dirent *entry;	/* entry found by diskfs_lookup_hard */
   int dotdot;
 };
 const size_t diskfs_dirstat_size = sizeof (struct dirstat);
@@ -157,7 +200,7 @@ const size_t diskfs_dirstat_size = sizeof (struct dirstat);
 void
 diskfs_null_dirstat (struct dirstat *ds)
 {
-  ds->prevp = 0;
+  ds->entry = 0;
 }
 
 error_t
@@ -174,7 +217,7 @@ diskfs_lookup_hard (struct node *dp,
 		    struct protid *cred)
 {
   const size_t namelen = strlen (name);
-  struct tmpfs_dirent *d, **prevp;
+  struct tmpfs_dirent *d;
 
   if (type == REMOVE || type == RENAME)
     assert_backtrace (np);
@@ -225,21 +268,21 @@ diskfs_lookup_hard (struct node *dp,
 	}
     }
 
-  for (d = *(prevp = &dp->dn->u.dir.entries); d != 0;
-       d = *(prevp = &d->next))
-    if (d->namelen == namelen && !memcmp (d->name, name, namelen))
-      {
-	if (ds)
-	  ds->prevp = prevp;
-
-	if (np)
-	  return diskfs_cached_lookup ((ino_t) (uintptr_t) d->dn, np);
-	else
-	  return 0;
-      }
+  d = 0;
+  if (dp->dn->u.dir.index != 0)
+    d = hurd_ihash_find (dp->dn->u.dir.index, (hurd_ihash_key_t) name);
 
   if (ds)
-    ds->prevp = prevp;
+    ds->entry = d;
+
+  if (d != 0)
+    {
+      if (np)
+	return diskfs_cached_lookup ((ino_t) (uintptr_t) d->dn, np);
+      else
+	return 0;
+    }
+
   if (np)
     *np = 0;
   return ENOENT;
@@ -255,20 +298,48 @@ diskfs_direnter_hard (struct node *dp, const char *name,
   const size_t entsize
 	  = (offsetof (struct dirent, d_name[1]) + namelen + 7) & ~7;
   struct tmpfs_dirent *new;
+  error_t err;
 
   if (round_page (tmpfs_space_used + entsize) / vm_page_size
       > tmpfs_page_limit)
     return ENOSPC;
 
+  if (dp->dn->u.dir.index == 0)
+    {
+      err = hurd_ihash_create (&dp->dn->u.dir.index,
+			       offsetof (struct tmpfs_dirent, locp));
+      if (err)
+	return ENOSPC;
+      hurd_ihash_set_gki (dp->dn->u.dir.index, dirent_hash, dirent_compare);
+    }
+
   new = malloc (offsetof (struct tmpfs_dirent, name) + namelen + 1);
   if (new == 0)
     return ENOSPC;
 
-  new->next = 0;
   new->dn = np->dn;
+  new->serial = dp->dn->u.dir.next_serial++;
   new->namelen = namelen;
   memcpy (new->name, name, namelen + 1);
-  *ds->prevp = new;
+
+  err = hurd_ihash_add (dp->dn->u.dir.index,
+			(hurd_ihash_key_t) new->name, new);
+  if (err)
+    {
+      free (new);
+      return ENOSPC;
+    }
+
+  /* The root directory is not set up by diskfs_init_dir.  */
+  if (dp->dn->u.dir.tailp == 0)
+    dp->dn->u.dir.tailp = &dp->dn->u.dir.entries;
+
+  /* Append, so that the entry numbers seen by readers (and the readdir
+     cursor) stay valid.  */
+  new->next = 0;
+  new->prevp = dp->dn->u.dir.tailp;
+  *new->prevp = new;
+  dp->dn->u.dir.tailp = &new->next;
 
   dp->dn_stat.st_size += entsize;
   adjust_used (entsize);
@@ -286,7 +357,7 @@ diskfs_dirrewrite_hard (struct node *dp, struct node *np,
   if (ds->dotdot)
     dp->dn->u.dir.dotdot = np->dn;
   else
-    (*ds->prevp)->dn = np->dn;
+    ds->entry->dn = np->dn;
 
   return 0;
 }
@@ -294,11 +365,26 @@ diskfs_dirrewrite_hard (struct node *dp, struct node *np,
 error_t
 diskfs_dirremove_hard (struct node *dp, struct dirstat *ds)
 {
-  struct tmpfs_dirent *d = *ds->prevp;
+  struct tmpfs_dirent *d = ds->entry;
   const size_t entsize
 	  = (offsetof (struct dirent, d_name[1]) + d->namelen + 7) & ~7;
 
-  *ds->prevp = d->next;
+  hurd_ihash_locp_remove (dp->dn->u.dir.index, d->locp);
+
+  *d->prevp = d->next;
+  if (d->next != 0)
+    d->next->prevp = d->prevp;
+  else
+    dp->dn->u.dir.tailp = d->prevp;
+
+  /* Entry numbers after D have shifted down by one.  Keep the cursor
+     on the entry it numbers, so that removing the entries just read,
+     as rm -r does, doesn't make the next read walk from the head.  */
+  if (dp->dn->u.dir.cursor == d)
+    dp->dn->u.dir.cursor = d->next;
+  else if (dp->dn->u.dir.cursor != 0
+	   && d->serial < dp->dn->u.dir.cursor->serial)
+    dp->dn->u.dir.cursor_pos--;
 
   if (dp->dirmod_reqs != 0)
     diskfs_notice_dirchange (dp, DIR_CHANGED_UNLINK, d->name);
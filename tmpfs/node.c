@@ -21,9 +21,11 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <sys/param.h>
 #include <mach/mach4.h>
 #include <hurd/hurd_types.h>
 #include <hurd/store.h>
+#include <hurd/pager.h>
 #include "default_pager_U.h"
 #include "libdiskfs/fs_S.h"
 
@@ -79,9 +81,11 @@ diskfs_free_node (struct node *np, mode_t mode)
 	vm_deallocate (mach_task_self (), np->dn->u.reg.memref, 4096);
 	mach_port_deallocate (mach_task_self (), np->dn->u.reg.memobj);
       }	
+      free (np->dn->u.reg.inline_data);
       break;
     case DT_DIR:
       assert_backtrace (np->dn->u.dir.entries == 0);
+      tmpfs_dir_free_index (np->dn);
       break;
     case DT_LNK:
       free (np->dn->u.lnk);
@@ -135,7 +139,7 @@ diskfs_node_norefs (struct node *np)
 	}
     }
 
-  free (np);
+  diskfs_dealloc_node (np);
 }
 
 static void
@@ -409,6 +413,49 @@ read_symlink_hook (struct node *np, char *target)
 error_t (*diskfs_read_symlink_hook)(struct node *np, char *target)
      = read_symlink_hook;
 
+/* Small regular files keep their contents in the disknode, so that
+   neither a memory object nor a page fault is needed to access them.
+   Once a file grows past TMPFS_INLINE_MAX or is mapped,
+   diskfs_get_filemap moves the contents into a memory object.  */
+static error_t
+rdwr_hook (struct node *np, char *data, off_t offset, size_t *amt, int dir)
+{
+  struct disknode *const dn = np->dn;
+
+  if (dn->type != DT_REG || dn->u.reg.memobj != MACH_PORT_NULL
+      || offset + *amt > TMPFS_INLINE_MAX)
+    return EINVAL;
+
+  if (dir)
+    {
+      if (offset + *amt > dn->u.reg.inline_len)
+	{
+	  char *new = realloc (dn->u.reg.inline_data, offset + *amt);
+	  if (new == 0)
+	    return ENOSPC;
+	  /* Zero the hole, if any, between the old end and OFFSET.  */
+	  if (offset > dn->u.reg.inline_len)
+	    memset (new + dn->u.reg.inline_len, 0,
+		    offset - dn->u.reg.inline_len);
+	  dn->u.reg.inline_data = new;
+	  dn->u.reg.inline_len = offset + *amt;
+	}
+      memcpy (dn->u.reg.inline_data + offset, data, *amt);
+    }
+  else
+    {
+      size_t n = 0;
+      if (offset < dn->u.reg.inline_len)
+	n = MIN (*amt, dn->u.reg.inline_len - offset);
+      memcpy (data, dn->u.reg.inline_data + offset, n);
+      memset (data + n, 0, *amt - n);
+    }
+
+  return 0;
+}
+error_t (*diskfs_rdwr_hook)(struct node *np, char *data, off_t offset,
+			    size_t *amt, int dir) = rdwr_hook;
+
 void
 diskfs_write_disknode (struct node *np, int wait)
 {
@@ -449,7 +496,12 @@ diskfs_truncate (struct node *np, off_t size)
 
   assert_backtrace (np->dn->type == DT_REG);
 
-  if (default_pager == MACH_PORT_NULL)
+  if (np->dn->u.reg.memobj == MACH_PORT_NULL)
+    {
+      if (np->dn->u.reg.inline_len > size)
+	np->dn->u.reg.inline_len = size;
+    }
+  else if (default_pager == MACH_PORT_NULL)
     return EIO;
 
   np->dn_stat.st_size = size;
@@ -498,7 +550,8 @@ diskfs_grow (struct node *np, off_t size, struct protid *cred)
       / vm_page_size > tmpfs_page_limit)
     return ENOSPC;
 
-  if (default_pager == MACH_PORT_NULL)
+  /* Files small enough to be kept inline do not need the pager.  */
+  if (default_pager == MACH_PORT_NULL && set_size > TMPFS_INLINE_MAX)
     return EIO;
 
   if (np->dn->u.reg.memobj != MACH_PORT_NULL)
@@ -561,6 +614,27 @@ diskfs_get_filemap (struct node *np, vm_prot_t prot)
 	      np->dn->u.reg.memobj, 0, 0, VM_PROT_NONE, VM_PROT_NONE,
 	      VM_INHERIT_NONE);
       assert_perror_backtrace (err);
+
+      /* Move inline contents into the new object, in one go.  */
+      if (np->dn->u.reg.inline_data != 0)
+	{
+	  size_t len = np->dn->u.reg.inline_len;
+	  err = pager_memcpy (0, np->dn->u.reg.memobj, 0,
+			      np->dn->u.reg.inline_data, &len,
+			      VM_PROT_READ | VM_PROT_WRITE);
+	  if (err)
+	    {
+	      /* Keep the inline copy authoritative.  */
+	      vm_deallocate (mach_task_self (), np->dn->u.reg.memref, 4096);
+	      mach_port_deallocate (mach_task_self (), np->dn->u.reg.memobj);
+	      np->dn->u.reg.memobj = MACH_PORT_NULL;
+	      errno = err;
+	      return MACH_PORT_NULL;
+	    }
+	  free (np->dn->u.reg.inline_data);
+	  np->dn->u.reg.inline_data = 0;
+	  np->dn->u.reg.inline_len = 0;
+	}
     }
 
   if (prot & VM_PROT_WRITE)
@@ -49,6 +49,7 @@ int diskfs_shortcut_chrdev = 1;
 int diskfs_shortcut_blkdev = 1;
 int diskfs_shortcut_fifo = 1;
 int diskfs_shortcut_ifsock = 1;
+int diskfs_slab_nodes = 1;
 
 struct node *diskfs_root_node;
 mach_port_t default_pager;
@@ -21,6 +21,7 @@ the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.  */
 #define _tmpfs_h 1
 
 #include <hurd/diskfs.h>
+#include <hurd/ihash.h>
 #include <sys/types.h>
 #include <dirent.h>
 #include <stdint.h>
@@ -49,11 +50,23 @@ struct disknode
       mach_port_t memobj, ro_memobj;
       vm_address_t memref;
       unsigned int allocpages;	/* largest size while memobj was live */
+      /* Contents of a small file that has no memory object yet.  */
+      char *inline_data;	/* malloc'd, INLINE_LEN bytes valid */
+      size_t inline_len;
     } reg;
     struct
     {
-      struct tmpfs_dirent *entries;
+      /* Entries in creation order; new ones are appended at *TAILP.  */
+      struct tmpfs_dirent *entries, **tailp;
       struct disknode *dotdot;
+      /* Name index over ENTRIES, created on the first diskfs_direnter.  */
+      struct hurd_ihash *index;
+      /* Where the last diskfs_get_directs call stopped: CURSOR is the
+	 entry with number CURSOR_POS (counting . and ..), or null.  */
+      struct tmpfs_dirent *cursor;
+      int cursor_pos;
+      /* The serial number of the next entry made.  */
+      unsigned long next_serial;
     } dir;
     dev_t chr, blk;
   } u;
@@ -63,15 +76,24 @@ struct disknode
 
 struct tmpfs_dirent
 {
-  struct tmpfs_dirent *next;
+  struct tmpfs_dirent *next, **prevp;
+  hurd_ihash_locp_t locp;	/* slot in the directory's name index */
   struct disknode *dn;
+  unsigned long serial;		/* increases along the list */
   uint8_t namelen;
   char name[0];
 };
 
+/* Regular files no larger than this keep their contents in the
+   disknode until they grow past it or are mapped.  */
+#define TMPFS_INLINE_MAX	1024
+
 extern off_t tmpfs_page_limit;
 extern mach_port_t default_pager;
 
+/* Release the name index of directory DN, if any.  */
+void tmpfs_dir_free_index (struct disknode *dn);
+
 /* These two must be accessed using atomic operations.  */
 extern unsigned int num_files;
 extern off_t tmpfs_space_used;
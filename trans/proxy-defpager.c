@@ -63,6 +63,14 @@ S_default_pager_info (mach_port_t default_pager, default_pager_info_t *info)
     ?: default_pager_info (real_defpager, info);
 }
 
+kern_return_t
+S_default_pager_paging_stats (mach_port_t default_pager,
+			      default_pager_paging_stats_t *stats)
+{
+  return allowed (default_pager, O_READ)
+    ?: default_pager_paging_stats (real_defpager, stats);
+}
+
 kern_return_t
 S_default_pager_storage_info (mach_port_t default_pager,
 			      vm_size_array_t *size,
@@ -49,12 +49,17 @@ pthread_cond_t open_alert;
 /* Wakeup for select */
 pthread_cond_t select_alert;
 
+/* Our control port, for telling io_notify_request registrations.  */
+static struct trivfs_control *streamdev_cntl;
+
 /* Bucket for all out ports */
 struct port_bucket *streamdev_bucket;
 
 /* The buffers we use */
 struct buffer *input_buffer, *output_buffer;
 
+static void select_wakeup (void);
+
 
 /* Information about a buffer.  */
 struct buffer
@@ -114,7 +119,7 @@ clear_buffer (struct buffer *b)
     return;
   b->head = b->tail = b->buf;
   pthread_cond_broadcast (b->wait);
-  pthread_cond_broadcast (&select_alert);
+  select_wakeup ();
 }
 
 /* Read up to LEN bytes from B to DATA, returning the amount actually read.  */
@@ -139,7 +144,7 @@ buffer_read (struct buffer *b, void *data, size_t len)
     }
 
   pthread_cond_broadcast (b->wait);
-  pthread_cond_broadcast (&select_alert);
+  select_wakeup ();
   return len;
 }
 
@@ -156,10 +161,47 @@ buffer_write (struct buffer *b, const void *data, size_t len)
   b->tail += len;
 
   pthread_cond_broadcast (b->wait);
-  pthread_cond_broadcast (&select_alert);
+  select_wakeup ();
   return len;
 }
 
+/* Return which of SELECT_READ and SELECT_WRITE can be done without
+   blocking.  GLOBAL_LOCK must be held.  */
+static int
+buffers_ready (void)
+{
+  int ready = 0;
+
+  if (input_buffer && buffer_readable (input_buffer))
+    ready |= SELECT_READ;
+  if (output_buffer && buffer_writable (output_buffer))
+    ready |= SELECT_WRITE;
+  return ready;
+}
+
+/* Wake up the threads waiting in io_select, and send io_ready to those
+   registered with io_notify_request.  GLOBAL_LOCK must be held.  */
+static void
+select_wakeup (void)
+{
+  pthread_cond_broadcast (&select_alert);
+  if (streamdev_cntl)
+    trivfs_notify_ready (streamdev_cntl, buffers_ready ());
+}
+
+static int
+ready_hook (struct trivfs_control *cntl)
+{
+  int ready;
+
+  pthread_mutex_lock (&global_lock);
+  ready = buffers_ready ();
+  pthread_mutex_unlock (&global_lock);
+  return ready;
+}
+
+int (*trivfs_ready_hook) (struct trivfs_control *cntl) = ready_hook;
+
 
 /* Open a new device structure for the device NAME with MODE. If an error
    occurs, the error code is returned, otherwise 0.  */
@@ -318,6 +360,7 @@ main (int argc, char *argv[])
     input_buffer = create_buffer (256);
   if (trivfs_allow_open & O_WRITE)
     output_buffer = create_buffer (256);
+  streamdev_cntl = fsys;
 
   /* Launch */
   ports_manage_port_operations_multithread (streamdev_bucket, demuxer,
@@ -1070,7 +1113,7 @@ device_read_reply_inband (mach_port_t reply, kern_return_t errorcode,
 	  data += nwritten;
 	  datalen -= nwritten;
 	  pthread_cond_broadcast (input_buffer->wait);
-	  pthread_cond_broadcast (&select_alert);
+	  select_wakeup ();
 	}
     }
   else
@@ -1174,7 +1217,7 @@ device_write_reply_inband (mach_port_t reply, kern_return_t returncode, int amou
 	{
 	  npending_output = 0;
 	  pthread_cond_broadcast (output_buffer->wait);
-	  pthread_cond_broadcast (&select_alert);
+	  select_wakeup ();
 	}
       else
 	{
@@ -0,0 +1,199 @@
+/* Show the per-RPC statistics gathered by a libports server.
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with the GNU Hurd.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <mach.h>
+#include <hurd.h>
+#include <hurd/ports.h>
+#include <argp.h>
+#include <errno.h>
+#include <error.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <version.h>
+
+#include "msgids.h"
+#include "rpcstats_U.h"
+
+const char *argp_program_version = STANDARD_HURD_VERSION (rpcprof);
+
+#define OPT_PROC	-1
+
+static const struct argp_option options[] =
+{
+  {"enable", 'e', 0, 0, "Start gathering statistics"},
+  {"disable", 'd', 0, 0, "Stop gathering statistics"},
+  {"reset", 'r', 0, 0, "Forget the statistics gathered so far"},
+  {"histogram", 'H', 0, 0, "Print a latency histogram for each message id"},
+  {"proc", OPT_PROC, 0, 0, "Query the proc server instead of a FILE"},
+  {0}
+};
+
+static const char args_doc[] = "FILE";
+static const char doc[] = "Show which RPCs a server spends its time on."
+"\vFILE names a node served by the server (usually the node it is"
+" attached to).  Statistics are only gathered after --enable.  Without"
+" any of --enable, --disable or --reset, the statistics are printed."
+" The server only answers root.";
+
+static bool show_histogram;
+
+/* Sort by the total time spent handling the RPCs, then by count.  */
+static int
+compare_stats (const void *a, const void *b)
+{
+  const struct ports_rpc_stat *x = a, *y = b;
+
+  if (x->total_ns != y->total_ns)
+    return x->total_ns < y->total_ns ? 1 : -1;
+  if (x->count != y->count)
+    return x->count < y->count ? 1 : -1;
+  return x->msg_id < y->msg_id ? -1 : x->msg_id > y->msg_id;
+}
+
+static void
+print_histogram (const struct ports_rpc_stat *s)
+{
+  uint64_t peak = 0;
+  int i, lo, hi;
+
+  for (lo = 0; lo < PORTS_RPC_STAT_BUCKETS && s->histogram[lo] == 0; lo++)
+    ;
+  for (hi = PORTS_RPC_STAT_BUCKETS - 1; hi >= lo && s->histogram[hi] == 0; hi--)
+    ;
+  for (i = lo; i <= hi; i++)
+    if (s->histogram[i] > peak)
+      peak = s->histogram[i];
+
+  for (i = lo; i <= hi; i++)
+    printf ("  %10" PRIu64 " us %10" PRIu64 " %.*s\n",
+	    (uint64_t) 1 << i, s->histogram[i],
+	    (int) (s->histogram[i] * 50 / peak),
+	    "##################################################");
+}
+
+static void
+report (struct ports_rpc_stat *stats, size_t n)
+{
+  size_t i;
+
+  qsort (stats, n, sizeof *stats, compare_stats);
+
+  printf ("%-30s %10s %12s %10s %10s %10s\n",
+	  "RPC", "count", "total ms", "avg us", "max us", "queue us");
+  for (i = 0; i < n; i++)
+    {
+      const struct ports_rpc_stat *s = &stats[i];
+      const struct msgid_info *info = msgid_info (s->msg_id);
+      char idbuf[16];
+      const char *name = info ? info->name : idbuf;
+
+      if (! info)
+	snprintf (idbuf, sizeof idbuf, "%" PRIu32, (uint32_t) s->msg_id);
+
+      printf ("%-30s %10" PRIu64 " %12.3f %10.1f %10.1f %10.1f\n",
+	      name, s->count, s->total_ns / 1e6,
+	      s->count ? s->total_ns / 1e3 / s->count : 0.,
+	      s->max_ns / 1e3,
+	      s->count ? s->queue_ns / 1e3 / s->count : 0.);
+
+      if (show_histogram && s->count)
+	print_histogram (s);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  const char *file = NULL;
+  bool use_proc = false;
+  int flags = 0;
+  mach_port_t server;
+  data_t data = NULL;
+  mach_msg_type_number_t data_len = 0;
+  error_t err;
+
+  error_t parse_opt (int key, char *arg, struct argp_state *state)
+    {
+      switch (key)
+	{
+	case 'e': flags |= RPCSTATS_ENABLE; break;
+	case 'd': flags |= RPCSTATS_DISABLE; break;
+	case 'r': flags |= RPCSTATS_RESET; break;
+	case 'H': show_histogram = true; break;
+	case OPT_PROC: use_proc = true; break;
+
+	case ARGP_KEY_ARG:
+	  if (file || use_proc)
+	    argp_usage (state);
+	  file = arg;
+	  break;
+
+	case ARGP_KEY_END:
+	  if (!file && !use_proc)
+	    argp_usage (state);
+	  if ((flags & RPCSTATS_ENABLE) && (flags & RPCSTATS_DISABLE))
+	    argp_error (state, "--enable and --disable are exclusive");
+	  break;
+
+	default:
+	  return ARGP_ERR_UNKNOWN;
+	}
+      return 0;
+    }
+  const struct argp_child children[] =
+    {
+      { .argp=&msgid_argp, },
+      { 0 }
+    };
+  const struct argp argp = { options, parse_opt, args_doc, doc, children };
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+
+  if (use_proc)
+    server = getproc ();
+  else
+    server = file_name_lookup (file, 0, 0);
+  if (! MACH_PORT_VALID (server))
+    error (1, errno, "%s", use_proc ? "getproc" : file);
+
+  if (flags)
+    {
+      err = rpcstats_control (server, flags);
+      if (err)
+	error (1, err, "%s", use_proc ? "proc" : file);
+    }
+  else
+    {
+      err = rpcstats_get (server, &data, &data_len);
+      if (err)
+	error (1, err, "%s", use_proc ? "proc" : file);
+
+      report ((struct ports_rpc_stat *) data,
+	      data_len / sizeof (struct ports_rpc_stat));
+      munmap (data, data_len);
+    }
+
+  mach_port_deallocate (mach_task_self (), server);
+  return 0;
+}
@@ -0,0 +1,248 @@
+/* Summarize binary traces written by rpctrace --binary.
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with the GNU Hurd.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <mach.h>
+#include <hurd.h>
+#include <hurd/ihash.h>
+#include <argp.h>
+#include <errno.h>
+#include <error.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <version.h>
+
+#include "msgids.h"
+#include "rpctrace-binary.h"
+
+const char *argp_program_version = STANDARD_HURD_VERSION (rpcstat);
+
+static const struct argp_option options[] =
+{
+  {"histogram", 'H', 0, 0, "Print a latency histogram for each message id."},
+  {0}
+};
+
+static const char args_doc[] = "FILE";
+static const char doc[] = "Summarize a binary trace written by rpctrace "
+"--binary: call counts, message sizes and reply latencies per message id.";
+
+/* Latencies are counted in power of two buckets of nanoseconds: bucket
+   N holds latencies in [2^N, 2^(N+1)).  */
+#define BUCKETS 40
+
+struct msgid_stat
+{
+  uint32_t msgid;
+  uint64_t calls;		/* All requests.  */
+  uint64_t replies;		/* Requests whose reply was seen.  */
+  uint64_t bytes;		/* Request and reply bytes.  */
+  uint64_t total;		/* Sum of reply latencies.  */
+  uint64_t min, max;
+  uint64_t histogram[BUCKETS];
+};
+
+static struct hurd_ihash stats = HURD_IHASH_INITIALIZER (HURD_IHASH_NO_LOCP);
+static bool show_histogram;
+
+static struct msgid_stat *
+get_stat (uint32_t msgid)
+{
+  struct msgid_stat *s = hurd_ihash_find (&stats, msgid);
+  if (s == NULL)
+    {
+      error_t err;
+
+      s = calloc (1, sizeof *s);
+      if (s == NULL)
+	error (1, errno, "calloc");
+      s->msgid = msgid;
+      s->min = UINT64_MAX;
+      err = hurd_ihash_add (&stats, msgid, s);
+      if (err)
+	error (1, err, "hurd_ihash_add");
+    }
+  return s;
+}
+
+static void
+account (const struct rpctrace_record *r)
+{
+  struct msgid_stat *s = get_stat (r->msgid);
+
+  s->calls++;
+  s->bytes += r->size + r->reply_size;
+  if (r->latency != RPCTRACE_NO_REPLY)
+    {
+      int bucket = r->latency ? 63 - __builtin_clzll (r->latency) : 0;
+      if (bucket >= BUCKETS)
+	bucket = BUCKETS - 1;
+
+      s->replies++;
+      s->total += r->latency;
+      if (r->latency < s->min)
+	s->min = r->latency;
+      if (r->latency > s->max)
+	s->max = r->latency;
+      s->histogram[bucket]++;
+    }
+}
+
+/* Sort by the total time spent waiting for replies, then by calls.  */
+static int
+compare_stats (const void *a, const void *b)
+{
+  const struct msgid_stat *x = *(struct msgid_stat *const *) a;
+  const struct msgid_stat *y = *(struct msgid_stat *const *) b;
+
+  if (x->total != y->total)
+    return x->total < y->total ? 1 : -1;
+  if (x->calls != y->calls)
+    return x->calls < y->calls ? 1 : -1;
+  return x->msgid < y->msgid ? -1 : x->msgid > y->msgid;
+}
+
+static void
+print_histogram (const struct msgid_stat *s)
+{
+  uint64_t peak = 0;
+  int i, lo, hi;
+
+  for (lo = 0; lo < BUCKETS && s->histogram[lo] == 0; lo++)
+    ;
+  for (hi = BUCKETS - 1; hi >= lo && s->histogram[hi] == 0; hi--)
+    ;
+  for (i = lo; i <= hi; i++)
+    if (s->histogram[i] > peak)
+      peak = s->histogram[i];
+
+  for (i = lo; i <= hi; i++)
+    printf ("  %12" PRIu64 " ns %10" PRIu64 " %.*s\n",
+	    (uint64_t) 1 << i, s->histogram[i],
+	    (int) (s->histogram[i] * 50 / peak),
+	    "##################################################");
+}
+
+static void
+report (void)
+{
+  struct msgid_stat **all;
+  size_t n = 0, i;
+
+  all = calloc (stats.nr_items ?: 1, sizeof *all);
+  if (all == NULL)
+    error (1, errno, "calloc");
+  HURD_IHASH_ITERATE (&stats, value)
+    all[n++] = value;
+  qsort (all, n, sizeof *all, compare_stats);
+
+  printf ("%-30s %10s %10s %12s %10s %10s %10s\n",
+	  "RPC", "calls", "replies", "bytes", "avg us", "min us", "max us");
+  for (i = 0; i < n; i++)
+    {
+      const struct msgid_stat *s = all[i];
+      const struct msgid_info *info = msgid_info (s->msgid);
+      char idbuf[16];
+      const char *name = info ? info->name : idbuf;
+
+      if (! info)
+	snprintf (idbuf, sizeof idbuf, "%" PRIu32, s->msgid);
+
+      if (s->replies)
+	printf ("%-30s %10" PRIu64 " %10" PRIu64 " %12" PRIu64
+		" %10.1f %10.1f %10.1f\n",
+		name, s->calls, s->replies, s->bytes,
+		s->total / 1e3 / s->replies, s->min / 1e3, s->max / 1e3);
+      else
+	printf ("%-30s %10" PRIu64 " %10" PRIu64 " %12" PRIu64
+		" %10s %10s %10s\n",
+		name, s->calls, s->replies, s->bytes, "-", "-", "-");
+
+      if (show_histogram && s->replies)
+	print_histogram (s);
+    }
+
+  free (all);
+}
+
+int
+main (int argc, char **argv)
+{
+  const char *file = NULL;
+  struct rpctrace_header header;
+  struct rpctrace_record records[1024];
+  size_t n;
+  FILE *in;
+
+  error_t parse_opt (int key, char *arg, struct argp_state *state)
+    {
+      switch (key)
+	{
+	case 'H':
+	  show_histogram = true;
+	  break;
+
+	case ARGP_KEY_ARG:
+	  if (file)
+	    argp_usage (state);
+	  file = arg;
+	  break;
+
+	case ARGP_KEY_NO_ARGS:
+	  argp_usage (state);
+	  return EINVAL;
+
+	default:
+	  return ARGP_ERR_UNKNOWN;
+	}
+      return 0;
+    }
+  const struct argp_child children[] =
+    {
+      { .argp=&msgid_argp, },
+      { 0 }
+    };
+  const struct argp argp = { options, parse_opt, args_doc, doc, children };
+
+  argp_parse (&argp, argc, argv, 0, 0, 0);
+
+  in = strcmp (file, "-") ? fopen (file, "r") : stdin;
+  if (in == NULL)
+    error (1, errno, "%s", file);
+
+  if (fread (&header, sizeof header, 1, in) != 1
+      || memcmp (header.magic, RPCTRACE_MAGIC, sizeof header.magic))
+    error (1, 0, "%s: not an rpctrace binary trace", file);
+  if (header.version != RPCTRACE_VERSION
+      || header.record_size != sizeof records[0])
+    error (1, 0, "%s: unsupported trace version %" PRIu32,
+	   file, header.version);
+
+  while ((n = fread (records, sizeof records[0],
+		     sizeof records / sizeof records[0], in)) > 0)
+    for (size_t i = 0; i < n; i++)
+      account (&records[i]);
+  if (ferror (in))
+    error (1, errno, "%s", file);
+
+  report ();
+  return 0;
+}
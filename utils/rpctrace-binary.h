@@ -0,0 +1,53 @@
+/* Binary trace format written by rpctrace --binary and read by rpcstat.
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNU Hurd.
+
+   The GNU Hurd is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation; either version 2, or (at
+   your option) any later version.
+
+   The GNU Hurd is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with the GNU Hurd.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef _HURD_RPCTRACE_BINARY_H_
+#define _HURD_RPCTRACE_BINARY_H_
+
+#include <stdint.h>
+
+/* A trace file starts with this header, followed by any number of
+   records, all in the byte order of the tracing machine.  */
+struct rpctrace_header
+{
+  char magic[8];		/* RPCTRACE_MAGIC */
+  uint32_t version;		/* RPCTRACE_VERSION */
+  uint32_t record_size;		/* sizeof (struct rpctrace_record) */
+};
+
+#define RPCTRACE_MAGIC		"RPCTRACE"
+#define RPCTRACE_VERSION	1
+
+/* One record is written per message that is not a reply.  For RPCs
+   whose reply was seen, it is written when the reply arrives.  */
+struct rpctrace_record
+{
+  uint64_t time;		/* Nanoseconds from the start of the trace
+				   until the message was forwarded.  */
+  uint64_t latency;		/* Nanoseconds until the reply was
+				   forwarded, or RPCTRACE_NO_REPLY.  */
+  uint32_t msgid;		/* Request message id.  */
+  uint32_t port;		/* rpctrace's name for the destination.  */
+  uint32_t size;		/* Size of the request message.  */
+  uint32_t reply_size;		/* Size of the reply message, or 0.  */
+};
+
+#define RPCTRACE_NO_REPLY	UINT64_MAX
+
+#endif	/* _HURD_RPCTRACE_BINARY_H_ */
@@ -38,8 +38,10 @@
 #include <stddef.h>
 #include <argz.h>
 #include <envz.h>
+#include <time.h>
 
 #include "msgids.h"
+#include "rpctrace-binary.h"
 
 /* Should match MiG's desired_complex_alignof */
 #define MSG_ALIGNMENT __alignof__(uintptr_t)
@@ -48,10 +50,17 @@ const char *argp_program_version = STANDARD_HURD_VERSION (rpctrace);
 
 static unsigned strsize = 80;
 
+/* If set, write fixed-size binary records instead of decoding messages.  */
+static bool binary_mode;
+
 static const struct argp_option options[] =
 {
   {"output", 'o', "FILE", 0, "Send trace output to FILE instead of stderr."},
   {0, 's', "SIZE", 0, "Specify the maximum string size to print (the default is 80)."},
+  {"binary", 'b', 0, 0,
+   "Write a compact binary trace of message ids, sizes and reply latencies "
+   "to the --output FILE instead of printing messages; use rpcstat to "
+   "analyze it."},
   {0, 'E', "var[=value]", 0,
    "Set/change (var=value) or remove (var) an environment variable among the "
    "ones inherited by the executed process."},
@@ -182,6 +191,9 @@ struct req_info
   mach_port_t reply_port;
   task_t from;
   task_t to;
+  uint64_t time;		/* When the request was forwarded.  */
+  mach_msg_size_t size;		/* Size of the request.  */
+  mach_port_t port;		/* Our name for the destination.  */
   struct req_info *next;
 };
 
@@ -861,7 +873,7 @@ print_contents (mach_msg_header_t *inp,
 
       if (first)
 	first = 0;
-      else
+      else if (!binary_mode)
 	putc (' ', ostream);
 
       /* Note that MACH_MSG_TYPE_PORT_NAME does not indicate a port right.
@@ -893,6 +905,12 @@ print_contents (mach_msg_header_t *inp,
 
 	      str = rewrite_right (port_name, &newtypes[i], req);
 
+	      if (i > 0 && newtypes[i] != newtypes[0])
+		poly = 1;
+
+	      if (binary_mode)
+		continue;
+
 	      putc ((i == 0 && nelt > 1) ? '{' : ' ', ostream);
 
 	      if (*port_name == MACH_PORT_NULL)
@@ -906,10 +924,8 @@ print_contents (mach_msg_header_t *inp,
 		  else
 		    fprintf (ostream, "%3u", (unsigned int) *port_name);
 		}
-	      if (i > 0 && newtypes[i] != newtypes[0])
-		poly = 1;
 	    }
-	  if (nelt > 1)
+	  if (nelt > 1 && !binary_mode)
 	    putc ('}', ostream);
 
 	  if (poly)
@@ -974,7 +990,7 @@ print_contents (mach_msg_header_t *inp,
 		type->msgt_name = newtypes[0];
 	    }
 	}
-      else
+      else if (!binary_mode)
 	print_data (name, data, nelt, eltsize);
     }
 }
@@ -1123,6 +1139,133 @@ is_notification (const mach_msg_header_t *InHeadP)
   return 1;
 }
 
+/*** Binary output ***/
+
+/* In binary mode, the tracing thread only appends fixed-size records
+   to this ring, and a separate thread writes them out in large
+   batches, so that tracing does not wait for stdio or the filesystem.
+   If the writer falls behind, records are dropped and counted.  */
+#define RING_SIZE 8192		/* Must be a power of two.  */
+static struct rpctrace_record ring[RING_SIZE];
+static unsigned long ring_head;	/* Next record to fill.  */
+static unsigned long ring_tail;	/* Next record to write out.  */
+static unsigned long ring_dropped;
+static bool ring_done;
+static pthread_mutex_t ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ring_wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_t ring_writer;
+static struct timespec trace_start;
+
+/* Return the number of nanoseconds since the trace started.  */
+static uint64_t
+trace_clock (void)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (uint64_t) (now.tv_sec - trace_start.tv_sec) * 1000000000
+    + now.tv_nsec - trace_start.tv_nsec;
+}
+
+static void
+binary_record (uint64_t time, uint64_t latency, mach_msg_id_t msgid,
+	       mach_port_t port, mach_msg_size_t size,
+	       mach_msg_size_t reply_size)
+{
+  struct rpctrace_record *r;
+
+  pthread_mutex_lock (&ring_lock);
+  if (ring_head - ring_tail == RING_SIZE)
+    {
+      ring_dropped++;
+      pthread_mutex_unlock (&ring_lock);
+      return;
+    }
+  r = &ring[ring_head % RING_SIZE];
+  r->time = time;
+  r->latency = latency;
+  r->msgid = msgid;
+  r->port = port;
+  r->size = size;
+  r->reply_size = reply_size;
+  /* Only wake the writer once a batch has accumulated.  */
+  if (++ring_head - ring_tail == RING_SIZE / 4)
+    pthread_cond_signal (&ring_wakeup);
+  pthread_mutex_unlock (&ring_lock);
+}
+
+static void *
+binary_writer_function (void *arg)
+{
+  pthread_mutex_lock (&ring_lock);
+  for (;;)
+    {
+      unsigned long head = ring_head, tail = ring_tail;
+
+      if (head == tail)
+	{
+	  struct timespec deadline;
+
+	  if (ring_done)
+	    break;
+	  /* Write out stragglers at least every second.  */
+	  clock_gettime (CLOCK_REALTIME, &deadline);
+	  deadline.tv_sec += 1;
+	  pthread_cond_timedwait (&ring_wakeup, &ring_lock, &deadline);
+	  continue;
+	}
+
+      /* The records between TAIL and HEAD are ours until we advance
+	 ring_tail; write them without holding the lock.  */
+      pthread_mutex_unlock (&ring_lock);
+      while (tail != head)
+	{
+	  unsigned long n = head - tail;
+	  if (tail % RING_SIZE + n > RING_SIZE)
+	    n = RING_SIZE - tail % RING_SIZE;
+	  if (fwrite (&ring[tail % RING_SIZE], sizeof ring[0], n, ostream) != n)
+	    error (1, errno, "writing trace");
+	  tail += n;
+	}
+      pthread_mutex_lock (&ring_lock);
+      ring_tail = tail;
+    }
+  pthread_mutex_unlock (&ring_lock);
+
+  fflush (ostream);
+  return NULL;
+}
+
+static void
+binary_start (void)
+{
+  struct rpctrace_header header = { .version = RPCTRACE_VERSION,
+				    .record_size = sizeof ring[0] };
+  error_t err;
+
+  memcpy (header.magic, RPCTRACE_MAGIC, sizeof header.magic);
+  if (fwrite (&header, sizeof header, 1, ostream) != 1)
+    error (1, errno, "writing trace");
+
+  clock_gettime (CLOCK_MONOTONIC, &trace_start);
+  err = pthread_create (&ring_writer, NULL, binary_writer_function, NULL);
+  if (err)
+    error (1, err, "pthread_create");
+}
+
+/* Write out the remaining records and stop the writer thread.  */
+static void
+binary_finish (void)
+{
+  pthread_mutex_lock (&ring_lock);
+  ring_done = true;
+  pthread_cond_signal (&ring_wakeup);
+  pthread_mutex_unlock (&ring_lock);
+  pthread_join (ring_writer, NULL);
+
+  if (ring_dropped)
+    error (0, 0, "%lu records dropped", ring_dropped);
+}
+
 int
 trace_and_forward (mach_msg_header_t *inp, mach_msg_header_t *outp)
 {
@@ -1313,11 +1456,21 @@ trace_and_forward (mach_msg_header_t *inp, mach_msg_header_t *outp)
 	  req->is_req = FALSE;
 	  /* This sure looks like an RPC reply message.  */
 	  mig_reply_header_t *rh = (void *) inp;
-	  print_reply_header ((struct send_once_info *) info, rh, req);
-	  putc (' ', ostream);
-	  fflush (ostream);
-	  print_contents (&rh->Head, rh + 1, req);
-	  putc ('\n', ostream);
+	  if (binary_mode)
+	    {
+	      binary_record (req->time, trace_clock () - req->time,
+			     req->req_id, req->port, req->size,
+			     inp->msgh_size);
+	      print_contents (&rh->Head, rh + 1, req);
+	    }
+	  else
+	    {
+	      print_reply_header ((struct send_once_info *) info, rh, req);
+	      putc (' ', ostream);
+	      fflush (ostream);
+	      print_contents (&rh->Head, rh + 1, req);
+	      putc ('\n', ostream);
+	    }
 
 	  if (inp->msgh_id == 2161)/* the reply message for thread_create */
 	    wrap_new_thread (inp, req);
@@ -1333,7 +1486,8 @@ trace_and_forward (mach_msg_header_t *inp, mach_msg_header_t *outp)
 	  struct req_info *req = NULL;
 
 	  /* Print something about the message header.  */
-	  print_request_header ((struct sender_info *) info, inp);
+	  if (!binary_mode)
+	    print_request_header ((struct sender_info *) info, inp);
 	  /* It's a notification message. */
 	  if (inp->msgh_id <= 72 && inp->msgh_id >= 64)
 	    {
@@ -1350,13 +1504,29 @@ trace_and_forward (mach_msg_header_t *inp, mach_msg_header_t *outp)
 	  else
 	    to = SEND_INFO (info)->receive_right->task;
 	  if (info->type == MACH_MSG_TYPE_MOVE_SEND)
-	    req = add_request (inp->msgh_id, reply_port,
-			       SEND_INFO (info)->task, to);
+	    {
+	      req = add_request (inp->msgh_id, reply_port,
+				 SEND_INFO (info)->task, to);
+	      req->port = info->pi.port_right;
+	      req->size = inp->msgh_size;
+	      if (binary_mode)
+		req->time = trace_clock ();
+	    }
 
 	  /* If it's the notification message, req is NULL.
 	   * TODO again, it's difficult to handle mach_notify_port_destroyed */
 	  print_contents (inp, inp + 1, req);
-	  if (inp->msgh_local_port == MACH_PORT_NULL) /* simpleroutine */
+	  if (binary_mode)
+	    {
+	      /* Anything we will not see a reply for is recorded now.  */
+	      if (inp->msgh_local_port == MACH_PORT_NULL || req == NULL)
+		binary_record (trace_clock (), RPCTRACE_NO_REPLY,
+			       inp->msgh_id, info->pi.port_right,
+			       inp->msgh_size, 0);
+	      if (inp->msgh_local_port == MACH_PORT_NULL)
+		free (remove_request (inp->msgh_id, reply_port));
+	    }
+	  else if (inp->msgh_local_port == MACH_PORT_NULL) /* simpleroutine */
 	    {
 	      /* If it's a simpleroutine,
 	       * we don't need the request information any more. */
@@ -1367,7 +1537,8 @@ trace_and_forward (mach_msg_header_t *inp, mach_msg_header_t *outp)
 	  else
 	    /* Leave a partial line that will be finished later.  */
 	    fprintf (ostream, ")");
-	  fflush (ostream);
+	  if (!binary_mode)
+	    fflush (ostream);
 
 	  /* If it's the first request from the traced task,
 	   * wrap the all threads in the task. */
@@ -1730,6 +1901,10 @@ main (int argc, char **argv, char **envp)
 	  strsize = atoi (arg);
 	  break;
 
+	case 'b':
+	  binary_mode = true;
+	  break;
+
 	case 'E':
 	  if (envz == NULL)
 	    {
@@ -1782,6 +1957,9 @@ main (int argc, char **argv, char **envp)
   /* Parse our arguments.  */
   argp_parse (&argp, argc, argv, ARGP_IN_ORDER, 0, 0);
 
+  if (binary_mode && !outfile)
+    error (1, 0, "--binary requires --output");
+
   err = mach_port_allocate (mach_task_self (), MACH_PORT_RIGHT_DEAD_NAME,
 			    &unknown_task);
   assert_perror_backtrace (err);
@@ -1794,7 +1972,10 @@ main (int argc, char **argv, char **envp)
     }
   else
     ostream = stderr;
-  setlinebuf (ostream);
+  if (binary_mode)
+    binary_start ();
+  else
+    setlinebuf (ostream);
 
   traced_bucket = ports_create_bucket ();
   traced_class = ports_create_class (&traced_clean, NULL);
@@ -1833,16 +2014,20 @@ main (int argc, char **argv, char **envp)
   {
     pid_t child, pid;
     int status;
+    FILE *statusstream = binary_mode ? stderr : ostream;
     child = traced_spawn (cmd_argv, cmd_envp);
     pid = waitpid (child, &status, 0);
     sleep (1);			/* XXX gives other thread time to print */
+    if (binary_mode)
+      binary_finish ();
     if (pid != child)
       error (1, errno, "waitpid");
     if (WIFEXITED (status))
-      fprintf (ostream, "Child %d exited with %d\n",
+      fprintf (statusstream, "Child %d exited with %d\n",
 	       pid, WEXITSTATUS (status));
     else
-      fprintf (ostream, "Child %d %s\n", pid, strsignal (WTERMSIG (status)));
+      fprintf (statusstream, "Child %d %s\n",
+	       pid, strsignal (WTERMSIG (status)));
   }
   
   ports_destroy_right (notify_pi);